@@ -275,7 +275,8 @@ void unbuffer(FILE *fp);
         OPT_S_NOSSL3, OPT_S_NOTLS1, OPT_S_NOTLS1_1, OPT_S_NOTLS1_2, \
         OPT_S_BUGS, OPT_S_NOCOMP, OPT_S_ECDHSINGLE, OPT_S_NOTICKET, \
         OPT_S_SERVERPREF, OPT_S_LEGACYRENEG, OPT_S_LEGACYCONN, \
-        OPT_S_ONRESUMP, OPT_S_NOLEGACYCONN, OPT_S_STRICT, OPT_S_SIGALGS, \
+        OPT_S_ONRESUMP, OPT_S_NOLEGACYCONN, OPT_S_STRICT, OPT_S_PRIORITIZECHACHA, \
+        OPT_S_SIGALGS, \
         OPT_S_CLIENTSIGALGS, OPT_S_CURVES, OPT_S_NAMEDCURVE, OPT_S_CIPHER, \
         OPT_S_DHPARAM, OPT_S_DEBUGBROKE, \
         OPT_S__LAST
@@ -295,6 +296,8 @@ void unbuffer(FILE *fp);
         {"no_resumption_on_reneg", OPT_S_ONRESUMP, '-' }, \
         {"no_legacy_server_connect", OPT_S_NOLEGACYCONN, '-' }, \
         {"strict", OPT_S_STRICT, '-' }, \
+        {"prioritize_chacha", OPT_S_PRIORITIZECHACHA, '-', \
+            "Prefer ChaCha20-Poly1305 if the client lists it first" }, \
         {"sigalgs", OPT_S_SIGALGS, 's', \
             "Signature algorithms to support (colon-separated list)" }, \
         {"client_sigalgs", OPT_S_CLIENTSIGALGS, 's', \
@@ -324,6 +327,7 @@ void unbuffer(FILE *fp);
         case OPT_S_ONRESUMP: \
         case OPT_S_NOLEGACYCONN: \
         case OPT_S_STRICT: \
+        case OPT_S_PRIORITIZECHACHA: \
         case OPT_S_SIGALGS: \
         case OPT_S_CLIENTSIGALGS: \
         case OPT_S_CURVES: \
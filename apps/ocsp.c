@@ -94,9 +94,57 @@
 #  endif
 # endif
 
+# ifndef HAVE_FORK
+#  if defined(OPENSSL_SYS_VMS) || defined(OPENSSL_SYS_WINDOWS) || defined(OPENSSL_SYS_OS2) || defined(OPENSSL_SYS_NETWARE)
+#   define HAVE_FORK 0
+#  else
+#   define HAVE_FORK 1
+#  endif
+# endif
+
+# if HAVE_FORK
+#  undef NO_FORK
+#  include <errno.h>
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+# else
+#  define NO_FORK
+# endif
+
 /* Maximum leeway in validity period: default 5 minutes */
 # define MAX_VALIDITY_PERIOD    (5 * 60)
 
+/* How often to sign again with -presign if responses have no nextUpdate */
+# define PRESIGN_PERIOD         (60 * 60)
+
+/* How soon to try again if signing with -presign failed */
+# define PRESIGN_RETRY          60
+
+/* A response signed ahead of time, keyed by the CertID it answers */
+typedef struct presigned_st {
+    unsigned char *key;
+    int keylen;
+    unsigned char *resp;
+    int resplen;
+} PRESIGNED;
+
+DECLARE_LHASH_OF(PRESIGNED);
+
+# ifndef NO_FORK
+/*
+ * With -presign and responder processes, the parent signs the responses
+ * again and writes them to |presign_file|, then bumps |presign_gen|, which
+ * is shared with the responders.  |presigned_gen| is the version a process
+ * has loaded.
+ */
+static char *presign_file = NULL;
+static volatile unsigned long *presign_gen = NULL;
+static unsigned long presigned_gen = 0;
+static pid_t presign_owner = 0;
+# endif
+
 static int add_ocsp_cert(OCSP_REQUEST **req, X509 *cert,
                          const EVP_MD *cert_id_md, X509 *issuer,
                          STACK_OF(OCSP_CERTID) *ids);
@@ -114,10 +162,36 @@ static void make_ocsp_response(OCSP_RESPONSE **resp, OCSP_REQUEST *req,
                               int nmin, int ndays, int badsig);
 
 static char **lookup_serial(CA_DB *db, ASN1_INTEGER *ser);
+static LHASH_OF(PRESIGNED) *presign_responses(CA_DB *db, X509 *ca,
+                                              X509 *rcert, EVP_PKEY *rkey,
+                                              const EVP_MD *rmd,
+                                              STACK_OF(X509) *rother,
+                                              unsigned long flags, int nmin,
+                                              int ndays, int badsig,
+                                              const EVP_MD *cert_id_md);
+static PRESIGNED *presigned_lookup(LHASH_OF(PRESIGNED) *presigned,
+                                   OCSP_REQUEST *req);
+static void presigned_free(LHASH_OF(PRESIGNED) *presigned);
+static int presign_again(LHASH_OF(PRESIGNED) **presigned, CA_DB **db,
+                         char *dbfile, X509 *ca, X509 *rcert,
+                         EVP_PKEY *rkey, const EVP_MD *rmd,
+                         STACK_OF(X509) *rother, unsigned long flags,
+                         int nmin, int ndays, int badsig,
+                         const EVP_MD *cert_id_md);
+static void reload_index(CA_DB **db, char *dbfile);
 static BIO *init_responder(const char *port);
 static int do_responder(OCSP_REQUEST **preq, BIO **pcbio, BIO *acbio,
                         const char *port);
 static int send_ocsp_response(BIO *cbio, OCSP_RESPONSE *resp);
+static int send_presigned(BIO *cbio, const PRESIGNED *ps);
+# ifndef NO_FORK
+static int spawn_responders(int multi);
+static int wait_responders(time_t until);
+static int presign_share(void);
+static void presign_unlink(int sig);
+static int presigned_write(LHASH_OF(PRESIGNED) *presigned, const char *file);
+static LHASH_OF(PRESIGNED) *presigned_read(const char *file);
+# endif
 static OCSP_RESPONSE *query_responder(BIO *cbio, const char *host,
                                       const char *path,
                                       const STACK_OF(CONF_VALUE) *headers,
@@ -136,7 +210,7 @@ typedef enum OPTION_choice {
     OPT_VALIDITY_PERIOD, OPT_STATUS_AGE, OPT_SIGNKEY, OPT_REQOUT,
     OPT_RESPOUT, OPT_PATH, OPT_ISSUER, OPT_CERT, OPT_SERIAL,
     OPT_INDEX, OPT_CA, OPT_NMIN, OPT_REQUEST, OPT_NDAYS, OPT_RSIGNER,
-    OPT_RKEY, OPT_ROTHER, OPT_RMD, OPT_HEADER,
+    OPT_RKEY, OPT_ROTHER, OPT_RMD, OPT_HEADER, OPT_PRESIGN, OPT_MULTI,
     OPT_V_ENUM,
     OPT_MD
 } OPTION_CHOICE;
@@ -210,6 +284,11 @@ OPTIONS ocsp_options[] = {
     {"rother", OPT_ROTHER, '<', "Other certificates to include in response"},
     {"rmd", OPT_RMD, 's'},
     {"header", OPT_HEADER, 's', "key=value header to add"},
+    {"presign", OPT_PRESIGN, '-',
+     "Sign responses for all certificates in the index ahead of time"},
+# ifndef NO_FORK
+    {"multi", OPT_MULTI, 'p', "Run this many responder processes"},
+# endif
     {"", OPT_MD, '-', "Any supported digest"},
     OPT_V_OPTIONS,
     {NULL}
@@ -245,6 +324,14 @@ int ocsp_main(int argc, char **argv)
     int accept_count = -1, add_nonce = 1, noverify = 0, use_ssl = -1;
     int vpmtouched = 0, badsig = 0, i, ignore_err = 0, nmin = 0, ndays = -1;
     int req_text = 0, resp_text = 0, req_timeout = -1, ret = 1;
+    int presign = 0;
+# ifndef NO_FORK
+    int multi = 0;
+# endif
+    LHASH_OF(PRESIGNED) *presigned = NULL;
+    PRESIGNED *ps;
+    time_t presign_refresh = 0;
+    long presign_period = PRESIGN_PERIOD;
     long nsec = MAX_VALIDITY_PERIOD, maxage = -1;
     unsigned long sign_flags = 0, verify_flags = 0, rflags = 0;
     OPTION_CHOICE o;
@@ -466,6 +553,14 @@ int ocsp_main(int argc, char **argv)
             if (!opt_md(opt_arg(), &rsign_md))
                 goto end;
             break;
+        case OPT_PRESIGN:
+            presign = 1;
+            break;
+        case OPT_MULTI:
+# ifndef NO_FORK
+            multi = atoi(opt_arg());
+# endif
+            break;
         case OPT_HEADER:
             header = opt_arg();
             value = strchr(header, '=');
@@ -543,6 +638,55 @@ int ocsp_main(int argc, char **argv)
         if (!rkey)
             goto end;
     }
+
+    if (presign) {
+        if (!ridx_filename || !rkey || !rsigner || !rca_cert) {
+            BIO_printf(bio_err,
+                       "Need an index, responder certificate, key and CA for -presign!\n");
+            goto end;
+        }
+        rdb = load_index(ridx_filename, NULL);
+        if (!rdb || !index_index(rdb))
+            goto end;
+        /* Sign again when half of the validity period has passed */
+        if (ndays != -1 && nmin * 60L + ndays * 24 * 3600L >= 2)
+            presign_period = (nmin * 60L + ndays * 24 * 3600L) / 2;
+        presigned = presign_responses(rdb, rca_cert, rsigner, rkey, rsign_md,
+                                      rother, rflags, nmin, ndays, badsig,
+                                      cert_id_md);
+        if (!presigned)
+            goto end;
+        presign_refresh = time(NULL) + presign_period;
+    }
+
+# ifndef NO_FORK
+    /*
+     * With -presign the requests are served by child processes, so that
+     * the parent can sign new responses ahead of time without holding up
+     * requests, and do so once for all of them.
+     */
+    if (acbio && (multi > 1 || presigned)) {
+        if (presigned && !presign_share())
+            goto end;
+        if (!spawn_responders(multi > 1 ? multi : 1)) {
+            if (presigned) {
+                signal(SIGINT, presign_unlink);
+                signal(SIGTERM, presign_unlink);
+            }
+            while (wait_responders(presigned ? presign_refresh : 0)) {
+                if (presign_again(&presigned, &rdb, ridx_filename, rca_cert,
+                                  rsigner, rkey, rsign_md, rother, rflags,
+                                  nmin, ndays, badsig, cert_id_md))
+                    presign_refresh = time(NULL) + presign_period;
+                else
+                    presign_refresh = time(NULL) + PRESIGN_RETRY;
+            }
+            ret = 0;
+            goto end;
+        }
+    }
+# endif
+
     if (acbio)
         BIO_printf(bio_err, "Waiting for OCSP client connections...\n");
 
@@ -620,9 +764,39 @@ int ocsp_main(int argc, char **argv)
             goto end;
     }
 
+# ifndef NO_FORK
+    if (presigned && presign_gen != NULL && *presign_gen != presigned_gen) {
+        /* The parent has signed new responses: switch to them */
+        unsigned long gen = *presign_gen;
+        LHASH_OF(PRESIGNED) *newps = presigned_read(presign_file);
+
+        if (newps != NULL) {
+            reload_index(&rdb, ridx_filename);
+            presigned_free(presigned);
+            presigned = newps;
+        } else {
+            BIO_printf(bio_err,
+                       "Error reading new OCSP responses, using the old ones\n");
+        }
+        presigned_gen = gen;
+    }
+# endif
+
     if (rdb) {
-        make_ocsp_response(&resp, req, rdb, rca_cert, rsigner, rkey,
+        if (presigned && (ps = presigned_lookup(presigned, req)) != NULL) {
+            const unsigned char *p = ps->resp;
+
+            if (cbio && !respout && !resp_text) {
+                send_presigned(cbio, ps);
+                goto next_request;
+            }
+            resp = d2i_OCSP_RESPONSE(NULL, &p, ps->resplen);
+            if (!resp)
+                goto end;
+        } else {
+            make_ocsp_response(&resp, req, rdb, rca_cert, rsigner, rkey,
                                rsign_md, rother, rflags, nmin, ndays, badsig);
+        }
         if (cbio)
             send_ocsp_response(cbio, resp);
     } else if (host) {
@@ -674,8 +848,26 @@ int ocsp_main(int argc, char **argv)
     if (resp_text)
         OCSP_RESPONSE_print(out, resp, 0);
 
+ next_request:
+
     /* If running as responder don't verify our own response */
     if (cbio) {
+        /*
+         * Without a parent process to do it, sign again between requests.
+         * The old responses stay in use if that fails.
+         */
+        if (presigned && time(NULL) >= presign_refresh
+# ifndef NO_FORK
+            && (presign_file == NULL || getpid() == presign_owner)
+# endif
+            ) {
+            if (presign_again(&presigned, &rdb, ridx_filename, rca_cert,
+                              rsigner, rkey, rsign_md, rother, rflags,
+                              nmin, ndays, badsig, cert_id_md))
+                presign_refresh = time(NULL) + presign_period;
+            else
+                presign_refresh = time(NULL) + PRESIGN_RETRY;
+        }
         /* If not unlimited, see if we took all we should. */
         if (accept_count != -1 && --accept_count <= 0) {
             ret = 0;
@@ -756,6 +948,12 @@ int ocsp_main(int argc, char **argv)
     X509_free(rsigner);
     X509_free(rca_cert);
     free_index(rdb);
+    presigned_free(presigned);
+# ifndef NO_FORK
+    if (presign_file != NULL && getpid() == presign_owner)
+        unlink(presign_file);
+    OPENSSL_free(presign_file);
+# endif
     BIO_free_all(cbio);
     BIO_free_all(acbio);
     BIO_free(out);
@@ -1017,6 +1215,263 @@ static char **lookup_serial(CA_DB *db, ASN1_INTEGER *ser)
     return rrow;
 }
 
+/*
+ * The table key for a CertID: the hash algorithm followed by the issuer
+ * name hash, issuer key hash and serial number, each with its length. This
+ * does not depend on how the hash algorithm parameters were encoded.
+ */
+static int certid_key(OCSP_CERTID *cid, unsigned char **pkey)
+{
+    ASN1_OCTET_STRING *namehash, *keyhash;
+    ASN1_OBJECT *md;
+    ASN1_INTEGER *serial;
+    ASN1_STRING *parts[3];
+    unsigned char *key, *p;
+    int i, len, nid;
+
+    OCSP_id_get0_info(&namehash, &md, &keyhash, &serial, cid);
+    nid = OBJ_obj2nid(md);
+    parts[0] = namehash;
+    parts[1] = keyhash;
+    parts[2] = serial;
+    len = 4;
+    for (i = 0; i < 3; i++) {
+        if (ASN1_STRING_length(parts[i]) > 0xffff)
+            return 0;
+        len += 2 + ASN1_STRING_length(parts[i]);
+    }
+    if ((key = OPENSSL_malloc(len)) == NULL)
+        return 0;
+
+    p = key;
+    *p++ = (unsigned char)(nid >> 24);
+    *p++ = (unsigned char)(nid >> 16);
+    *p++ = (unsigned char)(nid >> 8);
+    *p++ = (unsigned char)nid;
+    for (i = 0; i < 3; i++) {
+        *p++ = (unsigned char)(ASN1_STRING_length(parts[i]) >> 8);
+        *p++ = (unsigned char)ASN1_STRING_length(parts[i]);
+        memcpy(p, ASN1_STRING_data(parts[i]), ASN1_STRING_length(parts[i]));
+        p += ASN1_STRING_length(parts[i]);
+    }
+    *pkey = key;
+    return len;
+}
+
+static unsigned long presigned_hash(const PRESIGNED *a)
+{
+    unsigned long h = 2166136261UL;
+    int i;
+
+    /* FNV-1a: the key is mostly hash output already */
+    for (i = 0; i < a->keylen; i++)
+        h = ((h ^ a->key[i]) * 16777619UL) & 0xffffffffUL;
+    return h;
+}
+
+static int presigned_cmp(const PRESIGNED *a, const PRESIGNED *b)
+{
+    if (a->keylen != b->keylen)
+        return a->keylen - b->keylen;
+    return memcmp(a->key, b->key, a->keylen);
+}
+
+static void presigned_doall(PRESIGNED *ps)
+{
+    OPENSSL_free(ps->key);
+    OPENSSL_free(ps->resp);
+    OPENSSL_free(ps);
+}
+
+static IMPLEMENT_LHASH_HASH_FN(presigned, PRESIGNED)
+static IMPLEMENT_LHASH_COMP_FN(presigned, PRESIGNED)
+static IMPLEMENT_LHASH_DOALL_FN(presigned, PRESIGNED)
+
+static void presigned_free(LHASH_OF(PRESIGNED) *presigned)
+{
+    if (presigned == NULL)
+        return;
+    LHM_lh_doall(PRESIGNED, presigned, LHASH_DOALL_FN(presigned));
+    LHM_lh_free(PRESIGNED, presigned);
+}
+
+/* Store the encoding of |resp| as the answer for |cid| */
+static int presigned_add(LHASH_OF(PRESIGNED) *presigned, OCSP_CERTID *cid,
+                         OCSP_RESPONSE *resp)
+{
+    PRESIGNED *ps, *old;
+    unsigned char *p;
+
+    if ((ps = OPENSSL_zalloc(sizeof(*ps))) == NULL)
+        return 0;
+    if ((ps->keylen = certid_key(cid, &ps->key)) <= 0
+        || (ps->resplen = i2d_OCSP_RESPONSE(resp, NULL)) <= 0
+        || (ps->resp = OPENSSL_malloc(ps->resplen)) == NULL)
+        goto err;
+    p = ps->resp;
+    i2d_OCSP_RESPONSE(resp, &p);
+
+    old = LHM_lh_insert(PRESIGNED, presigned, ps);
+    if (old != NULL)
+        presigned_doall(old);
+    else if (LHM_lh_error(PRESIGNED, presigned) > 0)
+        goto err;
+    return 1;
+ err:
+    presigned_doall(ps);
+    return 0;
+}
+
+/*
+ * Sign a response for each valid or revoked certificate in |db| ahead of
+ * time, for CertIDs hashed with SHA-1 (which clients almost always use) and
+ * with |cert_id_md| if that is different. These responses carry no nonce.
+ */
+static LHASH_OF(PRESIGNED) *presign_responses(CA_DB *db, X509 *ca,
+                                              X509 *rcert, EVP_PKEY *rkey,
+                                              const EVP_MD *rmd,
+                                              STACK_OF(X509) *rother,
+                                              unsigned long flags, int nmin,
+                                              int ndays, int badsig,
+                                              const EVP_MD *cert_id_md)
+{
+    LHASH_OF(PRESIGNED) *presigned;
+    const EVP_MD *mds[2];
+    OCSP_REQUEST *req = NULL;
+    OCSP_RESPONSE *resp = NULL;
+    OCSP_CERTID *cid;
+    ASN1_INTEGER *serial = NULL;
+    BIGNUM *bn = NULL;
+    int i, j, nmds = 0, num = 0;
+
+    mds[nmds++] = EVP_sha1();
+    if (cert_id_md != NULL && EVP_MD_type(cert_id_md) != NID_sha1)
+        mds[nmds++] = cert_id_md;
+
+    presigned = LHM_lh_new(PRESIGNED, presigned);
+    if (presigned == NULL)
+        goto err;
+
+    for (i = 0; i < sk_OPENSSL_PSTRING_num(db->db->data); i++) {
+        OPENSSL_STRING *row = sk_OPENSSL_PSTRING_value(db->db->data, i);
+
+        if (row[DB_type][0] != DB_TYPE_VAL && row[DB_type][0] != DB_TYPE_REV)
+            continue;
+        if (!BN_hex2bn(&bn, row[DB_serial])
+            || (serial = BN_to_ASN1_INTEGER(bn, serial)) == NULL)
+            goto err;
+
+        for (j = 0; j < nmds; j++) {
+            /* Answer a request for just this certificate, as a client would */
+            cid = OCSP_cert_id_new(mds[j], X509_get_subject_name(ca),
+                                   X509_get0_pubkey_bitstr(ca), serial);
+            if ((req = OCSP_REQUEST_new()) == NULL || cid == NULL
+                || !OCSP_request_add0_id(req, cid)) {
+                OCSP_CERTID_free(cid);
+                goto err;
+            }
+            make_ocsp_response(&resp, req, db, ca, rcert, rkey, rmd, rother,
+                               flags, nmin, ndays, badsig);
+            if (resp == NULL
+                || OCSP_response_status(resp)
+                   != OCSP_RESPONSE_STATUS_SUCCESSFUL
+                || !presigned_add(presigned, cid, resp))
+                goto err;
+            OCSP_RESPONSE_free(resp);
+            resp = NULL;
+            OCSP_REQUEST_free(req);
+            req = NULL;
+            num++;
+        }
+    }
+
+    BIO_printf(bio_err, "Signed %d OCSP responses in advance\n", num);
+    BN_free(bn);
+    ASN1_INTEGER_free(serial);
+    return presigned;
+
+ err:
+    BIO_printf(bio_err, "Error signing OCSP responses in advance\n");
+    ERR_print_errors(bio_err);
+    OCSP_RESPONSE_free(resp);
+    OCSP_REQUEST_free(req);
+    BN_free(bn);
+    ASN1_INTEGER_free(serial);
+    presigned_free(presigned);
+    return NULL;
+}
+
+/* Find the response signed in advance for |req|, if there is one */
+static PRESIGNED *presigned_lookup(LHASH_OF(PRESIGNED) *presigned,
+                                   OCSP_REQUEST *req)
+{
+    PRESIGNED tmp, *ps;
+
+    /* Only requests about a single certificate are answered in advance */
+    if (OCSP_request_onereq_count(req) != 1)
+        return NULL;
+    tmp.keylen = certid_key(OCSP_onereq_get0_id(OCSP_request_onereq_get0(req,
+                                                                         0)),
+                            &tmp.key);
+    if (tmp.keylen <= 0)
+        return NULL;
+    ps = LHM_lh_retrieve(PRESIGNED, presigned, &tmp);
+    OPENSSL_free(tmp.key);
+    return ps;
+}
+
+/* Read |dbfile| again into |*db|, keeping the old index if that fails */
+static void reload_index(CA_DB **db, char *dbfile)
+{
+    CA_DB *newdb = load_index(dbfile, NULL);
+
+    if (newdb != NULL && index_index(newdb)) {
+        free_index(*db);
+        *db = newdb;
+    } else {
+        BIO_printf(bio_err, "Error reloading index, using the old one\n");
+        free_index(newdb);
+    }
+}
+
+/*
+ * Read the index again, to pick up any certificates added or revoked since
+ * the last time, and sign new responses from it.  On success they replace
+ * |*presigned| and are handed to any responder processes.  On failure the
+ * error is reported and the old responses are left in place.
+ */
+static int presign_again(LHASH_OF(PRESIGNED) **presigned, CA_DB **db,
+                         char *dbfile, X509 *ca, X509 *rcert,
+                         EVP_PKEY *rkey, const EVP_MD *rmd,
+                         STACK_OF(X509) *rother, unsigned long flags,
+                         int nmin, int ndays, int badsig,
+                         const EVP_MD *cert_id_md)
+{
+    LHASH_OF(PRESIGNED) *newps;
+
+    reload_index(db, dbfile);
+    newps = presign_responses(*db, ca, rcert, rkey, rmd, rother, flags,
+                              nmin, ndays, badsig, cert_id_md);
+# ifndef NO_FORK
+    if (newps != NULL && presign_file != NULL) {
+        if (!presigned_write(newps, presign_file)) {
+            BIO_printf(bio_err, "Error writing %s\n", presign_file);
+            presigned_free(newps);
+            newps = NULL;
+        } else {
+            presigned_gen = ++*presign_gen;
+        }
+    }
+# endif
+    if (newps == NULL) {
+        BIO_printf(bio_err, "Keeping the OCSP responses signed before\n");
+        return 0;
+    }
+    presigned_free(*presigned);
+    *presigned = newps;
+    return 1;
+}
+
 /* Quick and dirty OCSP server: read in and parse input request */
 
 static BIO *init_responder(const char *port)
@@ -1178,6 +1633,226 @@ static int send_ocsp_response(BIO *cbio, OCSP_RESPONSE *resp)
     return 1;
 }
 
+/* Send a response signed in advance as it is, without decoding it */
+static int send_presigned(BIO *cbio, const PRESIGNED *ps)
+{
+    char http_resp[] =
+        "HTTP/1.0 200 OK\r\nContent-type: application/ocsp-response\r\n"
+        "Content-Length: %d\r\n\r\n";
+    if (!cbio)
+        return 0;
+    BIO_printf(cbio, http_resp, ps->resplen);
+    BIO_write(cbio, ps->resp, ps->resplen);
+    (void)BIO_flush(cbio);
+    return 1;
+}
+
+# ifndef NO_FORK
+/*
+ * Fork |multi| responder processes that all accept connections on the
+ * listening socket. Returns 1 in each child and, once they have all
+ * finished, 0 in the parent.
+ */
+static int spawn_responders(int multi)
+{
+    int n;
+
+    for (n = 0; n < multi; n++) {
+        (void)BIO_flush(bio_err);
+        switch (fork()) {
+        case -1:
+            BIO_printf(bio_err, "fork failure\n");
+            /* Serve with the processes we have */
+            if (n == 0)
+                return 1;
+            n = multi;
+            break;
+        case 0:
+            return 1;
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Wait for the responder processes to exit.  Returns 0 once they all have,
+ * or 1 as soon as the time |until| has come if it is not 0.
+ */
+static int wait_responders(time_t until)
+{
+    int status;
+    pid_t pid;
+
+    for (;;) {
+        pid = waitpid(-1, &status, until != 0 ? WNOHANG : 0);
+        if (pid > 0 || (pid < 0 && errno == EINTR))
+            continue;
+        if (pid < 0)
+            return 0;
+        if (time(NULL) >= until)
+            return 1;
+        sleep(1);
+    }
+}
+
+/*
+ * Set up the file and the counter through which the parent hands newly
+ * signed responses to the responder processes.  The responses signed at
+ * startup are inherited across fork().
+ */
+static int presign_share(void)
+{
+    const char *dir = getenv("TMPDIR");
+    void *gen;
+    int fd;
+
+    if (dir == NULL || *dir == '\0')
+        dir = "/tmp";
+    gen = mmap(NULL, sizeof(*presign_gen), PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_ANON, -1, 0);
+    if (gen == MAP_FAILED) {
+        BIO_printf(bio_err, "Error mapping shared memory\n");
+        return 0;
+    }
+    presign_gen = gen;
+    presign_file = app_malloc(strlen(dir) + sizeof("/ocspXXXXXX"),
+                              "presign file name");
+    sprintf(presign_file, "%s/ocspXXXXXX", dir);
+    if ((fd = mkstemp(presign_file)) == -1) {
+        BIO_printf(bio_err, "Error creating %s\n", presign_file);
+        OPENSSL_free(presign_file);
+        presign_file = NULL;
+        return 0;
+    }
+    close(fd);
+    presign_owner = getpid();
+    return 1;
+}
+
+/* Remove the file shared with the responders if the parent is killed */
+static void presign_unlink(int sig)
+{
+    unlink(presign_file);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+typedef struct presigned_out_st {
+    BIO *out;
+    int err;
+} PRESIGNED_OUT;
+
+static void put_len(unsigned char *p, int len)
+{
+    p[0] = (unsigned char)(len >> 24);
+    p[1] = (unsigned char)(len >> 16);
+    p[2] = (unsigned char)(len >> 8);
+    p[3] = (unsigned char)len;
+}
+
+static int get_len(const unsigned char *p)
+{
+    return ((int)p[0] << 24) | ((int)p[1] << 16) | ((int)p[2] << 8) | p[3];
+}
+
+static void presigned_write_doall_arg(PRESIGNED *ps, PRESIGNED_OUT *po)
+{
+    unsigned char lens[8];
+
+    put_len(lens, ps->keylen);
+    put_len(lens + 4, ps->resplen);
+    if (BIO_write(po->out, lens, 8) != 8
+        || BIO_write(po->out, ps->key, ps->keylen) != ps->keylen
+        || BIO_write(po->out, ps->resp, ps->resplen) != ps->resplen)
+        po->err = 1;
+}
+
+static IMPLEMENT_LHASH_DOALL_ARG_FN(presigned_write, PRESIGNED, PRESIGNED_OUT)
+
+/*
+ * Write |presigned| to a new file and rename it to |file|, so that a
+ * responder reading |file| sees either the old or the new responses.  Each
+ * entry is the key length, response length, key and response.
+ */
+static int presigned_write(LHASH_OF(PRESIGNED) *presigned, const char *file)
+{
+    PRESIGNED_OUT po;
+    char *tmp;
+    int fd;
+
+    tmp = app_malloc(strlen(file) + sizeof("XXXXXX"), "presign file name");
+    sprintf(tmp, "%sXXXXXX", file);
+    if ((fd = mkstemp(tmp)) == -1) {
+        OPENSSL_free(tmp);
+        return 0;
+    }
+    po.err = 0;
+    if ((po.out = BIO_new_fd(fd, BIO_CLOSE)) == NULL) {
+        close(fd);
+        po.err = 1;
+    } else {
+        LHM_lh_doall_arg(PRESIGNED, presigned,
+                         LHASH_DOALL_ARG_FN(presigned_write), PRESIGNED_OUT,
+                         &po);
+        if (BIO_flush(po.out) <= 0)
+            po.err = 1;
+        BIO_free(po.out);
+    }
+    if (po.err || rename(tmp, file) != 0) {
+        unlink(tmp);
+        OPENSSL_free(tmp);
+        return 0;
+    }
+    OPENSSL_free(tmp);
+    return 1;
+}
+
+/* Read the responses written by presigned_write() */
+static LHASH_OF(PRESIGNED) *presigned_read(const char *file)
+{
+    LHASH_OF(PRESIGNED) *presigned = NULL;
+    PRESIGNED *ps = NULL, *old;
+    unsigned char lens[8];
+    BIO *in;
+    int n;
+
+    if ((in = BIO_new_file(file, "rb")) == NULL
+        || (presigned = LHM_lh_new(PRESIGNED, presigned)) == NULL)
+        goto err;
+    while ((n = BIO_read(in, lens, 8)) == 8) {
+        if ((ps = OPENSSL_zalloc(sizeof(*ps))) == NULL)
+            goto err;
+        ps->keylen = get_len(lens);
+        ps->resplen = get_len(lens + 4);
+        if (ps->keylen <= 0 || ps->resplen <= 0
+            || (ps->key = OPENSSL_malloc(ps->keylen)) == NULL
+            || (ps->resp = OPENSSL_malloc(ps->resplen)) == NULL
+            || BIO_read(in, ps->key, ps->keylen) != ps->keylen
+            || BIO_read(in, ps->resp, ps->resplen) != ps->resplen)
+            goto err;
+        old = LHM_lh_insert(PRESIGNED, presigned, ps);
+        if (old != NULL)
+            presigned_doall(old);
+        else if (LHM_lh_error(PRESIGNED, presigned) > 0)
+            goto err;
+        ps = NULL;
+    }
+    if (n > 0)
+        goto err;
+    BIO_free(in);
+    return presigned;
+
+ err:
+    if (ps != NULL)
+        presigned_doall(ps);
+    BIO_free(in);
+    presigned_free(presigned);
+    return NULL;
+}
+# endif
+
 static OCSP_RESPONSE *query_responder(BIO *cbio, const char *host,
                                       const char *path,
                                       const STACK_OF(CONF_VALUE) *headers,
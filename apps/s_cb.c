@@ -488,7 +488,11 @@ int ssl_print_tmp_key(BIO *out, SSL *s)
                 cname = OBJ_nid2sn(nid);
             BIO_printf(out, "ECDH, %s, %d bits\n", cname, EVP_PKEY_bits(key));
         }
+        break;
 #endif
+    default:
+        BIO_printf(out, "%s, %d bits\n", OBJ_nid2sn(EVP_PKEY_id(key)),
+                   EVP_PKEY_bits(key));
     }
     EVP_PKEY_free(key);
     return 1;
@@ -1453,3 +1457,26 @@ void ssl_ctx_security_debug(SSL_CTX *ctx, int verbose)
     SSL_CTX_set_security_callback(ctx, security_callback_debug);
     SSL_CTX_set0_security_ex_data(ctx, &sdb);
 }
+
+/*
+ * Block until the async job paused on |s| can make progress again.  On
+ * Windows the wait fd is an event handle rather than something select()
+ * understands.
+ */
+void wait_for_async(SSL *s)
+{
+    OSSL_ASYNC_FD fd = SSL_get_async_wait_fd(s);
+#ifndef OPENSSL_SYS_WINDOWS
+    fd_set asyncfds;
+#endif
+
+    if (fd == OSSL_BAD_ASYNC_FD)
+        return;
+#ifdef OPENSSL_SYS_WINDOWS
+    WaitForSingleObject(fd, INFINITE);
+#else
+    FD_ZERO(&asyncfds);
+    openssl_fdset(fd, &asyncfds);
+    select(fd + 1, (void *)&asyncfds, NULL, NULL, NULL);
+#endif
+}
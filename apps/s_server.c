@@ -244,6 +244,10 @@ static int s_tlsextdebug = 0;
 static int s_tlsextstatus = 0;
 static int cert_status_cb(SSL *s, void *arg);
 static int no_resume_ephemeral = 0;
+static int async = 0;
+static size_t read_buf_len = 0;
+static long dyn_records = 0;
+static long dyn_records_timeout = -1;
 static int s_msg = 0;
 static int s_quiet = 0;
 static int s_ign_eof = 0;
@@ -402,6 +406,10 @@ static void s_server_init(void)
     s_msg = 0;
     s_quiet = 0;
     s_brief = 0;
+    async = 0;
+    read_buf_len = 0;
+    dyn_records = 0;
+    dyn_records_timeout = -1;
 #ifndef OPENSSL_NO_ENGINE
     engine_id = NULL;
 #endif
@@ -811,7 +819,8 @@ typedef enum OPTION_choice {
     OPT_DTLS1_2, OPT_TIMEOUT, OPT_MTU, OPT_CHAIN, OPT_LISTEN,
     OPT_ID_PREFIX, OPT_RAND, OPT_SERVERNAME, OPT_SERVERNAME_FATAL,
     OPT_CERT2, OPT_KEY2, OPT_NEXTPROTONEG, OPT_ALPN, OPT_JPAKE,
-    OPT_SRTP_PROFILES, OPT_KEYMATEXPORT, OPT_KEYMATEXPORTLEN,
+    OPT_SRTP_PROFILES, OPT_KEYMATEXPORT, OPT_KEYMATEXPORTLEN, OPT_ASYNC,
+    OPT_READ_BUF, OPT_DYN_RECORDS, OPT_DYN_RECORDS_TIMEOUT,
     OPT_S_ENUM,
     OPT_V_ENUM,
     OPT_X_ENUM
@@ -868,6 +877,13 @@ OPTIONS s_server_options[] = {
     {"tls1", OPT_TLS1, '-', "Just talk TLSv1"},
     {"no_resume_ephemeral", OPT_NO_RESUME_EPHEMERAL, '-',
      "Disable caching and tickets if ephemeral (EC)DH is used"},
+    {"async", OPT_ASYNC, '-', "Operate in asynchronous mode"},
+    {"read_buf", OPT_READ_BUF, 'p',
+     "Default read buffer size for connections (enables read ahead)"},
+    {"dynamic_records", OPT_DYN_RECORDS, 'p',
+     "Send small records until this many bytes of a burst are sent"},
+    {"dynamic_records_timeout", OPT_DYN_RECORDS_TIMEOUT, 'p',
+     "Milliseconds idle after which a new burst starts"},
     {"www", OPT_WWW, '-', "Respond to a 'GET /' with a status page"},
     {"WWW", OPT_UPPER_WWW, '-', "Respond to a 'GET with the file ./path"},
     {"servername", OPT_SERVERNAME, 's',
@@ -1304,6 +1320,20 @@ int s_server_main(int argc, char *argv[])
         case OPT_NO_RESUME_EPHEMERAL:
             no_resume_ephemeral = 1;
             break;
+        case OPT_ASYNC:
+            async = 1;
+            break;
+        case OPT_READ_BUF:
+            read_buf_len = atoi(opt_arg());
+            break;
+        case OPT_DYN_RECORDS:
+            if (!opt_long(opt_arg(), &dyn_records))
+                goto opthelp;
+            break;
+        case OPT_DYN_RECORDS_TIMEOUT:
+            if (!opt_long(opt_arg(), &dyn_records_timeout))
+                goto opthelp;
+            break;
 #ifndef OPENSSL_NO_PSK
         case OPT_PSK_HINT:
             psk_identity_hint = opt_arg();
@@ -1640,6 +1670,16 @@ int s_server_main(int argc, char *argv[])
     SSL_CTX_set_quiet_shutdown(ctx, 1);
     if (exc)
         ssl_ctx_set_excert(ctx, exc);
+    if (async)
+        SSL_CTX_set_mode(ctx, SSL_MODE_ASYNC);
+    if (read_buf_len > 0) {
+        SSL_CTX_set_default_read_buffer_len(ctx, read_buf_len);
+        SSL_CTX_set_read_ahead(ctx, 1);
+    }
+    if (dyn_records > 0)
+        SSL_CTX_set_dynamic_record_threshold(ctx, dyn_records);
+    if (dyn_records_timeout >= 0)
+        SSL_CTX_set_dynamic_record_timeout(ctx, dyn_records_timeout);
 
     if (state)
         SSL_CTX_set_info_callback(ctx, apps_ssl_info_callback);
@@ -1710,6 +1750,16 @@ int s_server_main(int argc, char *argv[])
         SSL_CTX_set_quiet_shutdown(ctx2, 1);
         if (exc)
             ssl_ctx_set_excert(ctx2, exc);
+        if (async)
+            SSL_CTX_set_mode(ctx2, SSL_MODE_ASYNC);
+        if (read_buf_len > 0) {
+            SSL_CTX_set_default_read_buffer_len(ctx2, read_buf_len);
+            SSL_CTX_set_read_ahead(ctx2, 1);
+        }
+        if (dyn_records > 0)
+            SSL_CTX_set_dynamic_record_threshold(ctx2, dyn_records);
+        if (dyn_records_timeout >= 0)
+            SSL_CTX_set_dynamic_record_timeout(ctx2, dyn_records_timeout);
 
         if (state)
             SSL_CTX_set_info_callback(ctx2, apps_ssl_info_callback);
@@ -1957,6 +2007,7 @@ int s_server_main(int argc, char *argv[])
     bio_s_out = NULL;
     BIO_free(bio_s_msg);
     bio_s_msg = NULL;
+    ASYNC_cleanup_thread();
     return (ret);
 }
 
@@ -2281,6 +2332,10 @@ static int sv_body(char *hostname, int s, int stype, unsigned char *context)
                 switch (SSL_get_error(con, k)) {
                 case SSL_ERROR_NONE:
                     break;
+                case SSL_ERROR_WANT_ASYNC:
+                    BIO_printf(bio_s_out, "Write BLOCK (Async)\n");
+                    wait_for_async(con);
+                    break;
                 case SSL_ERROR_WANT_WRITE:
                 case SSL_ERROR_WANT_READ:
                 case SSL_ERROR_WANT_X509_LOOKUP:
@@ -2345,6 +2400,10 @@ static int sv_body(char *hostname, int s, int stype, unsigned char *context)
                     if (SSL_pending(con))
                         goto again;
                     break;
+                case SSL_ERROR_WANT_ASYNC:
+                    BIO_printf(bio_s_out, "Read BLOCK (Async)\n");
+                    wait_for_async(con);
+                    goto again;
                 case SSL_ERROR_WANT_WRITE:
                 case SSL_ERROR_WANT_READ:
                     BIO_printf(bio_s_out, "Read BLOCK\n");
@@ -2425,6 +2484,11 @@ static int init_ssl_connection(SSL *con)
 #endif
         i = SSL_accept(con);
 
+    while (i <= 0 && SSL_waiting_for_async(con)) {
+        wait_for_async(con);
+        i = SSL_accept(con);
+    }
+
 #ifdef CERT_CB_TEST_RETRY
     {
         while (i <= 0 && SSL_get_error(con, i) == SSL_ERROR_WANT_X509_LOOKUP
@@ -2647,6 +2711,10 @@ static int www_body(char *hostname, int s, int stype, unsigned char *context)
                 goto err;
             } else {
                 BIO_printf(bio_s_out, "read R BLOCK\n");
+                if (SSL_waiting_for_async(con)) {
+                    wait_for_async(con);
+                    continue;
+                }
 #ifndef OPENSSL_NO_SRP
                 if (BIO_should_io_special(io)
                     && BIO_get_retry_reason(io) == BIO_RR_SSL_X509_LOOKUP) {
@@ -3009,6 +3077,10 @@ static int rev_body(char *hostname, int s, int stype, unsigned char *context)
             ERR_print_errors(bio_err);
             goto end;
         }
+        if (SSL_waiting_for_async(con)) {
+            wait_for_async(con);
+            continue;
+        }
 #ifndef OPENSSL_NO_SRP
         if (BIO_should_io_special(io)
             && BIO_get_retry_reason(io) == BIO_RR_SSL_X509_LOOKUP) {
@@ -3037,6 +3109,10 @@ static int rev_body(char *hostname, int s, int stype, unsigned char *context)
                 goto err;
             } else {
                 BIO_printf(bio_s_out, "read R BLOCK\n");
+                if (SSL_waiting_for_async(con)) {
+                    wait_for_async(con);
+                    continue;
+                }
 #ifndef OPENSSL_NO_SRP
                 if (BIO_should_io_special(io)
                     && BIO_get_retry_reason(io) == BIO_RR_SSL_X509_LOOKUP) {
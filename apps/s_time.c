@@ -76,6 +76,9 @@
 #if !defined(OPENSSL_SYS_MSDOS)
 # include OPENSSL_UNISTD
 #endif
+#if !defined(OPENSSL_SYS_WINDOWS)
+# include <sys/time.h>
+#endif
 
 #undef ioctl
 #define ioctl ioctlsocket
@@ -105,13 +108,21 @@ extern int verify_depth;
 extern int verify_error;
 
 static SSL *doConnection(SSL *scon, const char *host, SSL_CTX *ctx);
+static int doFetch(SSL *scon, const char *path, long *bytes_read);
+static int doUpload(SSL *scon, long len);
+static void print_ttfb(void);
+
+/* time to first byte of -www responses, with -ttfb */
+static int ttfb = 0;
+static long ttfb_num = 0;
+static double ttfb_total = 0.0, ttfb_max = 0.0;
 
 typedef enum OPTION_choice {
     OPT_ERR = -1, OPT_EOF = 0, OPT_HELP,
     OPT_CONNECT, OPT_CIPHER, OPT_CERT, OPT_KEY, OPT_CAPATH,
     OPT_CAFILE, OPT_NOCAPATH, OPT_NOCAFILE, OPT_NEW, OPT_REUSE, OPT_BUGS,
     OPT_VERIFY, OPT_TIME, OPT_SSL3,
-    OPT_WWW
+    OPT_WWW, OPT_UPLOAD, OPT_TTFB
 } OPTION_CHOICE;
 
 OPTIONS s_time_options[] = {
@@ -134,6 +145,10 @@ OPTIONS s_time_options[] = {
      "Turn on peer certificate verification, set depth"},
     {"time", OPT_TIME, 'p', "Sf seconds to collect data, default" SECONDSSTR},
     {"www", OPT_WWW, 's', "Fetch specified page from the site"},
+    {"ttfb", OPT_TTFB, '-',
+     "Report the time to the first byte of the -www responses"},
+    {"upload", OPT_UPLOAD, 'p',
+     "Send this many bytes to the server over each connection"},
 #ifndef OPENSSL_NO_SSL3
     {"ssl3", OPT_SSL3, '-', "Just use SSLv3"},
 #endif
@@ -158,9 +173,8 @@ int s_time_main(int argc, char **argv)
     char *host = SSL_CONNECT_NAME, *certfile = NULL, *keyfile = NULL, *prog;
     double totalTime = 0.0;
     int noCApath = 0, noCAfile = 0;
-    int maxtime = SECONDS, nConn = 0, perform = 3, ret = 1, i, st_bugs =
-        0, ver;
-    long bytes_read = 0, finishtime = 0;
+    int maxtime = SECONDS, nConn = 0, perform = 3, ret = 1, st_bugs = 0, ver;
+    long bytes_read = 0, bytes_sent = 0, upload = 0, finishtime = 0;
     OPTION_CHOICE o;
 
     meth = TLS_client_method();
@@ -229,6 +243,13 @@ int s_time_main(int argc, char **argv)
                 goto end;
             }
             break;
+        case OPT_UPLOAD:
+            if (!opt_long(opt_arg(), &upload))
+                goto opthelp;
+            break;
+        case OPT_TTFB:
+            ttfb = 1;
+            break;
         case OPT_SSL3:
 #ifndef OPENSSL_NO_SSL3
             meth = SSLv3_client_method();
@@ -268,7 +289,7 @@ int s_time_main(int argc, char **argv)
 
     /* Loop and time how long it takes to make connections */
 
-    bytes_read = 0;
+    bytes_read = bytes_sent = 0;
     finishtime = (long)time(NULL) + maxtime;
     tm_Time_F(START);
     for (;;) {
@@ -278,13 +299,12 @@ int s_time_main(int argc, char **argv)
         if ((scon = doConnection(NULL, host, ctx)) == NULL)
             goto end;
 
-        if (www_path != NULL) {
-            BIO_snprintf(buf, sizeof buf, "GET %s HTTP/1.0\r\n\r\n",
-                         www_path);
-            if (SSL_write(scon, buf, strlen(buf)) <= 0)
+        if (www_path != NULL && !doFetch(scon, www_path, &bytes_read))
+            goto end;
+        if (upload > 0) {
+            if (!doUpload(scon, upload))
                 goto end;
-            while ((i = SSL_read(scon, buf, sizeof(buf))) > 0)
-                bytes_read += i;
+            bytes_sent += upload;
         }
 #ifdef NO_SHUTDOWN
         SSL_set_shutdown(scon, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
@@ -313,13 +333,18 @@ int s_time_main(int argc, char **argv)
     }
     totalTime += tm_Time_F(STOP); /* Add the time for this iteration */
 
-    i = (int)((long)time(NULL) - finishtime + maxtime);
     printf
         ("\n\n%d connections in %.2fs; %.2f connections/user sec, bytes read %ld\n",
          nConn, totalTime, ((double)nConn / totalTime), bytes_read);
     printf
         ("%d connections in %ld real seconds, %ld bytes read per connection\n",
          nConn, (long)time(NULL) - finishtime + maxtime, bytes_read / nConn);
+    if (upload > 0)
+        printf("%ld bytes sent; %.2f MB/user sec, %.2f MB/real sec\n",
+               bytes_sent, bytes_sent / totalTime / 1e6,
+               bytes_sent / (double)((long)time(NULL) - finishtime + maxtime)
+               / 1e6);
+    print_ttfb();
 
     /*
      * Now loop and time connections using the same session id over and over
@@ -356,7 +381,9 @@ int s_time_main(int argc, char **argv)
     finishtime = (long)time(NULL) + maxtime;
 
     printf("starting\n");
-    bytes_read = 0;
+    bytes_read = bytes_sent = 0;
+    ttfb_num = 0;
+    ttfb_total = ttfb_max = 0.0;
     tm_Time_F(START);
 
     for (;;) {
@@ -366,13 +393,12 @@ int s_time_main(int argc, char **argv)
         if ((doConnection(scon, host, ctx)) == NULL)
             goto end;
 
-        if (www_path) {
-            BIO_snprintf(buf, sizeof buf, "GET %s HTTP/1.0\r\n\r\n",
-                         www_path);
-            if (SSL_write(scon, buf, strlen(buf)) <= 0)
+        if (www_path != NULL && !doFetch(scon, www_path, &bytes_read))
+            goto end;
+        if (upload > 0) {
+            if (!doUpload(scon, upload))
                 goto end;
-            while ((i = SSL_read(scon, buf, sizeof(buf))) > 0)
-                bytes_read += i;
+            bytes_sent += upload;
         }
 #ifdef NO_SHUTDOWN
         SSL_set_shutdown(scon, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
@@ -404,6 +430,12 @@ int s_time_main(int argc, char **argv)
     printf
         ("%d connections in %ld real seconds, %ld bytes read per connection\n",
          nConn, (long)time(NULL) - finishtime + maxtime, bytes_read / nConn);
+    if (upload > 0)
+        printf("%ld bytes sent; %.2f MB/user sec, %.2f MB/real sec\n",
+               bytes_sent, bytes_sent / totalTime / 1e6,
+               bytes_sent / (double)((long)time(NULL) - finishtime + maxtime)
+               / 1e6);
+    print_ttfb();
 
     ret = 0;
 
@@ -413,6 +445,78 @@ int s_time_main(int argc, char **argv)
     return (ret);
 }
 
+/* Wall clock time in seconds */
+static double wall_time(void)
+{
+#if defined(OPENSSL_SYS_WINDOWS)
+    return GetTickCount() / 1e3;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+/*-
+ * doFetch - send a GET request for path over an established connection and
+ * read the response, adding its length to *bytes_read and, with -ttfb,
+ * timing how long the first byte takes to arrive
+ */
+static int doFetch(SSL *scon, const char *path, long *bytes_read)
+{
+    char buf[MYBUFSIZ];
+    double start = 0.0, t;
+    int i, first = 1;
+
+    BIO_snprintf(buf, sizeof buf, "GET %s HTTP/1.0\r\n\r\n", path);
+    if (ttfb)
+        start = wall_time();
+    if (SSL_write(scon, buf, strlen(buf)) <= 0)
+        return 0;
+    while ((i = SSL_read(scon, buf, sizeof(buf))) > 0) {
+        if (ttfb && first) {
+            t = wall_time() - start;
+            ttfb_total += t;
+            ttfb_max = max(ttfb_max, t);
+            ttfb_num++;
+            first = 0;
+        }
+        *bytes_read += i;
+    }
+    return 1;
+}
+
+static void print_ttfb(void)
+{
+    if (!ttfb || ttfb_num == 0)
+        return;
+    printf("time to first byte %.3f ms on average, %.3f ms at most, "
+           "over %ld responses\n", ttfb_total / ttfb_num * 1e3,
+           ttfb_max * 1e3, ttfb_num);
+}
+
+/*-
+ * doUpload - send len bytes of application data over an established
+ * connection, in writes of one maximum sized record each
+ */
+static int doUpload(SSL *scon, long len)
+{
+    static unsigned char data[SSL3_RT_MAX_PLAIN_LENGTH];
+    int i, n;
+
+    while (len > 0) {
+        n = len > (long)sizeof(data) ? (int)sizeof(data) : (int)len;
+        if ((i = SSL_write(scon, data, n)) <= 0) {
+            BIO_printf(bio_err, "Upload failed\n");
+            ERR_print_errors(bio_err);
+            return 0;
+        }
+        len -= i;
+    }
+    return 1;
+}
+
 /*-
  * doConnection - make a connection
  */
@@ -94,6 +94,11 @@
 # include <signal.h>
 #endif
 
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX) && defined(SIGALRM)
+# define SPEED_THREADS
+# include <pthread.h>
+#endif
+
 #if defined(_WIN32) || defined(__CYGWIN__)
 # include <windows.h>
 # if defined(__CYGWIN__) && !defined(_WIN32)
@@ -207,13 +212,13 @@ static void print_result(int alg, int run_no, int count, double time_used);
 static int do_multi(int multi);
 #endif
 
-#define ALGOR_NUM       30
+#define ALGOR_NUM       33
 #define SIZE_NUM        5
 #define PRIME_NUM       3
 #define RSA_NUM         7
 #define DSA_NUM         3
 
-#define EC_NUM       16
+#define EC_NUM       17
 #define MAX_ECDH_SIZE 256
 #define MISALIGN        64
 
@@ -224,7 +229,8 @@ static const char *names[ALGOR_NUM] = {
     "aes-128 cbc", "aes-192 cbc", "aes-256 cbc",
     "camellia-128 cbc", "camellia-192 cbc", "camellia-256 cbc",
     "evp", "sha256", "sha512", "whirlpool",
-    "aes-128 ige", "aes-192 ige", "aes-256 ige", "ghash"
+    "aes-128 ige", "aes-192 ige", "aes-256 ige", "ghash", "rand",
+    "chacha20-poly1305", "rand+add"
 };
 
 static double results[ALGOR_NUM][SIZE_NUM];
@@ -338,6 +344,75 @@ static void *KDF1_SHA1(const void *in, size_t inlen, void *out,
 
 static void multiblock_speed(const EVP_CIPHER *evp_cipher);
 
+/*
+ * One iteration of the rand+add test: the zero-entropy RAND_add() that
+ * BN_rand() and each TLS handshake make, followed by RAND_bytes().
+ */
+static void rand_add_bytes(unsigned char *buf, int length)
+{
+    time_t tim;
+
+    time(&tim);
+    RAND_add(&tim, sizeof(tim), 0.0);
+    RAND_bytes(buf, length);
+}
+
+#ifdef SPEED_THREADS
+typedef struct {
+    pthread_t tid;
+    unsigned char buf[BUFSIZE];
+    int length;
+    int add;
+    long count;
+} RAND_JOB;
+
+static void *rand_loop(void *arg)
+{
+    RAND_JOB *job = arg;
+    long count;
+
+    for (count = 0; run && count < 0x7fffffff; count++) {
+        if (job->add)
+            rand_add_bytes(job->buf, job->length);
+        else
+            RAND_bytes(job->buf, job->length);
+    }
+    job->count = count;
+    return NULL;
+}
+
+/*
+ * Call RAND_bytes(), preceded by RAND_add() if |add| is set, from
+ * |nthreads| threads at once until the alarm goes off and return the total
+ * number of iterations.
+ */
+static long rand_speed_threads(int nthreads, int length, int add)
+{
+    RAND_JOB *jobs;
+    long count = 0;
+    int i, started;
+
+    jobs = app_malloc(nthreads * sizeof(*jobs), "rand jobs");
+    run = 1;
+    for (started = 0; started < nthreads; started++) {
+        jobs[started].length = length;
+        jobs[started].add = add;
+        jobs[started].count = 0;
+        if (pthread_create(&jobs[started].tid, NULL, rand_loop,
+                           &jobs[started]) != 0) {
+            BIO_printf(bio_err, "unable to create thread %d\n", started);
+            break;
+        }
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(jobs[i].tid, NULL);
+        count += jobs[i].count;
+    }
+    OPENSSL_free(jobs);
+    return count;
+}
+#endif
+
 static int found(const char *name, const OPT_PAIR * pairs, int *result)
 {
     for (; pairs->name; pairs++)
@@ -351,7 +426,7 @@ static int found(const char *name, const OPT_PAIR * pairs, int *result)
 typedef enum OPTION_choice {
     OPT_ERR = -1, OPT_EOF = 0, OPT_HELP,
     OPT_ELAPSED, OPT_EVP, OPT_DECRYPT, OPT_ENGINE, OPT_MULTI,
-    OPT_MR, OPT_MB, OPT_MISALIGN
+    OPT_MR, OPT_MB, OPT_MISALIGN, OPT_THREADS
 } OPTION_CHOICE;
 
 OPTIONS speed_options[] = {
@@ -369,6 +444,10 @@ OPTIONS speed_options[] = {
 #ifndef NO_FORK
     {"multi", OPT_MULTI, 'p', "Run benchmarks in parallel"},
 #endif
+#ifdef SPEED_THREADS
+    {"threads", OPT_THREADS, 'p',
+     "Run the rand benchmark in this many threads (implies -elapsed)"},
+#endif
 #ifndef OPENSSL_NO_ENGINE
     {"engine", OPT_ENGINE, 's', "Use engine, possibly a hardware device"},
 #endif
@@ -405,6 +484,9 @@ OPTIONS speed_options[] = {
 #define D_IGE_192_AES   27
 #define D_IGE_256_AES   28
 #define D_GHASH         29
+#define D_RAND          30
+#define D_CHACHA20_POLY1305 31
+#define D_RAND_ADD      32
 static OPT_PAIR doit_choices[] = {
 #ifndef OPENSSL_NO_MD2
     {"md2", D_MD2},
@@ -474,6 +556,11 @@ static OPT_PAIR doit_choices[] = {
     {"cast5", D_CBC_CAST},
 #endif
     {"ghash", D_GHASH},
+    {"rand", D_RAND},
+    {"rand+add", D_RAND_ADD},
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+    {"chacha20-poly1305", D_CHACHA20_POLY1305},
+#endif
     {NULL}
 };
 
@@ -521,6 +608,7 @@ static OPT_PAIR rsa_choices[] = {
 #define R_EC_B283    13
 #define R_EC_B409    14
 #define R_EC_B571    15
+#define R_EC_X25519  16
 #ifndef OPENSSL_NO_EC
 static OPT_PAIR ecdsa_choices[] = {
     {"ecdsap160", R_EC_P160},
@@ -558,6 +646,7 @@ static OPT_PAIR ecdh_choices[] = {
     {"ecdhb283", R_EC_B283},
     {"ecdhb409", R_EC_B409},
     {"ecdhb571", R_EC_B571},
+    {"ecdhx25519", R_EC_X25519},
     {NULL}
 };
 #endif
@@ -578,6 +667,9 @@ int speed_main(int argc, char **argv)
     unsigned char md[EVP_MAX_MD_SIZE];
 #ifndef NO_FORK
     int multi = 0;
+#ifdef SPEED_THREADS
+    int rand_threads = 1;
+#endif
 #endif
     /* What follows are the buffers and key material. */
 #if !defined(OPENSSL_NO_RSA) || !defined(OPENSSL_NO_DSA)
@@ -717,7 +809,9 @@ int speed_main(int argc, char **argv)
         NID_sect163k1, NID_sect233k1, NID_sect283k1,
         NID_sect409k1, NID_sect571k1, NID_sect163r2,
         NID_sect233r1, NID_sect283r1, NID_sect409r1,
-        NID_sect571r1
+        NID_sect571r1,
+        /* Other */
+        NID_X25519
     };
     static const char *test_curves_names[EC_NUM] = {
         /* Prime Curves */
@@ -727,7 +821,7 @@ int speed_main(int argc, char **argv)
         "nistk163", "nistk233", "nistk283",
         "nistk409", "nistk571", "nistb163",
         "nistb233", "nistb283", "nistb409",
-        "nistb571"
+        "nistb571", "X25519"
     };
     static int test_curves_bits[EC_NUM] = {
         160, 192, 224,
@@ -735,7 +829,7 @@ int speed_main(int argc, char **argv)
         163, 233, 283,
         409, 571, 163,
         233, 283, 409,
-        571
+        571, 253                /* X25519 */
     };
 #endif
 #ifndef OPENSSL_NO_EC
@@ -845,6 +939,14 @@ int speed_main(int argc, char **argv)
         case OPT_MB:
             multiblock = 1;
             break;
+        case OPT_THREADS:
+#ifdef SPEED_THREADS
+            rand_threads = atoi(opt_arg());
+            /* CPU time would add up across threads */
+            if (rand_threads > 1)
+                usertime = 0;
+#endif
+            break;
         }
     }
     argc = opt_num_rest();
@@ -912,7 +1014,8 @@ int speed_main(int argc, char **argv)
 #endif
 #ifndef OPENSSL_NO_EC
         if (strcmp(*argv, "ecdsa") == 0) {
-            for (i = 0; i < EC_NUM; i++)
+            /* All curves except X25519, which cannot sign */
+            for (i = 0; i < R_EC_X25519; i++)
                 ecdsa_doit[i] = 1;
             continue;
         }
@@ -949,7 +1052,7 @@ int speed_main(int argc, char **argv)
         for (i = 0; i < DSA_NUM; i++)
             dsa_doit[i] = 1;
 #ifndef OPENSSL_NO_EC
-        for (i = 0; i < EC_NUM; i++)
+        for (i = 0; i < R_EC_X25519; i++)
             ecdsa_doit[i] = 1;
         for (i = 0; i < EC_NUM; i++)
             ecdh_doit[i] = 1;
@@ -1066,6 +1169,9 @@ int speed_main(int argc, char **argv)
     c[D_IGE_192_AES][0] = count;
     c[D_IGE_256_AES][0] = count;
     c[D_GHASH][0] = count;
+    c[D_RAND][0] = count;
+    c[D_CHACHA20_POLY1305][0] = count;
+    c[D_RAND_ADD][0] = count;
 
     for (i = 1; i < SIZE_NUM; i++) {
         long l0, l1;
@@ -1226,6 +1332,8 @@ int speed_main(int argc, char **argv)
             }
         }
     }
+    ecdh_c[R_EC_X25519][0] = count / 1800;
+    ecdh_c[R_EC_X25519][1] = count / 1800;
 #  endif
 
 #  define COND(d) (count < (d))
@@ -1508,6 +1616,67 @@ int speed_main(int argc, char **argv)
         }
         CRYPTO_gcm128_release(ctx);
     }
+#endif
+    if (doit[D_RAND]) {
+        for (j = 0; j < SIZE_NUM; j++) {
+            print_message(names[D_RAND], c[D_RAND][j], lengths[j]);
+            Time_F(START);
+#ifdef SPEED_THREADS
+            if (rand_threads > 1)
+                count = rand_speed_threads(rand_threads, lengths[j], 0);
+            else
+#endif
+            for (count = 0, run = 1; COND(c[D_RAND][j]); count++)
+                RAND_bytes(buf, lengths[j]);
+            d = Time_F(STOP);
+            print_result(D_RAND, j, count, d);
+        }
+    }
+    if (doit[D_RAND_ADD]) {
+        for (j = 0; j < SIZE_NUM; j++) {
+            print_message(names[D_RAND_ADD], c[D_RAND_ADD][j], lengths[j]);
+            Time_F(START);
+#ifdef SPEED_THREADS
+            if (rand_threads > 1)
+                count = rand_speed_threads(rand_threads, lengths[j], 1);
+            else
+#endif
+            for (count = 0, run = 1; COND(c[D_RAND_ADD][j]); count++)
+                rand_add_bytes(buf, lengths[j]);
+            d = Time_F(STOP);
+            print_result(D_RAND_ADD, j, count, d);
+        }
+    }
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+    if (doit[D_CHACHA20_POLY1305]) {
+        /* Seal one TLS-sized record per iteration: nonce, AAD, data, tag */
+        static const unsigned char ckey[32] = {
+            0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0,
+            0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x12,
+            0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x12, 0x34,
+            0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x12, 0x34, 0x56
+        };
+        EVP_CIPHER_CTX ctx;
+        int outl;
+
+        EVP_CIPHER_CTX_init(&ctx);
+        EVP_EncryptInit_ex(&ctx, EVP_chacha20_poly1305(), NULL, ckey, NULL);
+        for (j = 0; j < SIZE_NUM; j++) {
+            print_message(names[D_CHACHA20_POLY1305],
+                          c[D_CHACHA20_POLY1305][j], lengths[j]);
+            Time_F(START);
+            for (count = 0, run = 1; COND(c[D_CHACHA20_POLY1305][j]);
+                 count++) {
+                EVP_EncryptInit_ex(&ctx, NULL, NULL, NULL, iv);
+                EVP_EncryptUpdate(&ctx, NULL, &outl, buf2, 13);
+                EVP_EncryptUpdate(&ctx, buf, &outl, buf, lengths[j]);
+                EVP_EncryptFinal_ex(&ctx, buf + outl, &outl);
+            }
+            d = Time_F(STOP);
+            print_result(D_CHACHA20_POLY1305, j, count, d);
+        }
+        EVP_CIPHER_CTX_cleanup(&ctx);
+    }
 #endif
 #ifndef OPENSSL_NO_CAMELLIA
     if (doit[D_CBC_128_CML]) {
@@ -1953,9 +2122,58 @@ int speed_main(int argc, char **argv)
     for (j = 0; j < EC_NUM; j++) {
         if (!ecdh_doit[j])
             continue;
-        ecdh_a[j] = EC_KEY_new_by_curve_name(test_curves[j]);
-        ecdh_b[j] = EC_KEY_new_by_curve_name(test_curves[j]);
-        if ((ecdh_a[j] == NULL) || (ecdh_b[j] == NULL)) {
+        if (test_curves[j] == NID_X25519) {
+            /* X25519 has no EC_KEY form, it is only usable via EVP_PKEY */
+            EVP_PKEY_CTX *kctx, *actx = NULL, *bctx = NULL;
+            EVP_PKEY *xkey_a = NULL, *xkey_b = NULL;
+            size_t xlen_a = sizeof(secret_a), xlen_b = sizeof(secret_b);
+
+            kctx = EVP_PKEY_CTX_new_id(NID_X25519, NULL);
+            if (kctx == NULL || EVP_PKEY_keygen_init(kctx) <= 0
+                || EVP_PKEY_keygen(kctx, &xkey_a) <= 0
+                || EVP_PKEY_keygen(kctx, &xkey_b) <= 0
+                || (actx = EVP_PKEY_CTX_new(xkey_a, NULL)) == NULL
+                || (bctx = EVP_PKEY_CTX_new(xkey_b, NULL)) == NULL
+                || EVP_PKEY_derive_init(actx) <= 0
+                || EVP_PKEY_derive_set_peer(actx, xkey_b) <= 0
+                || EVP_PKEY_derive_init(bctx) <= 0
+                || EVP_PKEY_derive_set_peer(bctx, xkey_a) <= 0
+                || EVP_PKEY_derive(actx, secret_a, &xlen_a) <= 0
+                || EVP_PKEY_derive(bctx, secret_b, &xlen_b) <= 0) {
+                BIO_printf(bio_err, "X25519 failure.\n");
+                ERR_print_errors(bio_err);
+                rsa_count = 1;
+            } else {
+                if (xlen_a != xlen_b || memcmp(secret_a, secret_b, xlen_a)) {
+                    BIO_printf(bio_err, "ECDH computations don't match.\n");
+                    rsa_count = 1;
+                }
+
+                pkey_print_message("", "ecdh",
+                                   ecdh_c[j][0],
+                                   test_curves_bits[j], ECDH_SECONDS);
+                Time_F(START);
+                for (count = 0, run = 1; COND(ecdh_c[j][0]); count++) {
+                    xlen_a = sizeof(secret_a);
+                    EVP_PKEY_derive(actx, secret_a, &xlen_a);
+                }
+                d = Time_F(STOP);
+                BIO_printf(bio_err,
+                           mr ? "+R7:%ld:%d:%.2f\n" :
+                           "%ld %d-bit ECDH ops in %.2fs\n", count,
+                           test_curves_bits[j], d);
+                ecdh_results[j][0] = d / (double)count;
+                rsa_count = count;
+            }
+            EVP_PKEY_CTX_free(kctx);
+            EVP_PKEY_CTX_free(actx);
+            EVP_PKEY_CTX_free(bctx);
+            EVP_PKEY_free(xkey_a);
+            EVP_PKEY_free(xkey_b);
+        } else if ((ecdh_a[j] = EC_KEY_new_by_curve_name(test_curves[j]))
+                   == NULL
+                   || (ecdh_b[j] = EC_KEY_new_by_curve_name(test_curves[j]))
+                   == NULL) {
             BIO_printf(bio_err, "ECDH failure.\n");
             ERR_print_errors(bio_err);
             rsa_count = 1;
@@ -58,6 +58,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "apps.h"
 #include <openssl/bio.h>
 #include <openssl/err.h>
@@ -69,13 +70,19 @@ static int cb(int ok, X509_STORE_CTX *ctx);
 static int check(X509_STORE *ctx, char *file,
                  STACK_OF(X509) *uchain, STACK_OF(X509) *tchain,
                  STACK_OF(X509_CRL) *crls, ENGINE *e, int show_chain);
+static int check_batch(X509_STORE *ctx, char **files, int num,
+                       STACK_OF(X509) *uchain, STACK_OF(X509) *tchain,
+                       STACK_OF(X509_CRL) *crls, ENGINE *e, int show_chain,
+                       int threads, int repeat);
 static int v_verbose = 0, vflags = 0;
+/* Keeps the output of callbacks running in different threads apart */
+static CRYPTO_RWLOCK *cb_lock = NULL;
 
 typedef enum OPTION_choice {
     OPT_ERR = -1, OPT_EOF = 0, OPT_HELP,
     OPT_ENGINE, OPT_CAPATH, OPT_CAFILE, OPT_NOCAPATH, OPT_NOCAFILE,
     OPT_UNTRUSTED, OPT_TRUSTED, OPT_CRLFILE, OPT_CRL_DOWNLOAD, OPT_SHOW_CHAIN,
-    OPT_V_ENUM,
+    OPT_THREADS, OPT_REPEAT, OPT_V_ENUM,
     OPT_VERBOSE
 } OPTION_CHOICE;
 
@@ -99,6 +106,10 @@ OPTIONS verify_options[] = {
         "Attempt to download CRL information for this certificate"},
     {"show_chain", OPT_SHOW_CHAIN, '-',
         "Display information about the certificate chain"},
+    {"threads", OPT_THREADS, 'p',
+        "Verify the certificates in this many threads"},
+    {"repeat", OPT_REPEAT, 'p',
+        "Verify each certificate this many times and report the rate"},
     OPT_V_OPTIONS,
 #ifndef OPENSSL_NO_ENGINE
     {"engine", OPT_ENGINE, 's', "Use engine, possibly a hardware device"},
@@ -117,6 +128,7 @@ int verify_main(int argc, char **argv)
     int noCApath = 0, noCAfile = 0;
     char *untfile = NULL, *trustfile = NULL, *crlfile = NULL;
     int vpmtouched = 0, crl_download = 0, show_chain = 0, i = 0, ret = 1;
+    int threads = 1, repeat = 1;
     OPTION_CHOICE o;
 
     if ((vpm = X509_VERIFY_PARAM_new()) == NULL)
@@ -181,6 +193,12 @@ int verify_main(int argc, char **argv)
         case OPT_SHOW_CHAIN:
             show_chain = 1;
             break;
+        case OPT_THREADS:
+            threads = atoi(opt_arg());
+            break;
+        case OPT_REPEAT:
+            repeat = atoi(opt_arg());
+            break;
         case OPT_ENGINE:
             e = setup_engine(opt_arg(), 0);
             break;
@@ -191,6 +209,15 @@ int verify_main(int argc, char **argv)
     }
     argc = opt_num_rest();
     argv = opt_rest();
+
+    /*
+     * The locking callback installed by main() only checks that locks are
+     * used in pairs and doesn't lock anything.  Switch to the library's
+     * own locks once, before any lock is taken or thread started.
+     */
+    if (threads > 1)
+        CRYPTO_set_locking_callback(NULL);
+
     if (trustfile && (CAfile || CApath)) {
         BIO_printf(bio_err,
                    "%s: Cannot use -trusted with -CAfile or -CApath\n",
@@ -234,6 +261,10 @@ int verify_main(int argc, char **argv)
     if (argc < 1) {
         if (check(store, NULL, untrusted, trusted, crls, e, show_chain) != 1)
             ret = -1;
+    } else if ((threads > 1 && argc > 1) || repeat > 1) {
+        if (!check_batch(store, argv, argc, untrusted, trusted, crls, e,
+                         show_chain, threads, repeat))
+            ret = -1;
     } else {
         for (i = 0; i < argc; i++)
             if (check(store, argv[i], untrusted, trusted, crls, e,
@@ -250,58 +281,78 @@ int verify_main(int argc, char **argv)
     return (ret < 0 ? 2 : ret);
 }
 
-static int check(X509_STORE *ctx, char *file,
-                 STACK_OF(X509) *uchain, STACK_OF(X509) *tchain,
-                 STACK_OF(X509_CRL) *crls, ENGINE *e, int show_chain)
+static X509_STORE_CTX *setup_check(X509_STORE *ctx, X509 *x,
+                                   STACK_OF(X509) *uchain,
+                                   STACK_OF(X509) *tchain,
+                                   STACK_OF(X509_CRL) *crls)
 {
-    X509 *x = NULL;
-    int i = 0, ret = 0;
     X509_STORE_CTX *csc;
-    STACK_OF(X509) *chain = NULL;
-    int num_untrusted;
-
-    x = load_cert(file, FORMAT_PEM, NULL, e, "certificate file");
-    if (x == NULL)
-        goto end;
-    printf("%s: ", (file == NULL) ? "stdin" : file);
 
     csc = X509_STORE_CTX_new();
     if (csc == NULL) {
         ERR_print_errors(bio_err);
-        goto end;
+        return NULL;
     }
     X509_STORE_set_flags(ctx, vflags);
     if (!X509_STORE_CTX_init(csc, ctx, x, uchain)) {
         ERR_print_errors(bio_err);
-        goto end;
+        X509_STORE_CTX_free(csc);
+        return NULL;
     }
     if (tchain)
         X509_STORE_CTX_trusted_stack(csc, tchain);
     if (crls)
         X509_STORE_CTX_set0_crls(csc, crls);
-    i = X509_verify_cert(csc);
-    if (i > 0) {
-        printf("OK\n");
-        ret = 1;
-	if (show_chain) {
-	    int j;
-
-	    chain = X509_STORE_CTX_get1_chain(csc);
-	    num_untrusted = X509_STORE_CTX_get_num_untrusted(csc);
-	    printf("Chain:\n");
-	    for (j = 0; j < sk_X509_num(chain); j++) {
-		X509 *cert = sk_X509_value(chain, j);
-		printf("depth=%d: ", j);
-		X509_NAME_print_ex_fp(stdout,
-				      X509_get_subject_name(cert),
-				      0, XN_FLAG_ONELINE);
-		if (j < num_untrusted)
-		    printf(" (untrusted)");
-		printf("\n");
-	    }
-	    sk_X509_pop_free(chain, X509_free);
-	}
+    return csc;
+}
+
+static int show_result(X509_STORE_CTX *csc, int i, int show_chain)
+{
+    STACK_OF(X509) *chain = NULL;
+    int num_untrusted;
+
+    if (i <= 0)
+        return 0;
+    printf("OK\n");
+    if (show_chain) {
+        int j;
+
+        chain = X509_STORE_CTX_get1_chain(csc);
+        num_untrusted = X509_STORE_CTX_get_num_untrusted(csc);
+        printf("Chain:\n");
+        for (j = 0; j < sk_X509_num(chain); j++) {
+            X509 *cert = sk_X509_value(chain, j);
+            printf("depth=%d: ", j);
+            X509_NAME_print_ex_fp(stdout,
+                                  X509_get_subject_name(cert),
+                                  0, XN_FLAG_ONELINE);
+            if (j < num_untrusted)
+                printf(" (untrusted)");
+            printf("\n");
+        }
+        sk_X509_pop_free(chain, X509_free);
     }
+    return 1;
+}
+
+static int check(X509_STORE *ctx, char *file,
+                 STACK_OF(X509) *uchain, STACK_OF(X509) *tchain,
+                 STACK_OF(X509_CRL) *crls, ENGINE *e, int show_chain)
+{
+    X509 *x = NULL;
+    int i = 0, ret = 0;
+    X509_STORE_CTX *csc;
+
+    x = load_cert(file, FORMAT_PEM, NULL, e, "certificate file");
+    if (x == NULL)
+        goto end;
+    printf("%s: ", (file == NULL) ? "stdin" : file);
+
+    csc = setup_check(ctx, x, uchain, tchain, crls);
+    if (csc == NULL)
+        goto end;
+    i = X509_verify_cert(csc);
+    ret = show_result(csc, i, show_chain);
     X509_STORE_CTX_free(csc);
 
  end:
@@ -312,12 +363,108 @@ static int check(X509_STORE *ctx, char *file,
     return ret;
 }
 
+/*
+ * Verify all of |files| at once with X509_verify_cert_batch(), then report
+ * the results in order.  With a |repeat| count above 1 each certificate is
+ * verified that many times, all sharing the same X509, and the rate is
+ * reported.  Only the first result for each file is printed.
+ */
+static int check_batch(X509_STORE *ctx, char **files, int num,
+                       STACK_OF(X509) *uchain, STACK_OF(X509) *tchain,
+                       STACK_OF(X509_CRL) *crls, ENGINE *e, int show_chain,
+                       int threads, int repeat)
+{
+    X509 **certs;
+    X509_STORE_CTX **cscs;
+    int *results;
+    int i, j, n = 0, verified = 1, ret = 1;
+    double secs;
+
+    if (threads < 1)
+        threads = 1;
+    if (repeat < 1)
+        repeat = 1;
+    if (num > INT_MAX / repeat) {
+        BIO_printf(bio_err, "Too many verifications\n");
+        return 0;
+    }
+    certs = app_malloc(sizeof(*certs) * num, "certificate array");
+    cscs = app_malloc(sizeof(*cscs) * num * repeat, "context array");
+    results = app_malloc(sizeof(*results) * num * repeat, "result array");
+
+    /* Files that can't be loaded are reported now and skipped */
+    for (i = 0; i < num; i++) {
+        certs[i] = load_cert(files[i], FORMAT_PEM, NULL, e,
+                             "certificate file");
+        for (j = 0; certs[i] != NULL && j < repeat; j++) {
+            if ((cscs[n + j] = setup_check(ctx, certs[i], uchain, tchain,
+                                           crls)) == NULL) {
+                while (j-- > 0)
+                    X509_STORE_CTX_free(cscs[n + j]);
+                X509_free(certs[i]);
+                certs[i] = NULL;
+            }
+        }
+        if (certs[i] == NULL) {
+            ERR_print_errors(bio_err);
+            ret = 0;
+            continue;
+        }
+        n += repeat;
+    }
+
+    app_tminterval(TM_START, 0);
+    if ((cb_lock = CRYPTO_THREAD_lock_new()) == NULL
+        || X509_verify_cert_batch(cscs, results, n, threads) < 0) {
+        ERR_print_errors(bio_err);
+        verified = 0;
+        ret = 0;
+    }
+    secs = app_tminterval(TM_STOP, 0);
+    if (verified && repeat > 1)
+        BIO_printf(bio_err, "%d verifications in %.2fs in %d thread%s: "
+                   "%.0f/s\n", n, secs, threads, threads > 1 ? "s" : "",
+                   secs > 0 ? n / secs : 0.0);
+
+    for (i = 0, n = 0; i < num; i++) {
+        int err;
+
+        if (certs[i] == NULL)
+            continue;
+        printf("%s: ", files[i]);
+        if (!verified) {
+            printf("not verified\n");
+        } else if (!show_result(cscs[n], results[n], show_chain)) {
+            err = X509_STORE_CTX_get_error(cscs[n]);
+            printf("error %d at %d depth lookup:%s\n", err,
+                   X509_STORE_CTX_get_error_depth(cscs[n]),
+                   X509_verify_cert_error_string(err));
+            ret = 0;
+        }
+        for (j = 0; j < repeat; j++) {
+            if (j > 0 && verified && results[n] <= 0)
+                ret = 0;
+            X509_STORE_CTX_free(cscs[n++]);
+        }
+        X509_free(certs[i]);
+    }
+
+    CRYPTO_THREAD_lock_free(cb_lock);
+    cb_lock = NULL;
+    OPENSSL_free(certs);
+    OPENSSL_free(cscs);
+    OPENSSL_free(results);
+    return ret;
+}
+
 static int cb(int ok, X509_STORE_CTX *ctx)
 {
     int cert_error = X509_STORE_CTX_get_error(ctx);
     X509 *current_cert = X509_STORE_CTX_get_current_cert(ctx);
 
     if (!ok) {
+        if (cb_lock != NULL)
+            CRYPTO_THREAD_write_lock(cb_lock);
         if (current_cert) {
             X509_NAME_print_ex(bio_err,
                             X509_get_subject_name(current_cert),
@@ -350,11 +497,18 @@ static int cb(int ok, X509_STORE_CTX *ctx)
             ok = 1;
         }
 
+        if (cb_lock != NULL)
+            CRYPTO_THREAD_unlock(cb_lock);
         return ok;
 
     }
-    if (cert_error == X509_V_OK && ok == 2)
+    if (cert_error == X509_V_OK && ok == 2) {
+        if (cb_lock != NULL)
+            CRYPTO_THREAD_write_lock(cb_lock);
         policies_print(ctx);
+        if (cb_lock != NULL)
+            CRYPTO_THREAD_unlock(cb_lock);
+    }
     if (!v_verbose)
         ERR_clear_error();
     return (ok);
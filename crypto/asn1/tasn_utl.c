@@ -65,6 +65,7 @@
 #include <openssl/objects.h>
 #include <openssl/err.h>
 #include "asn1_locl.h"
+#include "internal/refcount.h"
 
 /* Utility functions for manipulating fields and offsets */
 
@@ -117,7 +118,10 @@ int asn1_do_lock(ASN1_VALUE **pval, int op, const ASN1_ITEM *it)
         *lck = 1;
         return 1;
     }
-    ret = CRYPTO_add(lck, op, aux->ref_lock);
+    if (op > 0)
+        ret = CRYPTO_UP_REF(lck, aux->ref_lock);
+    else
+        ret = CRYPTO_DOWN_REF(lck, aux->ref_lock);
 #ifdef REF_PRINT
     fprintf(stderr, "%s: Reference Count: %d\n", it->sname, *lck);
 #endif
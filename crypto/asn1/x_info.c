@@ -61,6 +61,7 @@
 #include <openssl/evp.h>
 #include <openssl/asn1.h>
 #include <openssl/x509.h>
+#include "internal/refcount.h"
 
 X509_INFO *X509_INFO_new(void)
 {
@@ -82,7 +83,7 @@ void X509_INFO_free(X509_INFO *x)
     if (x == NULL)
         return;
 
-    i = CRYPTO_add(&x->references, -1, CRYPTO_LOCK_X509_INFO);
+    i = CRYPTO_DOWN_REF(&x->references, CRYPTO_LOCK_X509_INFO);
 #ifdef REF_PRINT
     REF_PRINT("X509_INFO", x);
 #endif
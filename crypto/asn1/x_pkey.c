@@ -61,6 +61,7 @@
 #include <openssl/evp.h>
 #include <openssl/objects.h>
 #include <openssl/x509.h>
+#include "internal/refcount.h"
 
 X509_PKEY *X509_PKEY_new(void)
 {
@@ -90,7 +91,7 @@ void X509_PKEY_free(X509_PKEY *x)
     if (x == NULL)
         return;
 
-    i = CRYPTO_add(&x->references, -1, CRYPTO_LOCK_X509_PKEY);
+    i = CRYPTO_DOWN_REF(&x->references, CRYPTO_LOCK_X509_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("X509_PKEY", x);
 #endif
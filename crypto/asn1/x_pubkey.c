@@ -61,6 +61,7 @@
 #include <openssl/asn1t.h>
 #include <openssl/x509.h>
 #include "internal/asn1_int.h"
+#include "internal/refcount.h"
 #ifndef OPENSSL_NO_RSA
 # include <openssl/rsa.h>
 #endif
@@ -129,7 +130,7 @@ EVP_PKEY *X509_PUBKEY_get(X509_PUBKEY *key)
         goto error;
 
     if (key->pkey != NULL) {
-        CRYPTO_add(&key->pkey->references, 1, CRYPTO_LOCK_EVP_PKEY);
+        CRYPTO_UP_REF(&key->pkey->references, CRYPTO_LOCK_EVP_PKEY);
         return key->pkey;
     }
 
@@ -166,7 +167,7 @@ EVP_PKEY *X509_PUBKEY_get(X509_PUBKEY *key)
         key->pkey = ret;
         CRYPTO_w_unlock(CRYPTO_LOCK_EVP_PKEY);
     }
-    CRYPTO_add(&ret->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&ret->references, CRYPTO_LOCK_EVP_PKEY);
 
     return ret;
 
@@ -0,0 +1,512 @@
+/* crypto/async/async.c */
+/*
+ * Job scheduling for the ASYNC framework.  Each thread has a context,
+ * which remembers the job currently running on that thread and the point
+ * to return to when it pauses or finishes, and a pool of idle jobs whose
+ * stacks are reused from one ASYNC_start_job() call to the next.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <string.h>
+#include <openssl/err.h>
+#include "async_locl.h"
+
+static CRYPTO_ONCE async_once = CRYPTO_ONCE_STATIC_INIT;
+static CRYPTO_THREAD_LOCAL ctxkey;
+static CRYPTO_THREAD_LOCAL poolkey;
+static int async_inited = 0;
+
+static void async_pool_free(async_pool *pool);
+
+static void async_ctx_free_cb(void *ctx)
+{
+    OPENSSL_free(ctx);
+}
+
+static void async_pool_free_cb(void *pool)
+{
+    async_pool_free(pool);
+}
+
+static void async_init(void)
+{
+    if (!CRYPTO_THREAD_init_local(&ctxkey, async_ctx_free_cb))
+        return;
+    if (!CRYPTO_THREAD_init_local(&poolkey, async_pool_free_cb)) {
+        CRYPTO_THREAD_cleanup_local(&ctxkey);
+        return;
+    }
+    async_inited = 1;
+}
+
+static int async_init_once(void)
+{
+    return CRYPTO_THREAD_run_once(&async_once, async_init) && async_inited;
+}
+
+async_ctx *async_get_ctx(void)
+{
+    if (!async_init_once())
+        return NULL;
+    return CRYPTO_THREAD_get_local(&ctxkey);
+}
+
+static async_ctx *async_ctx_new(void)
+{
+    async_ctx *nctx;
+
+    nctx = OPENSSL_malloc(sizeof(*nctx));
+    if (nctx == NULL) {
+        ASYNCerr(ASYNC_F_ASYNC_CTX_NEW, ERR_R_MALLOC_FAILURE);
+        return NULL;
+    }
+
+    async_fibre_init_dispatcher(&nctx->dispatcher);
+    nctx->currjob = NULL;
+    nctx->blocked = 0;
+    if (!CRYPTO_THREAD_set_local(&ctxkey, nctx)) {
+        ASYNCerr(ASYNC_F_ASYNC_CTX_NEW, ASYNC_R_INIT_FAILED);
+        OPENSSL_free(nctx);
+        return NULL;
+    }
+
+    return nctx;
+}
+
+static async_pool *async_get_pool(void)
+{
+    if (!async_init_once())
+        return NULL;
+    return CRYPTO_THREAD_get_local(&poolkey);
+}
+
+static ASYNC_JOB *async_job_new(void)
+{
+    ASYNC_JOB *job;
+    OSSL_ASYNC_FD pipefds[2];
+
+    job = OPENSSL_zalloc(sizeof(*job));
+    if (job == NULL) {
+        ASYNCerr(ASYNC_F_ASYNC_JOB_NEW, ERR_R_MALLOC_FAILURE);
+        return NULL;
+    }
+
+    if (!async_fibre_makecontext(&job->fibrectx)) {
+        ASYNCerr(ASYNC_F_ASYNC_JOB_NEW, ERR_R_MALLOC_FAILURE);
+        OPENSSL_free(job);
+        return NULL;
+    }
+
+    if (!async_pipe(pipefds)) {
+        ASYNCerr(ASYNC_F_ASYNC_JOB_NEW, ASYNC_R_CANNOT_CREATE_WAIT_PIPE);
+        async_fibre_free(&job->fibrectx);
+        OPENSSL_free(job);
+        return NULL;
+    }
+
+    job->status = ASYNC_JOB_RUNNING;
+    job->wait_fd = pipefds[0];
+    job->wake_fd = pipefds[1];
+
+    return job;
+}
+
+static void async_job_free(ASYNC_JOB *job)
+{
+    if (job == NULL)
+        return;
+
+    OPENSSL_free(job->funcargs);
+    async_fibre_free(&job->fibrectx);
+    async_close_fd(job->wait_fd);
+    async_close_fd(job->wake_fd);
+    OPENSSL_free(job);
+}
+
+/*
+ * Take an idle job from this thread's pool, creating one if the pool is
+ * below its size limit.  Returns NULL with |*exhausted| set if the pool is
+ * full and every job in it is in use.
+ */
+static ASYNC_JOB *async_get_pool_job(int *exhausted)
+{
+    ASYNC_JOB *job;
+    async_pool *pool;
+
+    *exhausted = 0;
+    pool = async_get_pool();
+    if (pool == NULL) {
+        /*
+         * Pool has not been initialised, so init with the defaults, i.e.
+         * no limit on the number of jobs and nothing created up front
+         */
+        if (!ASYNC_init_thread(0, 0))
+            return NULL;
+        pool = async_get_pool();
+    }
+
+    job = pool->free_jobs;
+    if (job != NULL) {
+        pool->free_jobs = job->next;
+        job->next = NULL;
+        return job;
+    }
+
+    if (pool->max_size != 0 && pool->curr_size >= pool->max_size) {
+        *exhausted = 1;
+        return NULL;
+    }
+
+    job = async_job_new();
+    if (job != NULL)
+        pool->curr_size++;
+
+    return job;
+}
+
+static void async_release_job(ASYNC_JOB *job)
+{
+    async_pool *pool = async_get_pool();
+
+    if (pool == NULL) {
+        /* ASYNC_cleanup_thread() has been called under our feet */
+        async_job_free(job);
+        return;
+    }
+
+    OPENSSL_free(job->funcargs);
+    job->funcargs = NULL;
+    ASYNC_clear_wake(job);
+    job->status = ASYNC_JOB_RUNNING;
+    job->next = pool->free_jobs;
+    pool->free_jobs = job;
+}
+
+/*
+ * Entry point of every fibre.  A fibre never returns: once its job has
+ * finished it switches back to the dispatcher, and it resumes here when
+ * the pool hands the same job out again.
+ */
+void async_start_func(void)
+{
+    ASYNC_JOB *job;
+    async_ctx *ctx = async_get_ctx();
+
+    for (;;) {
+        job = ctx->currjob;
+        job->ret = job->func(job->funcargs);
+
+        job->status = ASYNC_JOB_STOPPING;
+        if (!async_fibre_swapcontext(&job->fibrectx, &ctx->dispatcher, 1)) {
+            /*
+             * Should not happen, and there is nowhere sensible to return
+             * to.  Record the failure and go round again.
+             */
+            ASYNCerr(ASYNC_F_ASYNC_START_FUNC,
+                     ASYNC_R_FAILED_TO_SWAP_CONTEXT);
+        }
+    }
+}
+
+int ASYNC_start_job(ASYNC_JOB **job, int *ret, int (*func) (void *),
+                    void *args, size_t size)
+{
+    async_ctx *ctx;
+    int exhausted;
+
+    if (!ASYNC_is_capable()) {
+        ASYNCerr(ASYNC_F_ASYNC_START_JOB, ASYNC_R_NOT_SUPPORTED);
+        return ASYNC_ERR;
+    }
+
+    ctx = async_get_ctx();
+    if (ctx == NULL)
+        ctx = async_ctx_new();
+    if (ctx == NULL)
+        return ASYNC_ERR;
+
+    if (ctx->currjob != NULL) {
+        /* Jobs cannot be started from inside another job */
+        ASYNCerr(ASYNC_F_ASYNC_START_JOB, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+        return ASYNC_ERR;
+    }
+
+    if (*job != NULL) {
+        if ((*job)->status != ASYNC_JOB_PAUSED) {
+            ASYNCerr(ASYNC_F_ASYNC_START_JOB, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+            return ASYNC_ERR;
+        }
+        /* Resume a paused job */
+        ctx->currjob = *job;
+        ctx->currjob->status = ASYNC_JOB_RUNNING;
+    } else {
+        /* Start a new job */
+        if ((ctx->currjob = async_get_pool_job(&exhausted)) == NULL)
+            return exhausted ? ASYNC_NO_JOBS : ASYNC_ERR;
+
+        if (args != NULL) {
+            ctx->currjob->funcargs = OPENSSL_malloc(size);
+            if (ctx->currjob->funcargs == NULL) {
+                ASYNCerr(ASYNC_F_ASYNC_START_JOB, ERR_R_MALLOC_FAILURE);
+                async_release_job(ctx->currjob);
+                ctx->currjob = NULL;
+                return ASYNC_ERR;
+            }
+            memcpy(ctx->currjob->funcargs, args, size);
+        } else {
+            ctx->currjob->funcargs = NULL;
+        }
+        ctx->currjob->func = func;
+    }
+
+    if (!async_fibre_swapcontext(&ctx->dispatcher,
+                                 &ctx->currjob->fibrectx, 1)) {
+        ASYNCerr(ASYNC_F_ASYNC_START_JOB, ASYNC_R_FAILED_TO_SWAP_CONTEXT);
+        async_release_job(ctx->currjob);
+        ctx->currjob = NULL;
+        *job = NULL;
+        return ASYNC_ERR;
+    }
+
+    /* The job has either paused or finished */
+    if (ctx->currjob->status == ASYNC_JOB_PAUSING) {
+        *job = ctx->currjob;
+        ctx->currjob->status = ASYNC_JOB_PAUSED;
+        ctx->currjob = NULL;
+        return ASYNC_PAUSE;
+    }
+
+    *ret = ctx->currjob->ret;
+    async_release_job(ctx->currjob);
+    ctx->currjob = NULL;
+    *job = NULL;
+    return ASYNC_FINISH;
+}
+
+int ASYNC_pause_job(void)
+{
+    ASYNC_JOB *job;
+    async_ctx *ctx = async_get_ctx();
+
+    if (ctx == NULL || ctx->currjob == NULL || ctx->blocked) {
+        /*
+         * Not running inside a job, or pausing has been blocked: carry on
+         * synchronously, which counts as success.
+         */
+        return 1;
+    }
+
+    job = ctx->currjob;
+    job->status = ASYNC_JOB_PAUSING;
+
+    if (!async_fibre_swapcontext(&job->fibrectx, &ctx->dispatcher, 1)) {
+        ASYNCerr(ASYNC_F_ASYNC_PAUSE_JOB, ASYNC_R_FAILED_TO_SWAP_CONTEXT);
+        return 0;
+    }
+
+    return 1;
+}
+
+void ASYNC_abort_job(ASYNC_JOB *job)
+{
+    async_pool *pool;
+    async_ctx *ctx = async_get_ctx();
+
+    /* Only a job that is paused can be thrown away */
+    if (job == NULL || job->status != ASYNC_JOB_PAUSED
+            || (ctx != NULL && ctx->currjob == job))
+        return;
+
+    /*
+     * The fibre is never resumed, so anything |func| still holds on its
+     * stack is lost.  The job no longer counts against the pool limit.
+     */
+    pool = async_get_pool();
+    if (pool != NULL && pool->curr_size > 0)
+        pool->curr_size--;
+    async_job_free(job);
+}
+
+static void async_pool_free(async_pool *pool)
+{
+    ASYNC_JOB *job;
+
+    if (pool == NULL)
+        return;
+
+    while ((job = pool->free_jobs) != NULL) {
+        pool->free_jobs = job->next;
+        async_job_free(job);
+    }
+    OPENSSL_free(pool);
+}
+
+int ASYNC_init_thread(size_t max_size, size_t init_size)
+{
+    async_pool *pool;
+    ASYNC_JOB *job;
+
+    if (max_size != 0 && init_size > max_size) {
+        ASYNCerr(ASYNC_F_ASYNC_INIT_THREAD, ASYNC_R_INVALID_POOL_SIZE);
+        return 0;
+    }
+
+    if (!async_init_once()) {
+        ASYNCerr(ASYNC_F_ASYNC_INIT_THREAD, ASYNC_R_INIT_FAILED);
+        return 0;
+    }
+
+    if (async_get_pool() != NULL) {
+        ASYNCerr(ASYNC_F_ASYNC_INIT_THREAD, ASYNC_R_POOL_ALREADY_INITED);
+        return 0;
+    }
+
+    pool = OPENSSL_zalloc(sizeof(*pool));
+    if (pool == NULL) {
+        ASYNCerr(ASYNC_F_ASYNC_INIT_THREAD, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    pool->max_size = max_size;
+
+    /* Pre-create jobs as required */
+    while (init_size-- > 0) {
+        job = async_job_new();
+        if (job == NULL) {
+            /* Not fatal: we just start with a smaller pool */
+            break;
+        }
+        job->next = pool->free_jobs;
+        pool->free_jobs = job;
+        pool->curr_size++;
+    }
+
+    if (!CRYPTO_THREAD_set_local(&poolkey, pool)) {
+        ASYNCerr(ASYNC_F_ASYNC_INIT_THREAD, ASYNC_R_FAILED_TO_SET_POOL);
+        async_pool_free(pool);
+        return 0;
+    }
+
+    return 1;
+}
+
+void ASYNC_cleanup_thread(void)
+{
+    async_ctx *ctx;
+
+    if (!async_init_once())
+        return;
+
+    /* Jobs that are still paused belong to whoever started them */
+    async_pool_free(CRYPTO_THREAD_get_local(&poolkey));
+    CRYPTO_THREAD_set_local(&poolkey, NULL);
+
+    ctx = CRYPTO_THREAD_get_local(&ctxkey);
+    OPENSSL_free(ctx);
+    CRYPTO_THREAD_set_local(&ctxkey, NULL);
+}
+
+ASYNC_JOB *ASYNC_get_current_job(void)
+{
+    async_ctx *ctx = async_get_ctx();
+
+    if (ctx == NULL)
+        return NULL;
+
+    return ctx->currjob;
+}
+
+OSSL_ASYNC_FD ASYNC_get_wait_fd(ASYNC_JOB *job)
+{
+    return job->wait_fd;
+}
+
+void ASYNC_wake(ASYNC_JOB *job)
+{
+    char dummy = 0;
+
+    if (job->wake_set)
+        return;
+    async_write1(job->wake_fd, &dummy);
+    job->wake_set = 1;
+}
+
+void ASYNC_clear_wake(ASYNC_JOB *job)
+{
+    char dummy = 0;
+
+    if (!job->wake_set)
+        return;
+    async_read1(job->wait_fd, &dummy);
+    job->wake_set = 0;
+}
+
+void ASYNC_block_pause(void)
+{
+    async_ctx *ctx = async_get_ctx();
+
+    /* Nothing to block unless we are inside a job */
+    if (ctx == NULL || ctx->currjob == NULL)
+        return;
+    ctx->blocked++;
+}
+
+void ASYNC_unblock_pause(void)
+{
+    async_ctx *ctx = async_get_ctx();
+
+    if (ctx == NULL || ctx->currjob == NULL || ctx->blocked == 0)
+        return;
+    ctx->blocked--;
+}
@@ -34,3 +34,12 @@
 #  define UP_close        close
 # endif
 #endif
+
+/*
+ * Where writev() is available, BIO_s_socket() and BIO_s_fd() hand up to
+ * BIO_IOV_MAX buffers of a BIO_writev() to a single call of it.
+ */
+#if defined(OPENSSL_SYS_UNIX) && !defined(WATT32)
+# include <sys/uio.h>
+# define BIO_IOV_MAX     64
+#endif
@@ -58,10 +58,12 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <limits.h>
 #include <openssl/crypto.h>
 #include "internal/cryptlib.h"
 #include <openssl/bio.h>
 #include <openssl/stack.h>
+#include "internal/refcount.h"
 
 BIO *BIO_new(BIO_METHOD *method)
 {
@@ -110,7 +112,7 @@ int BIO_free(BIO *a)
     if (a == NULL)
         return (0);
 
-    i = CRYPTO_add(&a->references, -1, CRYPTO_LOCK_BIO);
+    i = CRYPTO_DOWN_REF(&a->references, CRYPTO_LOCK_BIO);
 #ifdef REF_PRINT
     REF_PRINT("BIO", a);
 #endif
@@ -249,6 +251,61 @@ int BIO_write(BIO *b, const void *in, int inl)
     return (i);
 }
 
+/*
+ * Write the |iovcnt| buffers of |iov| one after the other. Like BIO_write()
+ * this may write less than all of them, and returns the number of bytes
+ * written.
+ */
+int BIO_writev(BIO *b, const BIO_IOVEC *iov, int iovcnt)
+{
+    int i, ret = 0;
+    size_t len = 0;
+
+    if (b == NULL)
+        return (0);
+
+    if ((b->method == NULL) || (b->method->bwrite == NULL)) {
+        BIOerr(BIO_F_BIO_WRITEV, BIO_R_UNSUPPORTED_METHOD);
+        return (-2);
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].len > (size_t)INT_MAX - len) {
+            BIOerr(BIO_F_BIO_WRITEV, BIO_R_INVALID_ARGUMENT);
+            return (-1);
+        }
+        len += iov[i].len;
+    }
+
+    /* A callback gets to see each of the buffers in turn */
+    if (b->method->bwritev == NULL || b->callback != NULL) {
+        for (i = 0; i < iovcnt; i++) {
+            int n;
+
+            if (iov[i].len == 0)
+                continue;
+            n = BIO_write(b, iov[i].base, (int)iov[i].len);
+            if (n <= 0)
+                return ret > 0 ? ret : n;
+            ret += n;
+            if ((size_t)n < iov[i].len)
+                break;
+        }
+        return ret;
+    }
+
+    if (!b->init) {
+        BIOerr(BIO_F_BIO_WRITEV, BIO_R_UNINITIALIZED);
+        return (-2);
+    }
+
+    ret = b->method->bwritev(b, iov, iovcnt);
+
+    if (ret > 0)
+        b->num_write += (uint64_t)ret;
+    return (ret);
+}
+
 int BIO_puts(BIO *b, const char *in)
 {
     int i;
@@ -100,6 +100,11 @@ BIO_METHOD *BIO_s_fd(void)
 # include "bio_lcl.h"
 
 static int fd_write(BIO *h, const char *buf, int num);
+# ifdef BIO_IOV_MAX
+static int fd_writev(BIO *h, const BIO_IOVEC *iov, int iovcnt);
+# else
+#  define fd_writev NULL
+# endif
 static int fd_read(BIO *h, char *buf, int size);
 static int fd_puts(BIO *h, const char *str);
 static int fd_gets(BIO *h, char *buf, int size);
@@ -118,6 +123,7 @@ static BIO_METHOD methods_fdp = {
     fd_new,
     fd_free,
     NULL,
+    fd_writev,
 };
 
 BIO_METHOD *BIO_s_fd(void)
@@ -187,6 +193,29 @@ static int fd_write(BIO *b, const char *in, int inl)
     return (ret);
 }
 
+# ifdef BIO_IOV_MAX
+static int fd_writev(BIO *b, const BIO_IOVEC *iov, int iovcnt)
+{
+    struct iovec v[BIO_IOV_MAX];
+    int i, ret;
+
+    if (iovcnt > BIO_IOV_MAX)
+        iovcnt = BIO_IOV_MAX;
+    for (i = 0; i < iovcnt; i++) {
+        v[i].iov_base = (void *)iov[i].base;
+        v[i].iov_len = iov[i].len;
+    }
+    clear_sys_error();
+    ret = (int)writev(b->num, v, iovcnt);
+    BIO_clear_retry_flags(b);
+    if (ret <= 0) {
+        if (BIO_fd_should_retry(ret))
+            BIO_set_retry_write(b);
+    }
+    return (ret);
+}
+# endif
+
 static long fd_ctrl(BIO *b, int cmd, long num, void *ptr)
 {
     long ret = 1;
@@ -64,6 +64,7 @@
 #ifndef OPENSSL_NO_SOCK
 
 # include <openssl/bio.h>
+# include "bio_lcl.h"
 
 # ifdef WATT32
 #  define sock_write SockWrite  /* Watt-32 uses same names */
@@ -72,6 +73,11 @@
 # endif
 
 static int sock_write(BIO *h, const char *buf, int num);
+# ifdef BIO_IOV_MAX
+static int sock_writev(BIO *h, const BIO_IOVEC *iov, int iovcnt);
+# else
+#  define sock_writev NULL
+# endif
 static int sock_read(BIO *h, char *buf, int size);
 static int sock_puts(BIO *h, const char *str);
 static long sock_ctrl(BIO *h, int cmd, long arg1, void *arg2);
@@ -90,6 +96,7 @@ static BIO_METHOD methods_sockp = {
     sock_new,
     sock_free,
     NULL,
+    sock_writev,
 };
 
 BIO_METHOD *BIO_s_socket(void)
@@ -161,6 +168,29 @@ static int sock_write(BIO *b, const char *in, int inl)
     return (ret);
 }
 
+# ifdef BIO_IOV_MAX
+static int sock_writev(BIO *b, const BIO_IOVEC *iov, int iovcnt)
+{
+    struct iovec v[BIO_IOV_MAX];
+    int i, ret;
+
+    if (iovcnt > BIO_IOV_MAX)
+        iovcnt = BIO_IOV_MAX;
+    for (i = 0; i < iovcnt; i++) {
+        v[i].iov_base = (void *)iov[i].base;
+        v[i].iov_len = iov[i].len;
+    }
+    clear_socket_error();
+    ret = (int)writev(b->num, v, iovcnt);
+    BIO_clear_retry_flags(b);
+    if (ret <= 0) {
+        if (BIO_sock_should_retry(ret))
+            BIO_set_retry_write(b);
+    }
+    return (ret);
+}
+# endif
+
 static long sock_ctrl(BIO *b, int cmd, long num, void *ptr)
 {
     long ret = 1;
@@ -497,6 +497,27 @@ BN_MONT_CTX *BN_MONT_CTX_copy(BN_MONT_CTX *to, BN_MONT_CTX *from)
     return (to);
 }
 
+/*
+ * We don't want to serialise globally while doing our lazy-init math in
+ * BN_MONT_CTX_set. That punishes threads that are doing independent
+ * things. Instead, punish the case where more than one thread tries to
+ * lazy-init the same 'pmont', by having each do the lazy-init math work
+ * independently and only use the one from the thread that wins the race
+ * (the losers throw away the work they've done).
+ */
+static BN_MONT_CTX *mont_ctx_compute(const BIGNUM *mod, BN_CTX *ctx)
+{
+    BN_MONT_CTX *ret = BN_MONT_CTX_new();
+
+    if (!ret)
+        return NULL;
+    if (!BN_MONT_CTX_set(ret, mod, ctx)) {
+        BN_MONT_CTX_free(ret);
+        return NULL;
+    }
+    return ret;
+}
+
 BN_MONT_CTX *BN_MONT_CTX_set_locked(BN_MONT_CTX **pmont, int lock,
                                     const BIGNUM *mod, BN_CTX *ctx)
 {
@@ -508,21 +529,8 @@ BN_MONT_CTX *BN_MONT_CTX_set_locked(BN_MONT_CTX **pmont, int lock,
     if (ret)
         return ret;
 
-    /*
-     * We don't want to serialise globally while doing our lazy-init math in
-     * BN_MONT_CTX_set. That punishes threads that are doing independent
-     * things. Instead, punish the case where more than one thread tries to
-     * lazy-init the same 'pmont', by having each do the lazy-init math work
-     * independently and only use the one from the thread that wins the race
-     * (the losers throw away the work they've done).
-     */
-    ret = BN_MONT_CTX_new();
-    if (!ret)
+    if ((ret = mont_ctx_compute(mod, ctx)) == NULL)
         return NULL;
-    if (!BN_MONT_CTX_set(ret, mod, ctx)) {
-        BN_MONT_CTX_free(ret);
-        return NULL;
-    }
 
     /* The locked compare-and-set, after the local work is done. */
     CRYPTO_w_lock(lock);
@@ -534,3 +542,28 @@ BN_MONT_CTX *BN_MONT_CTX_set_locked(BN_MONT_CTX **pmont, int lock,
     CRYPTO_w_unlock(lock);
     return ret;
 }
+
+/* As BN_MONT_CTX_set_locked() but using the owning object's own lock */
+BN_MONT_CTX *bn_mont_ctx_set_locked(BN_MONT_CTX **pmont, CRYPTO_RWLOCK *lock,
+                                    const BIGNUM *mod, BN_CTX *ctx)
+{
+    BN_MONT_CTX *ret;
+
+    CRYPTO_THREAD_read_lock(lock);
+    ret = *pmont;
+    CRYPTO_THREAD_unlock(lock);
+    if (ret)
+        return ret;
+
+    if ((ret = mont_ctx_compute(mod, ctx)) == NULL)
+        return NULL;
+
+    CRYPTO_THREAD_write_lock(lock);
+    if (*pmont) {
+        BN_MONT_CTX_free(ret);
+        ret = *pmont;
+    } else
+        *pmont = ret;
+    CRYPTO_THREAD_unlock(lock);
+    return ret;
+}
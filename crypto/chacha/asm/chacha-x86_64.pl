@@ -0,0 +1,544 @@
+#!/usr/bin/env perl
+#
+# ChaCha20 for x86_64.
+#
+# Two multi-block kernels are provided, both working on a "vertical"
+# layout in which every register holds the same state word of 4 (SSSE3)
+# or 8 (AVX2) consecutive blocks.  This way the quarter-rounds need no
+# lane shuffles, and the 8- and 16-bit rotations collapse to a single
+# pshufb.  Twelve of the sixteen state words live in registers for the
+# whole round loop, the remaining "c" row is paired in and out of the
+# stack two words at a time, which is arranged so that every column and
+# diagonal round finds its pair already loaded.  Output is transposed
+# back to block order just before it is XOR-ed with the input.
+#
+# The kernels process whole 256- or 512-byte chunks only.  Dispatch and
+# the partial-chunk tail are left to ChaCha20_ctr32 in chacha_enc.c.
+#
+# ChaCha20_4x_ssse3(out, inp, len, key[8], counter[4]);
+#	len is a non-zero multiple of 256
+# ChaCha20_8x_avx2(out, inp, len, key[8], counter[4]);
+#	len is a non-zero multiple of 512
+#
+# Performance in cycles per byte, as measured with 'openssl speed -evp
+# chacha20' on 8KB buffers:
+#
+#		C		SSSE3		AVX2
+# Xeon 2.1GHz	5.4		2.0		1.0
+#
+# If the assembler can't handle AVX2, ChaCha20_8x_avx2 is emitted as a
+# tail call to ChaCha20_4x_ssse3, which accepts any multiple of 512 too.
+
+$flavour = shift;
+$output  = shift;
+if ($flavour =~ /\./) { $output = $flavour; undef $flavour; }
+
+$win64=0; $win64=1 if ($flavour =~ /[nm]asm|mingw64/ || $output =~ /\.asm$/);
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+		=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.19) + ($1>=2.22);
+}
+
+if (!$avx && $win64 && ($flavour =~ /nasm/ || $ENV{ASM} =~ /nasm/) &&
+	    `nasm -v 2>&1` =~ /NASM version ([2-9]\.[0-9]+)/) {
+	$avx = ($1>=2.09) + ($1>=2.10);
+}
+
+if (!$avx && $win64 && ($flavour =~ /masm/ || $ENV{ASM} =~ /ml64/) &&
+	    `ml64 2>&1` =~ /Version ([0-9]+)\./) {
+	$avx = ($1>=10) + ($1>=11);
+}
+
+if (!$avx && `$ENV{CC} -v 2>&1` =~ /(^clang version|based on LLVM) ([3-9]\.[0-9]+)/) {
+	$avx = ($2>=3.0) + ($2>3.0);
+}
+
+open OUT,"| \"$^X\" $xlate $flavour $output";
+*STDOUT=*OUT;
+
+# argument layout, same for both kernels
+($out,$inp,$len,$key,$counter)=("%rdi","%rsi","%rdx","%rcx","%r8");
+$frame="%r9";		# %rsp before realignment
+$rounds="%eax";
+
+$code.=<<___;
+.text
+
+.align	64
+.Lsigma:
+.asciz	"expand 32-byte k"
+.align	64
+.Lrot16:
+.byte	0x2,0x3,0x0,0x1, 0x6,0x7,0x4,0x5, 0xa,0xb,0x8,0x9, 0xe,0xf,0xc,0xd
+.byte	0x2,0x3,0x0,0x1, 0x6,0x7,0x4,0x5, 0xa,0xb,0x8,0x9, 0xe,0xf,0xc,0xd
+.Lrot24:
+.byte	0x3,0x0,0x1,0x2, 0x7,0x4,0x5,0x6, 0xb,0x8,0x9,0xa, 0xf,0xc,0xd,0xe
+.byte	0x3,0x0,0x1,0x2, 0x7,0x4,0x5,0x6, 0xb,0x8,0x9,0xa, 0xf,0xc,0xd,0xe
+.Linc:
+.long	0,1,2,3,4,5,6,7
+.Lfour:
+.long	4,4,4,4
+.Leight:
+.long	8,8,8,8,8,8,8,8
+___
+
+# Win64 ABI treats %xmm6-%xmm15 as non-volatile.
+sub win64_prologue {
+    return if (!$win64);
+    $code.="	lea	-0xa8(%rsp),%rsp\n";
+    for (my $i=6; $i<16; $i++) {
+	$code.=sprintf("	movaps	%%xmm%d,0x%x(%%rsp)\n",$i,16*($i-6));
+    }
+}
+
+sub win64_epilogue {
+    return if (!$win64);
+    for (my $i=6; $i<16; $i++) {
+	$code.=sprintf("	movaps	0x%x(%%rsp),%%xmm%d\n",16*($i-6),$i);
+    }
+    $code.="	lea	0xa8(%rsp),%rsp\n";
+}
+
+########################################################################
+# SSSE3 4x kernel
+#
+# Stack frame, 64-byte aligned:
+#	0x000-0x0ff	input state, word i at 16*i
+#	0x100-0x13f	spilled "c" row, word 8+i at 0x100+16*i
+
+{
+my @a=map("%xmm$_",(0..3));	# words 0-3
+my @b=map("%xmm$_",(4..7));	# words 4-7
+my @d=map("%xmm$_",(8..11));	# words 12-15
+my @c=("%xmm12","%xmm13");	# two words of 8-11
+my @t=("%xmm14","%xmm15");
+
+# Two interleaved quarter-rounds.
+sub SSSE3_QR2 {
+my ($a0,$b0,$c0,$d0,$a1,$b1,$c1,$d1)=@_;
+$code.=<<___;
+	paddd	$b0,$a0
+	paddd	$b1,$a1
+	pxor	$a0,$d0
+	pxor	$a1,$d1
+	pshufb	.Lrot16(%rip),$d0
+	pshufb	.Lrot16(%rip),$d1
+	paddd	$d0,$c0
+	paddd	$d1,$c1
+	pxor	$c0,$b0
+	pxor	$c1,$b1
+	movdqa	$b0,$t[0]
+	pslld	\$12,$b0
+	psrld	\$20,$t[0]
+	movdqa	$b1,$t[1]
+	pslld	\$12,$b1
+	por	$t[0],$b0
+	psrld	\$20,$t[1]
+	por	$t[1],$b1
+	paddd	$b0,$a0
+	paddd	$b1,$a1
+	pxor	$a0,$d0
+	pxor	$a1,$d1
+	pshufb	.Lrot24(%rip),$d0
+	pshufb	.Lrot24(%rip),$d1
+	paddd	$d0,$c0
+	paddd	$d1,$c1
+	pxor	$c0,$b0
+	pxor	$c1,$b1
+	movdqa	$b0,$t[0]
+	pslld	\$7,$b0
+	psrld	\$25,$t[0]
+	movdqa	$b1,$t[1]
+	pslld	\$7,$b1
+	por	$t[0],$b0
+	psrld	\$25,$t[1]
+	por	$t[1],$b1
+___
+}
+
+# Transpose four words of four blocks held in @r, using $t and $u as
+# scratch, then XOR 16 bytes of each block with input at offset $off.
+# $u is clobbered.
+sub SSSE3_TRANSPOSE_XOR {
+my ($off,$t,$u,@r)=@_;
+$code.=<<___;
+	movdqa	$r[0],$t
+	punpckldq	$r[1],$r[0]
+	punpckhdq	$r[1],$t
+	movdqa	$r[2],$u
+	punpckldq	$r[3],$r[2]
+	punpckhdq	$r[3],$u
+	movdqa	$r[0],$r[1]
+	punpcklqdq	$r[2],$r[0]
+	punpckhqdq	$r[2],$r[1]
+	movdqa	$t,$r[2]
+	punpcklqdq	$u,$r[2]
+	punpckhqdq	$u,$t
+___
+my @blk=($r[0],$r[1],$r[2],$t);
+for (my $j=0; $j<4; $j++) {
+$code.=<<___;
+	movdqu	`64*$j+$off`($inp),$u
+	pxor	$blk[$j],$u
+	movdqu	$u,`64*$j+$off`($out)
+___
+}
+}
+
+$code.=<<___;
+.globl	ChaCha20_4x_ssse3
+.type	ChaCha20_4x_ssse3,\@function,5
+.align	32
+ChaCha20_4x_ssse3:
+___
+&win64_prologue();
+$code.=<<___;
+	mov	%rsp,$frame
+	sub	\$0x140+64,%rsp
+	and	\$-64,%rsp
+
+	movdqa	.Lsigma(%rip),@t[0]
+	movdqu	($key),@t[1]
+	movdqu	16($key),@c[0]
+	movdqu	($counter),@c[1]
+___
+for (my $i=0; $i<4; $i++) {
+my $imm=sprintf("0x%02x",0x55*$i);
+$code.=<<___;
+	pshufd	\$$imm,@t[0],@a[$i]
+	pshufd	\$$imm,@t[1],@b[$i]
+	movdqa	@a[$i],`16*$i`(%rsp)
+	pshufd	\$$imm,@c[0],@a[$i]
+	movdqa	@b[$i],`16*(4+$i)`(%rsp)
+	pshufd	\$$imm,@c[1],@d[$i]
+	movdqa	@a[$i],`16*(8+$i)`(%rsp)
+___
+}
+$code.=<<___;
+	paddd	.Linc(%rip),@d[0]
+	movdqa	@d[0],0xc0(%rsp)
+	movdqa	@d[1],0xd0(%rsp)
+	movdqa	@d[2],0xe0(%rsp)
+	movdqa	@d[3],0xf0(%rsp)
+	jmp	.Loop_outer4x
+
+.align	32
+.Loop_outer4x:
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	movdqa	`16*$i`(%rsp),@a[$i]
+	movdqa	`16*(4+$i)`(%rsp),@b[$i]
+	movdqa	`16*(12+$i)`(%rsp),@d[$i]
+___
+}
+$code.=<<___;
+	movdqa	0x80(%rsp),@c[0]
+	movdqa	0x90(%rsp),@c[1]
+	movdqa	0xa0(%rsp),@t[0]
+	movdqa	0xb0(%rsp),@t[1]
+	movdqa	@t[0],0x120(%rsp)
+	movdqa	@t[1],0x130(%rsp)
+	mov	\$10,$rounds
+	jmp	.Loop4x
+
+.align	32
+.Loop4x:
+___
+	&SSSE3_QR2(@a[0],@b[0],@c[0],@d[0], @a[1],@b[1],@c[1],@d[1]);
+$code.=<<___;
+	movdqa	@c[0],0x100(%rsp)
+	movdqa	@c[1],0x110(%rsp)
+	movdqa	0x120(%rsp),@c[0]
+	movdqa	0x130(%rsp),@c[1]
+___
+	&SSSE3_QR2(@a[2],@b[2],@c[0],@d[2], @a[3],@b[3],@c[1],@d[3]);
+	&SSSE3_QR2(@a[0],@b[1],@c[0],@d[3], @a[1],@b[2],@c[1],@d[0]);
+$code.=<<___;
+	movdqa	@c[0],0x120(%rsp)
+	movdqa	@c[1],0x130(%rsp)
+	movdqa	0x100(%rsp),@c[0]
+	movdqa	0x110(%rsp),@c[1]
+___
+	&SSSE3_QR2(@a[2],@b[3],@c[0],@d[1], @a[3],@b[0],@c[1],@d[2]);
+$code.=<<___;
+	dec	$rounds
+	jnz	.Loop4x
+
+	paddd	0x80(%rsp),@c[0]
+	paddd	0x90(%rsp),@c[1]
+	movdqa	@c[0],0x100(%rsp)
+	movdqa	@c[1],0x110(%rsp)
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	paddd	`16*$i`(%rsp),@a[$i]
+	paddd	`16*(4+$i)`(%rsp),@b[$i]
+	paddd	`16*(12+$i)`(%rsp),@d[$i]
+___
+}
+	&SSSE3_TRANSPOSE_XOR(0x00,@t,@a);
+	&SSSE3_TRANSPOSE_XOR(0x10,@t,@b);
+	&SSSE3_TRANSPOSE_XOR(0x30,@t,@d);
+$code.=<<___;
+	movdqa	0x100(%rsp),@a[0]
+	movdqa	0x110(%rsp),@a[1]
+	movdqa	0x120(%rsp),@a[2]
+	movdqa	0x130(%rsp),@a[3]
+	paddd	0xa0(%rsp),@a[2]
+	paddd	0xb0(%rsp),@a[3]
+___
+	&SSSE3_TRANSPOSE_XOR(0x20,@t,@a);
+$code.=<<___;
+	movdqa	0xc0(%rsp),@d[0]
+	paddd	.Lfour(%rip),@d[0]
+	movdqa	@d[0],0xc0(%rsp)
+
+	lea	0x100($inp),$inp
+	lea	0x100($out),$out
+	sub	\$0x100,$len
+	jnz	.Loop_outer4x
+
+	lea	($frame),%rsp
+___
+	&win64_epilogue();
+$code.=<<___;
+	ret
+.size	ChaCha20_4x_ssse3,.-ChaCha20_4x_ssse3
+___
+}
+
+########################################################################
+# AVX2 8x kernel
+#
+# Stack frame, 64-byte aligned:
+#	0x000-0x1ff	input state, word i at 32*i
+#	0x200-0x27f	spilled "c" row, word 8+i at 0x200+32*i
+
+if ($avx>1) {
+my @a=map("%ymm$_",(0..3));
+my @b=map("%ymm$_",(4..7));
+my @d=map("%ymm$_",(8..11));
+my @c=("%ymm12","%ymm13");
+my @t=("%ymm14","%ymm15");
+
+sub AVX2_QR2 {
+my ($a0,$b0,$c0,$d0,$a1,$b1,$c1,$d1)=@_;
+$code.=<<___;
+	vpaddd	$b0,$a0,$a0
+	vpaddd	$b1,$a1,$a1
+	vpxor	$a0,$d0,$d0
+	vpxor	$a1,$d1,$d1
+	vpshufb	.Lrot16(%rip),$d0,$d0
+	vpshufb	.Lrot16(%rip),$d1,$d1
+	vpaddd	$d0,$c0,$c0
+	vpaddd	$d1,$c1,$c1
+	vpxor	$c0,$b0,$b0
+	vpxor	$c1,$b1,$b1
+	vpslld	\$12,$b0,$t[0]
+	vpsrld	\$20,$b0,$b0
+	vpslld	\$12,$b1,$t[1]
+	vpsrld	\$20,$b1,$b1
+	vpor	$t[0],$b0,$b0
+	vpor	$t[1],$b1,$b1
+	vpaddd	$b0,$a0,$a0
+	vpaddd	$b1,$a1,$a1
+	vpxor	$a0,$d0,$d0
+	vpxor	$a1,$d1,$d1
+	vpshufb	.Lrot24(%rip),$d0,$d0
+	vpshufb	.Lrot24(%rip),$d1,$d1
+	vpaddd	$d0,$c0,$c0
+	vpaddd	$d1,$c1,$c1
+	vpxor	$c0,$b0,$b0
+	vpxor	$c1,$b1,$b1
+	vpslld	\$7,$b0,$t[0]
+	vpsrld	\$25,$b0,$b0
+	vpslld	\$7,$b1,$t[1]
+	vpsrld	\$25,$b1,$b1
+	vpor	$t[0],$b0,$b0
+	vpor	$t[1],$b1,$b1
+___
+}
+
+# Transpose 4x4 words within each 128-bit lane of @r, using $t as
+# scratch.  Returns the registers holding blocks 0-3 in their low lanes
+# and blocks 4-7 in their high lanes; the remaining one is free.
+sub AVX2_TRANSPOSE {
+my ($t,@r)=@_;
+$code.=<<___;
+	vpunpckldq	$r[1],$r[0],$t
+	vpunpckhdq	$r[1],$r[0],$r[1]
+	vpunpckldq	$r[3],$r[2],$r[0]
+	vpunpckhdq	$r[3],$r[2],$r[3]
+	vpunpcklqdq	$r[0],$t,$r[2]
+	vpunpckhqdq	$r[0],$t,$t
+	vpunpcklqdq	$r[3],$r[1],$r[0]
+	vpunpckhqdq	$r[3],$r[1],$r[3]
+___
+return ($r[2],$t,$r[0],$r[3],$r[1]);
+}
+
+# Combine two transposed groups of four words into 32-byte halves of
+# blocks and XOR them with input at offset $off within each block.
+sub AVX2_XOR_OUT {
+my ($off,$x,$lo,$hi)=@_;
+for (my $j=0; $j<4; $j++) {
+$code.=<<___;
+	vperm2i128	\$0x20,$$hi[$j],$$lo[$j],$x
+	vpxor	`64*$j+$off`($inp),$x,$x
+	vmovdqu	$x,`64*$j+$off`($out)
+	vperm2i128	\$0x31,$$hi[$j],$$lo[$j],$x
+	vpxor	`64*($j+4)+$off`($inp),$x,$x
+	vmovdqu	$x,`64*($j+4)+$off`($out)
+___
+}
+}
+
+$code.=<<___;
+.globl	ChaCha20_8x_avx2
+.type	ChaCha20_8x_avx2,\@function,5
+.align	32
+ChaCha20_8x_avx2:
+___
+&win64_prologue();
+$code.=<<___;
+	mov	%rsp,$frame
+	sub	\$0x280+64,%rsp
+	and	\$-64,%rsp
+	vzeroupper
+
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	vpbroadcastd	.Lsigma+`4*$i`(%rip),@a[$i]
+	vpbroadcastd	`4*$i`($key),@b[$i]
+	vpbroadcastd	`4*(4+$i)`($key),@t[0]
+	vpbroadcastd	`4*$i`($counter),@d[$i]
+	vmovdqa	@a[$i],`32*$i`(%rsp)
+	vmovdqa	@b[$i],`32*(4+$i)`(%rsp)
+	vmovdqa	@t[0],`32*(8+$i)`(%rsp)
+___
+}
+$code.=<<___;
+	vpaddd	.Linc(%rip),@d[0],@d[0]
+	vmovdqa	@d[0],0x180(%rsp)
+	vmovdqa	@d[1],0x1a0(%rsp)
+	vmovdqa	@d[2],0x1c0(%rsp)
+	vmovdqa	@d[3],0x1e0(%rsp)
+	jmp	.Loop_outer8x
+
+.align	32
+.Loop_outer8x:
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	vmovdqa	`32*$i`(%rsp),@a[$i]
+	vmovdqa	`32*(4+$i)`(%rsp),@b[$i]
+	vmovdqa	`32*(12+$i)`(%rsp),@d[$i]
+___
+}
+$code.=<<___;
+	vmovdqa	0x100(%rsp),@c[0]
+	vmovdqa	0x120(%rsp),@c[1]
+	vmovdqa	0x140(%rsp),@t[0]
+	vmovdqa	0x160(%rsp),@t[1]
+	vmovdqa	@t[0],0x240(%rsp)
+	vmovdqa	@t[1],0x260(%rsp)
+	mov	\$10,$rounds
+	jmp	.Loop8x
+
+.align	32
+.Loop8x:
+___
+	&AVX2_QR2(@a[0],@b[0],@c[0],@d[0], @a[1],@b[1],@c[1],@d[1]);
+$code.=<<___;
+	vmovdqa	@c[0],0x200(%rsp)
+	vmovdqa	@c[1],0x220(%rsp)
+	vmovdqa	0x240(%rsp),@c[0]
+	vmovdqa	0x260(%rsp),@c[1]
+___
+	&AVX2_QR2(@a[2],@b[2],@c[0],@d[2], @a[3],@b[3],@c[1],@d[3]);
+	&AVX2_QR2(@a[0],@b[1],@c[0],@d[3], @a[1],@b[2],@c[1],@d[0]);
+$code.=<<___;
+	vmovdqa	@c[0],0x240(%rsp)
+	vmovdqa	@c[1],0x260(%rsp)
+	vmovdqa	0x200(%rsp),@c[0]
+	vmovdqa	0x220(%rsp),@c[1]
+___
+	&AVX2_QR2(@a[2],@b[3],@c[0],@d[1], @a[3],@b[0],@c[1],@d[2]);
+$code.=<<___;
+	dec	$rounds
+	jnz	.Loop8x
+
+	vpaddd	0x100(%rsp),@c[0],@c[0]
+	vpaddd	0x120(%rsp),@c[1],@c[1]
+	vmovdqa	@c[0],0x200(%rsp)
+	vmovdqa	@c[1],0x220(%rsp)
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	vpaddd	`32*$i`(%rsp),@a[$i],@a[$i]
+	vpaddd	`32*(4+$i)`(%rsp),@b[$i],@b[$i]
+	vpaddd	`32*(12+$i)`(%rsp),@d[$i],@d[$i]
+___
+}
+{
+my @A=&AVX2_TRANSPOSE(@t[0],@a);
+my @B=&AVX2_TRANSPOSE(@t[1],@b);
+my $x=pop(@A);
+	&AVX2_XOR_OUT(0x00,$x,\@A,\@B);
+}
+$code.=<<___;
+	vmovdqa	0x200(%rsp),@a[0]
+	vmovdqa	0x220(%rsp),@a[1]
+	vmovdqa	0x240(%rsp),@a[2]
+	vmovdqa	0x260(%rsp),@a[3]
+	vpaddd	0x140(%rsp),@a[2],@a[2]
+	vpaddd	0x160(%rsp),@a[3],@a[3]
+___
+{
+my @C=&AVX2_TRANSPOSE(@t[0],@a);
+my @D=&AVX2_TRANSPOSE(@t[1],@d);
+my $x=pop(@C);
+	&AVX2_XOR_OUT(0x20,$x,\@C,\@D);
+}
+$code.=<<___;
+	vmovdqa	0x180(%rsp),@d[0]
+	vpaddd	.Leight(%rip),@d[0],@d[0]
+	vmovdqa	@d[0],0x180(%rsp)
+
+	lea	0x200($inp),$inp
+	lea	0x200($out),$out
+	sub	\$0x200,$len
+	jnz	.Loop_outer8x
+
+	vzeroupper
+	lea	($frame),%rsp
+___
+	&win64_epilogue();
+$code.=<<___;
+	ret
+.size	ChaCha20_8x_avx2,.-ChaCha20_8x_avx2
+___
+} else {
+$code.=<<___;
+.globl	ChaCha20_8x_avx2
+.type	ChaCha20_8x_avx2,\@abi-omnipotent
+.align	32
+ChaCha20_8x_avx2:
+	jmp	ChaCha20_4x_ssse3
+.size	ChaCha20_8x_avx2,.-ChaCha20_8x_avx2
+___
+}
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+
+print $code;
+
+close STDOUT;
@@ -62,6 +62,7 @@
 #include <openssl/aes.h>
 #include "cms_lcl.h"
 #include "internal/asn1_int.h"
+#include "internal/refcount.h"
 
 /* Key Agreement Recipient Info (KARI) routines */
 
@@ -366,7 +367,7 @@ int cms_RecipientInfo_kari_init(CMS_RecipientInfo *ri, X509 *recip,
     if (!cms_kari_create_ephemeral_key(kari, pk))
         return 0;
 
-    CRYPTO_add(&pk->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&pk->references, CRYPTO_LOCK_EVP_PKEY);
     rek->pkey = pk;
     return 1;
 }
@@ -61,6 +61,7 @@
 #include <openssl/cms.h>
 #include "cms_lcl.h"
 #include "internal/asn1_int.h"
+#include "internal/refcount.h"
 
 /* CMS SignedData Utilities */
 
@@ -282,7 +283,7 @@ CMS_SignerInfo *CMS_add1_signer(CMS_ContentInfo *cms,
         goto merr;
     X509_check_purpose(signer, -1, -1);
 
-    CRYPTO_add(&pk->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&pk->references, CRYPTO_LOCK_EVP_PKEY);
     X509_up_ref(signer);
 
     si->pkey = pk;
@@ -60,6 +60,7 @@
 #include "internal/cryptlib.h"
 #include <openssl/bn.h>
 #include <openssl/dh.h>
+#include "internal/refcount.h"
 #ifndef OPENSSL_NO_ENGINE
 # include <openssl/engine.h>
 #endif
@@ -157,7 +158,7 @@ void DH_free(DH *r)
 
     if (r == NULL)
         return;
-    i = CRYPTO_add(&r->references, -1, CRYPTO_LOCK_DH);
+    i = CRYPTO_DOWN_REF(&r->references, CRYPTO_LOCK_DH);
 #ifdef REF_PRINT
     REF_PRINT("DH", r);
 #endif
@@ -192,7 +193,7 @@ void DH_free(DH *r)
 
 int DH_up_ref(DH *r)
 {
-    int i = CRYPTO_add(&r->references, 1, CRYPTO_LOCK_DH);
+    int i = CRYPTO_UP_REF(&r->references, CRYPTO_LOCK_DH);
 #ifdef REF_PRINT
     REF_PRINT("DH", r);
 #endif
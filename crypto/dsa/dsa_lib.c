@@ -63,6 +63,7 @@
 #include <openssl/bn.h>
 #include <openssl/dsa.h>
 #include <openssl/asn1.h>
+#include "internal/refcount.h"
 #ifndef OPENSSL_NO_ENGINE
 # include <openssl/engine.h>
 #endif
@@ -165,7 +166,7 @@ void DSA_free(DSA *r)
     if (r == NULL)
         return;
 
-    i = CRYPTO_add(&r->references, -1, CRYPTO_LOCK_DSA);
+    i = CRYPTO_DOWN_REF(&r->references, CRYPTO_LOCK_DSA);
 #ifdef REF_PRINT
     REF_PRINT("DSA", r);
 #endif
@@ -199,7 +200,7 @@ void DSA_free(DSA *r)
 
 int DSA_up_ref(DSA *r)
 {
-    int i = CRYPTO_add(&r->references, 1, CRYPTO_LOCK_DSA);
+    int i = CRYPTO_UP_REF(&r->references, CRYPTO_LOCK_DSA);
 #ifdef REF_PRINT
     REF_PRINT("DSA", r);
 #endif
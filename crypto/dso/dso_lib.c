@@ -61,6 +61,7 @@
 #include <openssl/crypto.h>
 #include "internal/cryptlib.h"
 #include <openssl/dso.h>
+#include "internal/refcount.h"
 
 static DSO_METHOD *default_DSO_meth = NULL;
 
@@ -135,7 +136,7 @@ int DSO_free(DSO *dso)
     if (dso == NULL)
         return (1);
 
-    i = CRYPTO_add(&dso->references, -1, CRYPTO_LOCK_DSO);
+    i = CRYPTO_DOWN_REF(&dso->references, CRYPTO_LOCK_DSO);
 #ifdef REF_PRINT
     REF_PRINT("DSO", dso);
 #endif
@@ -177,7 +178,7 @@ int DSO_up_ref(DSO *dso)
         return (0);
     }
 
-    CRYPTO_add(&dso->references, 1, CRYPTO_LOCK_DSO);
+    CRYPTO_UP_REF(&dso->references, CRYPTO_LOCK_DSO);
     return (1);
 }
 
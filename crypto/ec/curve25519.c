@@ -0,0 +1,525 @@
+/* crypto/ec/curve25519.c */
+/*
+ * Constant-time implementation of the X25519 Diffie-Hellman function as
+ * specified in RFC 7748.  Field elements are held in radix 2^51 where the
+ * compiler offers a 128-bit integer type and in radix 2^16 otherwise.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+
+#include "ec_lcl.h"
+
+/*
+ * Both field element representations below provide the same set of
+ * primitives: fe_frombytes, fe_tobytes, fe_0, fe_1, fe_copy, fe_add,
+ * fe_sub, fe_mul, fe_sq, fe_mul121665 and fe_cswap.  None of them branch
+ * on or index memory by secret data, and the Montgomery ladder that
+ * follows is written only in terms of them.
+ */
+#if defined(__SIZEOF_INT128__) && __SIZEOF_INT128__ == 16 \
+    && !defined(CURVE25519_FORCE_BASE2_16)
+
+typedef unsigned long long u64;
+typedef __uint128_t u128;
+
+/* Element of GF(2^255-19) as five 51-bit limbs, least significant first */
+typedef u64 fe[5];
+
+# define MASK51 (((u64)1 << 51) - 1)
+
+static u64 load_u64(const unsigned char *p)
+{
+    return ((u64)p[0]) | ((u64)p[1] << 8) | ((u64)p[2] << 16) |
+           ((u64)p[3] << 24) | ((u64)p[4] << 32) | ((u64)p[5] << 40) |
+           ((u64)p[6] << 48) | ((u64)p[7] << 56);
+}
+
+static void store_u64(unsigned char *p, u64 v)
+{
+    int i;
+
+    for (i = 0; i < 8; i++, v >>= 8)
+        p[i] = (unsigned char)v;
+}
+
+/* The most significant bit of |s| is ignored, see RFC 7748 section 5 */
+static void fe_frombytes(fe h, const unsigned char s[32])
+{
+    h[0] = load_u64(s) & MASK51;
+    h[1] = (load_u64(s + 6) >> 3) & MASK51;
+    h[2] = (load_u64(s + 12) >> 6) & MASK51;
+    h[3] = (load_u64(s + 19) >> 1) & MASK51;
+    h[4] = (load_u64(s + 24) >> 12) & MASK51;
+}
+
+static void fe_tobytes(unsigned char s[32], const fe f)
+{
+    u64 h0 = f[0], h1 = f[1], h2 = f[2], h3 = f[3], h4 = f[4], q;
+
+    /* Bring every limb below 2^51 ... */
+    h1 += h0 >> 51; h0 &= MASK51;
+    h2 += h1 >> 51; h1 &= MASK51;
+    h3 += h2 >> 51; h2 &= MASK51;
+    h4 += h3 >> 51; h3 &= MASK51;
+    h0 += 19 * (h4 >> 51); h4 &= MASK51;
+    h1 += h0 >> 51; h0 &= MASK51;
+
+    /* ... then subtract p if the value is not smaller than it */
+    q = (h0 + 19) >> 51;
+    q = (h1 + q) >> 51;
+    q = (h2 + q) >> 51;
+    q = (h3 + q) >> 51;
+    q = (h4 + q) >> 51;
+
+    h0 += 19 * q;
+    h1 += h0 >> 51; h0 &= MASK51;
+    h2 += h1 >> 51; h1 &= MASK51;
+    h3 += h2 >> 51; h2 &= MASK51;
+    h4 += h3 >> 51; h3 &= MASK51;
+    h4 &= MASK51;
+
+    store_u64(s, h0 | (h1 << 51));
+    store_u64(s + 8, (h1 >> 13) | (h2 << 38));
+    store_u64(s + 16, (h2 >> 26) | (h3 << 25));
+    store_u64(s + 24, (h3 >> 39) | (h4 << 12));
+}
+
+static void fe_0(fe h)
+{
+    h[0] = h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static void fe_1(fe h)
+{
+    h[0] = 1;
+    h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static void fe_copy(fe h, const fe f)
+{
+    memcpy(h, f, sizeof(fe));
+}
+
+static void fe_add(fe h, const fe f, const fe g)
+{
+    h[0] = f[0] + g[0];
+    h[1] = f[1] + g[1];
+    h[2] = f[2] + g[2];
+    h[3] = f[3] + g[3];
+    h[4] = f[4] + g[4];
+}
+
+/*
+ * |g| is the output of fe_mul or fe_sq, so each of its limbs is smaller
+ * than the corresponding limb of 2*p, which is added to keep the result
+ * non-negative.
+ */
+static void fe_sub(fe h, const fe f, const fe g)
+{
+    h[0] = (f[0] + 0xfffffffffffdaULL) - g[0];
+    h[1] = (f[1] + 0xffffffffffffeULL) - g[1];
+    h[2] = (f[2] + 0xffffffffffffeULL) - g[2];
+    h[3] = (f[3] + 0xffffffffffffeULL) - g[3];
+    h[4] = (f[4] + 0xffffffffffffeULL) - g[4];
+}
+
+static void fe_carry(fe h, u128 r0, u128 r1, u128 r2, u128 r3, u128 r4)
+{
+    u64 c;
+
+    r1 += (u64)(r0 >> 51);
+    r2 += (u64)(r1 >> 51);
+    r3 += (u64)(r2 >> 51);
+    r4 += (u64)(r3 >> 51);
+    c = (u64)(r4 >> 51);
+
+    h[0] = ((u64)r0 & MASK51) + 19 * c;
+    h[1] = (u64)r1 & MASK51;
+    h[2] = (u64)r2 & MASK51;
+    h[3] = (u64)r3 & MASK51;
+    h[4] = (u64)r4 & MASK51;
+
+    h[1] += h[0] >> 51;
+    h[0] &= MASK51;
+}
+
+static void fe_mul(fe h, const fe f, const fe g)
+{
+    u64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    u64 g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+    u64 g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+    u128 r0, r1, r2, r3, r4;
+
+    r0 = (u128)f0 * g0 + (u128)f1 * g4_19 + (u128)f2 * g3_19
+         + (u128)f3 * g2_19 + (u128)f4 * g1_19;
+    r1 = (u128)f0 * g1 + (u128)f1 * g0 + (u128)f2 * g4_19
+         + (u128)f3 * g3_19 + (u128)f4 * g2_19;
+    r2 = (u128)f0 * g2 + (u128)f1 * g1 + (u128)f2 * g0
+         + (u128)f3 * g4_19 + (u128)f4 * g3_19;
+    r3 = (u128)f0 * g3 + (u128)f1 * g2 + (u128)f2 * g1
+         + (u128)f3 * g0 + (u128)f4 * g4_19;
+    r4 = (u128)f0 * g4 + (u128)f1 * g3 + (u128)f2 * g2
+         + (u128)f3 * g1 + (u128)f4 * g0;
+
+    fe_carry(h, r0, r1, r2, r3, r4);
+}
+
+static void fe_sq(fe h, const fe f)
+{
+    u64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    u64 f0_2 = 2 * f0, f1_2 = 2 * f1;
+    u64 f1_38 = 38 * f1, f2_38 = 38 * f2, f3_38 = 38 * f3;
+    u64 f3_19 = 19 * f3, f4_19 = 19 * f4;
+    u128 r0, r1, r2, r3, r4;
+
+    r0 = (u128)f0 * f0 + (u128)f1_38 * f4 + (u128)f2_38 * f3;
+    r1 = (u128)f0_2 * f1 + (u128)f2_38 * f4 + (u128)f3_19 * f3;
+    r2 = (u128)f0_2 * f2 + (u128)f1 * f1 + (u128)f3_38 * f4;
+    r3 = (u128)f0_2 * f3 + (u128)f1_2 * f2 + (u128)f4_19 * f4;
+    r4 = (u128)f0_2 * f4 + (u128)f1_2 * f3 + (u128)f2 * f2;
+
+    fe_carry(h, r0, r1, r2, r3, r4);
+}
+
+static void fe_mul121665(fe h, const fe f)
+{
+    fe_carry(h, (u128)f[0] * 121665, (u128)f[1] * 121665,
+             (u128)f[2] * 121665, (u128)f[3] * 121665,
+             (u128)f[4] * 121665);
+}
+
+/* Swap |f| and |g| if |b| is 1, leave them alone if it is 0 */
+static void fe_cswap(fe f, fe g, unsigned int b)
+{
+    u64 mask = 0 - (u64)b, x;
+    int i;
+
+    for (i = 0; i < 5; i++) {
+        x = mask & (f[i] ^ g[i]);
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+#else
+
+typedef long long i64;
+
+/*
+ * Element of GF(2^255-19) as sixteen signed 16-bit limbs, least
+ * significant first; limbs may temporarily leave that range.
+ */
+typedef i64 fe[16];
+
+static void fe_frombytes(fe h, const unsigned char s[32])
+{
+    int i;
+
+    for (i = 0; i < 16; i++)
+        h[i] = s[2 * i] + ((i64)s[2 * i + 1] << 8);
+    h[15] &= 0x7fff;
+}
+
+static void fe_carry(fe h)
+{
+    i64 c;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        h[i] += (i64)1 << 16;
+        c = h[i] >> 16;
+        if (i < 15)
+            h[i + 1] += c - 1;
+        else
+            h[0] += 38 * (c - 1);
+        h[i] -= c * 65536;
+    }
+}
+
+/* Swap |f| and |g| if |b| is 1, leave them alone if it is 0 */
+static void fe_cswap(fe f, fe g, unsigned int b)
+{
+    i64 mask = ~((i64)b - 1), x;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        x = mask & (f[i] ^ g[i]);
+        f[i] ^= x;
+        g[i] ^= x;
+    }
+}
+
+static void fe_tobytes(unsigned char s[32], const fe f)
+{
+    fe t, m;
+    i64 b;
+    int i, j;
+
+    memcpy(t, f, sizeof(fe));
+    fe_carry(t);
+    fe_carry(t);
+    fe_carry(t);
+    /* Subtract p twice, keeping the result whenever it does not borrow */
+    for (j = 0; j < 2; j++) {
+        m[0] = t[0] - 0xffed;
+        for (i = 1; i < 15; i++) {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        b = (m[15] >> 16) & 1;
+        m[14] &= 0xffff;
+        fe_cswap(t, m, (unsigned int)(1 - b));
+    }
+    for (i = 0; i < 16; i++) {
+        s[2 * i] = (unsigned char)(t[i] & 0xff);
+        s[2 * i + 1] = (unsigned char)(t[i] >> 8);
+    }
+}
+
+static void fe_0(fe h)
+{
+    memset(h, 0, sizeof(fe));
+}
+
+static void fe_1(fe h)
+{
+    memset(h, 0, sizeof(fe));
+    h[0] = 1;
+}
+
+static void fe_copy(fe h, const fe f)
+{
+    memcpy(h, f, sizeof(fe));
+}
+
+static void fe_add(fe h, const fe f, const fe g)
+{
+    int i;
+
+    for (i = 0; i < 16; i++)
+        h[i] = f[i] + g[i];
+}
+
+static void fe_sub(fe h, const fe f, const fe g)
+{
+    int i;
+
+    for (i = 0; i < 16; i++)
+        h[i] = f[i] - g[i];
+}
+
+static void fe_mul(fe h, const fe f, const fe g)
+{
+    i64 t[31];
+    int i, j;
+
+    memset(t, 0, sizeof(t));
+    for (i = 0; i < 16; i++)
+        for (j = 0; j < 16; j++)
+            t[i + j] += f[i] * g[j];
+    for (i = 0; i < 15; i++)
+        t[i] += 38 * t[i + 16];
+    for (i = 0; i < 16; i++)
+        h[i] = t[i];
+    fe_carry(h);
+    fe_carry(h);
+}
+
+static void fe_sq(fe h, const fe f)
+{
+    fe_mul(h, f, f);
+}
+
+static void fe_mul121665(fe h, const fe f)
+{
+    int i;
+
+    for (i = 0; i < 16; i++)
+        h[i] = f[i] * 121665;
+    fe_carry(h);
+    fe_carry(h);
+}
+
+#endif
+
+/* out = z^(p-2) = z^-1, using the addition chain from ref10 */
+static void fe_invert(fe out, const fe z)
+{
+    fe t0, t1, t2, t3;
+    int i;
+
+    fe_sq(t0, z);
+    fe_sq(t1, t0);
+    fe_sq(t1, t1);
+    fe_mul(t1, z, t1);
+    fe_mul(t0, t0, t1);
+    fe_sq(t2, t0);
+    fe_mul(t1, t1, t2);
+    fe_sq(t2, t1);
+    for (i = 1; i < 5; i++)
+        fe_sq(t2, t2);
+    fe_mul(t1, t2, t1);
+    fe_sq(t2, t1);
+    for (i = 1; i < 10; i++)
+        fe_sq(t2, t2);
+    fe_mul(t2, t2, t1);
+    fe_sq(t3, t2);
+    for (i = 1; i < 20; i++)
+        fe_sq(t3, t3);
+    fe_mul(t2, t3, t2);
+    for (i = 0; i < 10; i++)
+        fe_sq(t2, t2);
+    fe_mul(t1, t2, t1);
+    fe_sq(t2, t1);
+    for (i = 1; i < 50; i++)
+        fe_sq(t2, t2);
+    fe_mul(t2, t2, t1);
+    fe_sq(t3, t2);
+    for (i = 1; i < 100; i++)
+        fe_sq(t3, t3);
+    fe_mul(t2, t3, t2);
+    for (i = 0; i < 50; i++)
+        fe_sq(t2, t2);
+    fe_mul(t1, t2, t1);
+    for (i = 0; i < 5; i++)
+        fe_sq(t1, t1);
+    fe_mul(out, t1, t0);
+}
+
+/* Montgomery ladder of RFC 7748 section 5 */
+static void x25519_scalar_mult(unsigned char out[32],
+                               const unsigned char scalar[32],
+                               const unsigned char point[32])
+{
+    fe x1, x2, z2, x3, z3, a, b, aa, bb, e, c, d, da, cb;
+    unsigned char k[32];
+    unsigned int swap = 0, bit;
+    int pos;
+
+    memcpy(k, scalar, 32);
+    k[0] &= 248;
+    k[31] &= 127;
+    k[31] |= 64;
+
+    fe_frombytes(x1, point);
+    fe_1(x2);
+    fe_0(z2);
+    fe_copy(x3, x1);
+    fe_1(z3);
+
+    for (pos = 254; pos >= 0; pos--) {
+        bit = (k[pos >> 3] >> (pos & 7)) & 1;
+        swap ^= bit;
+        fe_cswap(x2, x3, swap);
+        fe_cswap(z2, z3, swap);
+        swap = bit;
+
+        fe_add(a, x2, z2);
+        fe_sq(aa, a);
+        fe_sub(b, x2, z2);
+        fe_sq(bb, b);
+        fe_sub(e, aa, bb);
+        fe_add(c, x3, z3);
+        fe_sub(d, x3, z3);
+        fe_mul(da, d, a);
+        fe_mul(cb, c, b);
+        fe_add(x3, da, cb);
+        fe_sq(x3, x3);
+        fe_sub(z3, da, cb);
+        fe_sq(z3, z3);
+        fe_mul(z3, z3, x1);
+        fe_mul(x2, aa, bb);
+        fe_mul121665(z2, e);
+        fe_add(z2, z2, aa);
+        fe_mul(z2, z2, e);
+    }
+    fe_cswap(x2, x3, swap);
+    fe_cswap(z2, z3, swap);
+
+    fe_invert(z2, z2);
+    fe_mul(x2, x2, z2);
+    fe_tobytes(out, x2);
+
+    OPENSSL_cleanse(k, sizeof(k));
+}
+
+/*
+ * Computes the shared secret between |private_key| and |peer_public_value|.
+ * Returns 1 on success and 0 if the result is the all-zero value, which
+ * happens when the peer supplied a point of small order.
+ */
+int X25519(unsigned char out_shared_key[32],
+           const unsigned char private_key[32],
+           const unsigned char peer_public_value[32])
+{
+    unsigned char acc = 0;
+    int i;
+
+    x25519_scalar_mult(out_shared_key, private_key, peer_public_value);
+    for (i = 0; i < 32; i++)
+        acc |= out_shared_key[i];
+    return acc != 0;
+}
+
+void X25519_public_from_private(unsigned char out_public_value[32],
+                                const unsigned char private_key[32])
+{
+    static const unsigned char basepoint[32] = { 9 };
+
+    x25519_scalar_mult(out_public_value, private_key, basepoint);
+}
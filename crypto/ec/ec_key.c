@@ -65,6 +65,7 @@
 #include <string.h>
 #include "ec_lcl.h"
 #include <openssl/err.h>
+#include "internal/refcount.h"
 
 EC_KEY *EC_KEY_new(void)
 {
@@ -78,6 +79,12 @@ EC_KEY *EC_KEY_new(void)
     ret->version = 1;
     ret->conv_form = POINT_CONVERSION_UNCOMPRESSED;
     ret->references = 1;
+    ret->lock = CRYPTO_THREAD_lock_new();
+    if (ret->lock == NULL) {
+        ECerr(EC_F_EC_KEY_NEW, ERR_R_MALLOC_FAILURE);
+        OPENSSL_free(ret);
+        return (NULL);
+    }
     return (ret);
 }
 
@@ -101,7 +108,7 @@ void EC_KEY_free(EC_KEY *r)
     if (r == NULL)
         return;
 
-    i = CRYPTO_add(&r->references, -1, CRYPTO_LOCK_EC);
+    i = CRYPTO_DOWN_REF(&r->references, CRYPTO_LOCK_EC);
 #ifdef REF_PRINT
     REF_PRINT("EC_KEY", r);
 #endif
@@ -120,6 +127,7 @@ void EC_KEY_free(EC_KEY *r)
 
     EC_EX_DATA_free_all_data(&r->method_data);
 
+    CRYPTO_THREAD_lock_free(r->lock);
     OPENSSL_clear_free((void *)r, sizeof(EC_KEY));
 }
 
@@ -198,7 +206,7 @@ EC_KEY *EC_KEY_dup(const EC_KEY *ec_key)
 
 int EC_KEY_up_ref(EC_KEY *r)
 {
-    int i = CRYPTO_add(&r->references, 1, CRYPTO_LOCK_EC);
+    int i = CRYPTO_UP_REF(&r->references, CRYPTO_LOCK_EC);
 #ifdef REF_PRINT
     REF_PRINT("EC_KEY", r);
 #endif
@@ -478,11 +486,11 @@ void *EC_KEY_get_key_method_data(EC_KEY *key,
 {
     void *ret;
 
-    CRYPTO_r_lock(CRYPTO_LOCK_EC);
+    CRYPTO_THREAD_read_lock(key->lock);
     ret =
         EC_EX_DATA_get_data(key->method_data, dup_func, free_func,
                             clear_free_func);
-    CRYPTO_r_unlock(CRYPTO_LOCK_EC);
+    CRYPTO_THREAD_unlock(key->lock);
 
     return ret;
 }
@@ -494,14 +502,14 @@ void *EC_KEY_insert_key_method_data(EC_KEY *key, void *data,
 {
     EC_EXTRA_DATA *ex_data;
 
-    CRYPTO_w_lock(CRYPTO_LOCK_EC);
+    CRYPTO_THREAD_write_lock(key->lock);
     ex_data =
         EC_EX_DATA_get_data(key->method_data, dup_func, free_func,
                             clear_free_func);
     if (ex_data == NULL)
         EC_EX_DATA_set_data(&key->method_data, data, dup_func, free_func,
                             clear_free_func);
-    CRYPTO_w_unlock(CRYPTO_LOCK_EC);
+    CRYPTO_THREAD_unlock(key->lock);
 
     return ex_data;
 }
@@ -266,6 +266,7 @@ struct ec_key_st {
     int references;
     int flags;
     EC_EXTRA_DATA *method_data;
+    CRYPTO_RWLOCK *lock;
 } /* EC_KEY */ ;
 
 /*
@@ -552,3 +553,10 @@ int ec_precompute_mont_data(EC_GROUP *);
  */
 const EC_METHOD *EC_GFp_nistz256_method(void);
 #endif
+
+/* X25519 Diffie-Hellman function from RFC 7748, see curve25519.c */
+int X25519(unsigned char out_shared_key[32],
+           const unsigned char private_key[32],
+           const unsigned char peer_public_value[32]);
+void X25519_public_from_private(unsigned char out_public_value[32],
+                                const unsigned char private_key[32]);
@@ -66,6 +66,7 @@
 
 #include "internal/bn_int.h"
 #include "ec_lcl.h"
+#include "internal/refcount.h"
 
 /*
  * This file implements the wNAF-based interleaving multi-exponentation method
@@ -118,7 +119,7 @@ static void *ec_pre_comp_dup(void *src_)
 
     /* no need to actually copy, these objects never change! */
 
-    CRYPTO_add(&src->references, 1, CRYPTO_LOCK_EC_PRE_COMP);
+    CRYPTO_UP_REF(&src->references, CRYPTO_LOCK_EC_PRE_COMP);
 
     return src_;
 }
@@ -131,7 +132,7 @@ static void ec_pre_comp_free(void *pre_)
     if (!pre)
         return;
 
-    i = CRYPTO_add(&pre->references, -1, CRYPTO_LOCK_EC_PRE_COMP);
+    i = CRYPTO_DOWN_REF(&pre->references, CRYPTO_LOCK_EC_PRE_COMP);
     if (i > 0)
         return;
 
@@ -153,7 +154,7 @@ static void ec_pre_comp_clear_free(void *pre_)
     if (!pre)
         return;
 
-    i = CRYPTO_add(&pre->references, -1, CRYPTO_LOCK_EC_PRE_COMP);
+    i = CRYPTO_DOWN_REF(&pre->references, CRYPTO_LOCK_EC_PRE_COMP);
     if (i > 0)
         return;
 
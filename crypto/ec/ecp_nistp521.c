@@ -38,6 +38,7 @@
 # include <string.h>
 # include <openssl/err.h>
 # include "ec_lcl.h"
+# include "internal/refcount.h"
 
 # if defined(__GNUC__) && (__GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 1))
   /* even with gcc, the typedef won't work for 32-bit platforms */
@@ -1659,7 +1660,7 @@ static void *nistp521_pre_comp_dup(void *src_)
     NISTP521_PRE_COMP *src = src_;
 
     /* no need to actually copy, these objects never change! */
-    CRYPTO_add(&src->references, 1, CRYPTO_LOCK_EC_PRE_COMP);
+    CRYPTO_UP_REF(&src->references, CRYPTO_LOCK_EC_PRE_COMP);
 
     return src_;
 }
@@ -1672,7 +1673,7 @@ static void nistp521_pre_comp_free(void *pre_)
     if (!pre)
         return;
 
-    i = CRYPTO_add(&pre->references, -1, CRYPTO_LOCK_EC_PRE_COMP);
+    i = CRYPTO_DOWN_REF(&pre->references, CRYPTO_LOCK_EC_PRE_COMP);
     if (i > 0)
         return;
 
@@ -1687,7 +1688,7 @@ static void nistp521_pre_comp_clear_free(void *pre_)
     if (!pre)
         return;
 
-    i = CRYPTO_add(&pre->references, -1, CRYPTO_LOCK_EC_PRE_COMP);
+    i = CRYPTO_DOWN_REF(&pre->references, CRYPTO_LOCK_EC_PRE_COMP);
     if (i > 0)
         return;
 
@@ -31,6 +31,7 @@
 #include "internal/cryptlib.h"
 #include "internal/bn_int.h"
 #include "ec_lcl.h"
+#include "internal/refcount.h"
 
 #if BN_BITS2 != 64
 # define TOBN(hi,lo)    lo,hi
@@ -1428,7 +1429,7 @@ static void *ecp_nistz256_pre_comp_dup(void *src_)
     EC_PRE_COMP *src = src_;
 
     /* no need to actually copy, these objects never change! */
-    CRYPTO_add(&src->references, 1, CRYPTO_LOCK_EC_PRE_COMP);
+    CRYPTO_UP_REF(&src->references, CRYPTO_LOCK_EC_PRE_COMP);
 
     return src_;
 }
@@ -1441,7 +1442,7 @@ static void ecp_nistz256_pre_comp_free(void *pre_)
     if (!pre)
         return;
 
-    i = CRYPTO_add(&pre->references, -1, CRYPTO_LOCK_EC_PRE_COMP);
+    i = CRYPTO_DOWN_REF(&pre->references, CRYPTO_LOCK_EC_PRE_COMP);
     if (i > 0)
         return;
 
@@ -1457,7 +1458,7 @@ static void ecp_nistz256_pre_comp_clear_free(void *pre_)
     if (!pre)
         return;
 
-    i = CRYPTO_add(&pre->references, -1, CRYPTO_LOCK_EC_PRE_COMP);
+    i = CRYPTO_DOWN_REF(&pre->references, CRYPTO_LOCK_EC_PRE_COMP);
     if (i > 0)
         return;
 
@@ -54,6 +54,7 @@
  */
 
 #include "eng_int.h"
+#include "internal/refcount.h"
 
 /*
  * Initialise a engine type for use (or up its functional reference count if
@@ -74,7 +75,7 @@ int engine_unlocked_init(ENGINE *e)
          * OK, we return a functional reference which is also a structural
          * reference.
          */
-        e->struct_ref++;
+        CRYPTO_UP_REF_LOCKED(&e->struct_ref);
         e->funct_ref++;
         engine_ref_debug(e, 0, 1)
             engine_ref_debug(e, 1, 1)
@@ -212,6 +212,11 @@ struct engine_st {
     int funct_ref;
     /* A place to store per-ENGINE data */
     CRYPTO_EX_DATA ex_data;
+    /*
+     * Protects per-ENGINE state such as |ex_data|. The engine list, the
+     * method tables and |funct_ref| remain under CRYPTO_LOCK_ENGINE.
+     */
+    CRYPTO_RWLOCK *lock;
     /* Used to maintain the linked-list of engines. */
     struct engine_st *prev;
     struct engine_st *next;
@@ -63,6 +63,7 @@
  */
 
 #include "eng_int.h"
+#include "internal/refcount.h"
 
 /*
  * The linked-list of pointers to engine types. engine_list_head incorporates
@@ -141,7 +142,7 @@ static int engine_list_add(ENGINE *e)
     /*
      * Having the engine in the list assumes a structural reference.
      */
-    e->struct_ref++;
+    CRYPTO_UP_REF_LOCKED(&e->struct_ref);
     engine_ref_debug(e, 0, 1)
         /* However it came to be, e is the last item in the list. */
         engine_list_tail = e;
@@ -188,7 +189,7 @@ ENGINE *ENGINE_get_first(void)
     CRYPTO_w_lock(CRYPTO_LOCK_ENGINE);
     ret = engine_list_head;
     if (ret) {
-        ret->struct_ref++;
+        CRYPTO_UP_REF_LOCKED(&ret->struct_ref);
         engine_ref_debug(ret, 0, 1)
     }
     CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -202,7 +203,7 @@ ENGINE *ENGINE_get_last(void)
     CRYPTO_w_lock(CRYPTO_LOCK_ENGINE);
     ret = engine_list_tail;
     if (ret) {
-        ret->struct_ref++;
+        CRYPTO_UP_REF_LOCKED(&ret->struct_ref);
         engine_ref_debug(ret, 0, 1)
     }
     CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -221,7 +222,7 @@ ENGINE *ENGINE_get_next(ENGINE *e)
     ret = e->next;
     if (ret) {
         /* Return a valid structural refernce to the next ENGINE */
-        ret->struct_ref++;
+        CRYPTO_UP_REF_LOCKED(&ret->struct_ref);
         engine_ref_debug(ret, 0, 1)
     }
     CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -241,7 +242,7 @@ ENGINE *ENGINE_get_prev(ENGINE *e)
     ret = e->prev;
     if (ret) {
         /* Return a valid structural reference to the next ENGINE */
-        ret->struct_ref++;
+        CRYPTO_UP_REF_LOCKED(&ret->struct_ref);
         engine_ref_debug(ret, 0, 1)
     }
     CRYPTO_w_unlock(CRYPTO_LOCK_ENGINE);
@@ -347,7 +348,7 @@ ENGINE *ENGINE_by_id(const char *id)
                 iterator = cp;
             }
         } else {
-            iterator->struct_ref++;
+            CRYPTO_UP_REF_LOCKED(&iterator->struct_ref);
             engine_ref_debug(iterator, 0, 1)
         }
     }
@@ -389,6 +390,6 @@ int ENGINE_up_ref(ENGINE *e)
         ENGINEerr(ENGINE_F_ENGINE_UP_REF, ERR_R_PASSED_NULL_PARAMETER);
         return 0;
     }
-    CRYPTO_add(&e->struct_ref, 1, CRYPTO_LOCK_ENGINE);
+    CRYPTO_UP_REF(&e->struct_ref, CRYPTO_LOCK_ENGINE);
     return 1;
 }
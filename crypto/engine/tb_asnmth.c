@@ -55,6 +55,7 @@
 #include "eng_int.h"
 #include <openssl/evp.h>
 #include "internal/asn1_int.h"
+#include "internal/refcount.h"
 
 /*
  * If this symbol is defined then ENGINE_get_pkey_asn1_meth_engine(), the
@@ -237,7 +238,7 @@ const EVP_PKEY_ASN1_METHOD *ENGINE_pkey_asn1_find_str(ENGINE **pe,
     engine_table_doall(pkey_asn1_meth_table, look_str_cb, &fstr);
     /* If found obtain a structural reference to engine */
     if (fstr.e) {
-        fstr.e->struct_ref++;
+        CRYPTO_UP_REF_LOCKED(&fstr.e->struct_ref);
         engine_ref_debug(fstr.e, 0, 1)
     }
     *pe = fstr.e;
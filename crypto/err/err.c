@@ -118,6 +118,17 @@
 #include <openssl/buffer.h>
 #include <openssl/bio.h>
 #include <openssl/err.h>
+#include "internal/refcount.h"
+
+/*
+ * Where POSIX threads are available each thread's error queue is kept in
+ * thread-local storage, which needs no locking and is freed automatically
+ * when the thread exits. Elsewhere the queues live in a hash table keyed by
+ * CRYPTO_THREADID and guarded by CRYPTO_LOCK_ERR.
+ */
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX)
+# define ERR_STATE_THREAD_LOCAL
+#endif
 
 DECLARE_LHASH_OF(ERR_STRING_DATA);
 DECLARE_LHASH_OF(ERR_STATE);
@@ -157,6 +168,7 @@ static ERR_STRING_DATA ERR_str_libraries[] = {
     {ERR_PACK(ERR_LIB_FIPS, 0, 0), "FIPS routines"},
     {ERR_PACK(ERR_LIB_CMS, 0, 0), "CMS routines"},
     {ERR_PACK(ERR_LIB_HMAC, 0, 0), "HMAC routines"},
+    {ERR_PACK(ERR_LIB_ASYNC, 0, 0), "ASYNC routines"},
     {0, NULL},
 };
 
@@ -228,9 +240,11 @@ static LHASH_OF(ERR_STRING_DATA) *get_hash(int create, int lockit);
 static ERR_STRING_DATA *int_err_get_item(const ERR_STRING_DATA *);
 static LHASH_OF(ERR_STATE) *int_thread_get(int create, int lockit);
 static void int_thread_release(LHASH_OF(ERR_STATE) **hash);
+#ifndef ERR_STATE_THREAD_LOCAL
 static ERR_STATE *int_thread_get_item(const ERR_STATE *);
 static ERR_STATE *int_thread_set_item(ERR_STATE *);
 static void int_thread_del_item(const ERR_STATE *);
+#endif
 
 /*
  * The internal state
@@ -327,7 +341,7 @@ static LHASH_OF(ERR_STATE) *int_thread_get(int create, int lockit)
         CRYPTO_pop_info();
     }
     if (int_thread_hash) {
-        int_thread_hash_references++;
+        CRYPTO_UP_REF_LOCKED(&int_thread_hash_references);
         ret = int_thread_hash;
     }
     if (lockit)
@@ -342,7 +356,7 @@ static void int_thread_release(LHASH_OF(ERR_STATE) **hash)
     if (hash == NULL || *hash == NULL)
         return;
 
-    i = CRYPTO_add(&int_thread_hash_references, -1, CRYPTO_LOCK_ERR);
+    i = CRYPTO_DOWN_REF(&int_thread_hash_references, CRYPTO_LOCK_ERR);
 
 #ifdef REF_PRINT
     fprintf(stderr, "%4d:%s\n", int_thread_hash_references, "ERR");
@@ -358,6 +372,7 @@ static void int_thread_release(LHASH_OF(ERR_STATE) **hash)
     *hash = NULL;
 }
 
+#ifndef ERR_STATE_THREAD_LOCAL
 static ERR_STATE *int_thread_get_item(const ERR_STATE *d)
 {
     ERR_STATE *p = NULL;
@@ -411,6 +426,7 @@ static void int_thread_del_item(const ERR_STATE *d)
     int_thread_release(&hash);
     ERR_STATE_free(p);
 }
+#endif
 
 #ifndef OPENSSL_NO_ERR
 # define NUM_SYS_STR_REASONS 127
@@ -847,6 +863,103 @@ const char *ERR_reason_error_string(unsigned long e)
     return ((p == NULL) ? NULL : p->string);
 }
 
+#ifdef ERR_STATE_THREAD_LOCAL
+/*
+ * Every queue is also linked into |err_state_list|, under CRYPTO_LOCK_ERR,
+ * so that the queues of threads still alive when the library is unloaded
+ * can be freed along with the key. |state| must come first: the node is
+ * freed through a pointer to it.
+ */
+typedef struct err_state_node_st {
+    ERR_STATE state;
+    struct err_state_node_st *prev;
+    struct err_state_node_st *next;
+} ERR_STATE_NODE;
+
+static CRYPTO_ONCE err_state_once = CRYPTO_ONCE_STATIC_INIT;
+static CRYPTO_THREAD_LOCAL err_state_key;
+static int err_state_key_ok = 0;
+static ERR_STATE_NODE *err_state_list = NULL;
+
+static void err_state_node_free(ERR_STATE_NODE *n)
+{
+    CRYPTO_w_lock(CRYPTO_LOCK_ERR);
+    if (n->prev != NULL)
+        n->prev->next = n->next;
+    else
+        err_state_list = n->next;
+    if (n->next != NULL)
+        n->next->prev = n->prev;
+    CRYPTO_w_unlock(CRYPTO_LOCK_ERR);
+    ERR_STATE_free(&n->state);
+}
+
+static void err_state_thread_exit(void *state)
+{
+    err_state_node_free(state);
+}
+
+static void err_state_key_init(void)
+{
+    err_state_key_ok = CRYPTO_THREAD_init_local(&err_state_key,
+                                                err_state_thread_exit);
+}
+
+/* Return 1 if |err_state_key| can be used */
+static int err_state_key_get(void)
+{
+    if (!CRYPTO_THREAD_run_once(&err_state_once, err_state_key_init))
+        return 0;
+    return err_state_key_ok;
+}
+
+# if defined(__GNUC__)
+/*
+ * Delete the key when libcrypto is unloaded or the process exits, so that
+ * its destructor never outlives the library, and free the queues of the
+ * threads that are still alive. No other thread may be using the library
+ * by then, so no lock is taken. Elsewhere the key is simply kept.
+ */
+static void err_state_key_cleanup(void) __attribute__ ((destructor));
+
+static void err_state_key_cleanup(void)
+{
+    ERR_STATE_NODE *n;
+
+    if (!err_state_key_ok)
+        return;
+    CRYPTO_THREAD_cleanup_local(&err_state_key);
+    err_state_key_ok = 0;
+    while ((n = err_state_list) != NULL) {
+        err_state_list = n->next;
+        ERR_STATE_free(&n->state);
+    }
+}
+# endif
+
+void ERR_remove_thread_state(const CRYPTO_THREADID *id)
+{
+    CRYPTO_THREADID cur;
+    ERR_STATE_NODE *n;
+
+    /*
+     * Error queues are freed when their thread exits, so this is only needed
+     * to release the calling thread's queue early (e.g. before checking for
+     * leaks at exit). Other threads' queues cannot be reached from here.
+     */
+    if (id != NULL) {
+        CRYPTO_THREADID_current(&cur);
+        if (CRYPTO_THREADID_cmp(&cur, id) != 0)
+            return;
+    }
+    if (!err_state_key_get())
+        return;
+    if ((n = CRYPTO_THREAD_get_local(&err_state_key)) != NULL) {
+        CRYPTO_THREAD_set_local(&err_state_key, NULL);
+        err_state_node_free(n);
+    }
+}
+#else
 void ERR_remove_thread_state(const CRYPTO_THREADID *id)
 {
     ERR_STATE tmp;
@@ -861,6 +974,7 @@ void ERR_remove_thread_state(const CRYPTO_THREADID *id)
      */
     int_thread_del_item(&tmp);
 }
+#endif
 
 #ifndef OPENSSL_NO_DEPRECATED
 void ERR_remove_state(unsigned long pid)
@@ -869,11 +983,54 @@ void ERR_remove_state(unsigned long pid)
 }
 #endif
 
+static void err_state_init(ERR_STATE *s, const CRYPTO_THREADID *tid)
+{
+    int i;
+
+    CRYPTO_THREADID_cpy(&s->tid, tid);
+    s->top = 0;
+    s->bottom = 0;
+    for (i = 0; i < ERR_NUM_ERRORS; i++) {
+        s->err_data[i] = NULL;
+        s->err_data_flags[i] = 0;
+    }
+}
+
+#ifdef ERR_STATE_THREAD_LOCAL
+ERR_STATE *ERR_get_state(void)
+{
+    static ERR_STATE fallback;
+    ERR_STATE_NODE *n;
+    CRYPTO_THREADID tid;
+
+    if (!err_state_key_get())
+        return (&fallback);
+    n = CRYPTO_THREAD_get_local(&err_state_key);
+    if (n == NULL) {
+        n = OPENSSL_malloc(sizeof(*n));
+        if (n == NULL)
+            return (&fallback);
+        CRYPTO_THREADID_current(&tid);
+        err_state_init(&n->state, &tid);
+        if (!CRYPTO_THREAD_set_local(&err_state_key, n)) {
+            ERR_STATE_free(&n->state);
+            return (&fallback);
+        }
+        n->prev = NULL;
+        CRYPTO_w_lock(CRYPTO_LOCK_ERR);
+        n->next = err_state_list;
+        if (n->next != NULL)
+            n->next->prev = n;
+        err_state_list = n;
+        CRYPTO_w_unlock(CRYPTO_LOCK_ERR);
+    }
+    return &n->state;
+}
+#else
 ERR_STATE *ERR_get_state(void)
 {
     static ERR_STATE fallback;
     ERR_STATE *ret, tmp, *tmpp = NULL;
-    int i;
     CRYPTO_THREADID tid;
 
     CRYPTO_THREADID_current(&tid);
@@ -885,13 +1042,7 @@ ERR_STATE *ERR_get_state(void)
         ret = OPENSSL_malloc(sizeof(*ret));
         if (ret == NULL)
             return (&fallback);
-        CRYPTO_THREADID_cpy(&ret->tid, &tid);
-        ret->top = 0;
-        ret->bottom = 0;
-        for (i = 0; i < ERR_NUM_ERRORS; i++) {
-            ret->err_data[i] = NULL;
-            ret->err_data_flags[i] = 0;
-        }
+        err_state_init(ret, &tid);
         tmpp = int_thread_set_item(ret);
         /* To check if insertion failed, do a get. */
         if (int_thread_get_item(ret) != ret) {
@@ -906,6 +1057,7 @@ ERR_STATE *ERR_get_state(void)
     }
     return ret;
 }
+#endif
 
 int ERR_get_next_error_library(void)
 {
@@ -106,6 +106,7 @@
 # include <openssl/jpake.h>
 #endif
 #include <internal/ct_int.h>
+#include <openssl/async.h>
 
 void ERR_load_crypto_strings(void)
 {
@@ -165,5 +166,6 @@ void ERR_load_crypto_strings(void)
 # ifndef OPENSSL_NO_CT
     ERR_load_CT_strings();
 # endif
+    ERR_load_ASYNC_strings();
 #endif
 }
@@ -57,6 +57,7 @@
  */
 
 #include <stdio.h>
+#include <limits.h>
 #include "internal/cryptlib.h"
 #include <openssl/bn.h>
 #include <openssl/err.h>
@@ -78,6 +79,7 @@
 #endif
 
 #include "internal/asn1_int.h"
+#include "internal/refcount.h"
 
 static void EVP_PKEY_free_it(EVP_PKEY *x);
 
@@ -388,7 +390,7 @@ void EVP_PKEY_free(EVP_PKEY *x)
     if (x == NULL)
         return;
 
-    i = CRYPTO_add(&x->references, -1, CRYPTO_LOCK_EVP_PKEY);
+    i = CRYPTO_DOWN_REF(&x->references, CRYPTO_LOCK_EVP_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("EVP_PKEY", x);
 #endif
@@ -462,3 +464,27 @@ int EVP_PKEY_get_default_digest_nid(EVP_PKEY *pkey, int *pnid)
     return pkey->ameth->pkey_ctrl(pkey, ASN1_PKEY_CTRL_DEFAULT_MD_NID,
                                   0, pnid);
 }
+
+int EVP_PKEY_set1_tls_encodedpoint(EVP_PKEY *pkey,
+                                   const unsigned char *pt, size_t ptlen)
+{
+    if (ptlen > INT_MAX || pkey->ameth == NULL
+            || pkey->ameth->pkey_ctrl == NULL)
+        return 0;
+    if (pkey->ameth->pkey_ctrl(pkey, ASN1_PKEY_CTRL_SET1_TLS_ENCPT, ptlen,
+                               (void *)pt) <= 0)
+        return 0;
+    return 1;
+}
+
+size_t EVP_PKEY_get1_tls_encodedpoint(EVP_PKEY *pkey, unsigned char **ppt)
+{
+    int rv;
+
+    if (pkey->ameth == NULL || pkey->ameth->pkey_ctrl == NULL)
+        return 0;
+    rv = pkey->ameth->pkey_ctrl(pkey, ASN1_PKEY_CTRL_GET1_TLS_ENCPT, 0, ppt);
+    if (rv <= 0)
+        return 0;
+    return rv;
+}
@@ -65,6 +65,7 @@
 #endif
 #include "internal/asn1_int.h"
 #include "internal/evp_int.h"
+#include "internal/refcount.h"
 
 typedef int sk_cmp_fn_type(const char *const *a, const char *const *b);
 
@@ -87,7 +88,10 @@ static const EVP_PKEY_METHOD *standard_methods[] = {
     &hmac_pkey_meth,
     &cmac_pkey_meth,
 #ifndef OPENSSL_NO_DH
-    &dhx_pkey_meth
+    &dhx_pkey_meth,
+#endif
+#ifndef OPENSSL_NO_EC
+    &ecx25519_pkey_meth
 #endif
 };
 
@@ -173,7 +177,7 @@ static EVP_PKEY_CTX *int_ctx_new(EVP_PKEY *pkey, ENGINE *e, int id)
     ret->operation = EVP_PKEY_OP_UNDEFINED;
     ret->pkey = pkey;
     if (pkey)
-        CRYPTO_add(&pkey->references, 1, CRYPTO_LOCK_EVP_PKEY);
+        CRYPTO_UP_REF(&pkey->references, CRYPTO_LOCK_EVP_PKEY);
 
     if (pmeth->init) {
         if (pmeth->init(ret) <= 0) {
@@ -286,12 +290,12 @@ EVP_PKEY_CTX *EVP_PKEY_CTX_dup(EVP_PKEY_CTX *pctx)
 #endif
 
     if (pctx->pkey)
-        CRYPTO_add(&pctx->pkey->references, 1, CRYPTO_LOCK_EVP_PKEY);
+        CRYPTO_UP_REF(&pctx->pkey->references, CRYPTO_LOCK_EVP_PKEY);
 
     rctx->pkey = pctx->pkey;
 
     if (pctx->peerkey)
-        CRYPTO_add(&pctx->peerkey->references, 1, CRYPTO_LOCK_EVP_PKEY);
+        CRYPTO_UP_REF(&pctx->peerkey->references, CRYPTO_LOCK_EVP_PKEY);
 
     rctx->peerkey = pctx->peerkey;
 
@@ -120,6 +120,9 @@ size_t bn_sizeof_BIGNUM(void);
  */
 BIGNUM *bn_array_el(BIGNUM *base, int el);
 
+BN_MONT_CTX *bn_mont_ctx_set_locked(BN_MONT_CTX **pmont, CRYPTO_RWLOCK *lock,
+                                    const BIGNUM *mod, BN_CTX *ctx);
+
 
 #ifdef  __cplusplus
 }
@@ -103,6 +103,8 @@ extern unsigned int OPENSSL_ia32cap_P[];
 void OPENSSL_showfatal(const char *fmta, ...);
 extern int OPENSSL_NONPIC_relocated;
 
+void crypto_thread_static_lock(int mode, int type);
+
 #ifdef  __cplusplus
 }
 #endif
@@ -83,6 +83,8 @@ struct X509_name_st {
     /* canonical encoding used for rapid Name comparison */
     unsigned char *canon_enc;
     int canon_enclen;
+    /* first 8 bytes of the SHA-1 hash of canon_enc, little endian */
+    uint64_t canon_hash;
 } /* X509_NAME */ ;
 
 /* PKCS#10 certificate request */
@@ -142,6 +144,8 @@ struct X509_crl_st {
     /* alternative method to handle this CRL */
     const X509_CRL_METHOD *meth;
     void *meth_data;
+    /* Hash index of the revoked entries' serial numbers */
+    struct x509_crl_index_st *serial_index;
 };
 
 struct x509_revoked_st {
@@ -215,4 +219,8 @@ struct x509_st {
 # endif
     unsigned char sha1_hash[SHA_DIGEST_LENGTH];
     X509_CERT_AUX *aux;
+    /* Protects the extension and policy caches while they are computed */
+    CRYPTO_RWLOCK *lock;
 } /* X509 */ ;
+
+void x509v3_cache_extensions(X509 *x);
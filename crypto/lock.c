@@ -115,6 +115,7 @@
  */
 
 #include "internal/cryptlib.h"
+#include "internal/refcount.h"
 #include <openssl/safestack.h>
 
 #if defined(OPENSSL_SYS_WIN32)
@@ -453,6 +454,8 @@ void CRYPTO_lock(int mode, int type, const char *file, int line)
         }
     } else if (locking_callback != NULL)
         locking_callback(mode, type, file, line);
+    else
+        crypto_thread_static_lock(mode, type);
 }
 
 int CRYPTO_add_lock(int *pointer, int amount, int type, const char *file,
@@ -460,6 +463,22 @@ int CRYPTO_add_lock(int *pointer, int amount, int type, const char *file,
 {
     int ret = 0;
 
+#ifdef CRYPTO_REF_ATOMIC
+    /*
+     * Reference counts are updated atomically elsewhere, so this has to be
+     * atomic as well; neither the lock nor the add_lock callback is used.
+     */
+    ret = CRYPTO_ATOMIC_ADD(pointer, amount);
+# ifdef LOCK_DEBUG
+    {
+        CRYPTO_THREADID id;
+        CRYPTO_THREADID_current(&id);
+        fprintf(stderr, "ladd:%08lx:%2d+%2d->%2d %-18s %s:%d\n",
+                CRYPTO_THREADID_hash(&id), ret - amount, amount, ret,
+                CRYPTO_get_lock_name(type), file, line);
+    }
+# endif
+#else
     if (add_lock_callback != NULL) {
 #ifdef LOCK_DEBUG
         int before = *pointer;
@@ -492,6 +511,7 @@ int CRYPTO_add_lock(int *pointer, int amount, int type, const char *file,
         *pointer = ret;
         CRYPTO_lock(CRYPTO_UNLOCK | CRYPTO_WRITE, type, file, line);
     }
+#endif
     return (ret);
 }
 
@@ -0,0 +1,616 @@
+/* crypto/rand/drbg_rand.c */
+/*
+ * NIST SP 800-90A CTR_DRBG based on AES-256, used without a derivation
+ * function.  A master instance accumulates RAND_add()/RAND_poll() input
+ * and seeds a child instance per thread, which generates without locking.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "e_os.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <openssl/rand.h>
+#include <openssl/err.h>
+#include "rand_lcl.h"
+
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX)
+# include <pthread.h>
+# define DRBG_ATFORK
+#endif
+
+#ifdef BN_DEBUG
+# define PREDICT
+#endif
+
+#define DRBG_KEYLEN             32
+#define DRBG_BLOCKLEN           16
+#define DRBG_SEEDLEN            (DRBG_KEYLEN + DRBG_BLOCKLEN)
+
+/* Largest single generate request: 2^19 bits for AES */
+#define DRBG_MAX_REQUEST        (1 << 16)
+
+/*
+ * Number of generate requests a child serves before it reseeds from the
+ * master.  SP 800-90A permits up to 2^48, this keeps the children close
+ * to the master's state so that new seed material propagates quickly.
+ */
+#define DRBG_CHILD_RESEED_INTERVAL  (1 << 16)
+
+typedef struct ctr_drbg_st {
+    /* Holds the current key K */
+    EVP_CIPHER_CTX cctx;
+    unsigned char V[DRBG_BLOCKLEN];
+    unsigned int reseed_counter;
+    /* Value of |master_reseeds| this child was last seeded at */
+    unsigned int master_reseeds;
+    /* Value of |fork_count| this child was last seeded at */
+    unsigned int fork_count;
+#ifndef GETPID_IS_MEANINGLESS
+    pid_t pid;
+#endif
+    int seeded;
+} CTR_DRBG;
+
+static CRYPTO_ONCE drbg_once = CRYPTO_ONCE_STATIC_INIT;
+static int drbg_inited = 0;
+
+/* The master instance and its entropy estimate, protected by |master_lock| */
+static CRYPTO_RWLOCK *master_lock = NULL;
+static CTR_DRBG master;
+static double master_entropy = 0;
+static int master_polled = 0;
+
+/*
+ * Bumped whenever the master is reseeded so that children pick up new seed
+ * material on their next request.  Written under |master_lock|, read without
+ * it on the generate fast path.
+ */
+static unsigned int master_reseeds = 0;
+
+#if defined(__ATOMIC_ACQUIRE) && defined(__ATOMIC_RELEASE)
+# define master_reseeds_get() \
+        __atomic_load_n(&master_reseeds, __ATOMIC_ACQUIRE)
+# define master_reseeds_bump() \
+        __atomic_add_fetch(&master_reseeds, 1, __ATOMIC_RELEASE)
+#else
+# define master_reseeds_get()   (*(volatile unsigned int *)&master_reseeds)
+# define master_reseeds_bump()  (master_reseeds++)
+#endif
+
+/* Per-thread child instances */
+static CRYPTO_THREAD_LOCAL child_key;
+
+/*
+ * Children must not carry on from their parent process' state after fork().
+ * Where possible a fork handler counts forks, which is much cheaper than
+ * calling getpid() on every request.
+ */
+#ifdef DRBG_ATFORK
+static unsigned int fork_count = 0;
+static int fork_handler = 0;
+
+static void drbg_atfork_child(void)
+{
+    fork_count++;
+}
+#endif
+
+#ifdef PREDICT
+int rand_predictable = 0;
+#endif
+
+static void rand_cleanup(void);
+static int rand_seed(const void *buf, int num);
+static int rand_add(const void *buf, int num, double add_entropy);
+static int rand_bytes(unsigned char *buf, int num);
+static int rand_status(void);
+
+static RAND_METHOD rand_meth = {
+    rand_seed,
+    rand_bytes,
+    rand_cleanup,
+    rand_add,
+#ifndef OPENSSL_NO_DEPRECATED
+    rand_bytes,
+#else
+    NULL,
+#endif
+    rand_status
+};
+
+RAND_METHOD *RAND_OpenSSL(void)
+{
+    return (&rand_meth);
+}
+
+/* Add |n| to the 128 bit big-endian counter |V| */
+static void ctr_add(unsigned char *V, unsigned int n)
+{
+    int i;
+
+    for (i = DRBG_BLOCKLEN - 1; i >= 0 && n != 0; i--) {
+        n += V[i];
+        V[i] = (unsigned char)n;
+        n >>= 8;
+    }
+}
+
+/*
+ * CTR_DRBG_Update: (K, V) = leftmost 384 bits of E(K, V+1) || E(K, V+2) ||
+ * E(K, V+3), XORed with |in| (all zeroes if NULL).  That is simply |in|
+ * encrypted in counter mode starting at V+1.
+ */
+static int ctr_drbg_update(CTR_DRBG *drbg, const unsigned char *in)
+{
+    unsigned char temp[DRBG_SEEDLEN];
+    int outl, ret = 0;
+
+    if (in != NULL)
+        memcpy(temp, in, sizeof(temp));
+    else
+        memset(temp, 0, sizeof(temp));
+    ctr_add(drbg->V, 1);
+    if (!EVP_EncryptInit_ex(&drbg->cctx, NULL, NULL, NULL, drbg->V)
+        || !EVP_EncryptUpdate(&drbg->cctx, temp, &outl, temp, sizeof(temp))
+        || !EVP_EncryptInit_ex(&drbg->cctx, NULL, NULL, temp, NULL))
+        goto err;
+    memcpy(drbg->V, temp + DRBG_KEYLEN, DRBG_BLOCKLEN);
+    ret = 1;
+ err:
+    OPENSSL_cleanse(temp, sizeof(temp));
+    return ret;
+}
+
+/* CTR_DRBG_Instantiate with |seed| being DRBG_SEEDLEN bytes */
+static int ctr_drbg_instantiate(CTR_DRBG *drbg, const unsigned char *seed)
+{
+    static const unsigned char zero_key[DRBG_KEYLEN] = { 0 };
+    int ok;
+
+    memset(drbg->V, 0, sizeof(drbg->V));
+    ok = EVP_EncryptInit_ex(&drbg->cctx, EVP_aes_256_ctr(), NULL, zero_key,
+                            NULL);
+    if (!ok || !ctr_drbg_update(drbg, seed))
+        return 0;
+    drbg->reseed_counter = 1;
+    drbg->seeded = 1;
+    return 1;
+}
+
+/* CTR_DRBG_Reseed: seed material |seed| is DRBG_SEEDLEN bytes */
+static int ctr_drbg_reseed(CTR_DRBG *drbg, const unsigned char *seed)
+{
+    if (!drbg->seeded)
+        return ctr_drbg_instantiate(drbg, seed);
+    if (!ctr_drbg_update(drbg, seed))
+        return 0;
+    drbg->reseed_counter = 1;
+    return 1;
+}
+
+/*
+ * CTR_DRBG_Generate: fill |out| with |outlen| bytes, at most
+ * DRBG_MAX_REQUEST.  |adin| is optional additional input of DRBG_SEEDLEN
+ * bytes.
+ */
+static int ctr_drbg_generate(CTR_DRBG *drbg, unsigned char *out,
+                             size_t outlen, const unsigned char *adin)
+{
+    int outl;
+
+    if (adin != NULL && !ctr_drbg_update(drbg, adin))
+        return 0;
+    if (outlen > 0) {
+        memset(out, 0, outlen);
+        ctr_add(drbg->V, 1);
+        if (!EVP_EncryptInit_ex(&drbg->cctx, NULL, NULL, NULL, drbg->V)
+            || !EVP_EncryptUpdate(&drbg->cctx, out, &outl, out, outlen))
+            return 0;
+        /* V is left at the last counter block used */
+        ctr_add(drbg->V, (outlen - 1) / DRBG_BLOCKLEN);
+    }
+    if (!ctr_drbg_update(drbg, adin))
+        return 0;
+    drbg->reseed_counter++;
+    return 1;
+}
+
+static void ctr_drbg_uninstantiate(CTR_DRBG *drbg)
+{
+    EVP_CIPHER_CTX_cleanup(&drbg->cctx);
+    OPENSSL_cleanse(drbg->V, sizeof(drbg->V));
+    drbg->reseed_counter = 0;
+    drbg->seeded = 0;
+}
+
+static void child_free(void *arg)
+{
+    CTR_DRBG *child = arg;
+
+    ctr_drbg_uninstantiate(child);
+    OPENSSL_free(child);
+}
+
+static void drbg_init(void)
+{
+    EVP_CIPHER_CTX_init(&master.cctx);
+    master_lock = CRYPTO_THREAD_lock_new();
+    if (master_lock == NULL)
+        return;
+    if (!CRYPTO_THREAD_init_local(&child_key, child_free)) {
+        CRYPTO_THREAD_lock_free(master_lock);
+        master_lock = NULL;
+        return;
+    }
+#ifdef DRBG_ATFORK
+    /* The handler can't be removed, so it stays across RAND_cleanup() */
+    if (!fork_handler)
+        fork_handler = pthread_atfork(NULL, NULL, drbg_atfork_child) == 0;
+#endif
+    drbg_inited = 1;
+}
+
+static int drbg_forked(CTR_DRBG *child)
+{
+#ifdef DRBG_ATFORK
+    if (fork_handler)
+        return child->fork_count != fork_count;
+#endif
+#ifndef GETPID_IS_MEANINGLESS
+    return child->pid != getpid();
+#else
+    return 0;
+#endif
+}
+
+/* Set up the master once, and again after RAND_cleanup() has freed it */
+static int drbg_setup(void)
+{
+    if (!CRYPTO_THREAD_run_once(&drbg_once, drbg_init))
+        return 0;
+    if (!drbg_inited) {
+        CRYPTO_w_lock(CRYPTO_LOCK_RAND);
+        if (!drbg_inited)
+            drbg_init();
+        CRYPTO_w_unlock(CRYPTO_LOCK_RAND);
+    }
+    return drbg_inited;
+}
+
+/*
+ * Additional input for the master when it seeds a child: this tells apart
+ * children seeded from the same master state, in particular after fork().
+ */
+static void child_adin(CTR_DRBG *child, unsigned char *adin)
+{
+    CRYPTO_THREAD_ID tid = CRYPTO_THREAD_get_current_id();
+    time_t t = time(NULL);
+    unsigned char *p = adin;
+
+    memset(adin, 0, DRBG_SEEDLEN);
+    memcpy(p, &child, sizeof(child));
+    p += sizeof(child);
+    memcpy(p, &t, sizeof(t) < 8 ? sizeof(t) : 8);
+    p += 8;
+#ifndef GETPID_IS_MEANINGLESS
+    memcpy(p, &child->pid, sizeof(child->pid));
+    p += sizeof(child->pid);
+#endif
+    memcpy(p, &tid, sizeof(tid) < 16 ? sizeof(tid) : 16);
+    rand_hw_xor(adin, DRBG_SEEDLEN);
+}
+
+/* Draw fresh seed material for |child| from the master */
+static int child_reseed(CTR_DRBG *child)
+{
+    unsigned char seed[DRBG_SEEDLEN], adin[DRBG_SEEDLEN];
+    unsigned int reseeds = 0;
+    int ok = 0;
+
+#ifdef DRBG_ATFORK
+    child->fork_count = fork_count;
+#endif
+#ifndef GETPID_IS_MEANINGLESS
+    child->pid = getpid();
+#endif
+    child_adin(child, adin);
+
+    CRYPTO_THREAD_write_lock(master_lock);
+    if (!master_polled) {
+        /* RAND_poll() feeds us through RAND_add() so drop the lock */
+        master_polled = 1;
+        CRYPTO_THREAD_unlock(master_lock);
+        RAND_poll();
+        CRYPTO_THREAD_write_lock(master_lock);
+    }
+    if (master_entropy >= ENTROPY_NEEDED) {
+        reseeds = master_reseeds_get();
+        ok = ctr_drbg_generate(&master, seed, sizeof(seed), adin);
+    }
+    CRYPTO_THREAD_unlock(master_lock);
+
+    if (!ok) {
+        RANDerr(RAND_F_RAND_BYTES, RAND_R_PRNG_NOT_SEEDED);
+        ERR_add_error_data(1, "You need to read the OpenSSL FAQ, "
+                           "http://www.openssl.org/support/faq.html");
+        goto err;
+    }
+    if (!ctr_drbg_reseed(child, seed)) {
+        RANDerr(RAND_F_RAND_BYTES, ERR_R_EVP_LIB);
+        ok = 0;
+        goto err;
+    }
+    child->master_reseeds = reseeds;
+ err:
+    OPENSSL_cleanse(seed, sizeof(seed));
+    return ok;
+}
+
+static CTR_DRBG *child_get(void)
+{
+    CTR_DRBG *child;
+
+    if (!drbg_setup())
+        return NULL;
+    child = CRYPTO_THREAD_get_local(&child_key);
+    if (child == NULL) {
+        child = OPENSSL_zalloc(sizeof(*child));
+        if (child == NULL)
+            return NULL;
+        EVP_CIPHER_CTX_init(&child->cctx);
+        if (!CRYPTO_THREAD_set_local(&child_key, child)) {
+            OPENSSL_free(child);
+            return NULL;
+        }
+    }
+    return child;
+}
+
+/*
+ * Free the master, the calling thread's child and the thread-local key.
+ * Children of other threads that are still running can't be reached any
+ * more and are not freed; RAND_cleanup() must only be called when no other
+ * thread uses the PRNG.
+ */
+static void rand_cleanup(void)
+{
+    CTR_DRBG *child;
+
+    CRYPTO_w_lock(CRYPTO_LOCK_RAND);
+    if (!drbg_inited) {
+        CRYPTO_w_unlock(CRYPTO_LOCK_RAND);
+        return;
+    }
+    if ((child = CRYPTO_THREAD_get_local(&child_key)) != NULL) {
+        CRYPTO_THREAD_set_local(&child_key, NULL);
+        child_free(child);
+    }
+    CRYPTO_THREAD_cleanup_local(&child_key);
+
+    ctr_drbg_uninstantiate(&master);
+    master_entropy = 0;
+    master_polled = 0;
+    master_reseeds_bump();
+    CRYPTO_THREAD_lock_free(master_lock);
+    master_lock = NULL;
+    drbg_inited = 0;
+    CRYPTO_w_unlock(CRYPTO_LOCK_RAND);
+}
+
+/*
+ * Input of any length is conditioned to DRBG_SEEDLEN bytes with SHA-384
+ * and always mixed into the master. Input that is credited with entropy
+ * also makes every child reseed from the master on its next request.
+ * Input without entropy, which BN_rand() and others add on hot paths, is
+ * not worth pushing all children through the master for; it reaches them
+ * at their next scheduled reseed. The calling thread's child mixes it in
+ * straight away in either case.
+ */
+static int rand_add(const void *buf, int num, double add)
+{
+    unsigned char seed[DRBG_SEEDLEN], mseed[DRBG_SEEDLEN];
+    CTR_DRBG *child;
+    int ok = 1;
+
+    if (num <= 0)
+        return 1;
+    if (!drbg_setup())
+        return 0;
+    if (SHA384(buf, num, seed) == NULL)
+        return 0;
+
+    child = CRYPTO_THREAD_get_local(&child_key);
+    if (child != NULL && child->seeded)
+        ok = ctr_drbg_update(child, seed);
+
+    memcpy(mseed, seed, sizeof(mseed));
+    rand_hw_xor(mseed, sizeof(mseed));
+    CRYPTO_THREAD_write_lock(master_lock);
+    if (ctr_drbg_reseed(&master, mseed)) {
+        if (master_entropy < ENTROPY_NEEDED) /* stop counting when we have enough */
+            master_entropy += add;
+        if (add > 0)
+            master_reseeds_bump();
+    } else {
+        ok = 0;
+    }
+    CRYPTO_THREAD_unlock(master_lock);
+
+    OPENSSL_cleanse(seed, sizeof(seed));
+    OPENSSL_cleanse(mseed, sizeof(mseed));
+    return ok;
+}
+
+static int rand_seed(const void *buf, int num)
+{
+    return rand_add(buf, num, (double)num);
+}
+
+static int rand_bytes(unsigned char *buf, int num)
+{
+    CTR_DRBG *child;
+    int n;
+
+#ifdef PREDICT
+    if (rand_predictable) {
+        static unsigned char val = 0;
+        int i;
+
+        for (i = 0; i < num; i++)
+            buf[i] = val++;
+        return 1;
+    }
+#endif
+
+    if (num <= 0)
+        return 1;
+    if ((child = child_get()) == NULL) {
+        RANDerr(RAND_F_RAND_BYTES, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+
+    if (!child->seeded
+        || child->reseed_counter >= DRBG_CHILD_RESEED_INTERVAL
+        || child->master_reseeds != master_reseeds_get()
+        || drbg_forked(child)) {
+        if (!child_reseed(child))
+            return 0;
+    }
+
+    while (num > 0) {
+        n = num > DRBG_MAX_REQUEST ? DRBG_MAX_REQUEST : num;
+        if (!ctr_drbg_generate(child, buf, n, NULL)) {
+            RANDerr(RAND_F_RAND_BYTES, ERR_R_EVP_LIB);
+            return 0;
+        }
+        buf += n;
+        num -= n;
+    }
+    return 1;
+}
+
+static int rand_status(void)
+{
+    int ret, poll;
+
+    if (!drbg_setup())
+        return 0;
+    CRYPTO_THREAD_write_lock(master_lock);
+    poll = !master_polled;
+    master_polled = 1;
+    CRYPTO_THREAD_unlock(master_lock);
+    if (poll)
+        RAND_poll();
+
+    CRYPTO_THREAD_read_lock(master_lock);
+    ret = master_entropy >= ENTROPY_NEEDED;
+    CRYPTO_THREAD_unlock(master_lock);
+    return ret;
+}
+
+/*
+ * rand_hw_xor: XOR a buffer with output from any available hardware RNG.
+ * Only rdrand is currently supported.
+ */
+
+/* Adapted from eng_rdrand.c */
+
+#if (defined(__i386)   || defined(__i386__)   || defined(_M_IX86) || \
+     defined(__x86_64) || defined(__x86_64__) || \
+     defined(_M_AMD64) || defined (_M_X64)) && defined(OPENSSL_CPUID_OBJ)
+
+size_t OPENSSL_ia32_rdrand(void);
+extern unsigned int OPENSSL_ia32cap_P[];
+
+void rand_hw_xor(unsigned char *buf, size_t num)
+{
+    size_t rnd;
+    if (!(OPENSSL_ia32cap_P[1] & (1 << (62 - 32))))
+        return;
+    while (num >= sizeof(size_t)) {
+        rnd = OPENSSL_ia32_rdrand();
+        if (rnd == 0)
+            return;
+        *((size_t *)buf) ^= rnd;
+        buf += sizeof(size_t);
+        num -= sizeof(size_t);
+    }
+    if (num) {
+        rnd = OPENSSL_ia32_rdrand();
+        if (rnd == 0)
+            return;
+        while (num) {
+            *buf ^= rnd & 0xff;
+            rnd >>= 8;
+            buf++;
+            num--;
+        }
+    }
+}
+
+#else
+
+void rand_hw_xor(unsigned char *buf, size_t num)
+{
+    return;
+}
+
+#endif
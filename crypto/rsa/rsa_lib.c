@@ -63,6 +63,7 @@
 #include "internal/bn_int.h"
 #include <openssl/rsa.h>
 #include <openssl/rand.h>
+#include "internal/refcount.h"
 #ifndef OPENSSL_NO_ENGINE
 # include <openssl/engine.h>
 #endif
@@ -131,11 +132,19 @@ RSA *RSA_new_method(ENGINE *engine)
         return NULL;
     }
 
+    ret->lock = CRYPTO_THREAD_lock_new();
+    if (ret->lock == NULL) {
+        RSAerr(RSA_F_RSA_NEW_METHOD, ERR_R_MALLOC_FAILURE);
+        OPENSSL_free(ret);
+        return NULL;
+    }
+
     ret->meth = RSA_get_default_method();
 #ifndef OPENSSL_NO_ENGINE
     if (engine) {
         if (!ENGINE_init(engine)) {
             RSAerr(RSA_F_RSA_NEW_METHOD, ERR_R_ENGINE_LIB);
+            CRYPTO_THREAD_lock_free(ret->lock);
             OPENSSL_free(ret);
             return NULL;
         }
@@ -147,6 +156,7 @@ RSA *RSA_new_method(ENGINE *engine)
         if (!ret->meth) {
             RSAerr(RSA_F_RSA_NEW_METHOD, ERR_R_ENGINE_LIB);
             ENGINE_finish(ret->engine);
+            CRYPTO_THREAD_lock_free(ret->lock);
             OPENSSL_free(ret);
             return NULL;
         }
@@ -160,6 +170,7 @@ RSA *RSA_new_method(ENGINE *engine)
         if (ret->engine)
             ENGINE_finish(ret->engine);
 #endif
+        CRYPTO_THREAD_lock_free(ret->lock);
         OPENSSL_free(ret);
         return (NULL);
     }
@@ -170,6 +181,7 @@ RSA *RSA_new_method(ENGINE *engine)
             ENGINE_finish(ret->engine);
 #endif
         CRYPTO_free_ex_data(CRYPTO_EX_INDEX_RSA, ret, &ret->ex_data);
+        CRYPTO_THREAD_lock_free(ret->lock);
         OPENSSL_free(ret);
         ret = NULL;
     }
@@ -183,7 +195,7 @@ void RSA_free(RSA *r)
     if (r == NULL)
         return;
 
-    i = CRYPTO_add(&r->references, -1, CRYPTO_LOCK_RSA);
+    i = CRYPTO_DOWN_REF(&r->references, CRYPTO_LOCK_RSA);
 #ifdef REF_PRINT
     REF_PRINT("RSA", r);
 #endif
@@ -216,12 +228,13 @@ void RSA_free(RSA *r)
     BN_BLINDING_free(r->blinding);
     BN_BLINDING_free(r->mt_blinding);
     OPENSSL_free(r->bignum_data);
+    CRYPTO_THREAD_lock_free(r->lock);
     OPENSSL_free(r);
 }
 
 int RSA_up_ref(RSA *r)
 {
-    int i = CRYPTO_add(&r->references, 1, CRYPTO_LOCK_RSA);
+    int i = CRYPTO_UP_REF(&r->references, CRYPTO_LOCK_RSA);
 #ifdef REF_PRINT
     REF_PRINT("RSA", r);
 #endif
@@ -66,6 +66,7 @@
 #include <openssl/sha.h>
 #include <openssl/x509.h>
 #include "str_locl.h"
+#include "internal/refcount.h"
 
 const char *const STORE_object_type_string[STORE_OBJECT_TYPE_NUM + 1] = {
     0,
@@ -427,7 +428,7 @@ EVP_PKEY *STORE_generate_key(STORE *s, OPENSSL_ITEM attributes[],
         STOREerr(STORE_F_STORE_GENERATE_KEY, STORE_R_FAILED_GENERATING_KEY);
         return 0;
     }
-    CRYPTO_add(&object->data.key->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&object->data.key->references, CRYPTO_LOCK_EVP_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("EVP_PKEY", data);
 #endif
@@ -451,7 +452,7 @@ EVP_PKEY *STORE_get_private_key(STORE *s, OPENSSL_ITEM attributes[],
         STOREerr(STORE_F_STORE_GET_PRIVATE_KEY, STORE_R_FAILED_GETTING_KEY);
         return 0;
     }
-    CRYPTO_add(&object->data.key->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&object->data.key->references, CRYPTO_LOCK_EVP_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("EVP_PKEY", data);
 #endif
@@ -481,7 +482,7 @@ int STORE_store_private_key(STORE *s, EVP_PKEY *data,
         return 0;
     }
 
-    CRYPTO_add(&data->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&data->references, CRYPTO_LOCK_EVP_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("EVP_PKEY", data);
 #endif
@@ -585,7 +586,7 @@ EVP_PKEY *STORE_list_private_key_next(STORE *s, void *handle)
                  STORE_R_FAILED_LISTING_KEYS);
         return 0;
     }
-    CRYPTO_add(&object->data.key->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&object->data.key->references, CRYPTO_LOCK_EVP_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("EVP_PKEY", data);
 #endif
@@ -635,7 +636,7 @@ EVP_PKEY *STORE_get_public_key(STORE *s, OPENSSL_ITEM attributes[],
         STOREerr(STORE_F_STORE_GET_PUBLIC_KEY, STORE_R_FAILED_GETTING_KEY);
         return 0;
     }
-    CRYPTO_add(&object->data.key->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&object->data.key->references, CRYPTO_LOCK_EVP_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("EVP_PKEY", data);
 #endif
@@ -665,7 +666,7 @@ int STORE_store_public_key(STORE *s, EVP_PKEY *data,
         return 0;
     }
 
-    CRYPTO_add(&data->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&data->references, CRYPTO_LOCK_EVP_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("EVP_PKEY", data);
 #endif
@@ -769,7 +770,7 @@ EVP_PKEY *STORE_list_public_key_next(STORE *s, void *handle)
                  STORE_R_FAILED_LISTING_KEYS);
         return 0;
     }
-    CRYPTO_add(&object->data.key->references, 1, CRYPTO_LOCK_EVP_PKEY);
+    CRYPTO_UP_REF(&object->data.key->references, CRYPTO_LOCK_EVP_PKEY);
 #ifdef REF_PRINT
     REF_PRINT("EVP_PKEY", data);
 #endif
@@ -67,27 +67,58 @@
 #endif
 #ifndef OPENSSL_NO_POSIX_IO
 # include <sys/stat.h>
+# ifdef _WIN32
+#  define stat _stat
+# endif
 #endif
 
 
 #include <openssl/lhash.h>
 #include <openssl/x509.h>
 #include "internal/x509_int.h"
+#include "internal/o_dir.h"
+#include "x509_lcl.h"
 
 typedef struct lookup_dir_hashes_st {
     unsigned long hash;
     int suffix;
 } BY_DIR_HASH;
 
+/*
+ * Index entry for the files of one hash value in an indexed directory:
+ * |certs| and |crls| are one more than the highest <hash>.N and <hash>.rN
+ * suffixes present, |certs_loaded| and |crls_loaded| how many of those,
+ * counting from suffix 0 without gaps, have been loaded into the store.
+ */
+typedef struct lookup_dir_index_st {
+    unsigned long hash;
+    int certs, crls;
+    int certs_loaded, crls_loaded;
+} BY_DIR_INDEX;
+
+DECLARE_STACK_OF(BY_DIR_INDEX)
+
 typedef struct lookup_dir_entry_st {
     char *dir;
     int dir_type;
     STACK_OF(BY_DIR_HASH) *hashes;
+    /* Directory index, if the lookup is indexed and it has been read */
+    STACK_OF(BY_DIR_INDEX) *index;
+    time_t index_mtime;         /* directory mtime when read, or -1 */
+    time_t index_checked;       /* when the mtime was last checked */
+    unsigned long index_gen;    /* bumped each time |index| is replaced */
 } BY_DIR_ENTRY;
 
 typedef struct lookup_dir_st {
     BUF_MEM *buffer;
     STACK_OF(BY_DIR_ENTRY) *dirs;
+    /* Seconds between directory mtime checks, -1 if not indexed */
+    long index_interval;
+    /*
+     * Protects the directory indexes.  It is never held while reading a
+     * directory or loading files.
+     */
+    CRYPTO_RWLOCK *lock;
 } BY_DIR;
 
 DECLARE_STACK_OF(BY_DIR_HASH)
@@ -142,6 +173,12 @@ static int dir_ctrl(X509_LOOKUP *ctx, int cmd, const char *argp, long argl,
         } else
             ret = add_cert_dir(ld, argp, (int)argl);
         break;
+    case X509_L_INDEX_DIRS:
+        if (argl >= 0) {
+            ld->index_interval = argl;
+            ret = 1;
+        }
+        break;
     }
     return (ret);
 }
@@ -156,7 +193,13 @@ static int new_dir(X509_LOOKUP *lu)
         OPENSSL_free(a);
         return (0);
     }
+    if ((a->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        BUF_MEM_free(a->buffer);
+        OPENSSL_free(a);
+        return (0);
+    }
     a->dirs = NULL;
+    a->index_interval = -1;
     lu->method_data = (char *)a;
     return (1);
 }
@@ -176,10 +219,26 @@ static int by_dir_hash_cmp(const BY_DIR_HASH *const *a,
     return 0;
 }
 
+static void by_dir_index_free(BY_DIR_INDEX *idx)
+{
+    OPENSSL_free(idx);
+}
+
+static int by_dir_index_cmp(const BY_DIR_INDEX *const *a,
+                            const BY_DIR_INDEX *const *b)
+{
+    if ((*a)->hash > (*b)->hash)
+        return 1;
+    if ((*a)->hash < (*b)->hash)
+        return -1;
+    return 0;
+}
+
 static void by_dir_entry_free(BY_DIR_ENTRY *ent)
 {
     OPENSSL_free(ent->dir);
     sk_BY_DIR_HASH_pop_free(ent->hashes, by_dir_hash_free);
+    sk_BY_DIR_INDEX_pop_free(ent->index, by_dir_index_free);
     OPENSSL_free(ent);
 }
 
@@ -190,6 +249,7 @@ static void free_dir(X509_LOOKUP *lu)
     a = (BY_DIR *)lu->method_data;
     sk_BY_DIR_ENTRY_pop_free(a->dirs, by_dir_entry_free);
     BUF_MEM_free(a->buffer);
+    CRYPTO_THREAD_lock_free(a->lock);
     OPENSSL_free(a);
 }
 
@@ -232,6 +292,10 @@ static int add_cert_dir(BY_DIR *ctx, const char *dir, int type)
             if (!ent)
                 return 0;
             ent->dir_type = type;
+            ent->index = NULL;
+            ent->index_mtime = -1;
+            ent->index_checked = 0;
+            ent->index_gen = 0;
             ent->hashes = sk_BY_DIR_HASH_new(by_dir_hash_cmp);
             ent->dir = OPENSSL_malloc((unsigned int)len + 1);
             if (!ent->dir || !ent->hashes) {
@@ -249,32 +313,236 @@ static int add_cert_dir(BY_DIR *ctx, const char *dir, int type)
     return 1;
 }
 
+/*
+ * Parse a hashed file name, <hash>.N or <hash>.rN, returning 0 if |name|
+ * isn't one.
+ */
+static int parse_hashed_name(const char *name, unsigned long *hash,
+                             int *crl, int *suffix)
+{
+    unsigned long h = 0;
+    int i, n = 0;
+
+    for (i = 0; i < 8; i++) {
+        if (name[i] >= '0' && name[i] <= '9')
+            h = (h << 4) | (name[i] - '0');
+        else if (name[i] >= 'a' && name[i] <= 'f')
+            h = (h << 4) | (name[i] - 'a' + 10);
+        else
+            return 0;
+    }
+    if (name[i++] != '.')
+        return 0;
+    *crl = name[i] == 'r';
+    if (*crl)
+        i++;
+    if (name[i] == '\0')
+        return 0;
+    for (; name[i] != '\0'; i++) {
+        if (name[i] < '0' || name[i] > '9' || n > 100000)
+            return 0;
+        n = n * 10 + name[i] - '0';
+    }
+    *hash = h;
+    *suffix = n;
+    return 1;
+}
+
+/* Read the names of the hashed files in |dir| into a new index */
+static STACK_OF(BY_DIR_INDEX) *read_dir_index(const char *dir)
+{
+    OPENSSL_DIR_CTX *d = NULL;
+    STACK_OF(BY_DIR_INDEX) *index;
+    BY_DIR_INDEX itmp, *ient;
+    const char *filename;
+    unsigned long h;
+    int idx, crl, suffix;
+
+    if ((index = sk_BY_DIR_INDEX_new(by_dir_index_cmp)) == NULL)
+        return NULL;
+    while ((filename = OPENSSL_DIR_read(&d, dir)) != NULL) {
+        if (!parse_hashed_name(filename, &h, &crl, &suffix))
+            continue;
+        itmp.hash = h;
+        idx = sk_BY_DIR_INDEX_find(index, &itmp);
+        if (idx >= 0) {
+            ient = sk_BY_DIR_INDEX_value(index, idx);
+        } else {
+            if ((ient = OPENSSL_zalloc(sizeof(*ient))) == NULL
+                || !sk_BY_DIR_INDEX_push(index, ient)) {
+                OPENSSL_free(ient);
+                OPENSSL_DIR_end(&d);
+                sk_BY_DIR_INDEX_pop_free(index, by_dir_index_free);
+                return NULL;
+            }
+            ient->hash = h;
+        }
+        if (crl && ient->crls <= suffix)
+            ient->crls = suffix + 1;
+        else if (!crl && ient->certs <= suffix)
+            ient->certs = suffix + 1;
+    }
+    OPENSSL_DIR_end(&d);
+    /* Sort now so that later lookups don't modify the stack */
+    sk_BY_DIR_INDEX_sort(index);
+    return index;
+}
+
+/*
+ * Find the files for hash |h| and lookup |type| in the current index of
+ * |ent|: set |*first| to the number of them already loaded and |*last| to
+ * the total.  The lookup's lock must be held.
+ */
+static void index_find(BY_DIR_ENTRY *ent, int type, unsigned long h,
+                       int *first, int *last)
+{
+    BY_DIR_INDEX itmp, *ient;
+    int idx;
+
+    *first = *last = 0;
+    itmp.hash = h;
+    /* The index is sorted, so this does not modify it */
+    idx = sk_BY_DIR_INDEX_find(ent->index, &itmp);
+    if (idx < 0)
+        return;
+    ient = sk_BY_DIR_INDEX_value(ent->index, idx);
+    if (type == X509_LU_X509) {
+        *first = ient->certs_loaded;
+        *last = ient->certs;
+    } else {
+        *first = ient->crls_loaded;
+        *last = ient->crls;
+    }
+}
+
+/*
+ * Look up hash |h| in indexed directory |ent| as index_find() does, and set
+ * |*gen| to the generation of the index the answer came from.  The directory
+ * is read the first time through and again whenever its mtime is seen to
+ * have changed; the mtime is checked at most every |interval| seconds.  The
+ * directory is read without holding the lock, which is only taken for
+ * writing to install the new index.  Returns 0 on allocation failure.
+ */
+static int index_lookup(BY_DIR *ctx, BY_DIR_ENTRY *ent, int type,
+                        unsigned long h, int *first, int *last,
+                        unsigned long *gen)
+{
+    STACK_OF(BY_DIR_INDEX) *index = NULL;
+    time_t now = time(NULL), mtime = -1, old_mtime;
+    unsigned long old_gen;
+    int have_index;
+
+    CRYPTO_THREAD_read_lock(ctx->lock);
+    have_index = ent->index != NULL;
+    if (have_index && now - ent->index_checked < ctx->index_interval) {
+        index_find(ent, type, h, first, last);
+        *gen = ent->index_gen;
+        CRYPTO_THREAD_unlock(ctx->lock);
+        return 1;
+    }
+    old_mtime = ent->index_mtime;
+    old_gen = ent->index_gen;
+    CRYPTO_THREAD_unlock(ctx->lock);
+
+#ifndef OPENSSL_NO_POSIX_IO
+    {
+        struct stat st;
+
+        if (stat(ent->dir, &st) == 0)
+            mtime = st.st_mtime;
+    }
+#endif
+    /*
+     * Re-read the directory if its mtime has changed.  If the mtime is
+     * unknown or so recent that the directory could change again without
+     * it changing, keep re-reading it until it settles.
+     */
+    if ((!have_index || mtime == -1 || mtime != old_mtime)
+            && (index = read_dir_index(ent->dir)) == NULL)
+        return 0;
+
+    CRYPTO_THREAD_write_lock(ctx->lock);
+    /* If another thread replaced the index meanwhile, use its one */
+    if (ent->index_gen == old_gen) {
+        ent->index_checked = now;
+        if (index != NULL) {
+            sk_BY_DIR_INDEX_pop_free(ent->index, by_dir_index_free);
+            ent->index = index;
+            ent->index_mtime = mtime < now ? mtime : -1;
+            ent->index_gen++;
+            index = NULL;
+        }
+    }
+    index_find(ent, type, h, first, last);
+    *gen = ent->index_gen;
+    CRYPTO_THREAD_unlock(ctx->lock);
+
+    sk_BY_DIR_INDEX_pop_free(index, by_dir_index_free);
+    return 1;
+}
+
+/*
+ * Record that the first |loaded| files for hash |h| and lookup |type| have
+ * been loaded, unless the index they were listed in has since been
+ * replaced.
+ */
+static void index_set_loaded(BY_DIR *ctx, BY_DIR_ENTRY *ent, int type,
+                             unsigned long h, unsigned long gen, int loaded)
+{
+    BY_DIR_INDEX itmp, *ient;
+    int idx;
+
+    CRYPTO_THREAD_write_lock(ctx->lock);
+    itmp.hash = h;
+    if (ent->index_gen == gen
+            && (idx = sk_BY_DIR_INDEX_find(ent->index, &itmp)) >= 0) {
+        ient = sk_BY_DIR_INDEX_value(ent->index, idx);
+        if (type == X509_LU_X509 && ient->certs_loaded < loaded)
+            ient->certs_loaded = loaded;
+        else if (type == X509_LU_CRL && ient->crls_loaded < loaded)
+            ient->crls_loaded = loaded;
+    }
+    CRYPTO_THREAD_unlock(ctx->lock);
+}
+
+/*
+ * Load an indexed file, ignoring any errors.  A file whose contents are
+ * already in the store counts as loaded.  Returns 1 if the file is loaded.
+ */
+static int index_load_file(X509_LOOKUP *xl, int type, const char *file,
+                           int filetype)
+{
+    int ok;
+
+    ERR_set_mark();
+    if (type == X509_LU_X509)
+        ok = X509_load_cert_file(xl, file, filetype);
+    else
+        ok = X509_load_crl_file(xl, file, filetype);
+    if (!ok && ERR_GET_REASON(ERR_peek_last_error())
+               == X509_R_CERT_ALREADY_IN_HASH_TABLE)
+        ok = 1;
+    ERR_pop_to_mark();
+    return ok != 0;
+}
+
 static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
                                X509_NAME *name, X509_OBJECT *ret)
 {
     BY_DIR *ctx;
-    union {
-        X509 st_x509;
-        X509_CRL crl;
-    } data;
     int ok = 0;
-    int i, j, k;
-    unsigned long h;
+    int i, j, k, first = 0, last = 0, loaded = 0;
+    unsigned long h, gen = 0;
     BUF_MEM *b = NULL;
-    X509_OBJECT stmp, *tmp;
+    X509_OBJECT *tmp;
     const char *postfix = "";
 
     if (name == NULL)
         return (0);
 
-    stmp.type = type;
     if (type == X509_LU_X509) {
-        data.st_x509.cert_info.subject = name;
-        stmp.data.x509 = &data.st_x509;
         postfix = "";
     } else if (type == X509_LU_CRL) {
-        data.crl.crl.issuer = name;
-        stmp.data.crl = &data.crl;
         postfix = "r";
     } else {
         X509err(X509_F_GET_CERT_BY_SUBJECT, X509_R_WRONG_LOOKUP_TYPE);
@@ -299,9 +567,22 @@ static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
             X509err(X509_F_GET_CERT_BY_SUBJECT, ERR_R_MALLOC_FAILURE);
             goto finish;
         }
-        if (type == X509_LU_CRL && ent->hashes) {
+        if (ctx->index_interval >= 0) {
+            /*
+             * The files are loaded without holding the lock.  A concurrent
+             * lookup for the same hash may load them as well, which finds
+             * them already in the store and is harmless.
+             */
+            if (!index_lookup(ctx, ent, type, h, &first, &last, &gen)) {
+                X509err(X509_F_GET_CERT_BY_SUBJECT, ERR_R_MALLOC_FAILURE);
+                goto finish;
+            }
+            k = loaded = first;
+            hent = NULL;
+        } else if (type == X509_LU_CRL && ent->hashes) {
             htmp.hash = h;
-            CRYPTO_r_lock(CRYPTO_LOCK_X509_STORE);
+            /* sk_BY_DIR_HASH_find() may sort the stack, so lock for write */
+            CRYPTO_THREAD_write_lock(xl->store_ctx->lock);
             idx = sk_BY_DIR_HASH_find(ent->hashes, &htmp);
             if (idx >= 0) {
                 hent = sk_BY_DIR_HASH_value(ent->hashes, idx);
@@ -310,13 +591,19 @@ static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
                 hent = NULL;
                 k = 0;
             }
-            CRYPTO_r_unlock(CRYPTO_LOCK_X509_STORE);
+            CRYPTO_THREAD_unlock(xl->store_ctx->lock);
         } else {
             k = 0;
             hent = NULL;
         }
         for (;;) {
             char c = '/';
+
+            if (ctx->index_interval >= 0 && k >= last) {
+                if (loaded > first)
+                    index_set_loaded(ctx, ent, type, h, gen, loaded);
+                break;
+            }
 #ifdef OPENSSL_SYS_VMS
             c = ent->dir[strlen(ent->dir) - 1];
             if (c != ':' && c != '>' && c != ']') {
@@ -342,10 +629,19 @@ static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
                 BIO_snprintf(b->data, b->max,
                              "%s%c%08lx.%s%d", ent->dir, c, h, postfix, k);
             }
+            if (ctx->index_interval >= 0) {
+                /*
+                 * The index says the file exists.  Only count it as loaded
+                 * once it and all the files before it have been, so that
+                 * a failed load is retried by the next lookup.
+                 */
+                if (index_load_file(xl, type, b->data, ent->dir_type)
+                    && loaded == k)
+                    loaded = k + 1;
+                k++;
+                continue;
+            }
 #ifndef OPENSSL_NO_POSIX_IO
-# ifdef _WIN32
-#  define stat _stat
-# endif
             {
                 struct stat st;
                 if (stat(b->data, &st) < 0)
@@ -367,18 +663,15 @@ static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
         /*
          * we have added it to the cache so now pull it out again
          */
-        CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-        j = sk_X509_OBJECT_find(xl->store_ctx->objs, &stmp);
-        if (j != -1)
-            tmp = sk_X509_OBJECT_value(xl->store_ctx->objs, j);
-        else
-            tmp = NULL;
-        CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+        CRYPTO_THREAD_read_lock(xl->store_ctx->lock);
+        tmp = sk_X509_OBJECT_value(x509_store_index_by_subject(
+                                       xl->store_ctx->index, type, name), 0);
+        CRYPTO_THREAD_unlock(xl->store_ctx->lock);
 
         /* If a CRL, update the last file suffix added for this */
 
-        if (type == X509_LU_CRL) {
-            CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+        if (type == X509_LU_CRL && ctx->index_interval < 0) {
+            CRYPTO_THREAD_write_lock(xl->store_ctx->lock);
             /*
              * Look for entry again in case another thread added an entry
              * first.
@@ -392,7 +685,7 @@ static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
             if (!hent) {
                 hent = OPENSSL_malloc(sizeof(*hent));
                 if (hent == NULL) {
-                    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+                    CRYPTO_THREAD_unlock(xl->store_ctx->lock);
                     X509err(X509_F_GET_CERT_BY_SUBJECT, ERR_R_MALLOC_FAILURE);
                     ok = 0;
                     goto finish;
@@ -400,7 +693,7 @@ static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
                 hent->hash = h;
                 hent->suffix = k;
                 if (!sk_BY_DIR_HASH_push(ent->hashes, hent)) {
-                    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+                    CRYPTO_THREAD_unlock(xl->store_ctx->lock);
                     OPENSSL_free(hent);
                     ok = 0;
                     goto finish;
@@ -408,7 +701,7 @@ static int get_cert_by_subject(X509_LOOKUP *xl, X509_LOOKUP_TYPE type,
             } else if (hent->suffix < k)
                 hent->suffix = k;
 
-            CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+            CRYPTO_THREAD_unlock(xl->store_ctx->lock);
 
         }
 
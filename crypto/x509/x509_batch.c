@@ -0,0 +1,235 @@
+/* crypto/x509/x509_batch.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/*
+ * Verification of many certificate chains at once.  The contexts are
+ * handed out one at a time to a set of worker threads, and signature
+ * checks that succeed are recorded in a cache shared by the whole batch,
+ * so an intermediate CA common to many chains has its signature checked
+ * only once however many copies of it the chains carry.
+ */
+
+#if defined(_WIN32)
+# include <windows.h>
+#endif
+
+#include <stdio.h>
+#include "internal/cryptlib.h"
+#include <openssl/x509.h>
+#include <openssl/x509_vfy.h>
+#include "x509_lcl.h"
+
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_WINDOWS)
+# define BATCH_WIN32_THREADS
+typedef HANDLE BATCH_THREAD;
+#elif defined(OPENSSL_THREADS)
+# define BATCH_PTHREADS
+typedef pthread_t BATCH_THREAD;
+#endif
+
+/* Size of the signature cache used when a store has none of its own */
+#define X509_BATCH_SIGCACHE_SIZE        1024
+
+typedef struct verify_batch_st {
+    X509_STORE_CTX **ctxs;
+    int *results;
+    int num;
+    /* Index of the next context to verify, and whether any failed */
+    int next;
+    int failed;
+    CRYPTO_RWLOCK *lock;
+} VERIFY_BATCH;
+
+/*
+ * Record the result |last| of the previous verification and return the
+ * index of the next context to verify, or -1 if there are none left.
+ */
+static int batch_next(VERIFY_BATCH *batch, int last)
+{
+    int i = -1;
+
+    CRYPTO_THREAD_write_lock(batch->lock);
+    if (last <= 0)
+        batch->failed = 1;
+    if (batch->next < batch->num)
+        i = batch->next++;
+    CRYPTO_THREAD_unlock(batch->lock);
+    return i;
+}
+
+static void batch_run(VERIFY_BATCH *batch)
+{
+    int i, ret = 1;
+
+    while ((i = batch_next(batch, ret)) >= 0) {
+        ret = X509_verify_cert(batch->ctxs[i]);
+        if (batch->results != NULL)
+            batch->results[i] = ret;
+    }
+}
+
+#if defined(BATCH_WIN32_THREADS)
+static DWORD WINAPI batch_thread(LPVOID arg)
+{
+    batch_run(arg);
+    return 0;
+}
+
+static int batch_thread_start(BATCH_THREAD *thread, VERIFY_BATCH *batch)
+{
+    *thread = CreateThread(NULL, 0, batch_thread, batch, 0, NULL);
+    return *thread != NULL;
+}
+
+static void batch_thread_join(BATCH_THREAD thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#elif defined(BATCH_PTHREADS)
+static void *batch_thread(void *arg)
+{
+    batch_run(arg);
+    return NULL;
+}
+
+static int batch_thread_start(BATCH_THREAD *thread, VERIFY_BATCH *batch)
+{
+    return pthread_create(thread, NULL, batch_thread, batch) == 0;
+}
+
+static void batch_thread_join(BATCH_THREAD thread)
+{
+    pthread_join(thread, NULL);
+}
+#endif
+
+int X509_verify_cert_batch(X509_STORE_CTX **ctxs, int *results, int num,
+                           int threads)
+{
+    VERIFY_BATCH batch;
+    X509_SIGCACHE *sigcache = NULL;
+#if defined(BATCH_WIN32_THREADS) || defined(BATCH_PTHREADS)
+    BATCH_THREAD *workers = NULL;
+    int started = 0;
+#endif
+    int i, ret = -1;
+
+    if (num <= 0)
+        return 1;
+
+    batch.ctxs = ctxs;
+    batch.results = results;
+    batch.num = num;
+    batch.next = 0;
+    batch.failed = 0;
+    if ((batch.lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        X509err(X509_F_X509_VERIFY_CERT_BATCH, ERR_R_MALLOC_FAILURE);
+        return -1;
+    }
+
+    /*
+     * Contexts whose store keeps no signature cache share one for the
+     * duration of the batch.
+     */
+    for (i = 0; i < num; i++) {
+        X509_STORE_CTX *ctx = ctxs[i];
+
+        if (ctx->ctx != NULL && X509_STORE_get_sigcache_size(ctx->ctx) > 0)
+            continue;
+        if (sigcache == NULL
+            && (sigcache = x509_sigcache_new(X509_BATCH_SIGCACHE_SIZE))
+               == NULL) {
+            X509err(X509_F_X509_VERIFY_CERT_BATCH, ERR_R_MALLOC_FAILURE);
+            goto end;
+        }
+        ctx->sigcache = sigcache;
+    }
+
+#if defined(BATCH_WIN32_THREADS) || defined(BATCH_PTHREADS)
+    if (threads > num)
+        threads = num;
+    /* The calling thread is one of the workers */
+    if (threads > 1) {
+        workers = OPENSSL_malloc(sizeof(*workers) * (threads - 1));
+        if (workers == NULL) {
+            X509err(X509_F_X509_VERIFY_CERT_BATCH, ERR_R_MALLOC_FAILURE);
+            goto end;
+        }
+        /* If fewer threads can be started, the ones running do the rest */
+        while (started < threads - 1
+               && batch_thread_start(&workers[started], &batch))
+            started++;
+    }
+    batch_run(&batch);
+    for (i = 0; i < started; i++)
+        batch_thread_join(workers[i]);
+    OPENSSL_free(workers);
+#else
+    batch_run(&batch);
+#endif
+    ret = !batch.failed;
+
+ end:
+    if (sigcache != NULL) {
+        for (i = 0; i < num; i++) {
+            if (ctxs[i]->sigcache == sigcache)
+                ctxs[i]->sigcache = NULL;
+        }
+        x509_sigcache_free(sigcache);
+    }
+    CRYPTO_THREAD_lock_free(batch.lock);
+    return ret;
+}
@@ -214,6 +214,13 @@ int X509_NAME_cmp(const X509_NAME *a, const X509_NAME *b)
             return -2;
     }
 
+    /*
+     * Names are ordered by the hash of their canonical encoding first, so
+     * that different names rarely need their encodings compared.
+     */
+    if (a->canon_hash != b->canon_hash)
+        return a->canon_hash < b->canon_hash ? -1 : 1;
+
     ret = a->canon_enclen - b->canon_enclen;
 
     if (ret)
@@ -225,19 +232,11 @@ int X509_NAME_cmp(const X509_NAME *a, const X509_NAME *b)
 
 unsigned long X509_NAME_hash(X509_NAME *x)
 {
-    unsigned long ret = 0;
-    unsigned char md[SHA_DIGEST_LENGTH];
-
     /* Make sure X509_NAME structure contains valid cached encoding */
-    i2d_X509_NAME(x, NULL);
-    if (!EVP_Digest(x->canon_enc, x->canon_enclen, md, NULL, EVP_sha1(),
-                    NULL))
+    if (i2d_X509_NAME(x, NULL) < 0)
         return 0;
-
-    ret = (((unsigned long)md[0]) | ((unsigned long)md[1] << 8L) |
-           ((unsigned long)md[2] << 16L) | ((unsigned long)md[3] << 24L)
-        ) & 0xffffffffL;
-    return (ret);
+    /* The low 32 bits are the first four bytes of the SHA-1 hash */
+    return (unsigned long)(x->canon_hash & 0xffffffffL);
 }
 
 #ifndef OPENSSL_NO_MD5
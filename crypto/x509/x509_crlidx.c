@@ -0,0 +1,168 @@
+/* crypto/x509/x509_crlidx.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/*
+ * A compact hash index of CRL entry serial numbers.  Each slot holds a
+ * 32-bit hash of a serial number and a reference to the entry it came
+ * from; it is up to the caller what the reference points to and how the
+ * serial number of a candidate is checked.  The table uses open
+ * addressing with linear probing and is never more than two thirds full,
+ * so a lookup usually touches only a few slots.  Entries with equal serial
+ * numbers, as in indirect CRLs, are returned in the order they were added.
+ *
+ * The index is built once and only read afterwards, so it can be shared
+ * between threads without locking.
+ */
+
+#include <stdio.h>
+#include "internal/cryptlib.h"
+#include <openssl/x509.h>
+#include "internal/x509_int.h"
+#include "x509_lcl.h"
+
+typedef struct x509_crl_index_slot_st {
+    uint32_t hash;
+    const void *ref;            /* NULL if the slot is empty */
+} X509_CRL_INDEX_SLOT;
+
+struct x509_crl_index_st {
+    size_t mask;
+    X509_CRL_INDEX_SLOT *slots;
+};
+
+/*
+ * Hash the magnitude |data|, |len| and sign |neg| of a serial number with
+ * FNV-1a.  Leading zero octets are skipped so that the hash only depends
+ * on the value.
+ */
+uint32_t x509_crl_serial_hash(const unsigned char *data, int len, int neg)
+{
+    uint32_t h = 2166136261U;
+
+    while (len > 0 && *data == 0) {
+        data++;
+        len--;
+    }
+    while (len-- > 0) {
+        h ^= *data++;
+        h *= 16777619U;
+    }
+    return neg ? ~h : h;
+}
+
+/*
+ * Create an index with room for |num| entries, keeping the table at most
+ * two thirds full so that probe sequences stay short.
+ */
+X509_CRL_INDEX *x509_crl_index_new(size_t num)
+{
+    X509_CRL_INDEX *idx = OPENSSL_malloc(sizeof(*idx));
+    size_t size = 16;
+
+    if (idx == NULL)
+        return NULL;
+    while (size < num + num / 2)
+        size <<= 1;
+    if ((idx->slots = OPENSSL_zalloc(size * sizeof(*idx->slots))) == NULL) {
+        OPENSSL_free(idx);
+        return NULL;
+    }
+    idx->mask = size - 1;
+    return idx;
+}
+
+void x509_crl_index_free(X509_CRL_INDEX *idx)
+{
+    if (idx == NULL)
+        return;
+    OPENSSL_free(idx->slots);
+    OPENSSL_free(idx);
+}
+
+/*
+ * Add |ref| with serial number hash |hash|.  At most the |num| entries
+ * given to x509_crl_index_new() may be added.
+ */
+void x509_crl_index_add(X509_CRL_INDEX *idx, uint32_t hash, const void *ref)
+{
+    size_t i = hash & idx->mask;
+
+    while (idx->slots[i].ref != NULL)
+        i = (i + 1) & idx->mask;
+    idx->slots[i].hash = hash;
+    idx->slots[i].ref = ref;
+}
+
+/*
+ * Return the next entry whose serial number hash is |hash|, or NULL if
+ * there are no more.  |*iter| must be zero on the first call and is
+ * updated for the next one.  The caller has to check that the entry
+ * really has the serial number it is looking for.
+ */
+const void *x509_crl_index_next(const X509_CRL_INDEX *idx, uint32_t hash,
+                                size_t *iter)
+{
+    const X509_CRL_INDEX_SLOT *slot;
+
+    while (*iter <= idx->mask) {
+        slot = &idx->slots[(hash + *iter) & idx->mask];
+        if (slot->ref == NULL)
+            break;
+        (*iter)++;
+        if (slot->hash == hash)
+            return slot->ref;
+    }
+    return NULL;
+}
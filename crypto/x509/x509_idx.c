@@ -0,0 +1,342 @@
+/* crypto/x509/x509_idx.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/*
+ * Hash indexes over the objects held in an X509_STORE.  The store's |objs|
+ * stack keeps every object in insertion order; the indexes map a key to a
+ * bucket holding the objects that share it, so that neither adding an
+ * object nor looking one up has to sort or search the whole stack.  Three
+ * keys are indexed:
+ *
+ *  - the subject name of certificates and the issuer name of CRLs;
+ *  - the subject key identifier of certificates;
+ *  - the issuer name and serial number of certificates.
+ *
+ * Objects are never removed from a store, so buckets only grow and a
+ * bucket's key can point into the first object added to it.  The indexes
+ * are protected by the store lock: they are only modified with it held
+ * for writing, and lookups only need it held for reading.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "internal/cryptlib.h"
+#include <openssl/lhash.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include "internal/x509_int.h"
+#include "x509_lcl.h"
+
+typedef struct x509_object_bucket_st {
+    /* Key: any of the fields below which aren't used are NULL */
+    X509_LOOKUP_TYPE type;
+    X509_NAME *name;
+    ASN1_INTEGER *serial;
+    ASN1_OCTET_STRING *keyid;
+    /* All objects with this key, in the order they were added */
+    STACK_OF(X509_OBJECT) *objs;
+} X509_OBJECT_BUCKET;
+
+DECLARE_LHASH_OF(X509_OBJECT_BUCKET);
+
+struct x509_store_index_st {
+    LHASH_OF(X509_OBJECT_BUCKET) *by_subject;
+    LHASH_OF(X509_OBJECT_BUCKET) *by_keyid;
+    LHASH_OF(X509_OBJECT_BUCKET) *by_issuer_serial;
+};
+
+static unsigned long hash_bytes(const unsigned char *p, int len)
+{
+    unsigned long h = 0;
+
+    while (len-- > 0)
+        h = (h << 5) + (h >> 27) + *p++;
+    return h;
+}
+
+static unsigned long x509_object_bucket_hash(const X509_OBJECT_BUCKET *a)
+{
+    unsigned long h = (unsigned long)a->type;
+
+    if (a->name != NULL)
+        h ^= X509_NAME_hash(a->name);
+    if (a->serial != NULL)
+        h ^= hash_bytes(a->serial->data, a->serial->length);
+    if (a->keyid != NULL)
+        h ^= hash_bytes(a->keyid->data, a->keyid->length);
+    return h;
+}
+
+static int x509_object_bucket_cmp(const X509_OBJECT_BUCKET *a,
+                                  const X509_OBJECT_BUCKET *b)
+{
+    int ret;
+
+    if (a->type != b->type)
+        return a->type - b->type;
+    if ((a->name == NULL) != (b->name == NULL))
+        return a->name == NULL ? -1 : 1;
+    if (a->name != NULL && (ret = X509_NAME_cmp(a->name, b->name)) != 0)
+        return ret;
+    if ((a->serial == NULL) != (b->serial == NULL))
+        return a->serial == NULL ? -1 : 1;
+    if (a->serial != NULL
+        && (ret = ASN1_INTEGER_cmp(a->serial, b->serial)) != 0)
+        return ret;
+    if ((a->keyid == NULL) != (b->keyid == NULL))
+        return a->keyid == NULL ? -1 : 1;
+    if (a->keyid != NULL)
+        return ASN1_OCTET_STRING_cmp(a->keyid, b->keyid);
+    return 0;
+}
+
+static IMPLEMENT_LHASH_HASH_FN(x509_object_bucket, X509_OBJECT_BUCKET)
+static IMPLEMENT_LHASH_COMP_FN(x509_object_bucket, X509_OBJECT_BUCKET)
+
+static void bucket_free(X509_OBJECT_BUCKET *b)
+{
+    /* The objects themselves belong to the store */
+    sk_X509_OBJECT_free(b->objs);
+    OPENSSL_free(b);
+}
+
+static void bucket_free_doall(X509_OBJECT_BUCKET *b)
+{
+    bucket_free(b);
+}
+
+static IMPLEMENT_LHASH_DOALL_FN(bucket_free, X509_OBJECT_BUCKET)
+
+static void index_table_free(LHASH_OF(X509_OBJECT_BUCKET) *lh)
+{
+    if (lh == NULL)
+        return;
+    lh_X509_OBJECT_BUCKET_doall(lh, LHASH_DOALL_FN(bucket_free));
+    lh_X509_OBJECT_BUCKET_free(lh);
+}
+
+X509_STORE_INDEX *x509_store_index_new(void)
+{
+    X509_STORE_INDEX *idx = OPENSSL_zalloc(sizeof(*idx));
+
+    if (idx == NULL)
+        return NULL;
+    if ((idx->by_subject = lh_X509_OBJECT_BUCKET_new()) == NULL
+        || (idx->by_keyid = lh_X509_OBJECT_BUCKET_new()) == NULL
+        || (idx->by_issuer_serial = lh_X509_OBJECT_BUCKET_new()) == NULL) {
+        x509_store_index_free(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+void x509_store_index_free(X509_STORE_INDEX *idx)
+{
+    if (idx == NULL)
+        return;
+    index_table_free(idx->by_subject);
+    index_table_free(idx->by_keyid);
+    index_table_free(idx->by_issuer_serial);
+    OPENSSL_free(idx);
+}
+
+/* Fill in the subject index key for |obj|: 0 if it has none */
+static int subject_key(X509_OBJECT_BUCKET *key, X509_OBJECT *obj)
+{
+    memset(key, 0, sizeof(*key));
+    key->type = obj->type;
+    switch (obj->type) {
+    case X509_LU_X509:
+        key->name = X509_get_subject_name(obj->data.x509);
+        break;
+    case X509_LU_CRL:
+        key->name = X509_CRL_get_issuer(obj->data.crl);
+        break;
+    default:
+        return 0;
+    }
+    return key->name != NULL;
+}
+
+static STACK_OF(X509_OBJECT) *bucket_lookup(LHASH_OF(X509_OBJECT_BUCKET) *lh,
+                                            X509_OBJECT_BUCKET *key)
+{
+    X509_OBJECT_BUCKET *b = lh_X509_OBJECT_BUCKET_retrieve(lh, key);
+
+    return b == NULL ? NULL : b->objs;
+}
+
+/* Add |obj| to the bucket for |key|, creating it if necessary */
+static int bucket_add(LHASH_OF(X509_OBJECT_BUCKET) *lh,
+                      X509_OBJECT_BUCKET *key, X509_OBJECT *obj)
+{
+    X509_OBJECT_BUCKET *b = lh_X509_OBJECT_BUCKET_retrieve(lh, key);
+
+    if (b == NULL) {
+        if ((b = OPENSSL_malloc(sizeof(*b))) == NULL)
+            return 0;
+        *b = *key;
+        if ((b->objs = sk_X509_OBJECT_new_null()) == NULL) {
+            OPENSSL_free(b);
+            return 0;
+        }
+        (void)lh_X509_OBJECT_BUCKET_insert(lh, b);
+        if (lh_X509_OBJECT_BUCKET_error(lh)) {
+            bucket_free(b);
+            return 0;
+        }
+    }
+    return sk_X509_OBJECT_push(b->objs, obj) != 0;
+}
+
+/*
+ * Add |obj| to the indexes.  The caller must hold the store lock for
+ * writing.  On failure the indexes may reference |obj| only in some of the
+ * tables, so the caller should still add it to the store.
+ */
+int x509_store_index_add(X509_STORE_INDEX *idx, X509_OBJECT *obj)
+{
+    X509_OBJECT_BUCKET key;
+    X509 *x;
+
+    if (!subject_key(&key, obj))
+        return 1;
+    if (!bucket_add(idx->by_subject, &key, obj))
+        return 0;
+    if (obj->type != X509_LU_X509)
+        return 1;
+
+    x = obj->data.x509;
+    /* Make sure the subject key identifier has been decoded */
+    X509_check_purpose(x, -1, 0);
+    if (x->skid != NULL) {
+        memset(&key, 0, sizeof(key));
+        key.type = X509_LU_X509;
+        key.keyid = x->skid;
+        if (!bucket_add(idx->by_keyid, &key, obj))
+            return 0;
+    }
+
+    memset(&key, 0, sizeof(key));
+    key.type = X509_LU_X509;
+    key.name = X509_get_issuer_name(x);
+    key.serial = X509_get_serialNumber(x);
+    return bucket_add(idx->by_issuer_serial, &key, obj);
+}
+
+/*
+ * Return all certificates (type X509_LU_X509) with subject |name| or all
+ * CRLs (type X509_LU_CRL) with issuer |name|, or NULL if there are none.
+ * The stack is owned by the index and only valid while the store lock is
+ * held.
+ */
+STACK_OF(X509_OBJECT) *x509_store_index_by_subject(X509_STORE_INDEX *idx,
+                                                   int type, X509_NAME *name)
+{
+    X509_OBJECT_BUCKET key;
+
+    memset(&key, 0, sizeof(key));
+    key.type = type;
+    key.name = name;
+    return bucket_lookup(idx->by_subject, &key);
+}
+
+/* Return all certificates with subject key identifier |keyid| */
+STACK_OF(X509_OBJECT) *x509_store_index_by_keyid(X509_STORE_INDEX *idx,
+                                                 ASN1_OCTET_STRING *keyid)
+{
+    X509_OBJECT_BUCKET key;
+
+    memset(&key, 0, sizeof(key));
+    key.type = X509_LU_X509;
+    key.keyid = keyid;
+    return bucket_lookup(idx->by_keyid, &key);
+}
+
+/* Return the object in the store identical to |obj|, if any */
+X509_OBJECT *x509_store_index_match(X509_STORE_INDEX *idx, X509_OBJECT *obj)
+{
+    X509_OBJECT_BUCKET key;
+    STACK_OF(X509_OBJECT) *objs;
+    X509_OBJECT *tmp;
+    int i;
+
+    memset(&key, 0, sizeof(key));
+    key.type = obj->type;
+    switch (obj->type) {
+    case X509_LU_X509:
+        key.name = X509_get_issuer_name(obj->data.x509);
+        key.serial = X509_get_serialNumber(obj->data.x509);
+        objs = bucket_lookup(idx->by_issuer_serial, &key);
+        break;
+    case X509_LU_CRL:
+        key.name = X509_CRL_get_issuer(obj->data.crl);
+        objs = bucket_lookup(idx->by_subject, &key);
+        break;
+    default:
+        return NULL;
+    }
+
+    for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+        tmp = sk_X509_OBJECT_value(objs, i);
+        if (obj->type == X509_LU_X509) {
+            if (X509_cmp(tmp->data.x509, obj->data.x509) == 0)
+                return tmp;
+        } else if (X509_CRL_match(tmp->data.crl, obj->data.crl) == 0) {
+            return tmp;
+        }
+    }
+    return NULL;
+}
@@ -118,3 +118,34 @@ struct x509_crl_method_st {
                        ASN1_INTEGER *ser, X509_NAME *issuer);
     int (*crl_verify) (X509_CRL *crl, EVP_PKEY *pk);
 };
+
+/* Identifies a certificate signature checked with an issuer's key */
+typedef struct x509_sigcache_key_st {
+    unsigned char spki_md[SHA256_DIGEST_LENGTH];
+    unsigned char tbs_md[SHA256_DIGEST_LENGTH];
+    unsigned char sig_md[SHA256_DIGEST_LENGTH];
+} X509_SIGCACHE_KEY;
+
+X509_SIGCACHE *x509_sigcache_new(size_t size);
+void x509_sigcache_free(X509_SIGCACHE *sc);
+int x509_sigcache_key(X509_SIGCACHE_KEY *key, X509 *x, X509 *issuer);
+int x509_sigcache_check(X509_SIGCACHE *sc, const X509_SIGCACHE_KEY *key);
+void x509_sigcache_add(X509_SIGCACHE *sc, const X509_SIGCACHE_KEY *key);
+
+X509_STORE_INDEX *x509_store_index_new(void);
+void x509_store_index_free(X509_STORE_INDEX *idx);
+int x509_store_index_add(X509_STORE_INDEX *idx, X509_OBJECT *obj);
+STACK_OF(X509_OBJECT) *x509_store_index_by_subject(X509_STORE_INDEX *idx,
+                                                   int type, X509_NAME *name);
+STACK_OF(X509_OBJECT) *x509_store_index_by_keyid(X509_STORE_INDEX *idx,
+                                                 ASN1_OCTET_STRING *keyid);
+X509_OBJECT *x509_store_index_match(X509_STORE_INDEX *idx, X509_OBJECT *obj);
+
+typedef struct x509_crl_index_st X509_CRL_INDEX;
+
+uint32_t x509_crl_serial_hash(const unsigned char *data, int len, int neg);
+X509_CRL_INDEX *x509_crl_index_new(size_t num);
+void x509_crl_index_free(X509_CRL_INDEX *idx);
+void x509_crl_index_add(X509_CRL_INDEX *idx, uint32_t hash, const void *ref);
+const void *x509_crl_index_next(const X509_CRL_INDEX *idx, uint32_t hash,
+                                size_t *iter);
@@ -63,6 +63,7 @@
 #include "internal/x509_int.h"
 #include <openssl/x509v3.h>
 #include "x509_lcl.h"
+#include "internal/refcount.h"
 
 X509_LOOKUP *X509_LOOKUP_new(X509_LOOKUP_METHOD *method)
 {
@@ -184,6 +185,7 @@ X509_STORE *X509_STORE_new(void)
     if ((ret = OPENSSL_zalloc(sizeof(*ret))) == NULL)
         return NULL;
     ret->objs = sk_X509_OBJECT_new(x509_object_cmp);
+    ret->index = x509_store_index_new();
     ret->cache = 1;
     ret->get_cert_methods = sk_X509_LOOKUP_new_null();
 
@@ -191,11 +193,23 @@ X509_STORE *X509_STORE_new(void)
         return NULL;
 
     if (!CRYPTO_new_ex_data(CRYPTO_EX_INDEX_X509_STORE, ret, &ret->ex_data)) {
+        x509_store_index_free(ret->index);
         sk_X509_OBJECT_free(ret->objs);
         OPENSSL_free(ret);
         return NULL;
     }
 
+    ret->lock = CRYPTO_THREAD_lock_new();
+    if (ret->lock == NULL || ret->index == NULL) {
+        CRYPTO_THREAD_lock_free(ret->lock);
+        CRYPTO_free_ex_data(CRYPTO_EX_INDEX_X509_STORE, ret, &ret->ex_data);
+        X509_VERIFY_PARAM_free(ret->param);
+        sk_X509_LOOKUP_free(ret->get_cert_methods);
+        x509_store_index_free(ret->index);
+        sk_X509_OBJECT_free(ret->objs);
+        OPENSSL_free(ret);
+        return NULL;
+    }
     ret->references = 1;
     return ret;
 }
@@ -224,7 +238,7 @@ void X509_STORE_free(X509_STORE *vfy)
     if (vfy == NULL)
         return;
 
-    i = CRYPTO_add(&vfy->references, -1, CRYPTO_LOCK_X509_STORE);
+    i = CRYPTO_DOWN_REF(&vfy->references, CRYPTO_LOCK_X509_STORE);
 #ifdef REF_PRINT
     REF_PRINT("X509_STORE", vfy);
 #endif
@@ -244,10 +258,13 @@ void X509_STORE_free(X509_STORE *vfy)
         X509_LOOKUP_free(lu);
     }
     sk_X509_LOOKUP_free(sk);
+    x509_store_index_free(vfy->index);
     sk_X509_OBJECT_pop_free(vfy->objs, cleanup);
 
     CRYPTO_free_ex_data(CRYPTO_EX_INDEX_X509_STORE, vfy, &vfy->ex_data);
     X509_VERIFY_PARAM_free(vfy->param);
+    x509_sigcache_free(vfy->sigcache);
+    CRYPTO_THREAD_lock_free(vfy->lock);
     OPENSSL_free(vfy);
 }
 
@@ -287,9 +304,10 @@ int X509_STORE_get_by_subject(X509_STORE_CTX *vs, X509_LOOKUP_TYPE type,
     X509_OBJECT stmp, *tmp;
     int i, j;
 
-    CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-    tmp = X509_OBJECT_retrieve_by_subject(ctx->objs, type, name);
-    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_read_lock(ctx->lock);
+    tmp = sk_X509_OBJECT_value(x509_store_index_by_subject(ctx->index, type,
+                                                           name), 0);
+    CRYPTO_THREAD_unlock(ctx->lock);
 
     if (tmp == NULL || type == X509_LU_CRL) {
         for (i = vs->current_method;
@@ -335,20 +353,28 @@ int X509_STORE_add_cert(X509_STORE *ctx, X509 *x)
     obj->type = X509_LU_X509;
     obj->data.x509 = x;
 
-    CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_write_lock(ctx->lock);
 
     X509_OBJECT_up_ref_count(obj);
 
-    if (X509_OBJECT_retrieve_match(ctx->objs, obj)) {
+    if (x509_store_index_match(ctx->index, obj) != NULL) {
         X509_OBJECT_free_contents(obj);
         OPENSSL_free(obj);
         X509err(X509_F_X509_STORE_ADD_CERT,
                 X509_R_CERT_ALREADY_IN_HASH_TABLE);
         ret = 0;
-    } else
-        sk_X509_OBJECT_push(ctx->objs, obj);
+    } else if (!sk_X509_OBJECT_push(ctx->objs, obj)) {
+        X509_OBJECT_free_contents(obj);
+        OPENSSL_free(obj);
+        X509err(X509_F_X509_STORE_ADD_CERT, ERR_R_MALLOC_FAILURE);
+        ret = 0;
+    } else if (!x509_store_index_add(ctx->index, obj)) {
+        /* |obj| now belongs to the store, but may not be found by lookups */
+        X509err(X509_F_X509_STORE_ADD_CERT, ERR_R_MALLOC_FAILURE);
+        ret = 0;
+    }
 
-    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_unlock(ctx->lock);
 
     return ret;
 }
@@ -368,19 +394,27 @@ int X509_STORE_add_crl(X509_STORE *ctx, X509_CRL *x)
     obj->type = X509_LU_CRL;
     obj->data.crl = x;
 
-    CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_write_lock(ctx->lock);
 
     X509_OBJECT_up_ref_count(obj);
 
-    if (X509_OBJECT_retrieve_match(ctx->objs, obj)) {
+    if (x509_store_index_match(ctx->index, obj) != NULL) {
         X509_OBJECT_free_contents(obj);
         OPENSSL_free(obj);
         X509err(X509_F_X509_STORE_ADD_CRL, X509_R_CERT_ALREADY_IN_HASH_TABLE);
         ret = 0;
-    } else
-        sk_X509_OBJECT_push(ctx->objs, obj);
+    } else if (!sk_X509_OBJECT_push(ctx->objs, obj)) {
+        X509_OBJECT_free_contents(obj);
+        OPENSSL_free(obj);
+        X509err(X509_F_X509_STORE_ADD_CRL, ERR_R_MALLOC_FAILURE);
+        ret = 0;
+    } else if (!x509_store_index_add(ctx->index, obj)) {
+        /* |obj| now belongs to the store, but may not be found by lookups */
+        X509err(X509_F_X509_STORE_ADD_CRL, ERR_R_MALLOC_FAILURE);
+        ret = 0;
+    }
 
-    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_unlock(ctx->lock);
 
     return ret;
 }
@@ -472,87 +506,87 @@ X509_OBJECT *X509_OBJECT_retrieve_by_subject(STACK_OF(X509_OBJECT) *h,
 
 STACK_OF(X509) *X509_STORE_get1_certs(X509_STORE_CTX *ctx, X509_NAME *nm)
 {
-    int i, idx, cnt;
+    int i;
     STACK_OF(X509) *sk;
+    STACK_OF(X509_OBJECT) *objs;
     X509 *x;
     X509_OBJECT *obj;
     sk = sk_X509_new_null();
-    CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-    idx = x509_object_idx_cnt(ctx->ctx->objs, X509_LU_X509, nm, &cnt);
-    if (idx < 0) {
+    CRYPTO_THREAD_read_lock(ctx->ctx->lock);
+    objs = x509_store_index_by_subject(ctx->ctx->index, X509_LU_X509, nm);
+    if (objs == NULL) {
         /*
          * Nothing found in cache: do lookup to possibly add new objects to
          * cache
          */
         X509_OBJECT xobj;
-        CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+        CRYPTO_THREAD_unlock(ctx->ctx->lock);
         if (!X509_STORE_get_by_subject(ctx, X509_LU_X509, nm, &xobj)) {
             sk_X509_free(sk);
             return NULL;
         }
         X509_OBJECT_free_contents(&xobj);
-        CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-        idx = x509_object_idx_cnt(ctx->ctx->objs, X509_LU_X509, nm, &cnt);
-        if (idx < 0) {
-            CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+        CRYPTO_THREAD_read_lock(ctx->ctx->lock);
+        objs = x509_store_index_by_subject(ctx->ctx->index, X509_LU_X509, nm);
+        if (objs == NULL) {
+            CRYPTO_THREAD_unlock(ctx->ctx->lock);
             sk_X509_free(sk);
             return NULL;
         }
     }
-    for (i = 0; i < cnt; i++, idx++) {
-        obj = sk_X509_OBJECT_value(ctx->ctx->objs, idx);
+    for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+        obj = sk_X509_OBJECT_value(objs, i);
         x = obj->data.x509;
         X509_up_ref(x);
         if (!sk_X509_push(sk, x)) {
-            CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+            CRYPTO_THREAD_unlock(ctx->ctx->lock);
             X509_free(x);
             sk_X509_pop_free(sk, X509_free);
             return NULL;
         }
     }
-    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_unlock(ctx->ctx->lock);
     return sk;
 
 }
 
 STACK_OF(X509_CRL) *X509_STORE_get1_crls(X509_STORE_CTX *ctx, X509_NAME *nm)
 {
-    int i, idx, cnt;
+    int i;
     STACK_OF(X509_CRL) *sk;
+    STACK_OF(X509_OBJECT) *objs;
     X509_CRL *x;
     X509_OBJECT *obj, xobj;
     sk = sk_X509_CRL_new_null();
-    CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
 
     /*
      * Always do lookup to possibly add new CRLs to cache
      */
-    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
     if (!X509_STORE_get_by_subject(ctx, X509_LU_CRL, nm, &xobj)) {
         sk_X509_CRL_free(sk);
         return NULL;
     }
     X509_OBJECT_free_contents(&xobj);
-    CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-    idx = x509_object_idx_cnt(ctx->ctx->objs, X509_LU_CRL, nm, &cnt);
-    if (idx < 0) {
-        CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_read_lock(ctx->ctx->lock);
+    objs = x509_store_index_by_subject(ctx->ctx->index, X509_LU_CRL, nm);
+    if (objs == NULL) {
+        CRYPTO_THREAD_unlock(ctx->ctx->lock);
         sk_X509_CRL_free(sk);
         return NULL;
     }
 
-    for (i = 0; i < cnt; i++, idx++) {
-        obj = sk_X509_OBJECT_value(ctx->ctx->objs, idx);
+    for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+        obj = sk_X509_OBJECT_value(objs, i);
         x = obj->data.crl;
         X509_CRL_up_ref(x);
         if (!sk_X509_CRL_push(sk, x)) {
-            CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+            CRYPTO_THREAD_unlock(ctx->ctx->lock);
             X509_CRL_free(x);
             sk_X509_CRL_pop_free(sk, X509_CRL_free);
             return NULL;
         }
     }
-    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_unlock(ctx->ctx->lock);
     return sk;
 }
 
@@ -583,6 +617,30 @@ X509_OBJECT *X509_OBJECT_retrieve_match(STACK_OF(X509_OBJECT) *h,
     return NULL;
 }
 
+/*
+ * Look through |objs| for a certificate accepted by 'check_issued' as the
+ * issuer of |x|.  If one is found return 1, leaving it in |*issuer|.  If
+ * times check, stop there, otherwise keep looking. Leave last match in
+ * issuer so we return nearest match if no certificate time is OK.
+ */
+static int find_issuer(X509 **issuer, X509_STORE_CTX *ctx, X509 *x,
+                       STACK_OF(X509_OBJECT) *objs)
+{
+    X509_OBJECT *pobj;
+    int i, ret = 0;
+
+    for (i = 0; i < sk_X509_OBJECT_num(objs); i++) {
+        pobj = sk_X509_OBJECT_value(objs, i);
+        if (ctx->check_issued(ctx, x, pobj->data.x509)) {
+            *issuer = pobj->data.x509;
+            ret = 1;
+            if (x509_check_cert_time(ctx, *issuer, 1))
+                break;
+        }
+    }
+    return ret;
+}
+
 /*-
  * Try to get issuer certificate from store. Due to limitations
  * of the API this can only retrieve a single certificate matching
@@ -598,8 +656,9 @@ X509_OBJECT *X509_OBJECT_retrieve_match(STACK_OF(X509_OBJECT) *h,
 int X509_STORE_CTX_get1_issuer(X509 **issuer, X509_STORE_CTX *ctx, X509 *x)
 {
     X509_NAME *xn;
-    X509_OBJECT obj, *pobj;
-    int i, ok, idx, ret;
+    X509_OBJECT obj;
+    STACK_OF(X509_OBJECT) *objs;
+    int ok, ret;
     *issuer = NULL;
     xn = X509_get_issuer_name(x);
     ok = X509_STORE_get_by_subject(ctx, X509_LU_X509, xn, &obj);
@@ -624,36 +683,24 @@ int X509_STORE_CTX_get1_issuer(X509 **issuer, X509_STORE_CTX *ctx, X509 *x)
     }
     X509_OBJECT_free_contents(&obj);
 
-    /* Else find index of first cert accepted by 'check_issued' */
+    /*
+     * Else find the first cert accepted by 'check_issued'.  Candidates
+     * whose subject key identifier matches the authority key identifier of
+     * |x| are tried first, as they are the most likely to be accepted.
+     */
     ret = 0;
-    CRYPTO_w_lock(CRYPTO_LOCK_X509_STORE);
-    idx = X509_OBJECT_idx_by_subject(ctx->ctx->objs, X509_LU_X509, xn);
-    if (idx != -1) {            /* should be true as we've had at least one
-                                 * match */
-        /* Look through all matching certs for suitable issuer */
-        for (i = idx; i < sk_X509_OBJECT_num(ctx->ctx->objs); i++) {
-            pobj = sk_X509_OBJECT_value(ctx->ctx->objs, i);
-            /* See if we've run past the matches */
-            if (pobj->type != X509_LU_X509)
-                break;
-            if (X509_NAME_cmp(xn, X509_get_subject_name(pobj->data.x509)))
-                break;
-            if (ctx->check_issued(ctx, x, pobj->data.x509)) {
-                *issuer = pobj->data.x509;
-                ret = 1;
-                /*
-                 * If times check, exit with match,
-                 * otherwise keep looking. Leave last
-                 * match in issuer so we return nearest
-                 * match if no certificate time is OK.
-                 */
-
-                if (x509_check_cert_time(ctx, *issuer, 1))
-                    break;
-            }
-        }
+    X509_check_purpose(x, -1, 0);
+    CRYPTO_THREAD_read_lock(ctx->ctx->lock);
+    if (x->akid != NULL && x->akid->keyid != NULL) {
+        objs = x509_store_index_by_keyid(ctx->ctx->index, x->akid->keyid);
+        ret = find_issuer(issuer, ctx, x, objs);
+    }
+    if (*issuer == NULL || !x509_check_cert_time(ctx, *issuer, 1)) {
+        objs = x509_store_index_by_subject(ctx->ctx->index, X509_LU_X509, xn);
+        if (find_issuer(issuer, ctx, x, objs))
+            ret = 1;
     }
-    CRYPTO_w_unlock(CRYPTO_LOCK_X509_STORE);
+    CRYPTO_THREAD_unlock(ctx->ctx->lock);
     if (*issuer)
         X509_up_ref(*issuer);
     return ret;
@@ -0,0 +1,339 @@
+/* crypto/x509/x509_scache.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/*
+ * Cache of successful certificate signature checks, attached to an
+ * X509_STORE.  An entry records that a signature verified, identified by
+ * what it covers: the SHA-256 digests of the issuer's SubjectPublicKeyInfo,
+ * of the certificate's TBSCertificate and of the signature value.  A hit
+ * therefore replaces a public key operation with three digests and a hash
+ * table lookup, and holds whichever certificate objects carry the same key
+ * and contents.  Only successes are ever recorded and the cache is bounded.
+ *
+ * Lookups take the read lock where atomic operations are available: a hit
+ * just marks its entry as used.  When the cache is full, eviction gives
+ * used entries a second chance, which approximates least recently used.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "internal/cryptlib.h"
+#include "internal/refcount.h"
+#include <openssl/lhash.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include "internal/x509_int.h"
+#include "x509_lcl.h"
+
+typedef struct x509_sigcache_entry_st {
+    X509_SIGCACHE_KEY key;
+    /* set by hits, cleared as eviction passes over the entry */
+    int used;
+    /* insertion order, newest first */
+    struct x509_sigcache_entry_st *prev, *next;
+} X509_SIGCACHE_ENTRY;
+
+DECLARE_LHASH_OF(X509_SIGCACHE_ENTRY);
+
+struct x509_sigcache_st {
+    LHASH_OF(X509_SIGCACHE_ENTRY) *entries;
+    X509_SIGCACHE_ENTRY *head, *tail;
+    size_t num;
+    size_t max_size;
+    unsigned long hits;
+    unsigned long misses;
+    CRYPTO_RWLOCK *lock;
+};
+
+/*
+ * Without atomic operations, lookups update the counters and the used
+ * marks under the write lock instead.
+ */
+#ifdef CRYPTO_REF_ATOMIC
+# define SIGCACHE_LOOKUP_LOCK(sc)   CRYPTO_THREAD_read_lock((sc)->lock)
+# define SIGCACHE_INC(val)          CRYPTO_UP_REF((val), 0)
+#else
+# define SIGCACHE_LOOKUP_LOCK(sc)   CRYPTO_THREAD_write_lock((sc)->lock)
+# define SIGCACHE_INC(val)          (++*(val))
+#endif
+
+static unsigned long x509_sigcache_entry_hash(const X509_SIGCACHE_ENTRY *a)
+{
+    return (unsigned long)a->key.tbs_md[0]
+        | (unsigned long)a->key.tbs_md[1] << 8
+        | (unsigned long)a->key.tbs_md[2] << 16
+        | (unsigned long)a->key.tbs_md[3] << 24;
+}
+
+static int x509_sigcache_entry_cmp(const X509_SIGCACHE_ENTRY *a,
+                                   const X509_SIGCACHE_ENTRY *b)
+{
+    return memcmp(&a->key, &b->key, sizeof(a->key));
+}
+
+static IMPLEMENT_LHASH_HASH_FN(x509_sigcache_entry, X509_SIGCACHE_ENTRY)
+static IMPLEMENT_LHASH_COMP_FN(x509_sigcache_entry, X509_SIGCACHE_ENTRY)
+
+static void sigcache_list_remove(X509_SIGCACHE *sc, X509_SIGCACHE_ENTRY *e)
+{
+    if (e->prev != NULL)
+        e->prev->next = e->next;
+    else
+        sc->head = e->next;
+    if (e->next != NULL)
+        e->next->prev = e->prev;
+    else
+        sc->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void sigcache_list_add_head(X509_SIGCACHE *sc, X509_SIGCACHE_ENTRY *e)
+{
+    e->prev = NULL;
+    e->next = sc->head;
+    if (sc->head != NULL)
+        sc->head->prev = e;
+    else
+        sc->tail = e;
+    sc->head = e;
+}
+
+/*
+ * Drop entries until at most |max| remain, starting with the oldest.  An
+ * entry that has been used since eviction last passed it is moved to the
+ * front instead, once.  The write lock must be held.
+ */
+static void sigcache_trim(X509_SIGCACHE *sc, size_t max)
+{
+    X509_SIGCACHE_ENTRY *e;
+
+    while (sc->num > max && (e = sc->tail) != NULL) {
+        sigcache_list_remove(sc, e);
+        if (e->used && max > 0) {
+            e->used = 0;
+            sigcache_list_add_head(sc, e);
+            continue;
+        }
+        (void)lh_X509_SIGCACHE_ENTRY_delete(sc->entries, e);
+        OPENSSL_free(e);
+        sc->num--;
+    }
+}
+
+/*
+ * Fill in |key| for the signature on |x| checked with the key of |issuer|.
+ * Returns 0 if that can't be done, in which case the signature must be
+ * checked in full.
+ */
+int x509_sigcache_key(X509_SIGCACHE_KEY *key, X509 *x, X509 *issuer)
+{
+    unsigned int len;
+
+    /*
+     * X509_verify() fails if the outer signature algorithm differs from
+     * the one inside the TBSCertificate, which the key doesn't cover.
+     */
+    if (X509_ALGOR_cmp(&x->sig_alg, &x->cert_info.signature) != 0)
+        return 0;
+    return ASN1_item_digest(ASN1_ITEM_rptr(X509_PUBKEY), EVP_sha256(),
+                            issuer->cert_info.key, key->spki_md, &len)
+        && ASN1_item_digest(ASN1_ITEM_rptr(X509_CINF), EVP_sha256(),
+                            &x->cert_info, key->tbs_md, &len)
+        && EVP_Digest(x->signature.data, x->signature.length, key->sig_md,
+                      &len, EVP_sha256(), NULL);
+}
+
+X509_SIGCACHE *x509_sigcache_new(size_t size)
+{
+    X509_SIGCACHE *sc = OPENSSL_zalloc(sizeof(*sc));
+
+    if (sc == NULL)
+        return NULL;
+    if ((sc->entries = lh_X509_SIGCACHE_ENTRY_new()) == NULL
+        || (sc->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        lh_X509_SIGCACHE_ENTRY_free(sc->entries);
+        OPENSSL_free(sc);
+        return NULL;
+    }
+    sc->max_size = size;
+    return sc;
+}
+
+void x509_sigcache_free(X509_SIGCACHE *sc)
+{
+    if (sc == NULL)
+        return;
+    sigcache_trim(sc, 0);
+    lh_X509_SIGCACHE_ENTRY_free(sc->entries);
+    CRYPTO_THREAD_lock_free(sc->lock);
+    OPENSSL_free(sc);
+}
+
+/* Return 1 if the signature identified by |key| is known to verify */
+int x509_sigcache_check(X509_SIGCACHE *sc, const X509_SIGCACHE_KEY *key)
+{
+    X509_SIGCACHE_ENTRY tmp, *e;
+
+    memcpy(&tmp.key, key, sizeof(tmp.key));
+
+    SIGCACHE_LOOKUP_LOCK(sc);
+    if (sc->max_size == 0) {
+        /* Disabled: don't count this as a miss */
+        CRYPTO_THREAD_unlock(sc->lock);
+        return 0;
+    }
+    e = lh_X509_SIGCACHE_ENTRY_retrieve(sc->entries, &tmp);
+    if (e != NULL) {
+        SIGCACHE_INC(&sc->hits);
+        /* Only the first hit since eviction last looked needs to write */
+        if (!e->used)
+            SIGCACHE_INC(&e->used);
+    } else {
+        SIGCACHE_INC(&sc->misses);
+    }
+    CRYPTO_THREAD_unlock(sc->lock);
+
+    return e != NULL;
+}
+
+/* Record that the signature identified by |key| verified */
+void x509_sigcache_add(X509_SIGCACHE *sc, const X509_SIGCACHE_KEY *key)
+{
+    X509_SIGCACHE_ENTRY *e;
+
+    if ((e = OPENSSL_zalloc(sizeof(*e))) == NULL)
+        return;
+    memcpy(&e->key, key, sizeof(e->key));
+
+    CRYPTO_THREAD_write_lock(sc->lock);
+    if (sc->max_size == 0
+        || lh_X509_SIGCACHE_ENTRY_retrieve(sc->entries, e) != NULL) {
+        /* Disabled, or another thread got there first */
+        CRYPTO_THREAD_unlock(sc->lock);
+        OPENSSL_free(e);
+        return;
+    }
+    sigcache_trim(sc, sc->max_size - 1);
+    (void)lh_X509_SIGCACHE_ENTRY_insert(sc->entries, e);
+    if (lh_X509_SIGCACHE_ENTRY_error(sc->entries)) {
+        CRYPTO_THREAD_unlock(sc->lock);
+        OPENSSL_free(e);
+        return;
+    }
+    sigcache_list_add_head(sc, e);
+    sc->num++;
+    CRYPTO_THREAD_unlock(sc->lock);
+}
+
+int X509_STORE_set_sigcache_size(X509_STORE *store, size_t size)
+{
+    X509_SIGCACHE *sc;
+
+    CRYPTO_THREAD_write_lock(store->lock);
+    if ((sc = store->sigcache) == NULL && size > 0) {
+        if ((sc = x509_sigcache_new(size)) == NULL) {
+            CRYPTO_THREAD_unlock(store->lock);
+            X509err(X509_F_X509_STORE_SET_SIGCACHE_SIZE,
+                    ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        store->sigcache = sc;
+    }
+    CRYPTO_THREAD_unlock(store->lock);
+
+    /*
+     * The cache itself is only freed with the store, so that verifications
+     * running in other threads never see it disappear.
+     */
+    if (sc != NULL) {
+        CRYPTO_THREAD_write_lock(sc->lock);
+        sc->max_size = size;
+        sigcache_trim(sc, size);
+        CRYPTO_THREAD_unlock(sc->lock);
+    }
+    return 1;
+}
+
+size_t X509_STORE_get_sigcache_size(X509_STORE *store)
+{
+    size_t ret = 0;
+
+    if (store->sigcache != NULL) {
+        CRYPTO_THREAD_read_lock(store->sigcache->lock);
+        ret = store->sigcache->max_size;
+        CRYPTO_THREAD_unlock(store->sigcache->lock);
+    }
+    return ret;
+}
+
+void X509_STORE_get_sigcache_stats(X509_STORE *store, unsigned long *hits,
+                                   unsigned long *misses)
+{
+    X509_SIGCACHE *sc = store->sigcache;
+
+    if (hits != NULL)
+        *hits = 0;
+    if (misses != NULL)
+        *misses = 0;
+    if (sc == NULL)
+        return;
+    /* Hits and misses are counted under the read lock */
+    CRYPTO_THREAD_write_lock(sc->lock);
+    if (hits != NULL)
+        *hits = sc->hits;
+    if (misses != NULL)
+        *misses = sc->misses;
+    CRYPTO_THREAD_unlock(sc->lock);
+}
@@ -63,6 +63,7 @@
 #include <openssl/evp.h>
 #include <openssl/x509.h>
 #include "internal/x509_int.h"
+#include "internal/refcount.h"
 
 int X509_set_version(X509 *x, long version)
 {
@@ -149,7 +150,7 @@ int X509_set_pubkey(X509 *x, EVP_PKEY *pkey)
 
 void X509_up_ref(X509 *x)
 {
-    CRYPTO_add(&x->references, 1, CRYPTO_LOCK_X509);
+    CRYPTO_UP_REF(&x->references, CRYPTO_LOCK_X509);
 }
 
 long X509_get_version(X509 *x)
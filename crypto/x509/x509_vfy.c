@@ -1730,10 +1730,20 @@ static int internal_verify(X509_STORE_CTX *ctx)
     int ok = 0, n;
     X509 *xs, *xi;
     EVP_PKEY *pkey = NULL;
+    X509_SIGCACHE *sigcache = NULL;
+    X509_SIGCACHE_KEY sigkey;
+    int cacheable;
     int (*cb) (int xok, X509_STORE_CTX *xctx);
 
     cb = ctx->verify_cb;
 
+    if (!(ctx->param->flags & X509_V_FLAG_NO_SIG_CACHE)) {
+        if (ctx->sigcache != NULL)
+            sigcache = ctx->sigcache;
+        else if (ctx->ctx != NULL)
+            sigcache = ctx->ctx->sigcache;
+    }
+
     n = sk_X509_num(ctx->chain);
     ctx->error_depth = n - 1;
     n--;
@@ -1770,7 +1780,11 @@ static int internal_verify(X509_STORE_CTX *ctx)
         if (!xs->valid
             && (xs != xi
                 || (ctx->param->flags & X509_V_FLAG_CHECK_SS_SIGNATURE))) {
-            if ((pkey = X509_get_pubkey(xi)) == NULL) {
+            cacheable = sigcache != NULL
+                        && x509_sigcache_key(&sigkey, xs, xi);
+            if (cacheable && x509_sigcache_check(sigcache, &sigkey)) {
+                /* Already verified with this issuer's key */
+            } else if ((pkey = X509_get_pubkey(xi)) == NULL) {
                 ctx->error = X509_V_ERR_UNABLE_TO_DECODE_ISSUER_PUBLIC_KEY;
                 ctx->current_cert = xi;
                 ok = (*cb) (0, ctx);
@@ -1784,6 +1798,8 @@ static int internal_verify(X509_STORE_CTX *ctx)
                     EVP_PKEY_free(pkey);
                     goto end;
                 }
+            } else if (cacheable) {
+                x509_sigcache_add(sigcache, &sigkey);
             }
             EVP_PKEY_free(pkey);
             pkey = NULL;
@@ -2306,6 +2322,7 @@ int X509_STORE_CTX_init(X509_STORE_CTX *ctx, X509_STORE *store, X509 *x509,
     ctx->current_reasons = 0;
     ctx->tree = NULL;
     ctx->parent = NULL;
+    ctx->sigcache = NULL;
 
     if (store) {
         ctx->verify_cb = store->verify_cb;
@@ -64,6 +64,7 @@
 #include <openssl/evp.h>
 #include <openssl/x509.h>
 #include "internal/x509_int.h"
+#include "internal/refcount.h"
 
 int X509_CRL_set_version(X509_CRL *x, long version)
 {
@@ -135,7 +136,7 @@ int X509_CRL_sort(X509_CRL *c)
 
 void X509_CRL_up_ref(X509_CRL *crl)
 {
-    CRYPTO_add(&crl->references, 1, CRYPTO_LOCK_X509_CRL);
+    CRYPTO_UP_REF(&crl->references, CRYPTO_LOCK_X509_CRL);
 }
 
 long X509_CRL_get_version(X509_CRL *crl)
@@ -194,6 +194,32 @@ static int crl_set_issuers(X509_CRL *crl)
 
 }
 
+/* Index the serial numbers of the revoked entries */
+static int crl_set_serial_index(X509_CRL *crl)
+{
+    int i, num;
+    STACK_OF(X509_REVOKED) *revoked;
+    X509_REVOKED *rev;
+
+    revoked = X509_CRL_get_REVOKED(crl);
+    /* The stack is NULL if the CRL has no revokedCertificates */
+    num = revoked != NULL ? sk_X509_REVOKED_num(revoked) : 0;
+    x509_crl_index_free(crl->serial_index);
+    crl->serial_index = x509_crl_index_new(num);
+    if (crl->serial_index == NULL)
+        return 0;
+    for (i = 0; i < num; i++) {
+        rev = sk_X509_REVOKED_value(revoked, i);
+        x509_crl_index_add(crl->serial_index,
+                           x509_crl_serial_hash(rev->serialNumber.data,
+                                                rev->serialNumber.length,
+                                                rev->serialNumber.type
+                                                & V_ASN1_NEG),
+                           rev);
+    }
+    return 1;
+}
+
 /*
  * The X509_CRL structure needs a bit of customisation. Cache some extensions
  * and hash of the whole CRL.
@@ -218,6 +244,7 @@ static int crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         crl->issuers = NULL;
         crl->crl_number = NULL;
         crl->base_crl_number = NULL;
+        crl->serial_index = NULL;
         break;
 
     case ASN1_OP_D2I_POST:
@@ -271,6 +298,14 @@ static int crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         if (!crl_set_issuers(crl))
             return 0;
 
+        /*
+         * Index the serial numbers up front for the default lookup, so it
+         * needn't sort the entries under a lock later.
+         */
+        if (crl->meth->crl_lookup == def_crl_lookup
+            && !crl_set_serial_index(crl))
+            return 0;
+
         if (crl->meth->crl_init) {
             if (crl->meth->crl_init(crl) == 0)
                 return 0;
@@ -287,6 +322,7 @@ static int crl_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         ASN1_INTEGER_free(crl->crl_number);
         ASN1_INTEGER_free(crl->base_crl_number);
         sk_GENERAL_NAMES_pop_free(crl->issuers, GENERAL_NAMES_free);
+        x509_crl_index_free(crl->serial_index);
         break;
     }
     return 1;
@@ -364,6 +400,9 @@ int X509_CRL_add0_revoked(X509_CRL *crl, X509_REVOKED *rev)
         return 0;
     }
     inf->enc.modified = 1;
+    /* The index no longer covers all the entries */
+    x509_crl_index_free(crl->serial_index);
+    crl->serial_index = NULL;
     return 1;
 }
 
@@ -430,6 +469,27 @@ static int def_crl_lookup(X509_CRL *crl,
 {
     X509_REVOKED rtmp, *rev;
     int idx;
+    size_t iter = 0;
+    uint32_t hash;
+
+    if (crl->serial_index != NULL) {
+        hash = x509_crl_serial_hash(serial->data, serial->length,
+                                    serial->type & V_ASN1_NEG);
+        while ((rev = (X509_REVOKED *)x509_crl_index_next(crl->serial_index,
+                                                          hash,
+                                                          &iter)) != NULL) {
+            if (ASN1_INTEGER_cmp(&rev->serialNumber, serial) != 0
+                || !crl_revoked_issuer_match(crl, issuer, rev))
+                continue;
+            if (ret)
+                *ret = rev;
+            if (rev->reason == CRL_REASON_REMOVE_FROM_CRL)
+                return 2;
+            return 1;
+        }
+        return 0;
+    }
+
     rtmp.serialNumber = *serial;
     /*
      * Sort revoked into serial number order if not already sorted. Do this
@@ -504,3 +564,468 @@ void *X509_CRL_get_meth_data(X509_CRL *crl)
 {
     return crl->meth_data;
 }
+
+/*
+ * Lazily decoded CRLs. d2i_X509_CRL_lazy() decodes everything except the
+ * revokedCertificates field, which is only checked for well-formedness and
+ * indexed by serial number. The entries stay in the cached encoding of the
+ * CRL and are decoded one at a time when a lookup finds them.
+ */
+
+DECLARE_LHASH_OF(X509_REVOKED);
+
+typedef struct x509_crl_lazy_st {
+    CRYPTO_RWLOCK *lock;
+    /* Entries decoded by lookups, by serial number */
+    LHASH_OF(X509_REVOKED) *decoded;
+    /* Returned for an entry that can't be decoded, so it still counts */
+    X509_REVOKED *undecodable;
+} X509_CRL_LAZY;
+
+static int lazy_crl_free(X509_CRL *crl);
+static int lazy_crl_lookup(X509_CRL *crl,
+                           X509_REVOKED **ret, ASN1_INTEGER *serial,
+                           X509_NAME *issuer);
+
+static X509_CRL_METHOD lazy_crl_meth = {
+    0,
+    0, lazy_crl_free,
+    lazy_crl_lookup,
+    def_crl_verify
+};
+
+static unsigned long x509_revoked_hash(const X509_REVOKED *a)
+{
+    return x509_crl_serial_hash(a->serialNumber.data, a->serialNumber.length,
+                                a->serialNumber.type & V_ASN1_NEG);
+}
+
+static int x509_revoked_cmp(const X509_REVOKED *a, const X509_REVOKED *b)
+{
+    return ASN1_INTEGER_cmp(&a->serialNumber, &b->serialNumber);
+}
+
+static IMPLEMENT_LHASH_HASH_FN(x509_revoked, X509_REVOKED)
+static IMPLEMENT_LHASH_COMP_FN(x509_revoked, X509_REVOKED)
+
+static void revoked_free_doall(X509_REVOKED *rev)
+{
+    X509_REVOKED_free(rev);
+}
+
+static IMPLEMENT_LHASH_DOALL_FN(revoked_free, X509_REVOKED)
+
+#define DER_SEQUENCE    (V_ASN1_SEQUENCE | V_ASN1_CONSTRUCTED)
+
+/* Contents of the certificateIssuer and reasonCode OIDs */
+static const unsigned char oid_certificate_issuer[] = { 0x55, 0x1d, 0x1d };
+static const unsigned char oid_crl_reason[] = { 0x55, 0x1d, 0x15 };
+
+/*
+ * Parse the header of the DER element at |in|, of which |len| bytes are
+ * available. Set |*tag| to its universal tag ORed with V_ASN1_CONSTRUCTED
+ * for constructed elements, or -1 for other classes, and |*content| and
+ * |*clen| to its contents. Return the total length of the element, or -1
+ * if it is invalid or truncated.
+ */
+static long der_element(const unsigned char *in, long len, int *tag,
+                        const unsigned char **content, long *clen)
+{
+    const unsigned char *p = in;
+    int ret, xclass;
+
+    *content = NULL;
+    *clen = 0;
+    if (len <= 0)
+        return -1;
+    ret = ASN1_get_object(&p, clen, tag, &xclass, len);
+    /* Indefinite lengths aren't DER */
+    if ((ret & 0x80) != 0 || (ret & 1) != 0)
+        return -1;
+    if (xclass != V_ASN1_UNIVERSAL || *tag >= V_ASN1_PRIMITIVE_TAG)
+        *tag = -1;
+    else
+        *tag |= ret & V_ASN1_CONSTRUCTED;
+    *content = p;
+    return (long)(p - in) + *clen;
+}
+
+/*
+ * Negative serial numbers aren't allowed, so rather than working out their
+ * magnitude they all get the same hash.
+ */
+static uint32_t lazy_serial_hash(const unsigned char *data, long len,
+                                 int neg)
+{
+    if (neg)
+        return x509_crl_serial_hash(NULL, 0, 1);
+    return x509_crl_serial_hash(data, (int)len, 0);
+}
+
+/*
+ * Check whether the serial number of the entry, whose contents start at
+ * |in| with |len| bytes, is |serial|.
+ */
+static int lazy_serial_match(const unsigned char *in, long len,
+                             const ASN1_INTEGER *serial)
+{
+    const unsigned char *d = serial->data, *s;
+    long dlen = serial->length, slen;
+    ASN1_INTEGER *tmp;
+    int tag, ret;
+
+    der_element(in, len, &tag, &s, &slen);
+    if (s[0] & 0x80) {
+        /* If it can't be decoded, err on the side of a match */
+        if ((tmp = d2i_ASN1_INTEGER(NULL, &in, len)) == NULL)
+            return 1;
+        ret = ASN1_INTEGER_cmp(tmp, serial) == 0;
+        ASN1_INTEGER_free(tmp);
+        return ret;
+    }
+    if (serial->type & V_ASN1_NEG)
+        return 0;
+    while (slen > 0 && *s == 0) {
+        s++;
+        slen--;
+    }
+    while (dlen > 0 && *d == 0) {
+        d++;
+        dlen--;
+    }
+    return slen == dlen && memcmp(s, d, slen) == 0;
+}
+
+/*
+ * Check the revoked entry at |in|, of which |len| bytes are available, and
+ * set |*serial| and |*slen| to the contents of its serial number. Flag
+ * unhandled critical and invalid reason code extensions in |crl| like
+ * crl_set_issuers(). Return the length of the entry, 0 if it has a
+ * certificateIssuer extension or -1 if it is invalid.
+ */
+static long lazy_check_entry(X509_CRL *crl, const unsigned char *in,
+                             long len, const unsigned char **serial,
+                             long *slen)
+{
+    const unsigned char *p, *ext, *q, *oid, *val, *r;
+    long elen, l, n, xlen, m, oidlen, vlen, rlen;
+    int tag, critical;
+
+    if ((elen = der_element(in, len, &tag, &p, &l)) < 0
+        || tag != DER_SEQUENCE)
+        return -1;
+    if ((n = der_element(p, l, &tag, serial, slen)) < 0
+        || tag != V_ASN1_INTEGER || *slen == 0)
+        return -1;
+    p += n;
+    l -= n;
+    if ((n = der_element(p, l, &tag, &q, &m)) < 0
+        || (tag != V_ASN1_UTCTIME && tag != V_ASN1_GENERALIZEDTIME))
+        return -1;
+    p += n;
+    l -= n;
+    if (l == 0)
+        return elen;
+
+    /* The extensions must take up the rest of the entry */
+    if (der_element(p, l, &tag, &ext, &xlen) != l || tag != DER_SEQUENCE)
+        return -1;
+    while (xlen > 0) {
+        if ((n = der_element(ext, xlen, &tag, &q, &m)) < 0
+            || tag != DER_SEQUENCE)
+            return -1;
+        ext += n;
+        xlen -= n;
+        if ((n = der_element(q, m, &tag, &oid, &oidlen)) < 0
+            || tag != V_ASN1_OBJECT)
+            return -1;
+        q += n;
+        m -= n;
+        critical = 0;
+        if ((n = der_element(q, m, &tag, &val, &vlen)) < 0)
+            return -1;
+        if (tag == V_ASN1_BOOLEAN) {
+            if (vlen != 1)
+                return -1;
+            critical = val[0] != 0;
+            q += n;
+            m -= n;
+            if ((n = der_element(q, m, &tag, &val, &vlen)) < 0)
+                return -1;
+        }
+        if (tag != V_ASN1_OCTET_STRING || n != m)
+            return -1;
+
+        if (oidlen == sizeof(oid_certificate_issuer)
+            && memcmp(oid, oid_certificate_issuer, oidlen) == 0)
+            return 0;
+        if (oidlen == sizeof(oid_crl_reason)
+            && memcmp(oid, oid_crl_reason, oidlen) == 0) {
+            if (der_element(val, vlen, &tag, &r, &rlen) != vlen
+                || tag != V_ASN1_ENUMERATED || rlen == 0)
+                crl->flags |= EXFLAG_INVALID;
+        } else if (critical) {
+            crl->flags |= EXFLAG_CRITICAL;
+        }
+    }
+    return elen;
+}
+
+/*
+ * Return the entry at |der| of length |len| whose serial number is
+ * |serial|, decoding it if this is the first lookup that found it.
+ */
+static X509_REVOKED *lazy_decode_entry(X509_CRL_LAZY *lazy,
+                                       const unsigned char *der, long len,
+                                       ASN1_INTEGER *serial)
+{
+    X509_REVOKED rtmp, *rev, *found;
+    ASN1_ENUMERATED *reason;
+
+    rtmp.serialNumber = *serial;
+    CRYPTO_THREAD_read_lock(lazy->lock);
+    rev = lh_X509_REVOKED_retrieve(lazy->decoded, &rtmp);
+    CRYPTO_THREAD_unlock(lazy->lock);
+    if (rev != NULL)
+        return rev;
+
+    if ((rev = d2i_X509_REVOKED(NULL, &der, len)) == NULL)
+        return lazy->undecodable;
+    reason = X509_REVOKED_get_ext_d2i(rev, NID_crl_reason, NULL, NULL);
+    if (reason != NULL) {
+        rev->reason = ASN1_ENUMERATED_get(reason);
+        ASN1_ENUMERATED_free(reason);
+    } else
+        rev->reason = CRL_REASON_NONE;
+
+    /*
+     * Another thread may have decoded it in the meantime. Search with the
+     * decoded serial number in case |serial| isn't minimally encoded.
+     */
+    rtmp.serialNumber = rev->serialNumber;
+    CRYPTO_THREAD_write_lock(lazy->lock);
+    found = lh_X509_REVOKED_retrieve(lazy->decoded, &rtmp);
+    if (found == NULL) {
+        (void)lh_X509_REVOKED_insert(lazy->decoded, rev);
+        if (lh_X509_REVOKED_error(lazy->decoded)) {
+            found = lazy->undecodable;
+        } else {
+            found = rev;
+            rev = NULL;
+        }
+    }
+    CRYPTO_THREAD_unlock(lazy->lock);
+    X509_REVOKED_free(rev);
+    return found;
+}
+
+static int lazy_crl_lookup(X509_CRL *crl,
+                           X509_REVOKED **ret, ASN1_INTEGER *serial,
+                           X509_NAME *issuer)
+{
+    X509_CRL_LAZY *lazy = crl->meth_data;
+    const unsigned char *end = crl->crl.enc.enc + crl->crl.enc.len;
+    const unsigned char *entry, *p;
+    long len, l;
+    size_t iter = 0;
+    uint32_t hash;
+    int tag;
+    X509_REVOKED *rev;
+
+    /* Indirect CRLs are never loaded lazily */
+    if (issuer != NULL && X509_NAME_cmp(issuer, X509_CRL_get_issuer(crl)))
+        return 0;
+
+    hash = lazy_serial_hash(serial->data, serial->length,
+                            serial->type & V_ASN1_NEG);
+    while ((entry = x509_crl_index_next(crl->serial_index, hash,
+                                        &iter)) != NULL) {
+        /* Entries were checked when the CRL was loaded */
+        len = der_element(entry, (long)(end - entry), &tag, &p, &l);
+        if (!lazy_serial_match(p, l, serial))
+            continue;
+        rev = lazy_decode_entry(lazy, entry, len, serial);
+        if (ret)
+            *ret = rev;
+        if (rev->reason == CRL_REASON_REMOVE_FROM_CRL)
+            return 2;
+        return 1;
+    }
+    return 0;
+}
+
+static int lazy_crl_free(X509_CRL *crl)
+{
+    X509_CRL_LAZY *lazy = crl->meth_data;
+
+    if (lazy == NULL)
+        return 1;
+    CRYPTO_THREAD_lock_free(lazy->lock);
+    if (lazy->decoded != NULL) {
+        lh_X509_REVOKED_doall(lazy->decoded, LHASH_DOALL_FN(revoked_free));
+        lh_X509_REVOKED_free(lazy->decoded);
+    }
+    X509_REVOKED_free(lazy->undecodable);
+    OPENSSL_free(lazy);
+    crl->meth_data = NULL;
+    return 1;
+}
+
+/*
+ * Decode the CRL without its revokedCertificates, from a copy of the DER
+ * |der| of length |len| with the |revlen| bytes at |rev| left out.
+ */
+static X509_CRL *lazy_decode_rest(const unsigned char *der, long len,
+                                  const unsigned char *tbs, long tbslen,
+                                  long tbsclen, const unsigned char *rev,
+                                  long revlen)
+{
+    const unsigned char *tbsc = tbs + tbslen - tbsclen;
+    const unsigned char *tbsend = tbs + tbslen;
+    long sig = (long)(der + len - tbsend);
+    int tbsc2 = (int)(tbsclen - revlen);
+    int outerc = ASN1_object_size(1, tbsc2, V_ASN1_SEQUENCE) + (int)sig;
+    int size = ASN1_object_size(1, outerc, V_ASN1_SEQUENCE);
+    unsigned char *buf, *q;
+    const unsigned char *p;
+    X509_CRL *crl;
+
+    if ((buf = OPENSSL_malloc(size)) == NULL) {
+        X509err(X509_F_D2I_X509_CRL_LAZY, ERR_R_MALLOC_FAILURE);
+        return NULL;
+    }
+    q = buf;
+    ASN1_put_object(&q, 1, outerc, V_ASN1_SEQUENCE, V_ASN1_UNIVERSAL);
+    ASN1_put_object(&q, 1, tbsc2, V_ASN1_SEQUENCE, V_ASN1_UNIVERSAL);
+    memcpy(q, tbsc, rev - tbsc);
+    q += rev - tbsc;
+    memcpy(q, rev + revlen, tbsend - (rev + revlen));
+    q += tbsend - (rev + revlen);
+    memcpy(q, tbsend, sig);
+
+    p = buf;
+    crl = d2i_X509_CRL(NULL, &p, size);
+    OPENSSL_free(buf);
+    return crl;
+}
+
+X509_CRL *d2i_X509_CRL_lazy(X509_CRL **a, const unsigned char **in, long len)
+{
+    const unsigned char *der = *in, *tbs, *p, *c, *rev = NULL, *e, *s;
+    long total, tbslen, tbsclen, l, n, cl, revlen = 0, slen, off;
+    size_t num = 0;
+    unsigned char *enc;
+    X509_CRL *crl = NULL;
+    X509_CRL_LAZY *lazy = NULL;
+    int tag, i;
+
+    /* Find the revokedCertificates in the tbsCertList */
+    ERR_set_mark();
+    if ((total = der_element(der, len, &tag, &tbs, &l)) > 0
+        && tag == DER_SEQUENCE
+        && (tbslen = der_element(tbs, l, &tag, &p, &tbsclen)) > 0
+        && tag == DER_SEQUENCE) {
+        l = tbsclen;
+        /* Skip the version, signature, issuer and thisUpdate */
+        if ((n = der_element(p, l, &tag, &c, &cl)) > 0
+            && tag == V_ASN1_INTEGER) {
+            p += n;
+            l -= n;
+        }
+        for (i = 0; i < 3 && (n = der_element(p, l, &tag, &c, &cl)) > 0;
+             i++) {
+            p += n;
+            l -= n;
+        }
+        n = der_element(p, l, &tag, &c, &cl);
+        if (i == 3 && n > 0
+            && (tag == V_ASN1_UTCTIME || tag == V_ASN1_GENERALIZEDTIME)) {
+            p += n;
+            l -= n;
+            n = der_element(p, l, &tag, &c, &cl);
+        }
+        if (i == 3 && n > 0 && tag == DER_SEQUENCE) {
+            rev = p;
+            revlen = n;
+        }
+    }
+    ERR_pop_to_mark();
+
+    /*
+     * Without entries there is nothing to gain, and another default method
+     * has its own lookup: decode normally. Malformed input also ends up
+     * here so that it gets the usual errors.
+     */
+    if (rev == NULL || default_crl_method != &int_crl_meth)
+        return d2i_X509_CRL(a, in, len);
+
+    if ((crl = lazy_decode_rest(der, total, tbs, tbslen, tbsclen, rev,
+                                revlen)) == NULL)
+        return NULL;
+
+    /* Cache the original tbsCertList: it is what the signature covers */
+    if ((enc = OPENSSL_malloc(tbslen)) == NULL)
+        goto merr;
+    memcpy(enc, tbs, tbslen);
+    OPENSSL_free(crl->crl.enc.enc);
+    crl->crl.enc.enc = enc;
+    crl->crl.enc.len = tbslen;
+    crl->crl.enc.modified = 0;
+    off = (long)(rev - tbs);
+    der_element(enc + off, revlen, &tag, &c, &cl);
+
+    for (e = c; e < c + cl; e += n) {
+        if ((n = lazy_check_entry(crl, e, (long)(c + cl - e), &s,
+                                  &slen)) < 0)
+            goto err;
+        /* Indirect CRLs need the full decoding for the entry issuers */
+        if (n == 0) {
+            X509_CRL_free(crl);
+            return d2i_X509_CRL(a, in, len);
+        }
+        num++;
+    }
+
+    x509_crl_index_free(crl->serial_index);
+    if ((crl->serial_index = x509_crl_index_new(num)) == NULL)
+        goto merr;
+    for (e = c; e < c + cl; e += n) {
+        n = lazy_check_entry(crl, e, (long)(c + cl - e), &s, &slen);
+        x509_crl_index_add(crl->serial_index,
+                           lazy_serial_hash(s, slen, s[0] & 0x80), e);
+    }
+
+    if ((lazy = OPENSSL_zalloc(sizeof(*lazy))) == NULL
+        || (lazy->lock = CRYPTO_THREAD_lock_new()) == NULL
+        || (lazy->decoded = lh_X509_REVOKED_new()) == NULL
+        || (lazy->undecodable = X509_REVOKED_new()) == NULL)
+        goto merr;
+    lazy->undecodable->reason = CRL_REASON_NONE;
+    crl->meth = &lazy_crl_meth;
+    crl->meth_data = lazy;
+    lazy = NULL;
+
+    /* The hash was taken over the encoding without the entries */
+    X509_CRL_digest(crl, EVP_sha1(), crl->sha1_hash, NULL);
+
+    *in = der + total;
+    if (a != NULL) {
+        X509_CRL_free(*a);
+        *a = crl;
+    }
+    return crl;
+
+ merr:
+    X509err(X509_F_D2I_X509_CRL_LAZY, ERR_R_MALLOC_FAILURE);
+    goto end;
+ err:
+    X509err(X509_F_D2I_X509_CRL_LAZY, X509_R_ERR_ASN1_LIB);
+ end:
+    if (lazy != NULL) {
+        CRYPTO_THREAD_lock_free(lazy->lock);
+        lh_X509_REVOKED_free(lazy->decoded);
+        OPENSSL_free(lazy);
+    }
+    X509_CRL_free(crl);
+    return NULL;
+}
@@ -60,6 +60,7 @@
 #include <ctype.h>
 #include "internal/cryptlib.h"
 #include <openssl/asn1t.h>
+#include <openssl/evp.h>
 #include <openssl/x509.h>
 #include "internal/x509_int.h"
 #include "internal/asn1_int.h"
@@ -79,6 +80,7 @@ static void x509_name_ex_free(ASN1_VALUE **val, const ASN1_ITEM *it);
 
 static int x509_name_encode(X509_NAME *a);
 static int x509_name_canon(X509_NAME *a);
+static int x509_name_canon_hash(X509_NAME *a);
 static int asn1_string_canon(ASN1_STRING *out, ASN1_STRING *in);
 static int i2d_name_canon(STACK_OF(STACK_OF_X509_NAME_ENTRY) * intname,
                           unsigned char **in);
@@ -330,6 +332,8 @@ static int x509_name_ex_print(BIO *out, ASN1_VALUE **pval,
  * comparison of Name structures can be rapidly perfomed by just using
  * memcmp() of the canonical encoding. By omitting the leading SEQUENCE name
  * constraints of type dirName can also be checked with a simple memcmp().
+ * The encoding is hashed as well, so that most comparisons of different
+ * names and X509_NAME_hash() need not look at the encoding at all.
  */
 
 static int x509_name_canon(X509_NAME *a)
@@ -345,7 +349,7 @@ static int x509_name_canon(X509_NAME *a)
     /* Special case: empty X509_NAME => null encoding */
     if (sk_X509_NAME_ENTRY_num(a->entries) == 0) {
         a->canon_enclen = 0;
-        return 1;
+        return x509_name_canon_hash(a);
     }
     intname = sk_STACK_OF_X509_NAME_ENTRY_new_null();
     if (!intname)
@@ -384,7 +388,7 @@ static int x509_name_canon(X509_NAME *a)
 
     i2d_name_canon(intname, &p);
 
-    ret = 1;
+    ret = x509_name_canon_hash(a);
 
  err:
 
@@ -394,6 +398,20 @@ static int x509_name_canon(X509_NAME *a)
     return ret;
 }
 
+static int x509_name_canon_hash(X509_NAME *a)
+{
+    unsigned char md[SHA_DIGEST_LENGTH];
+    int i;
+
+    if (!EVP_Digest(a->canon_enc, a->canon_enclen, md, NULL, EVP_sha1(),
+                    NULL))
+        return 0;
+    a->canon_hash = 0;
+    for (i = 7; i >= 0; i--)
+        a->canon_hash = (a->canon_hash << 8) | md[i];
+    return 1;
+}
+
 /* Bitmap of all the types of string that will be canonicalized. */
 
 #define ASN1_MASK_CANON \
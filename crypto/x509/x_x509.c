@@ -89,6 +89,23 @@ static int x509_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
 
     switch (operation) {
 
+    case ASN1_OP_D2I_PRE:
+        /* Drop anything cached from a previous decoding into |ret| */
+        CRYPTO_free_ex_data(CRYPTO_EX_INDEX_X509, ret, &ret->ex_data);
+        X509_CERT_AUX_free(ret->aux);
+        ASN1_OCTET_STRING_free(ret->skid);
+        AUTHORITY_KEYID_free(ret->akid);
+        CRL_DIST_POINTS_free(ret->crldp);
+        policy_cache_free(ret->policy_cache);
+        GENERAL_NAMES_free(ret->altname);
+        NAME_CONSTRAINTS_free(ret->nc);
+#ifndef OPENSSL_NO_RFC3779
+        sk_IPAddressFamily_pop_free(ret->rfc3779_addr, IPAddressFamily_free);
+        ASIdentifiers_free(ret->rfc3779_asid);
+#endif
+        OPENSSL_free(ret->name);
+        /* fall thru */
+
     case ASN1_OP_NEW_POST:
         ret->valid = 0;
         ret->name = NULL;
@@ -96,6 +113,9 @@ static int x509_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         ret->ex_pathlen = -1;
         ret->skid = NULL;
         ret->akid = NULL;
+        ret->policy_cache = NULL;
+        ret->altname = NULL;
+        ret->nc = NULL;
 #ifndef OPENSSL_NO_RFC3779
         ret->rfc3779_addr = NULL;
         ret->rfc3779_asid = NULL;
@@ -103,11 +123,19 @@ static int x509_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         ret->aux = NULL;
         ret->crldp = NULL;
         CRYPTO_new_ex_data(CRYPTO_EX_INDEX_X509, ret, &ret->ex_data);
+        if (operation == ASN1_OP_NEW_POST
+            && (ret->lock = CRYPTO_THREAD_lock_new()) == NULL)
+            return 0;
         break;
 
     case ASN1_OP_D2I_POST:
         OPENSSL_free(ret->name);
         ret->name = X509_NAME_oneline(ret->cert_info.subject, NULL, 0);
+        /*
+         * Cache the extensions while nothing else can see the certificate,
+         * so that checking them later never needs a lock.
+         */
+        x509v3_cache_extensions(ret);
         break;
 
     case ASN1_OP_FREE_POST:
@@ -124,6 +152,7 @@ static int x509_cb(int operation, ASN1_VALUE **pval, const ASN1_ITEM *it,
         ASIdentifiers_free(ret->rfc3779_asid);
 #endif
         OPENSSL_free(ret->name);
+        CRYPTO_THREAD_lock_free(ret->lock);
         break;
 
     }
@@ -64,7 +64,7 @@
 #include <openssl/x509_vfy.h>
 #include "internal/x509_int.h"
 
-static void x509v3_cache_extensions(X509 *x);
+static void cache_extensions(X509 *x);
 
 static int check_ssl_ca(const X509 *x);
 static int check_purpose_ssl_client(const X509_PURPOSE *xp, const X509 *x,
@@ -128,11 +128,7 @@ int X509_check_purpose(X509 *x, int id, int ca)
 {
     int idx;
     const X509_PURPOSE *pt;
-    if (!(x->ex_flags & EXFLAG_SET)) {
-        CRYPTO_w_lock(CRYPTO_LOCK_X509);
-        x509v3_cache_extensions(x);
-        CRYPTO_w_unlock(CRYPTO_LOCK_X509);
-    }
+    x509v3_cache_extensions(x);
     if (id == -1)
         return 1;
     idx = X509_PURPOSE_get_by_id(id);
@@ -388,7 +384,39 @@ static void setup_crldp(X509 *x)
 #define ns_reject(x, usage) \
         (((x)->ex_flags & EXFLAG_NSCERT) && !((x)->ex_nscert & (usage)))
 
-static void x509v3_cache_extensions(X509 *x)
+/*
+ * EXFLAG_SET is published last, with release semantics, so that once it is
+ * seen set the cached values can be read without a lock.
+ */
+#if defined(__ATOMIC_ACQUIRE) && defined(__ATOMIC_RELEASE)
+# define ex_flags_get(x) \
+        __atomic_load_n(&(x)->ex_flags, __ATOMIC_ACQUIRE)
+# define ex_flags_publish(x, f) \
+        __atomic_or_fetch(&(x)->ex_flags, (f), __ATOMIC_RELEASE)
+#else
+# define ex_flags_get(x)        (*(volatile uint32_t *)&(x)->ex_flags)
+# define ex_flags_publish(x, f) ((x)->ex_flags |= (f))
+#endif
+
+/*
+ * Cache the extensions of |x| once. Decoded certificates have this done by
+ * x509_cb() before anyone else can see them, so after that this is just a
+ * flag check. Certificates built in memory are cached on first use under
+ * their own lock.
+ */
+void x509v3_cache_extensions(X509 *x)
+{
+    if (ex_flags_get(x) & EXFLAG_SET)
+        return;
+    CRYPTO_THREAD_write_lock(x->lock);
+    if (!(x->ex_flags & EXFLAG_SET)) {
+        cache_extensions(x);
+        ex_flags_publish(x, EXFLAG_SET);
+    }
+    CRYPTO_THREAD_unlock(x->lock);
+}
+
+static void cache_extensions(X509 *x)
 {
     BASIC_CONSTRAINTS *bs;
     PROXY_CERT_INFO_EXTENSION *pci;
@@ -398,8 +426,6 @@ static void x509v3_cache_extensions(X509 *x)
     X509_EXTENSION *ex;
 
     int i;
-    if (x->ex_flags & EXFLAG_SET)
-        return;
     X509_digest(x, EVP_sha1(), x->sha1_hash, NULL);
     /* V1 should mean no extensions ... */
     if (!X509_get_version(x))
@@ -532,7 +558,6 @@ static void x509v3_cache_extensions(X509 *x)
             break;
         }
     }
-    x->ex_flags |= EXFLAG_SET;
 }
 
 /*-
@@ -575,11 +600,7 @@ static int check_ca(const X509 *x)
 
 int X509_check_ca(X509 *x)
 {
-    if (!(x->ex_flags & EXFLAG_SET)) {
-        CRYPTO_w_lock(CRYPTO_LOCK_X509);
-        x509v3_cache_extensions(x);
-        CRYPTO_w_unlock(CRYPTO_LOCK_X509);
-    }
+    x509v3_cache_extensions(x);
 
     return check_ca(x);
 }
@@ -0,0 +1,268 @@
+/* engines/e_dasync.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.OpenSSL.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    licensing@OpenSSL.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.OpenSSL.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/*
+ * This is the DASYNC engine ("dummy async").  It does RSA private key
+ * operations in software like the default method, but pretends to hand
+ * them off to an accelerator: when running inside an ASYNC job each
+ * operation pauses the job until a configurable delay has passed.  It is
+ * only meant for testing and demonstrating SSL_MODE_ASYNC.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/engine.h>
+#include <openssl/rsa.h>
+#include <openssl/async.h>
+#include <openssl/err.h>
+
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <sys/time.h>
+# include <unistd.h>
+#endif
+
+#define DASYNC_LIB_NAME "DASYNC"
+#include "e_dasync_err.c"
+
+/* Engine Id and Name */
+static const char *engine_dasync_id = "dasync";
+static const char *engine_dasync_name = "Dummy Async engine support";
+
+
+/* Engine Lifetime functions */
+static int dasync_destroy(ENGINE *e);
+static int dasync_init(ENGINE *e);
+static int dasync_finish(ENGINE *e);
+static int dasync_ctrl(ENGINE *e, int cmd, long i, void *p,
+                       void (*f) (void));
+void ENGINE_load_dasync(void);
+
+#define DASYNC_CMD_DELAY        ENGINE_CMD_BASE
+
+static const ENGINE_CMD_DEFN dasync_cmd_defns[] = {
+    {DASYNC_CMD_DELAY,
+     "DELAY",
+     "Milliseconds each private key operation takes (default 0)",
+     ENGINE_CMD_FLAG_NUMERIC},
+    {0, NULL, NULL, 0}
+};
+
+/* Simulated completion time of each operation, in milliseconds */
+static long dasync_delay = 0;
+
+
+/* Set up RSA */
+static int dasync_rsa_priv_enc(int flen, const unsigned char *from,
+                               unsigned char *to, RSA *rsa, int padding);
+static int dasync_rsa_priv_dec(int flen, const unsigned char *from,
+                               unsigned char *to, RSA *rsa, int padding);
+
+/* Filled in from the default method when the engine is bound */
+static RSA_METHOD dasync_rsa_method;
+static const RSA_METHOD *dasync_rsa_orig = NULL;
+
+
+static int bind_dasync(ENGINE *e)
+{
+    dasync_rsa_orig = RSA_PKCS1_OpenSSL();
+    dasync_rsa_method = *dasync_rsa_orig;
+    dasync_rsa_method.name = "Dummy Async RSA method";
+    dasync_rsa_method.rsa_priv_enc = dasync_rsa_priv_enc;
+    dasync_rsa_method.rsa_priv_dec = dasync_rsa_priv_dec;
+
+    /* Ensure the dasync error handling is set up */
+    ERR_load_DASYNC_strings();
+    if (!ENGINE_set_id(e, engine_dasync_id)
+        || !ENGINE_set_name(e, engine_dasync_name)
+        || !ENGINE_set_RSA(e, &dasync_rsa_method)
+        || !ENGINE_set_destroy_function(e, dasync_destroy)
+        || !ENGINE_set_init_function(e, dasync_init)
+        || !ENGINE_set_finish_function(e, dasync_finish)
+        || !ENGINE_set_ctrl_function(e, dasync_ctrl)
+        || !ENGINE_set_cmd_defns(e, dasync_cmd_defns)) {
+        DASYNCerr(DASYNC_F_BIND_DASYNC, DASYNC_R_INIT_FAILED);
+        return 0;
+    }
+
+    return 1;
+}
+
+#ifndef OPENSSL_NO_DYNAMIC_ENGINE
+static int bind_helper(ENGINE *e, const char *id)
+{
+    if (id && (strcmp(id, engine_dasync_id) != 0))
+        return 0;
+    if (!bind_dasync(e))
+        return 0;
+    return 1;
+}
+
+IMPLEMENT_DYNAMIC_CHECK_FN()
+    IMPLEMENT_DYNAMIC_BIND_FN(bind_helper)
+#endif
+
+static ENGINE *engine_dasync(void)
+{
+    ENGINE *ret = ENGINE_new();
+    if (!ret)
+        return NULL;
+    if (!bind_dasync(ret)) {
+        ENGINE_free(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+void ENGINE_load_dasync(void)
+{
+    ENGINE *toadd = engine_dasync();
+    if (!toadd)
+        return;
+    ENGINE_add(toadd);
+    ENGINE_free(toadd);
+    ERR_clear_error();
+}
+
+static int dasync_init(ENGINE *e)
+{
+    return 1;
+}
+
+
+static int dasync_finish(ENGINE *e)
+{
+    return 1;
+}
+
+
+static int dasync_destroy(ENGINE *e)
+{
+    ERR_unload_DASYNC_strings();
+    return 1;
+}
+
+static int dasync_ctrl(ENGINE *e, int cmd, long i, void *p,
+                       void (*f) (void))
+{
+    switch (cmd) {
+    case DASYNC_CMD_DELAY:
+        if (i < 0) {
+            DASYNCerr(DASYNC_F_DASYNC_CTRL, DASYNC_R_INVALID_DELAY);
+            return 0;
+        }
+        dasync_delay = i;
+        return 1;
+    }
+    DASYNCerr(DASYNC_F_DASYNC_CTRL, ENGINE_R_CTRL_COMMAND_NOT_IMPLEMENTED);
+    return 0;
+}
+
+static unsigned long dasync_now_ms(void)
+{
+#if defined(_WIN32)
+    return GetTickCount();
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (unsigned long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+/*
+ * Wait for the "accelerator" to finish.  Inside a job we pause, leaving the
+ * wait fd readable so that the caller comes straight back, until the delay
+ * has passed: there is no real device to signal completion, so each resume
+ * simply checks the clock.  Outside a job the caller blocks for the whole
+ * delay, as it would with a synchronous driver.
+ */
+static void dummy_pause_job(void)
+{
+    ASYNC_JOB *job;
+    unsigned long start = dasync_now_ms();
+
+    if ((job = ASYNC_get_current_job()) == NULL) {
+        if (dasync_delay > 0) {
+#if defined(_WIN32)
+            Sleep(dasync_delay);
+#else
+            usleep(dasync_delay * 1000);
+#endif
+        }
+        return;
+    }
+
+    do {
+        ASYNC_wake(job);
+        ASYNC_pause_job();
+        ASYNC_clear_wake(job);
+    } while (dasync_now_ms() - start < (unsigned long)dasync_delay);
+}
+
+/*
+ * RSA implementation
+ */
+
+static int dasync_rsa_priv_enc(int flen, const unsigned char *from,
+                               unsigned char *to, RSA *rsa, int padding)
+{
+    dummy_pause_job();
+    return dasync_rsa_orig->rsa_priv_enc(flen, from, to, rsa, padding);
+}
+
+static int dasync_rsa_priv_dec(int flen, const unsigned char *from,
+                               unsigned char *to, RSA *rsa, int padding)
+{
+    dummy_pause_job();
+    return dasync_rsa_orig->rsa_priv_dec(flen, from, to, rsa, padding);
+}
@@ -0,0 +1,107 @@
+/* include/internal/refcount.h */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#ifndef HEADER_INTERNAL_REFCOUNT_H
+# define HEADER_INTERNAL_REFCOUNT_H
+
+# include <openssl/crypto.h>
+
+/*
+ * Reference counts are plain ints. Where the compiler offers native atomic
+ * operations they are updated with those and no lock is taken; otherwise
+ * CRYPTO_add() falls back to the lock named by |type|. CRYPTO_add_lock()
+ * uses the same atomics, so the two may be mixed on the same counter.
+ *
+ * Taking a reference needs no ordering. Dropping one is acquire/release so
+ * that all use of the object happens before whichever thread frees it.
+ */
+# if !defined(OPENSSL_NO_LOCKING) && !defined(OPENSSL_NO_ATOMIC_REFCOUNT)
+#  if defined(__ATOMIC_RELAXED) && defined(__ATOMIC_ACQ_REL)
+#   define CRYPTO_REF_ATOMIC
+#   define CRYPTO_ATOMIC_ADD(val, amount) \
+        __atomic_add_fetch((val), (amount), __ATOMIC_ACQ_REL)
+#   define CRYPTO_UP_REF(val, type) \
+        __atomic_add_fetch((val), 1, __ATOMIC_RELAXED)
+#   define CRYPTO_DOWN_REF(val, type) \
+        __atomic_sub_fetch((val), 1, __ATOMIC_ACQ_REL)
+#  elif defined(_MSC_VER) && _MSC_VER >= 1400
+#   include <intrin.h>
+#   pragma intrinsic(_InterlockedExchangeAdd)
+#   define CRYPTO_REF_ATOMIC
+#   define CRYPTO_ATOMIC_ADD(val, amount) \
+        (_InterlockedExchangeAdd((long volatile *)(val), (amount)) + (amount))
+#   define CRYPTO_UP_REF(val, type)     CRYPTO_ATOMIC_ADD(val, 1)
+#   define CRYPTO_DOWN_REF(val, type)   CRYPTO_ATOMIC_ADD(val, -1)
+#  endif
+# endif
+
+# ifndef CRYPTO_REF_ATOMIC
+#  define CRYPTO_UP_REF(val, type)      CRYPTO_add(val, 1, type)
+#  define CRYPTO_DOWN_REF(val, type)    CRYPTO_add(val, -1, type)
+# endif
+
+/*
+ * For callers that already hold the counter's lock for other reasons: the
+ * update must still be atomic if other paths no longer take that lock.
+ */
+# ifdef CRYPTO_REF_ATOMIC
+#  define CRYPTO_UP_REF_LOCKED(val)     CRYPTO_UP_REF(val, 0)
+#  define CRYPTO_DOWN_REF_LOCKED(val)   CRYPTO_DOWN_REF(val, 0)
+# else
+#  define CRYPTO_UP_REF_LOCKED(val)     (++*(val))
+#  define CRYPTO_DOWN_REF_LOCKED(val)   (--*(val))
+# endif
+
+#endif
@@ -264,6 +264,8 @@ void BIO_clear_flags(BIO *b, int flags);
 # define BIO_RR_CONNECT                  0x02
 /* Returned from the accept BIO when an accept would have blocked */
 # define BIO_RR_ACCEPT                   0x03
+/* Returned from the SSL bio when an async job has paused */
+# define BIO_RR_ASYNC                    0x04
 
 /* These are passed by the BIO callback */
 # define BIO_CB_FREE     0x01
@@ -296,6 +298,12 @@ int BIO_method_type(const BIO *b);
 typedef void bio_info_cb (struct bio_st *, int, const char *, int, long,
                           long);
 
+/* One of the buffers written by BIO_writev(), like struct iovec */
+typedef struct bio_iovec_st {
+    const void *base;
+    size_t len;
+} BIO_IOVEC;
+
 typedef struct bio_method_st {
     int type;
     const char *name;
@@ -307,6 +315,8 @@ typedef struct bio_method_st {
     int (*create) (BIO *);
     int (*destroy) (BIO *);
     long (*callback_ctrl) (BIO *, int, bio_info_cb *);
+    /* optional, BIO_writev() falls back to bwrite */
+    int (*bwritev) (BIO *, const BIO_IOVEC *, int);
 } BIO_METHOD;
 
 struct bio_st {
@@ -645,6 +655,7 @@ void BIO_vfree(BIO *a);
 int BIO_read(BIO *b, void *data, int len);
 int BIO_gets(BIO *bp, char *buf, int size);
 int BIO_write(BIO *b, const void *data, int len);
+int BIO_writev(BIO *b, const BIO_IOVEC *iov, int iovcnt);
 int BIO_puts(BIO *bp, const char *buf);
 int BIO_indent(BIO *b, int indent, int max);
 long BIO_ctrl(BIO *bp, int cmd, long larg, void *parg);
@@ -816,6 +827,7 @@ void ERR_load_BIO_strings(void);
 # define BIO_F_BIO_READ                                   111
 # define BIO_F_BIO_SOCK_INIT                              112
 # define BIO_F_BIO_WRITE                                  113
+# define BIO_F_BIO_WRITEV                                 134
 # define BIO_F_BUFFER_CTRL                                114
 # define BIO_F_CONN_CTRL                                  127
 # define BIO_F_CONN_STATE                                 115
@@ -141,6 +141,29 @@
  */
 # include <openssl/symhacks.h>
 
+/*
+ * Types for the built-in threading layer, see CRYPTO_THREAD_lock_new() and
+ * friends below.
+ */
+# if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_WINDOWS)
+/* LONG and DWORD, without pulling <windows.h> into every application */
+typedef long CRYPTO_ONCE;
+typedef unsigned long CRYPTO_THREAD_LOCAL;
+typedef unsigned long CRYPTO_THREAD_ID;
+#  define CRYPTO_ONCE_STATIC_INIT 0
+# elif defined(OPENSSL_THREADS)
+#  include <pthread.h>
+typedef pthread_once_t CRYPTO_ONCE;
+typedef pthread_key_t CRYPTO_THREAD_LOCAL;
+typedef pthread_t CRYPTO_THREAD_ID;
+#  define CRYPTO_ONCE_STATIC_INIT PTHREAD_ONCE_INIT
+# else
+typedef unsigned int CRYPTO_ONCE;
+typedef unsigned int CRYPTO_THREAD_LOCAL;
+typedef unsigned int CRYPTO_THREAD_ID;
+#  define CRYPTO_ONCE_STATIC_INIT 0
+# endif
+
 #ifdef  __cplusplus
 extern "C" {
 #endif
@@ -437,6 +460,30 @@ void (*CRYPTO_get_dynlock_destroy_callback(void)) (struct CRYPTO_dynlock_value
                                                    *l, const char *file,
                                                    int line);
 
+/*
+ * Built-in threading primitives. Unlike the numbered CRYPTO_LOCK_* locks
+ * these need no callbacks from the application, and each lock belongs to
+ * the object that created it.
+ */
+typedef void CRYPTO_RWLOCK;
+
+CRYPTO_RWLOCK *CRYPTO_THREAD_lock_new(void);
+int CRYPTO_THREAD_read_lock(CRYPTO_RWLOCK *lock);
+int CRYPTO_THREAD_write_lock(CRYPTO_RWLOCK *lock);
+int CRYPTO_THREAD_unlock(CRYPTO_RWLOCK *lock);
+void CRYPTO_THREAD_lock_free(CRYPTO_RWLOCK *lock);
+
+int CRYPTO_THREAD_run_once(CRYPTO_ONCE *once, void (*init) (void));
+
+int CRYPTO_THREAD_init_local(CRYPTO_THREAD_LOCAL *key,
+                             void (*cleanup) (void *));
+void *CRYPTO_THREAD_get_local(CRYPTO_THREAD_LOCAL *key);
+int CRYPTO_THREAD_set_local(CRYPTO_THREAD_LOCAL *key, void *val);
+int CRYPTO_THREAD_cleanup_local(CRYPTO_THREAD_LOCAL *key);
+
+CRYPTO_THREAD_ID CRYPTO_THREAD_get_current_id(void);
+int CRYPTO_THREAD_compare_id(CRYPTO_THREAD_ID a, CRYPTO_THREAD_ID b);
+
 int CRYPTO_set_mem_functions(void *(*m) (size_t), void *(*r) (void *, size_t),
                              void (*f) (void *));
 int CRYPTO_set_mem_ex_functions(void *(*m) (size_t, const char *, int),
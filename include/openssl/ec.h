@@ -1100,6 +1100,9 @@ void ERR_load_EC_strings(void);
 # define EC_F_ECP_NIST_MOD_224                            204
 # define EC_F_ECP_NIST_MOD_256                            205
 # define EC_F_ECP_NIST_MOD_521                            206
+# define EC_F_ECX_KEY_OP                                  245
+# define EC_F_ECX_PRIV_ENCODE                             246
+# define EC_F_ECX_PUB_ENCODE                              247
 # define EC_F_EC_ASN1_GROUP2CURVE                         153
 # define EC_F_EC_ASN1_GROUP2FIELDID                       154
 # define EC_F_EC_ASN1_GROUP2PARAMETERS                    155
@@ -1220,6 +1223,7 @@ void ERR_load_EC_strings(void);
 # define EC_F_PKEY_EC_KEYGEN                              199
 # define EC_F_PKEY_EC_PARAMGEN                            219
 # define EC_F_PKEY_EC_SIGN                                218
+# define EC_F_PKEY_ECX_DERIVE                             248
 
 /* Reason codes. */
 # define EC_R_ASN1_ERROR                                  115
@@ -1246,6 +1250,8 @@ void ERR_load_EC_strings(void);
 # define EC_R_INVALID_FIELD                               103
 # define EC_R_INVALID_FORM                                104
 # define EC_R_INVALID_GROUP_ORDER                         122
+# define EC_R_INVALID_KEY                                 152
+# define EC_R_INVALID_PEER_KEY                            153
 # define EC_R_INVALID_PENTANOMIAL_BASIS                   132
 # define EC_R_INVALID_PRIVATE_KEY                         123
 # define EC_R_INVALID_TRINOMIAL_BASIS                     137
@@ -481,6 +481,29 @@ DECLARE_SPECIAL_STACK_OF(OPENSSL_BLOCK, void)
 # define sk_BY_DIR_HASH_sort(st) SKM_sk_sort(BY_DIR_HASH, (st))
 # define sk_BY_DIR_HASH_is_sorted(st) SKM_sk_is_sorted(BY_DIR_HASH, (st))
 
+# define sk_BY_DIR_INDEX_new(cmp) SKM_sk_new(BY_DIR_INDEX, (cmp))
+# define sk_BY_DIR_INDEX_new_null() SKM_sk_new_null(BY_DIR_INDEX)
+# define sk_BY_DIR_INDEX_free(st) SKM_sk_free(BY_DIR_INDEX, (st))
+# define sk_BY_DIR_INDEX_num(st) SKM_sk_num(BY_DIR_INDEX, (st))
+# define sk_BY_DIR_INDEX_value(st, i) SKM_sk_value(BY_DIR_INDEX, (st), (i))
+# define sk_BY_DIR_INDEX_set(st, i, val) SKM_sk_set(BY_DIR_INDEX, (st), (i), (val))
+# define sk_BY_DIR_INDEX_zero(st) SKM_sk_zero(BY_DIR_INDEX, (st))
+# define sk_BY_DIR_INDEX_push(st, val) SKM_sk_push(BY_DIR_INDEX, (st), (val))
+# define sk_BY_DIR_INDEX_unshift(st, val) SKM_sk_unshift(BY_DIR_INDEX, (st), (val))
+# define sk_BY_DIR_INDEX_find(st, val) SKM_sk_find(BY_DIR_INDEX, (st), (val))
+# define sk_BY_DIR_INDEX_find_ex(st, val) SKM_sk_find_ex(BY_DIR_INDEX, (st), (val))
+# define sk_BY_DIR_INDEX_delete(st, i) SKM_sk_delete(BY_DIR_INDEX, (st), (i))
+# define sk_BY_DIR_INDEX_delete_ptr(st, ptr) SKM_sk_delete_ptr(BY_DIR_INDEX, (st), (ptr))
+# define sk_BY_DIR_INDEX_insert(st, val, i) SKM_sk_insert(BY_DIR_INDEX, (st), (val), (i))
+# define sk_BY_DIR_INDEX_set_cmp_func(st, cmp) SKM_sk_set_cmp_func(BY_DIR_INDEX, (st), (cmp))
+# define sk_BY_DIR_INDEX_dup(st) SKM_sk_dup(BY_DIR_INDEX, st)
+# define sk_BY_DIR_INDEX_pop_free(st, free_func) SKM_sk_pop_free(BY_DIR_INDEX, (st), (free_func))
+# define sk_BY_DIR_INDEX_deep_copy(st, copy_func, free_func) SKM_sk_deep_copy(BY_DIR_INDEX, (st), (copy_func), (free_func))
+# define sk_BY_DIR_INDEX_shift(st) SKM_sk_shift(BY_DIR_INDEX, (st))
+# define sk_BY_DIR_INDEX_pop(st) SKM_sk_pop(BY_DIR_INDEX, (st))
+# define sk_BY_DIR_INDEX_sort(st) SKM_sk_sort(BY_DIR_INDEX, (st))
+# define sk_BY_DIR_INDEX_is_sorted(st) SKM_sk_is_sorted(BY_DIR_INDEX, (st))
+
 # define sk_CMS_CertificateChoices_new(cmp) SKM_sk_new(CMS_CertificateChoices, (cmp))
 # define sk_CMS_CertificateChoices_new_null() SKM_sk_new_null(CMS_CertificateChoices)
 # define sk_CMS_CertificateChoices_free(st) SKM_sk_free(CMS_CertificateChoices, (st))
@@ -2359,6 +2382,60 @@ DECLARE_SPECIAL_STACK_OF(OPENSSL_BLOCK, void)
   LHM_lh_stats_bio(SSL_SESSION,lh,out)
 # define lh_SSL_SESSION_free(lh) LHM_lh_free(SSL_SESSION,lh)
 
+# define lh_X509_OBJECT_BUCKET_new() LHM_lh_new(X509_OBJECT_BUCKET,x509_object_bucket)
+# define lh_X509_OBJECT_BUCKET_insert(lh,inst) LHM_lh_insert(X509_OBJECT_BUCKET,lh,inst)
+# define lh_X509_OBJECT_BUCKET_retrieve(lh,inst) LHM_lh_retrieve(X509_OBJECT_BUCKET,lh,inst)
+# define lh_X509_OBJECT_BUCKET_delete(lh,inst) LHM_lh_delete(X509_OBJECT_BUCKET,lh,inst)
+# define lh_X509_OBJECT_BUCKET_doall(lh,fn) LHM_lh_doall(X509_OBJECT_BUCKET,lh,fn)
+# define lh_X509_OBJECT_BUCKET_doall_arg(lh,fn,arg_type,arg) \
+  LHM_lh_doall_arg(X509_OBJECT_BUCKET,lh,fn,arg_type,arg)
+# define lh_X509_OBJECT_BUCKET_error(lh) LHM_lh_error(X509_OBJECT_BUCKET,lh)
+# define lh_X509_OBJECT_BUCKET_num_items(lh) LHM_lh_num_items(X509_OBJECT_BUCKET,lh)
+# define lh_X509_OBJECT_BUCKET_down_load(lh) LHM_lh_down_load(X509_OBJECT_BUCKET,lh)
+# define lh_X509_OBJECT_BUCKET_node_stats_bio(lh,out) \
+  LHM_lh_node_stats_bio(X509_OBJECT_BUCKET,lh,out)
+# define lh_X509_OBJECT_BUCKET_node_usage_stats_bio(lh,out) \
+  LHM_lh_node_usage_stats_bio(X509_OBJECT_BUCKET,lh,out)
+# define lh_X509_OBJECT_BUCKET_stats_bio(lh,out) \
+  LHM_lh_stats_bio(X509_OBJECT_BUCKET,lh,out)
+# define lh_X509_OBJECT_BUCKET_free(lh) LHM_lh_free(X509_OBJECT_BUCKET,lh)
+
+# define lh_X509_REVOKED_new() LHM_lh_new(X509_REVOKED,x509_revoked)
+# define lh_X509_REVOKED_insert(lh,inst) LHM_lh_insert(X509_REVOKED,lh,inst)
+# define lh_X509_REVOKED_retrieve(lh,inst) LHM_lh_retrieve(X509_REVOKED,lh,inst)
+# define lh_X509_REVOKED_delete(lh,inst) LHM_lh_delete(X509_REVOKED,lh,inst)
+# define lh_X509_REVOKED_doall(lh,fn) LHM_lh_doall(X509_REVOKED,lh,fn)
+# define lh_X509_REVOKED_doall_arg(lh,fn,arg_type,arg) \
+  LHM_lh_doall_arg(X509_REVOKED,lh,fn,arg_type,arg)
+# define lh_X509_REVOKED_error(lh) LHM_lh_error(X509_REVOKED,lh)
+# define lh_X509_REVOKED_num_items(lh) LHM_lh_num_items(X509_REVOKED,lh)
+# define lh_X509_REVOKED_down_load(lh) LHM_lh_down_load(X509_REVOKED,lh)
+# define lh_X509_REVOKED_node_stats_bio(lh,out) \
+  LHM_lh_node_stats_bio(X509_REVOKED,lh,out)
+# define lh_X509_REVOKED_node_usage_stats_bio(lh,out) \
+  LHM_lh_node_usage_stats_bio(X509_REVOKED,lh,out)
+# define lh_X509_REVOKED_stats_bio(lh,out) \
+  LHM_lh_stats_bio(X509_REVOKED,lh,out)
+# define lh_X509_REVOKED_free(lh) LHM_lh_free(X509_REVOKED,lh)
+
+# define lh_X509_SIGCACHE_ENTRY_new() LHM_lh_new(X509_SIGCACHE_ENTRY,x509_sigcache_entry)
+# define lh_X509_SIGCACHE_ENTRY_insert(lh,inst) LHM_lh_insert(X509_SIGCACHE_ENTRY,lh,inst)
+# define lh_X509_SIGCACHE_ENTRY_retrieve(lh,inst) LHM_lh_retrieve(X509_SIGCACHE_ENTRY,lh,inst)
+# define lh_X509_SIGCACHE_ENTRY_delete(lh,inst) LHM_lh_delete(X509_SIGCACHE_ENTRY,lh,inst)
+# define lh_X509_SIGCACHE_ENTRY_doall(lh,fn) LHM_lh_doall(X509_SIGCACHE_ENTRY,lh,fn)
+# define lh_X509_SIGCACHE_ENTRY_doall_arg(lh,fn,arg_type,arg) \
+  LHM_lh_doall_arg(X509_SIGCACHE_ENTRY,lh,fn,arg_type,arg)
+# define lh_X509_SIGCACHE_ENTRY_error(lh) LHM_lh_error(X509_SIGCACHE_ENTRY,lh)
+# define lh_X509_SIGCACHE_ENTRY_num_items(lh) LHM_lh_num_items(X509_SIGCACHE_ENTRY,lh)
+# define lh_X509_SIGCACHE_ENTRY_down_load(lh) LHM_lh_down_load(X509_SIGCACHE_ENTRY,lh)
+# define lh_X509_SIGCACHE_ENTRY_node_stats_bio(lh,out) \
+  LHM_lh_node_stats_bio(X509_SIGCACHE_ENTRY,lh,out)
+# define lh_X509_SIGCACHE_ENTRY_node_usage_stats_bio(lh,out) \
+  LHM_lh_node_usage_stats_bio(X509_SIGCACHE_ENTRY,lh,out)
+# define lh_X509_SIGCACHE_ENTRY_stats_bio(lh,out) \
+  LHM_lh_stats_bio(X509_SIGCACHE_ENTRY,lh,out)
+# define lh_X509_SIGCACHE_ENTRY_free(lh) LHM_lh_free(X509_SIGCACHE_ENTRY,lh)
+
 # ifdef  __cplusplus
 }
 # endif
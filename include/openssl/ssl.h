@@ -158,6 +158,7 @@
 
 # include <openssl/safestack.h>
 # include <openssl/symhacks.h>
+# include <openssl/async.h>
 
 #ifdef  __cplusplus
 extern "C" {
@@ -250,6 +251,7 @@ extern "C" {
 # define SSL_TXT_CAMELLIA128     "CAMELLIA128"
 # define SSL_TXT_CAMELLIA256     "CAMELLIA256"
 # define SSL_TXT_CAMELLIA        "CAMELLIA"
+# define SSL_TXT_CHACHA20        "CHACHA20"
 
 # define SSL_TXT_MD5             "MD5"
 # define SSL_TXT_SHA1            "SHA1"
@@ -412,6 +414,11 @@ typedef int (*custom_ext_parse_cb) (SSL *s, unsigned int ext_type,
 # define SSL_OP_SINGLE_ECDH_USE                          0x00080000L
 /* If set, always create a new key when using tmp_dh parameters */
 # define SSL_OP_SINGLE_DH_USE                            0x00100000L
+/*
+ * With SSL_OP_CIPHER_SERVER_PREFERENCE, prefer ChaCha20-Poly1305 when the
+ * client lists it first, i.e. when it most likely lacks AES acceleration
+ */
+# define SSL_OP_PRIORITIZE_CHACHA                        0x00200000L
 /* Does nothing: retained for compatibiity */
 # define SSL_OP_EPHEMERAL_RSA                            0x0
 /*
@@ -490,6 +497,13 @@ typedef int (*custom_ext_parse_cb) (SSL *s, unsigned int ext_type,
  * draft-ietf-tls-downgrade-scsv-00.
  */
 # define SSL_MODE_SEND_FALLBACK_SCSV 0x00000080L
+/*
+ * Run handshakes, SSL_read() and SSL_write() inside an ASYNC job, so that an
+ * engine can pause a slow private key operation.  The call then fails with
+ * SSL_ERROR_WANT_ASYNC and must be repeated once the fd returned by
+ * SSL_get_async_wait_fd() becomes readable.
+ */
+# define SSL_MODE_ASYNC 0x00000100L
 
 /* Cert related flags */
 /*
@@ -671,6 +685,7 @@ typedef int (*GEN_SESSION_CB) (const SSL *ssl, unsigned char *id,
 # define SSL_SESS_CACHE_NO_INTERNAL_STORE        0x0200
 # define SSL_SESS_CACHE_NO_INTERNAL \
         (SSL_SESS_CACHE_NO_INTERNAL_LOOKUP|SSL_SESS_CACHE_NO_INTERNAL_STORE)
+# define SSL_SESS_CACHE_SHARDED                  0x0400
 
 LHASH_OF(SSL_SESSION) *SSL_CTX_sessions(SSL_CTX *ctx);
 # define SSL_CTX_sess_number(ctx) \
@@ -878,12 +893,16 @@ __owur int SSL_extension_supported(unsigned int ext_type);
 # define SSL_WRITING     2
 # define SSL_READING     3
 # define SSL_X509_LOOKUP 4
+# define SSL_ASYNC_PAUSED        5
+# define SSL_ASYNC_NO_JOBS       6
 
 /* These will only be used when doing non-blocking IO */
 # define SSL_want_nothing(s)     (SSL_want(s) == SSL_NOTHING)
 # define SSL_want_read(s)        (SSL_want(s) == SSL_READING)
 # define SSL_want_write(s)       (SSL_want(s) == SSL_WRITING)
 # define SSL_want_x509_lookup(s) (SSL_want(s) == SSL_X509_LOOKUP)
+# define SSL_want_async(s)       (SSL_want(s) == SSL_ASYNC_PAUSED)
+# define SSL_want_async_job(s)   (SSL_want(s) == SSL_ASYNC_NO_JOBS)
 
 # define SSL_MAC_FLAG_READ_MAC_STREAM 1
 # define SSL_MAC_FLAG_WRITE_MAC_STREAM 2
@@ -1102,6 +1121,8 @@ DECLARE_PEM_rw(SSL_SESSION, SSL_SESSION)
 # define SSL_ERROR_ZERO_RETURN           6
 # define SSL_ERROR_WANT_CONNECT          7
 # define SSL_ERROR_WANT_ACCEPT           8
+# define SSL_ERROR_WANT_ASYNC            9
+# define SSL_ERROR_WANT_ASYNC_JOB        10
 # define SSL_CTRL_NEED_TMP_RSA                   1
 # define SSL_CTRL_SET_TMP_RSA                    2
 # define SSL_CTRL_SET_TMP_DH                     3
@@ -1216,6 +1237,17 @@ DECLARE_PEM_rw(SSL_SESSION, SSL_SESSION)
 # define DTLS_CTRL_SET_LINK_MTU                  120
 # define DTLS_CTRL_GET_LINK_MIN_MTU              121
 # define SSL_CTRL_GET_EXTMS_SUPPORT              122
+# define SSL_CTRL_SET_BUFFER_POOL                124
+# define SSL_CTRL_GET_BUFFER_POOL                125
+# define SSL_CTRL_SET_BUFFER_POOL_ARENA          126
+# define SSL_CTRL_BUFFER_POOL_SIZE               127
+# define SSL_CTRL_BUFFER_POOL_IN_USE             128
+# define SSL_CTRL_BUFFER_POOL_HIGH_WATER         129
+# define SSL_CTRL_BUFFER_POOL_HITS               130
+# define SSL_CTRL_BUFFER_POOL_MISSES             131
+# define SSL_CTRL_SET_DYNAMIC_RECORD_THRESHOLD   132
+# define SSL_CTRL_SET_DYNAMIC_RECORD_TIMEOUT     133
+# define SSL_CTRL_SET_DYNAMIC_RECORD_SIZE        134
 # define SSL_CERT_SET_FIRST                      1
 # define SSL_CERT_SET_NEXT                       2
 # define SSL_CERT_SET_SERVER                     3
@@ -1404,6 +1436,8 @@ __owur BIO *SSL_get_rbio(const SSL *s);
 __owur BIO *SSL_get_wbio(const SSL *s);
 __owur int SSL_set_cipher_list(SSL *s, const char *str);
 void SSL_set_read_ahead(SSL *s, int yes);
+void SSL_CTX_set_default_read_buffer_len(SSL_CTX *ctx, size_t len);
+void SSL_set_default_read_buffer_len(SSL *s, size_t len);
 __owur int SSL_get_verify_mode(const SSL *s);
 __owur int SSL_get_verify_depth(const SSL *s);
 __owur int (*SSL_get_verify_callback(const SSL *s)) (int, X509_STORE_CTX *);
@@ -1426,6 +1460,16 @@ __owur int SSL_CTX_use_serverinfo(SSL_CTX *ctx, const unsigned char *serverinfo,
                            size_t serverinfo_length);
 __owur int SSL_CTX_use_serverinfo_file(SSL_CTX *ctx, const char *file);
 
+/* OCSP responses kept by the SSL_CTX and sent on request */
+typedef int (*SSL_ocsp_fetch_cb) (SSL_CTX *ctx, X509 *cert, X509 *issuer,
+                                  unsigned char **resp, size_t *resplen,
+                                  void *arg);
+__owur int SSL_CTX_set_ocsp_staple_fetch_cb(SSL_CTX *ctx, SSL_ocsp_fetch_cb cb,
+                                            void *arg);
+__owur int SSL_CTX_add_ocsp_staple(SSL_CTX *ctx, X509 *cert, X509 *issuer,
+                                   const unsigned char *resp, size_t resplen);
+int SSL_CTX_refresh_ocsp_staples(SSL_CTX *ctx);
+
 __owur int SSL_use_RSAPrivateKey_file(SSL *ssl, const char *file, int type);
 __owur int SSL_use_PrivateKey_file(SSL *ssl, const char *file, int type);
 __owur int SSL_use_certificate_file(SSL *ssl, const char *file, int type);
@@ -1566,7 +1610,10 @@ __owur int SSL_accept(SSL *ssl);
 __owur int SSL_connect(SSL *ssl);
 __owur int SSL_read(SSL *ssl, void *buf, int num);
 __owur int SSL_peek(SSL *ssl, void *buf, int num);
+__owur int SSL_peek_ptr(SSL *ssl, const void **buf);
+__owur int SSL_read_ptr(SSL *ssl, const void **buf, int num);
 __owur int SSL_write(SSL *ssl, const void *buf, int num);
+__owur int SSL_writev(SSL *ssl, const BIO_IOVEC *iov, int iovcnt);
 long SSL_ctrl(SSL *ssl, int cmd, long larg, void *parg);
 long SSL_callback_ctrl(SSL *, int, void (*)(void));
 long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg);
@@ -1575,6 +1622,9 @@ long SSL_CTX_callback_ctrl(SSL_CTX *, int, void (*)(void));
 __owur int SSL_get_error(const SSL *s, int ret_code);
 __owur const char *SSL_get_version(const SSL *s);
 
+__owur int SSL_waiting_for_async(SSL *s);
+__owur OSSL_ASYNC_FD SSL_get_async_wait_fd(SSL *s);
+
 /* This sets the 'default' SSL version that SSL_new() will create */
 __owur int SSL_CTX_set_ssl_version(SSL_CTX *ctx, const SSL_METHOD *meth);
 
@@ -1743,6 +1793,34 @@ __owur int SSL_get_ex_data_X509_STORE_CTX_idx(void);
         SSL_CTX_ctrl(ctx,SSL_CTRL_SET_MAX_SEND_FRAGMENT,m,NULL)
 # define SSL_set_max_send_fragment(ssl,m) \
         SSL_ctrl(ssl,SSL_CTRL_SET_MAX_SEND_FRAGMENT,m,NULL)
+# define SSL_CTX_set_dynamic_record_threshold(ctx,n) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_SET_DYNAMIC_RECORD_THRESHOLD,n,NULL)
+# define SSL_set_dynamic_record_threshold(ssl,n) \
+        SSL_ctrl(ssl,SSL_CTRL_SET_DYNAMIC_RECORD_THRESHOLD,n,NULL)
+# define SSL_CTX_set_dynamic_record_timeout(ctx,ms) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_SET_DYNAMIC_RECORD_TIMEOUT,ms,NULL)
+# define SSL_set_dynamic_record_timeout(ssl,ms) \
+        SSL_ctrl(ssl,SSL_CTRL_SET_DYNAMIC_RECORD_TIMEOUT,ms,NULL)
+# define SSL_CTX_set_dynamic_record_size(ctx,m) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_SET_DYNAMIC_RECORD_SIZE,m,NULL)
+# define SSL_set_dynamic_record_size(ssl,m) \
+        SSL_ctrl(ssl,SSL_CTRL_SET_DYNAMIC_RECORD_SIZE,m,NULL)
+# define SSL_CTX_set_buffer_pool(ctx,m) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_SET_BUFFER_POOL,m,NULL)
+# define SSL_CTX_get_buffer_pool(ctx) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_GET_BUFFER_POOL,0,NULL)
+# define SSL_CTX_set_buffer_pool_arena(ctx,n) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_SET_BUFFER_POOL_ARENA,n,NULL)
+# define SSL_CTX_buffer_pool_size(ctx) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_BUFFER_POOL_SIZE,0,NULL)
+# define SSL_CTX_buffer_pool_in_use(ctx) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_BUFFER_POOL_IN_USE,0,NULL)
+# define SSL_CTX_buffer_pool_high_water(ctx) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_BUFFER_POOL_HIGH_WATER,0,NULL)
+# define SSL_CTX_buffer_pool_hits(ctx) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_BUFFER_POOL_HITS,0,NULL)
+# define SSL_CTX_buffer_pool_misses(ctx) \
+        SSL_CTX_ctrl(ctx,SSL_CTRL_BUFFER_POOL_MISSES,0,NULL)
 
      /* NB: the keylength is only applicable when is_export is true */
 # ifndef OPENSSL_NO_RSA
@@ -2021,6 +2099,7 @@ void ERR_load_SSL_strings(void);
 # define SSL_F_SSL3_SETUP_WRITE_BUFFER                    291
 # define SSL_F_SSL3_WRITE_BYTES                           158
 # define SSL_F_SSL3_WRITE_PENDING                         159
+# define SSL_F_SSL3_WRITEV_BYTES                          395
 # define SSL_F_SSL_ADD_CERT_CHAIN                         316
 # define SSL_F_SSL_ADD_CERT_TO_BUF                        319
 # define SSL_F_SSL_ADD_CLIENTHELLO_RENEGOTIATE_EXT        298
@@ -2049,9 +2128,11 @@ void ERR_load_SSL_strings(void);
 # define SSL_F_SSL_CONF_CMD                               334
 # define SSL_F_SSL_CREATE_CIPHER_LIST                     166
 # define SSL_F_SSL_CTRL                                   232
+# define SSL_F_SSL_CTX_ADD_OCSP_STAPLE                    391
 # define SSL_F_SSL_CTX_CHECK_PRIVATE_KEY                  168
 # define SSL_F_SSL_CTX_MAKE_PROFILES                      309
 # define SSL_F_SSL_CTX_NEW                                169
+# define SSL_F_SSL_CTX_REFRESH_OCSP_STAPLES               392
 # define SSL_F_SSL_CTX_SET_CIPHER_LIST                    269
 # define SSL_F_SSL_CTX_SET_CLIENT_CERT_ENGINE             290
 # define SSL_F_SSL_CTX_SET_PURPOSE                        226
@@ -2070,6 +2151,7 @@ void ERR_load_SSL_strings(void);
 # define SSL_F_SSL_CTX_USE_RSAPRIVATEKEY_FILE             179
 # define SSL_F_SSL_CTX_USE_SERVERINFO                     336
 # define SSL_F_SSL_CTX_USE_SERVERINFO_FILE                337
+# define SSL_F_SSL_DERIVE                                 389
 # define SSL_F_SSL_DO_HANDSHAKE                           180
 # define SSL_F_SSL_GET_NEW_SESSION                        181
 # define SSL_F_SSL_GET_PREV_SESSION                       217
@@ -2096,6 +2178,7 @@ void ERR_load_SSL_strings(void);
 # define SSL_F_SSL_SESSION_NEW                            189
 # define SSL_F_SSL_SESSION_PRINT_FP                       190
 # define SSL_F_SSL_SESSION_SET1_ID_CONTEXT                312
+# define SSL_F_SSL_SESSION_SHARDS_NEW                     388
 # define SSL_F_SSL_SESS_CERT_NEW                          225
 # define SSL_F_SSL_SET_CERT                               191
 # define SSL_F_SSL_SET_CIPHER_LIST                        271
@@ -2111,6 +2194,7 @@ void ERR_load_SSL_strings(void);
 # define SSL_F_SSL_SET_WFD                                196
 # define SSL_F_SSL_SHUTDOWN                               224
 # define SSL_F_SSL_SRP_CTX_INIT                           313
+# define SSL_F_SSL_START_ASYNC_JOB                        390
 # define SSL_F_SSL_UNDEFINED_CONST_FUNCTION               243
 # define SSL_F_SSL_UNDEFINED_FUNCTION                     197
 # define SSL_F_SSL_UNDEFINED_VOID_FUNCTION                244
@@ -2126,6 +2210,7 @@ void ERR_load_SSL_strings(void);
 # define SSL_F_SSL_USE_RSAPRIVATEKEY_FILE                 206
 # define SSL_F_SSL_VERIFY_CERT_CHAIN                      207
 # define SSL_F_SSL_WRITE                                  208
+# define SSL_F_SSL_WRITEV                                 394
 # define SSL_F_STATE_MACHINE                              353
 # define SSL_F_TLS12_CHECK_PEER_SIGALG                    333
 # define SSL_F_TLS1_CERT_VERIFY_MAC                       286
@@ -2199,6 +2284,7 @@ void ERR_load_SSL_strings(void);
 # define SSL_R_BAD_LENGTH                                 271
 # define SSL_R_BAD_MAC_LENGTH                             333
 # define SSL_R_BAD_MESSAGE_TYPE                           114
+# define SSL_R_BAD_OCSP_STAPLE                            406
 # define SSL_R_BAD_PACKET_LENGTH                          115
 # define SSL_R_BAD_PROTOCOL_VERSION_NUMBER                116
 # define SSL_R_BAD_PSK_IDENTITY_HINT_LENGTH               316
@@ -2263,6 +2349,7 @@ void ERR_load_SSL_strings(void);
 # define SSL_R_ERROR_IN_RECEIVED_CIPHER_LIST              151
 # define SSL_R_EXCESSIVE_MESSAGE_SIZE                     152
 # define SSL_R_EXTRA_DATA_IN_MESSAGE                      153
+# define SSL_R_FAILED_TO_INIT_ASYNC                       405
 # define SSL_R_FRAGMENTED_CLIENT_HELLO                    401
 # define SSL_R_GOT_A_FIN_BEFORE_A_CCS                     154
 # define SSL_R_GOT_NEXT_PROTO_BEFORE_A_CCS                355
@@ -2318,6 +2405,7 @@ void ERR_load_SSL_strings(void);
 # define SSL_R_NO_COMPRESSION_SPECIFIED                   187
 # define SSL_R_NO_GOST_CERTIFICATE_SENT_BY_PEER           330
 # define SSL_R_NO_METHOD_SPECIFIED                        188
+# define SSL_R_NO_OCSP_FETCH_CALLBACK                     407
 # define SSL_R_NO_PEM_EXTENSIONS                          389
 # define SSL_R_NO_PRIVATE_KEY_ASSIGNED                    190
 # define SSL_R_NO_PROTOCOLS_AVAILABLE                     191
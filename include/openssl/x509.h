@@ -642,6 +642,7 @@ void X509_reject_clear(X509 *x);
 DECLARE_ASN1_FUNCTIONS(X509_REVOKED)
 DECLARE_ASN1_FUNCTIONS(X509_CRL_INFO)
 DECLARE_ASN1_FUNCTIONS(X509_CRL)
+X509_CRL *d2i_X509_CRL_lazy(X509_CRL **a, const unsigned char **in, long len);
 
 int X509_CRL_add0_revoked(X509_CRL *crl, X509_REVOKED *rev);
 int X509_CRL_get0_by_serial(X509_CRL *crl,
@@ -987,6 +988,8 @@ int EVP_PKEY_add1_attr_by_txt(EVP_PKEY *key,
                               const unsigned char *bytes, int len);
 
 int X509_verify_cert(X509_STORE_CTX *ctx);
+int X509_verify_cert_batch(X509_STORE_CTX **ctxs, int *results, int num,
+                           int threads);
 
 /* lookup a cert from a X509 STACK */
 X509 *X509_find_by_issuer_and_serial(STACK_OF(X509) *sk, X509_NAME *name,
@@ -1065,6 +1068,7 @@ void ERR_load_X509_strings(void);
 # define X509_F_ADD_CERT_DIR                              100
 # define X509_F_BY_FILE_CTRL                              101
 # define X509_F_CHECK_POLICY                              145
+# define X509_F_D2I_X509_CRL_LAZY                         149
 # define X509_F_DIR_CTRL                                  102
 # define X509_F_GET_CERT_BY_SUBJECT                       103
 # define X509_F_NETSCAPE_SPKI_B64_DECODE                  129
@@ -1104,10 +1108,12 @@ void ERR_load_X509_strings(void);
 # define X509_F_X509_STORE_CTX_INIT                       143
 # define X509_F_X509_STORE_CTX_NEW                        142
 # define X509_F_X509_STORE_CTX_PURPOSE_INHERIT            134
+# define X509_F_X509_STORE_SET_SIGCACHE_SIZE              148
 # define X509_F_X509_TO_X509_REQ                          126
 # define X509_F_X509_TRUST_ADD                            133
 # define X509_F_X509_TRUST_SET                            141
 # define X509_F_X509_VERIFY_CERT                          127
+# define X509_F_X509_VERIFY_CERT_BATCH                    150
 
 /* Reason codes. */
 # define X509_R_AKID_MISMATCH                             110
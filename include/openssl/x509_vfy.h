@@ -145,6 +145,8 @@ typedef struct x509_lookup_method_st {
 
 typedef struct X509_VERIFY_PARAM_ID_st X509_VERIFY_PARAM_ID;
 typedef struct X509_VERIFY_PARAM_st X509_VERIFY_PARAM;
+typedef struct x509_sigcache_st X509_SIGCACHE;
+typedef struct x509_store_index_st X509_STORE_INDEX;
 
 DECLARE_STACK_OF(X509_VERIFY_PARAM)
 
@@ -157,6 +159,7 @@ struct x509_store_st {
     /* The following is a cache of trusted certs */
     int cache;                  /* if true, stash any hits */
     STACK_OF(X509_OBJECT) *objs; /* Cache of all objects */
+    X509_STORE_INDEX *index;    /* Hash indexes over |objs| */
     /* These are external lookup methods */
     STACK_OF(X509_LOOKUP) *get_cert_methods;
     X509_VERIFY_PARAM *param;
@@ -182,6 +185,10 @@ struct x509_store_st {
     int (*cleanup) (X509_STORE_CTX *ctx);
     CRYPTO_EX_DATA ex_data;
     int references;
+    /* Protects |objs| and anything cached by the lookup methods */
+    CRYPTO_RWLOCK *lock;
+    /* Optional cache of successful signature checks */
+    X509_SIGCACHE *sigcache;
 } /* X509_STORE */ ;
 
 int X509_STORE_set_depth(X509_STORE *store, int depth);
@@ -263,6 +270,8 @@ struct x509_store_ctx_st {      /* X509_STORE_CTX */
     unsigned int current_reasons;
     /* For CRL path validation: parent context */
     X509_STORE_CTX *parent;
+    /* Signature cache shared with the rest of a verification batch */
+    X509_SIGCACHE *sigcache;
     CRYPTO_EX_DATA ex_data;
 } /* X509_STORE_CTX */ ;
 
@@ -275,6 +284,7 @@ void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 
 # define X509_L_FILE_LOAD        1
 # define X509_L_ADD_DIR          2
+# define X509_L_INDEX_DIRS       3
 
 # define X509_LOOKUP_load_file(x,name,type) \
                 X509_LOOKUP_ctrl((x),X509_L_FILE_LOAD,(name),(long)(type),NULL)
@@ -282,6 +292,10 @@ void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 # define X509_LOOKUP_add_dir(x,name,type) \
                 X509_LOOKUP_ctrl((x),X509_L_ADD_DIR,(name),(long)(type),NULL)
 
+# define X509_LOOKUP_index_dirs(x,interval) \
+                X509_LOOKUP_ctrl((x),X509_L_INDEX_DIRS,NULL,(long)(interval),\
+                                 NULL)
+
 # define         X509_V_OK                                       0
 /* illegal error (for uninitialized values, to avoid X509_V_OK): 1 */
 
@@ -409,6 +423,8 @@ void X509_STORE_CTX_set_depth(X509_STORE_CTX *ctx, int depth);
 # define X509_V_FLAG_NO_ALT_CHAINS               0x100000
 /* Do not check certificate/CRL validity against current time */
 # define X509_V_FLAG_NO_CHECK_TIME               0x200000
+/* Do not consult or update the store's signature cache */
+# define X509_V_FLAG_NO_SIG_CACHE                0x400000
 
 # define X509_VP_FLAG_DEFAULT                    0x1
 # define X509_VP_FLAG_OVERWRITE                  0x2
@@ -439,6 +455,10 @@ int X509_STORE_set_flags(X509_STORE *ctx, unsigned long flags);
 int X509_STORE_set_purpose(X509_STORE *ctx, int purpose);
 int X509_STORE_set_trust(X509_STORE *ctx, int trust);
 int X509_STORE_set1_param(X509_STORE *ctx, X509_VERIFY_PARAM *pm);
+int X509_STORE_set_sigcache_size(X509_STORE *store, size_t size);
+size_t X509_STORE_get_sigcache_size(X509_STORE *store);
+void X509_STORE_get_sigcache_stats(X509_STORE *store, unsigned long *hits,
+                                   unsigned long *misses);
 
 void X509_STORE_set_verify_cb(X509_STORE *ctx,
                               int (*verify_cb) (int, X509_STORE_CTX *));
@@ -64,8 +64,12 @@
 #include <openssl/bio.h>
 #include <openssl/err.h>
 #include "ssl_locl.h"
+#include "internal/refcount.h"
 
 static int ssl_write(BIO *h, const char *buf, int num);
+static int ssl_writev(BIO *h, const BIO_IOVEC *iov, int iovcnt);
+static int ssl_write_common(BIO *b, const char *out, int outl,
+                            const BIO_IOVEC *iov, int iovcnt);
 static int ssl_read(BIO *h, char *buf, int size);
 static int ssl_puts(BIO *h, const char *str);
 static long ssl_ctrl(BIO *h, int cmd, long arg1, void *arg2);
@@ -92,6 +96,7 @@ static BIO_METHOD methods_sslp = {
     ssl_new,
     ssl_free,
     ssl_callback_ctrl,
+    ssl_writev,
 };
 
 BIO_METHOD *BIO_f_ssl(void)
@@ -184,6 +189,10 @@ static int ssl_read(BIO *b, char *out, int outl)
         BIO_set_retry_special(b);
         retry_reason = BIO_RR_SSL_X509_LOOKUP;
         break;
+    case SSL_ERROR_WANT_ASYNC:
+        BIO_set_retry_special(b);
+        retry_reason = BIO_RR_ASYNC;
+        break;
     case SSL_ERROR_WANT_ACCEPT:
         BIO_set_retry_special(b);
         retry_reason = BIO_RR_ACCEPT;
@@ -204,14 +213,26 @@ static int ssl_read(BIO *b, char *out, int outl)
 }
 
 static int ssl_write(BIO *b, const char *out, int outl)
+{
+    if (out == NULL)
+        return (0);
+    return ssl_write_common(b, out, outl, NULL, 0);
+}
+
+static int ssl_writev(BIO *b, const BIO_IOVEC *iov, int iovcnt)
+{
+    return ssl_write_common(b, NULL, 0, iov, iovcnt);
+}
+
+/* Write |out| or, if |iov| is set, the buffers of |iov| */
+static int ssl_write_common(BIO *b, const char *out, int outl,
+                            const BIO_IOVEC *iov, int iovcnt)
 {
     int ret, r = 0;
     int retry_reason = 0;
     SSL *ssl;
     BIO_SSL *bs;
 
-    if (out == NULL)
-        return (0);
     bs = (BIO_SSL *)b->ptr;
     ssl = bs->ssl;
 
@@ -220,7 +241,10 @@ static int ssl_write(BIO *b, const char *out, int outl)
     /*
      * ret=SSL_do_handshake(ssl); if (ret > 0)
      */
-    ret = SSL_write(ssl, out, outl);
+    if (iov != NULL)
+        ret = SSL_writev(ssl, iov, iovcnt);
+    else
+        ret = SSL_write(ssl, out, outl);
 
     switch (SSL_get_error(ssl, ret)) {
     case SSL_ERROR_NONE:
@@ -256,6 +280,10 @@ static int ssl_write(BIO *b, const char *out, int outl)
         BIO_set_retry_special(b);
         retry_reason = BIO_RR_SSL_X509_LOOKUP;
         break;
+    case SSL_ERROR_WANT_ASYNC:
+        BIO_set_retry_special(b);
+        retry_reason = BIO_RR_ASYNC;
+        break;
     case SSL_ERROR_WANT_CONNECT:
         BIO_set_retry_special(b);
         retry_reason = BIO_RR_CONNECT;
@@ -339,7 +367,7 @@ static long ssl_ctrl(BIO *b, int cmd, long num, void *ptr)
             if (b->next_bio != NULL)
                 BIO_push(bio, b->next_bio);
             b->next_bio = bio;
-            CRYPTO_add(&bio->references, 1, CRYPTO_LOCK_BIO);
+            CRYPTO_UP_REF(&bio->references, CRYPTO_LOCK_BIO);
         }
         b->init = 1;
         break;
@@ -372,7 +400,7 @@ static long ssl_ctrl(BIO *b, int cmd, long num, void *ptr)
     case BIO_CTRL_PUSH:
         if ((b->next_bio != NULL) && (b->next_bio != ssl->rbio)) {
             SSL_set_bio(ssl, b->next_bio, b->next_bio);
-            CRYPTO_add(&b->next_bio->references, 1, CRYPTO_LOCK_BIO);
+            CRYPTO_UP_REF(&b->next_bio->references, CRYPTO_LOCK_BIO);
         }
         break;
     case BIO_CTRL_POP:
@@ -385,7 +413,7 @@ static long ssl_ctrl(BIO *b, int cmd, long num, void *ptr)
             if (ssl->rbio != ssl->wbio)
                 BIO_free_all(ssl->wbio);
             if (b->next_bio != NULL)
-                CRYPTO_add(&b->next_bio->references, -1, CRYPTO_LOCK_BIO);
+                CRYPTO_DOWN_REF(&b->next_bio->references, CRYPTO_LOCK_BIO);
             ssl->wbio = NULL;
             ssl->rbio = NULL;
         }
@@ -411,6 +439,10 @@ static long ssl_ctrl(BIO *b, int cmd, long num, void *ptr)
             BIO_set_retry_special(b);
             b->retry_reason = BIO_RR_SSL_X509_LOOKUP;
             break;
+        case SSL_ERROR_WANT_ASYNC:
+            BIO_set_retry_special(b);
+            b->retry_reason = BIO_RR_ASYNC;
+            break;
         default:
             break;
         }
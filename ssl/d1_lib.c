@@ -73,7 +73,6 @@
 # include <sys/time.h>
 #endif
 
-static void get_current_time(struct timeval *t);
 static int dtls1_set_handshake_header(SSL *s, int type, unsigned long len);
 static int dtls1_handshake_write(SSL *s);
 int dtls1_listen(SSL *s, struct sockaddr *client);
@@ -338,7 +337,7 @@ void dtls1_start_timer(SSL *s)
     }
 
     /* Set timeout to current time */
-    get_current_time(&(s->d1->next_timeout));
+    ssl_get_current_time(&(s->d1->next_timeout));
 
     /* Add duration to current time */
     s->d1->next_timeout.tv_sec += s->d1->timeout_duration;
@@ -356,7 +355,7 @@ struct timeval *dtls1_get_timeout(SSL *s, struct timeval *timeleft)
     }
 
     /* Get current time */
-    get_current_time(&timenow);
+    ssl_get_current_time(&timenow);
 
     /* If timer already expired, set remaining time to 0 */
     if (s->d1->next_timeout.tv_sec < timenow.tv_sec ||
@@ -476,7 +475,7 @@ int dtls1_handle_timeout(SSL *s)
     return dtls1_retransmit_buffered_messages(s);
 }
 
-static void get_current_time(struct timeval *t)
+void ssl_get_current_time(struct timeval *t)
 {
 #if defined(_WIN32)
     SYSTEMTIME st;
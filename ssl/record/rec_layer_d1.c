@@ -569,7 +569,9 @@ int dtls1_read_bytes(SSL *s, int type, int *recvd_type, unsigned char *buf,
         else
             n = (unsigned int)len;
 
-        memcpy(buf, &(SSL3_RECORD_get_data(rr)[SSL3_RECORD_get_off(rr)]), n);
+        if (buf != NULL)
+            memcpy(buf, &(SSL3_RECORD_get_data(rr)[SSL3_RECORD_get_off(rr)]),
+                   n);
         if (!peek) {
             SSL3_RECORD_add_length(rr, -n);
             SSL3_RECORD_add_off(rr, n);
@@ -160,6 +160,9 @@ void RECORD_LAYER_clear(RECORD_LAYER *rl)
     rl->wpend_type = 0;
     rl->wpend_ret = 0;
     rl->wpend_buf = NULL;
+    rl->rdest = NULL;
+    rl->rdestlen = 0;
+    rl->dyn_sent = 0;
 
     SSL3_BUFFER_clear(&rl->rbuf);
     SSL3_BUFFER_clear(&rl->wbuf);
@@ -433,6 +436,49 @@ int ssl3_read_n(SSL *s, int n, int max, int extend)
 }
 
 
+/*
+ * Dynamic record sizing: the payload length of the next application data
+ * record. It is dyn_record_size at the start of a burst, until
+ * dyn_record_threshold bytes have been sent, so that the peer can process
+ * the first records as soon as they arrive, and max_send_fragment after.
+ */
+static unsigned int ssl3_dyn_record_size(SSL *s)
+{
+    if (s->rlayer.dyn_sent < s->dyn_record_threshold
+            && s->dyn_record_size < s->max_send_fragment)
+        return s->dyn_record_size;
+    return s->max_send_fragment;
+}
+
+/* Start a new burst if nothing was sent for dyn_record_timeout ms */
+static void ssl3_dyn_record_start(SSL *s)
+{
+    RECORD_LAYER *rl = &s->rlayer;
+    struct timeval now;
+    long secs;
+
+    if (s->dyn_record_threshold == 0 || rl->dyn_sent == 0)
+        return;
+    ssl_get_current_time(&now);
+    secs = (long)(now.tv_sec - rl->dyn_last.tv_sec);
+    if (secs < 0 || secs > (long)(s->dyn_record_timeout / 1000) + 1
+            || secs * 1000 + (now.tv_usec - rl->dyn_last.tv_usec) / 1000
+               > (long)s->dyn_record_timeout)
+        rl->dyn_sent = 0;
+}
+
+/* Account for |n| bytes of application data just sent */
+static void ssl3_dyn_record_sent(SSL *s, unsigned int n)
+{
+    RECORD_LAYER *rl = &s->rlayer;
+
+    if (s->dyn_record_threshold == 0)
+        return;
+    if (rl->dyn_sent < s->dyn_record_threshold)
+        rl->dyn_sent += n;
+    ssl_get_current_time(&rl->dyn_last);
+}
+
 /*
  * Call this to write data in records of type 'type' It will return <= 0 if
  * not all data has been sent or non-blocking IO.
@@ -441,7 +487,7 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 {
     const unsigned char *buf = buf_;
     int tot;
-    unsigned int n, nw;
+    unsigned int n, nw, frag;
 #if !defined(OPENSSL_NO_MULTIBLOCK) && EVP_CIPH_FLAG_TLS1_1_MULTIBLOCK
     unsigned int max_send_fragment;
     unsigned int u_len = (unsigned int)len;
@@ -483,6 +529,9 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
         return (-1);
     }
 
+    if (type == SSL3_RT_APPLICATION_DATA)
+        ssl3_dyn_record_start(s);
+
     /*
      * first check if there is a SSL3_BUFFER still being written out.  This
      * will happen with non blocking IO
@@ -502,9 +551,15 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
      * better performance. Downside is that it has to allocate
      * jumbo buffer to accomodate up to 8 records, but the
      * compromise is considered worthy.
+     *
+     * Only the stitched AES-CBC-HMAC-SHA ciphers take this path. AES-GCM
+     * is deliberately left out: its single-record code already overlaps
+     * CTR and GHASH within each record, and spreading that work across
+     * several records in C measured slower, not faster.
      */
     if (type == SSL3_RT_APPLICATION_DATA &&
         u_len >= 4 * (max_send_fragment = s->max_send_fragment) &&
+        ssl3_dyn_record_size(s) == max_send_fragment &&
         s->compress == NULL && s->msg_callback == NULL &&
         !SSL_USE_ETM(s) && SSL_USE_EXPLICIT_IV(s) &&
         EVP_CIPHER_flags(s->enc_write_ctx->cipher) &
@@ -536,16 +591,14 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
             }
             wb->len = packlen;
         } else if (tot == len) { /* done? */
-            OPENSSL_free(wb->buf); /* free jumbo buffer */
-            wb->buf = NULL;
+            ssl3_release_write_buffer(s); /* free jumbo buffer */
             return tot;
         }
 
         n = (len - tot);
         for (;;) {
             if (n < 4 * max_send_fragment) {
-                OPENSSL_free(wb->buf); /* free jumbo buffer */
-                wb->buf = NULL;
+                ssl3_release_write_buffer(s); /* free jumbo buffer */
                 break;
             }
 
@@ -577,8 +630,7 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
                                           sizeof(mb_param), &mb_param);
 
             if (packlen <= 0 || packlen > (int)wb->len) { /* never happens */
-                OPENSSL_free(wb->buf); /* free jumbo buffer */
-                wb->buf = NULL;
+                ssl3_release_write_buffer(s); /* free jumbo buffer */
                 break;
             }
 
@@ -608,15 +660,13 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
             i = ssl3_write_pending(s, type, &buf[tot], nw);
             if (i <= 0) {
                 if (i < 0 && (!s->wbio || !BIO_should_retry(s->wbio))) {
-                    OPENSSL_free(wb->buf);
-                    wb->buf = NULL;
+                    ssl3_release_write_buffer(s);
                 }
                 s->rlayer.wnum = tot;
                 return i;
             }
             if (i == (int)n) {
-                OPENSSL_free(wb->buf); /* free jumbo buffer */
-                wb->buf = NULL;
+                ssl3_release_write_buffer(s); /* free jumbo buffer */
                 return tot + i;
             }
             n -= i;
@@ -633,8 +683,12 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
 
     n = (len - tot);
     for (;;) {
-        if (n > s->max_send_fragment)
-            nw = s->max_send_fragment;
+        if (type == SSL3_RT_APPLICATION_DATA)
+            frag = ssl3_dyn_record_size(s);
+        else
+            frag = s->max_send_fragment;
+        if (n > frag)
+            nw = frag;
         else
             nw = n;
 
@@ -666,107 +720,51 @@ int ssl3_write_bytes(SSL *s, int type, const void *buf_, int len)
     }
 }
 
-int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
-                  unsigned int len, int create_empty_fragment)
+/*
+ * Length of the explicit IV in front of the payload of each record written
+ * with the current cipher
+ */
+static int ssl3_write_eivlen(SSL *s)
 {
-    unsigned char *p, *plen;
-    int i, mac_size, clear = 0;
-    int prefix_len = 0;
-    int eivlen;
-    size_t align = 0;
-    SSL3_RECORD *wr;
-    SSL3_BUFFER *wb = &s->rlayer.wbuf;
-    SSL_SESSION *sess;
-
-    /*
-     * first check if there is a SSL3_BUFFER still being written out.  This
-     * will happen with non blocking IO
-     */
-    if (SSL3_BUFFER_get_left(wb) != 0)
-        return (ssl3_write_pending(s, type, buf, len));
+    int eivlen = 0;
 
-    /* If we have an alert to send, lets send it */
-    if (s->s3->alert_dispatch) {
-        i = s->method->ssl_dispatch_alert(s);
-        if (i <= 0)
-            return (i);
-        /* if it went, fall through and send more stuff */
+    /* Explicit IV length, block ciphers appropriate version flag */
+    if (s->enc_write_ctx && SSL_USE_EXPLICIT_IV(s)) {
+        int mode = EVP_CIPHER_CTX_mode(s->enc_write_ctx);
+        if (mode == EVP_CIPH_CBC_MODE) {
+            eivlen = EVP_CIPHER_CTX_iv_length(s->enc_write_ctx);
+            if (eivlen <= 1)
+                eivlen = 0;
+        }
+        /* Need explicit part of IV for GCM mode */
+        else if (mode == EVP_CIPH_GCM_MODE)
+            eivlen = EVP_GCM_TLS_EXPLICIT_IV_LEN;
+        else if (mode == EVP_CIPH_CCM_MODE)
+            eivlen = EVP_CCM_TLS_EXPLICIT_IV_LEN;
     }
+    return eivlen;
+}
 
-    if (!SSL3_BUFFER_is_initialised(wb))
-        if (!ssl3_setup_write_buffer(s))
-            return -1;
-
-    if (len == 0 && !create_empty_fragment)
-        return 0;
-
-    wr = &s->rlayer.wrec;
-    sess = s->session;
+/*
+ * Build a |type| record of the |len| bytes at |buf| at |p| in the write
+ * buffer. |buf| may also be where the payload goes, after the header and
+ * the explicit IV. Returns the length of the record, or -1 on error.
+ */
+static int ssl3_seal_record(SSL *s, int type, unsigned char *p,
+                            const unsigned char *buf, unsigned int len)
+{
+    unsigned char *plen;
+    int mac_size, eivlen;
+    SSL3_RECORD *wr = &s->rlayer.wrec;
 
-    if ((sess == NULL) ||
+    if ((s->session == NULL) ||
         (s->enc_write_ctx == NULL) ||
         (EVP_MD_CTX_md(s->write_hash) == NULL)) {
-        clear = s->enc_write_ctx ? 0 : 1; /* must be AEAD cipher */
         mac_size = 0;
     } else {
         mac_size = EVP_MD_CTX_size(s->write_hash);
         if (mac_size < 0)
-            goto err;
-    }
-
-    /*
-     * 'create_empty_fragment' is true only when this function calls itself
-     */
-    if (!clear && !create_empty_fragment && !s->s3->empty_fragment_done) {
-        /*
-         * countermeasure against known-IV weakness in CBC ciphersuites (see
-         * http://www.openssl.org/~bodo/tls-cbc.txt)
-         */
-
-        if (s->s3->need_empty_fragments && type == SSL3_RT_APPLICATION_DATA) {
-            /*
-             * recursive function call with 'create_empty_fragment' set; this
-             * prepares and buffers the data for an empty fragment (these
-             * 'prefix_len' bytes are sent out later together with the actual
-             * payload)
-             */
-            prefix_len = do_ssl3_write(s, type, buf, 0, 1);
-            if (prefix_len <= 0)
-                goto err;
-
-            if (prefix_len >
-                (SSL3_RT_HEADER_LENGTH + SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD))
-            {
-                /* insufficient space */
-                SSLerr(SSL_F_DO_SSL3_WRITE, ERR_R_INTERNAL_ERROR);
-                goto err;
-            }
-        }
-
-        s->s3->empty_fragment_done = 1;
-    }
-
-    if (create_empty_fragment) {
-#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
-        /*
-         * extra fragment would be couple of cipher blocks, which would be
-         * multiple of SSL3_ALIGN_PAYLOAD, so if we want to align the real
-         * payload, then we can just pretent we simply have two headers.
-         */
-        align = (size_t)SSL3_BUFFER_get_buf(wb) + 2 * SSL3_RT_HEADER_LENGTH;
-        align = (0-align) & (SSL3_ALIGN_PAYLOAD - 1);
-#endif
-        p = SSL3_BUFFER_get_buf(wb) + align;
-        SSL3_BUFFER_set_offset(wb, align);
-    } else if (prefix_len) {
-        p = SSL3_BUFFER_get_buf(wb) + SSL3_BUFFER_get_offset(wb) + prefix_len;
-    } else {
-#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
-        align = (size_t)SSL3_BUFFER_get_buf(wb) + SSL3_RT_HEADER_LENGTH;
-        align = (0-align) & (SSL3_ALIGN_PAYLOAD - 1);
-#endif
-        p = SSL3_BUFFER_get_buf(wb) + align;
-        SSL3_BUFFER_set_offset(wb, align);
+            return -1;
     }
 
     /* write the header */
@@ -788,23 +786,7 @@ int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
     /* field where we are to write out packet length */
     plen = p;
     p += 2;
-    /* Explicit IV length, block ciphers appropriate version flag */
-    if (s->enc_write_ctx && SSL_USE_EXPLICIT_IV(s)) {
-        int mode = EVP_CIPHER_CTX_mode(s->enc_write_ctx);
-        if (mode == EVP_CIPH_CBC_MODE) {
-            eivlen = EVP_CIPHER_CTX_iv_length(s->enc_write_ctx);
-            if (eivlen <= 1)
-                eivlen = 0;
-        }
-        /* Need explicit part of IV for GCM mode */
-        else if (mode == EVP_CIPH_GCM_MODE)
-            eivlen = EVP_GCM_TLS_EXPLICIT_IV_LEN;
-        else if (mode == EVP_CIPH_CCM_MODE)
-            eivlen = EVP_CCM_TLS_EXPLICIT_IV_LEN;
-        else
-            eivlen = 0;
-    } else
-        eivlen = 0;
+    eivlen = ssl3_write_eivlen(s);
 
     /* lets setup the record stuff. */
     SSL3_RECORD_set_data(wr, p + eivlen);
@@ -820,10 +802,11 @@ int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
     if (s->compress != NULL) {
         if (!ssl3_do_compress(s)) {
             SSLerr(SSL_F_DO_SSL3_WRITE, SSL_R_COMPRESSION_FAILURE);
-            goto err;
+            return -1;
         }
     } else {
-        memcpy(wr->data, wr->input, wr->length);
+        if (wr->data != wr->input)
+            memcpy(wr->data, wr->input, wr->length);
         SSL3_RECORD_reset_input(wr);
     }
 
@@ -835,7 +818,7 @@ int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
 
     if (!SSL_USE_ETM(s) && mac_size != 0) {
         if (s->method->ssl3_enc->mac(s, &(p[wr->length + eivlen]), 1) < 0)
-            goto err;
+            return -1;
         SSL3_RECORD_add_length(wr, mac_size);
     }
 
@@ -850,11 +833,11 @@ int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
     }
 
     if (s->method->ssl3_enc->enc(s, 1) < 1)
-        goto err;
+        return -1;
 
     if (SSL_USE_ETM(s) && mac_size != 0) {
         if (s->method->ssl3_enc->mac(s, p + wr->length, 1) < 0)
-            goto err;
+            return -1;
         SSL3_RECORD_add_length(wr, mac_size);
     }
 
@@ -872,16 +855,117 @@ int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
     SSL3_RECORD_set_type(wr, type);  /* not needed but helps for debugging */
     SSL3_RECORD_add_length(wr, SSL3_RT_HEADER_LENGTH);
 
+    return SSL3_RECORD_get_length(wr);
+}
+
+int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
+                  unsigned int len, int create_empty_fragment)
+{
+    unsigned char *p;
+    int i, clear = 0;
+    int prefix_len = 0;
+    size_t align = 0;
+    SSL3_BUFFER *wb = &s->rlayer.wbuf;
+    SSL_SESSION *sess;
+
+    /*
+     * first check if there is a SSL3_BUFFER still being written out.  This
+     * will happen with non blocking IO
+     */
+    if (SSL3_BUFFER_get_left(wb) != 0)
+        return (ssl3_write_pending(s, type, buf, len));
+
+    /* If we have an alert to send, lets send it */
+    if (s->s3->alert_dispatch) {
+        i = s->method->ssl_dispatch_alert(s);
+        if (i <= 0)
+            return (i);
+        /* if it went, fall through and send more stuff */
+    }
+
+    if (!SSL3_BUFFER_is_initialised(wb))
+        if (!ssl3_setup_write_buffer(s))
+            return -1;
+
+    if (len == 0 && !create_empty_fragment)
+        return 0;
+
+    sess = s->session;
+
+    if ((sess == NULL) ||
+        (s->enc_write_ctx == NULL) ||
+        (EVP_MD_CTX_md(s->write_hash) == NULL))
+        clear = s->enc_write_ctx ? 0 : 1; /* must be AEAD cipher */
+
+    /*
+     * 'create_empty_fragment' is true only when this function calls itself
+     */
+    if (!clear && !create_empty_fragment && !s->s3->empty_fragment_done) {
+        /*
+         * countermeasure against known-IV weakness in CBC ciphersuites (see
+         * http://www.openssl.org/~bodo/tls-cbc.txt)
+         */
+
+        if (s->s3->need_empty_fragments && type == SSL3_RT_APPLICATION_DATA) {
+            /*
+             * recursive function call with 'create_empty_fragment' set; this
+             * prepares and buffers the data for an empty fragment (these
+             * 'prefix_len' bytes are sent out later together with the actual
+             * payload)
+             */
+            prefix_len = do_ssl3_write(s, type, buf, 0, 1);
+            if (prefix_len <= 0)
+                goto err;
+
+            if (prefix_len >
+                (SSL3_RT_HEADER_LENGTH + SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD))
+            {
+                /* insufficient space */
+                SSLerr(SSL_F_DO_SSL3_WRITE, ERR_R_INTERNAL_ERROR);
+                goto err;
+            }
+        }
+
+        s->s3->empty_fragment_done = 1;
+    }
+
+    if (create_empty_fragment) {
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
+        /*
+         * extra fragment would be couple of cipher blocks, which would be
+         * multiple of SSL3_ALIGN_PAYLOAD, so if we want to align the real
+         * payload, then we can just pretent we simply have two headers.
+         */
+        align = (size_t)SSL3_BUFFER_get_buf(wb) + 2 * SSL3_RT_HEADER_LENGTH;
+        align = (0-align) & (SSL3_ALIGN_PAYLOAD - 1);
+#endif
+        p = SSL3_BUFFER_get_buf(wb) + align;
+        SSL3_BUFFER_set_offset(wb, align);
+    } else if (prefix_len) {
+        p = SSL3_BUFFER_get_buf(wb) + SSL3_BUFFER_get_offset(wb) + prefix_len;
+    } else {
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
+        align = (size_t)SSL3_BUFFER_get_buf(wb) + SSL3_RT_HEADER_LENGTH;
+        align = (0-align) & (SSL3_ALIGN_PAYLOAD - 1);
+#endif
+        p = SSL3_BUFFER_get_buf(wb) + align;
+        SSL3_BUFFER_set_offset(wb, align);
+    }
+
+    i = ssl3_seal_record(s, type, p, buf, len);
+    if (i < 0)
+        goto err;
+
     if (create_empty_fragment) {
         /*
          * we are in a recursive call; just return the length, don't write
          * out anything here
          */
-        return SSL3_RECORD_get_length(wr);
+        return i;
     }
 
     /* now let's set up wb */
-    SSL3_BUFFER_set_left(wb, prefix_len + SSL3_RECORD_get_length(wr));
+    SSL3_BUFFER_set_left(wb, prefix_len + i);
 
     /*
      * memorize arguments so that ssl3_write_pending can detect bad write
@@ -898,6 +982,199 @@ int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
     return -1;
 }
 
+/*
+ * Copy |len| bytes, starting |off| bytes into the data of the |iovcnt|
+ * buffers at |iov|, to |dst|
+ */
+static void ssl3_iov_gather(unsigned char *dst, const BIO_IOVEC *iov,
+                            int iovcnt, size_t off, size_t len)
+{
+    int i;
+    size_t n;
+
+    for (i = 0; i < iovcnt && len > 0; i++) {
+        n = iov[i].len;
+        if (off >= n) {
+            off -= n;
+            continue;
+        }
+        n -= off;
+        if (n > len)
+            n = len;
+        memcpy(dst, (const unsigned char *)iov[i].base + off, n);
+        dst += n;
+        len -= n;
+        off = 0;
+    }
+}
+
+/*
+ * Write the |iovcnt| buffers at |iov| as application data. Records are
+ * filled regardless of where the buffers start and end, and the data is
+ * gathered straight into the record payloads. Up to
+ * SSL3_WRITEV_MAX_RECORDS records are built back to back in the write
+ * buffer, which grows to hold them, and written out together. Like
+ * ssl3_write_bytes() this returns <= 0 if not all data has been sent, and
+ * must then be called again with the same |iov|.
+ */
+int ssl3_writev_bytes(SSL *s, const BIO_IOVEC *iov, int iovcnt)
+{
+    const unsigned char *id = (const unsigned char *)iov;
+    SSL3_BUFFER *wb = &s->rlayer.wbuf;
+    unsigned int max_frag = s->max_send_fragment;
+    unsigned int n, nw, nrec, done, k, frag;
+    size_t total = 0, reclen, need, align = 0;
+    unsigned char *p, *q, *scratch;
+    int i, len, tot, eivlen, empty;
+
+    if (iovcnt < 0) {
+        SSLerr(SSL_F_SSL3_WRITEV_BYTES, SSL_R_SSL_NEGATIVE_LENGTH);
+        return -1;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].len > (size_t)INT_MAX - total) {
+            SSLerr(SSL_F_SSL3_WRITEV_BYTES, SSL_R_BAD_LENGTH);
+            return -1;
+        }
+        total += iov[i].len;
+    }
+    len = (int)total;
+
+    s->rwstate = SSL_NOTHING;
+    OPENSSL_assert(s->rlayer.wnum <= INT_MAX);
+    tot = s->rlayer.wnum;
+    s->rlayer.wnum = 0;
+
+    if (SSL_in_init(s) && !ossl_statem_get_in_handshake(s)) {
+        i = s->handshake_func(s);
+        if (i < 0)
+            return (i);
+        if (i == 0) {
+            SSLerr(SSL_F_SSL3_WRITEV_BYTES, SSL_R_SSL_HANDSHAKE_FAILURE);
+            return -1;
+        }
+    }
+
+    /* see ssl3_write_bytes() */
+    if (len < tot) {
+        SSLerr(SSL_F_SSL3_WRITEV_BYTES, SSL_R_BAD_LENGTH);
+        return (-1);
+    }
+
+    /* one record's worth of write buffer */
+    reclen = SSL3_RT_HEADER_LENGTH + max_frag
+        + SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD;
+#ifndef OPENSSL_NO_COMP
+    if (s->compress != NULL)
+        reclen += SSL3_RT_MAX_COMPRESSED_OVERHEAD;
+#endif
+
+    ssl3_dyn_record_start(s);
+
+    if (wb->left != 0) {
+        i = ssl3_write_pending(s, SSL3_RT_APPLICATION_DATA, id,
+                               s->rlayer.wpend_tot);
+        if (i <= 0) {
+            s->rlayer.wnum = tot;
+            return i;
+        }
+        tot += i;
+    }
+
+    for (;;) {
+        if (tot == len) {
+            s->s3->empty_fragment_done = 0;
+            /* don't keep a buffer grown for several records */
+            if ((s->mode & SSL_MODE_RELEASE_BUFFERS) || wb->len >= 2 * reclen)
+                ssl3_release_write_buffer(s);
+            return tot;
+        }
+
+        if (s->s3->alert_dispatch) {
+            i = s->method->ssl_dispatch_alert(s);
+            if (i <= 0) {
+                s->rlayer.wnum = tot;
+                return i;
+            }
+        }
+
+        n = len - tot;
+        frag = ssl3_dyn_record_size(s);
+        nrec = (n - 1) / frag + 1;
+        if (nrec > SSL3_WRITEV_MAX_RECORDS)
+            nrec = SSL3_WRITEV_MAX_RECORDS;
+        /* countermeasure against known-IV weakness, see do_ssl3_write() */
+        empty = s->enc_write_ctx != NULL && !s->s3->empty_fragment_done
+            && s->s3->need_empty_fragments;
+
+        need = nrec * reclen;
+        if (empty)
+            need += SSL3_RT_HEADER_LENGTH + SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD;
+        /* compression needs the plaintext of a record gathered elsewhere */
+        if (s->compress != NULL)
+            need += max_frag;
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
+        need += SSL3_ALIGN_PAYLOAD - 1;
+#endif
+        if (wb->buf == NULL || wb->len < need) {
+            ssl3_release_write_buffer(s);
+            if ((wb->buf = OPENSSL_malloc(need)) == NULL) {
+                SSLerr(SSL_F_SSL3_WRITEV_BYTES, ERR_R_MALLOC_FAILURE);
+                return -1;
+            }
+            wb->len = need;
+        }
+
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
+        /* align the payload of the first record with data */
+        align = (size_t)wb->buf + (empty ? 2 : 1) * SSL3_RT_HEADER_LENGTH;
+        align = (0-align) & (SSL3_ALIGN_PAYLOAD - 1);
+#endif
+        p = wb->buf + align;
+        wb->offset = align;
+        scratch = s->compress != NULL ? wb->buf + wb->len - max_frag : NULL;
+        eivlen = ssl3_write_eivlen(s);
+
+        if (empty) {
+            i = ssl3_seal_record(s, SSL3_RT_APPLICATION_DATA, p,
+                                 p + SSL3_RT_HEADER_LENGTH + eivlen, 0);
+            if (i < 0)
+                return -1;
+            p += i;
+        }
+        if (s->enc_write_ctx != NULL)
+            s->s3->empty_fragment_done = 1;
+
+        for (k = 0, done = 0; k < nrec; k++, done += nw) {
+            nw = n - done > frag ? frag : n - done;
+            q = scratch != NULL ? scratch : p + SSL3_RT_HEADER_LENGTH + eivlen;
+            ssl3_iov_gather(q, iov, iovcnt, tot + done, nw);
+            i = ssl3_seal_record(s, SSL3_RT_APPLICATION_DATA, p, q, nw);
+            if (i < 0)
+                return -1;
+            p += i;
+        }
+
+        wb->left = p - (wb->buf + wb->offset);
+        s->rlayer.wpend_tot = done;
+        s->rlayer.wpend_buf = id;
+        s->rlayer.wpend_type = SSL3_RT_APPLICATION_DATA;
+        s->rlayer.wpend_ret = done;
+
+        i = ssl3_write_pending(s, SSL3_RT_APPLICATION_DATA, id, done);
+        if (i <= 0) {
+            s->rlayer.wnum = tot;
+            return i;
+        }
+        tot += i;
+
+        if (tot != len && (s->mode & SSL_MODE_ENABLE_PARTIAL_WRITE)) {
+            s->s3->empty_fragment_done = 0;
+            return tot;
+        }
+    }
+}
+
 /* if s->s3->wbuf.left != 0, we need to call this */
 int ssl3_write_pending(SSL *s, int type, const unsigned char *buf,
                        unsigned int len)
@@ -929,6 +1206,8 @@ int ssl3_write_pending(SSL *s, int type, const unsigned char *buf,
             SSL3_BUFFER_set_left(wb, 0);
             SSL3_BUFFER_add_offset(wb, i);
             s->rwstate = SSL_NOTHING;
+            if (type == SSL3_RT_APPLICATION_DATA)
+                ssl3_dyn_record_sent(s, s->rlayer.wpend_ret);
             return (s->rlayer.wpend_ret);
         } else if (i <= 0) {
             if (SSL_IS_DTLS(s)) {
@@ -1049,7 +1328,15 @@ int ssl3_read_bytes(SSL *s, int type, int *recvd_type, unsigned char *buf,
     /* get new packet if necessary */
     if ((SSL3_RECORD_get_length(rr) == 0)
             || (s->rlayer.rstate == SSL_ST_READ_BODY)) {
+        /*
+         * An application data record may be decrypted straight into |buf|
+         * if it fits, unless we are only peeking at it.
+         */
+        if (type == SSL3_RT_APPLICATION_DATA && !peek && buf != NULL
+                && len > 0 && !SSL_in_init(s))
+            RECORD_LAYER_set_rdest(&s->rlayer, buf, len);
         ret = ssl3_get_record(s);
+        RECORD_LAYER_set_rdest(&s->rlayer, NULL, 0);
         if (ret <= 0)
             return (ret);
     }
@@ -1112,14 +1399,23 @@ int ssl3_read_bytes(SSL *s, int type, int *recvd_type, unsigned char *buf,
         else
             n = (unsigned int)len;
 
-        memcpy(buf, &(rr->data[rr->off]), n);
+        /*
+         * |buf| is NULL when SSL_peek_ptr() and SSL_read_ptr() only want to
+         * know how much there is, or consume it
+         */
+        if (buf != NULL && buf != &(rr->data[rr->off]))
+            memcpy(buf, &(rr->data[rr->off]), n);
         if (!peek) {
             SSL3_RECORD_add_length(rr, -n);
             SSL3_RECORD_add_off(rr, n);
             if (SSL3_RECORD_get_length(rr) == 0) {
                 s->rlayer.rstate = SSL_ST_READ_HEADER;
                 SSL3_RECORD_set_off(rr, 0);
-                if (s->mode & SSL_MODE_RELEASE_BUFFERS
+                /*
+                 * The data SSL_read_ptr() points to stays in the read buffer
+                 * until the next read
+                 */
+                if (s->mode & SSL_MODE_RELEASE_BUFFERS && buf != NULL
                     && SSL3_BUFFER_get_left(&s->rlayer.rbuf) == 0)
                     ssl3_release_read_buffer(s);
             }
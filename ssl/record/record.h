@@ -127,10 +127,25 @@ typedef struct ssl3_buffer_st {
     int offset;
     /* how many bytes left */
     int left;
+    /* size to allocate instead of the minimum, if larger */
+    size_t default_len;
+    /* buf was borrowed from the SSL_CTX buffer pool */
+    int pooled;
 } SSL3_BUFFER;
 
+typedef struct ssl3_buffer_pool_st SSL3_BUFFER_POOL;
+
 #define SEQ_NUM_SIZE                            8
 
+/*
+ * Defaults for dynamic record sizing: the payload of the records that start
+ * a burst, small enough for a record of any cipher suite to fit one TCP
+ * segment over IPv6 with timestamps on a 1500 byte MTU path, and the idle
+ * time in milliseconds after which the next write starts a new burst.
+ */
+#define SSL3_DYN_RECORD_SIZE                    1340
+#define SSL3_DYN_RECORD_TIMEOUT                 1000
+
 typedef struct ssl3_record_st {
     /* Record layer version */
     /* r */
@@ -263,6 +278,18 @@ typedef struct record_layer_st {
     SSL3_RECORD rrec;
     /* goes out from here */
     SSL3_RECORD wrec;
+    /*
+     * caller's buffer that the next application data record may be
+     * decrypted straight into instead of the read buffer, see tls1_enc()
+     */
+    unsigned char *rdest;
+    unsigned int rdestlen;
+    /*
+     * application data sent in the current burst, up to the dynamic record
+     * sizing threshold, and when it was last sent
+     */
+    unsigned long dyn_sent;
+    struct timeval dyn_last;
 
     /* used internally to point at a raw packet */
     unsigned char *packet;
@@ -306,7 +333,11 @@ typedef struct record_layer_st {
 
 #define RECORD_LAYER_set_read_ahead(rl, ra)     ((rl)->read_ahead = (ra))
 #define RECORD_LAYER_get_read_ahead(rl)         ((rl)->read_ahead)
+#define RECORD_LAYER_set_default_read_buffer_len(rl, len) \
+                                                ((rl)->rbuf.default_len = (len))
 #define RECORD_LAYER_get_packet(rl)             ((rl)->packet)
+#define RECORD_LAYER_get_rrec_data(rl) \
+                                    (&(rl)->rrec.data[(rl)->rrec.off])
 #define RECORD_LAYER_get_packet_length(rl)      ((rl)->packet_length)
 #define RECORD_LAYER_add_packet_length(rl, inc) ((rl)->packet_length += (inc))
 #define DTLS_RECORD_LAYER_get_w_epoch(rl)       ((rl)->d->w_epoch)
@@ -327,8 +358,12 @@ void RECORD_LAYER_reset_write_sequence(RECORD_LAYER *rl);
 int RECORD_LAYER_setup_comp_buffer(RECORD_LAYER *rl);
 int RECORD_LAYER_is_sslv2_record(RECORD_LAYER *rl);
 unsigned int RECORD_LAYER_get_rrec_length(RECORD_LAYER *rl);
+SSL3_BUFFER_POOL *ssl3_buffer_pool_new(void);
+void ssl3_buffer_pool_free(SSL3_BUFFER_POOL *pool);
+long ssl3_buffer_pool_ctrl(SSL_CTX *ctx, int cmd, long larg);
 __owur int ssl3_pending(const SSL *s);
 __owur int ssl3_write_bytes(SSL *s, int type, const void *buf, int len);
+__owur int ssl3_writev_bytes(SSL *s, const BIO_IOVEC *iov, int iovcnt);
 __owur int do_ssl3_write(SSL *s, int type, const unsigned char *buf,
                          unsigned int len, int create_empty_fragment);
 __owur int ssl3_read_bytes(SSL *s, int type, int *recvd_type,
@@ -123,6 +123,12 @@
 #define RECORD_LAYER_get_wbuf(rl)               (&(rl)->wbuf)
 #define RECORD_LAYER_get_rrec(rl)               (&(rl)->rrec)
 #define RECORD_LAYER_get_wrec(rl)               (&(rl)->wrec)
+
+/* Most records ssl3_writev_bytes() builds before writing them out */
+#define SSL3_WRITEV_MAX_RECORDS                 8
+
+#define RECORD_LAYER_set_rdest(rl, d, l)        ((rl)->rdest = (d), \
+                                                 (rl)->rdestlen = (l))
 #define RECORD_LAYER_set_packet(rl, p)          ((rl)->packet = (p))
 #define RECORD_LAYER_reset_packet_length(rl)    ((rl)->packet_length = 0)
 #define RECORD_LAYER_get_rstate(rl)             ((rl)->rstate)
@@ -112,6 +112,285 @@
 #include "../ssl_locl.h"
 #include "record_locl.h"
 
+#if defined(OPENSSL_SYS_LINUX) || defined(OPENSSL_SYS_UNIX)
+# define POOL_MMAP
+# include <sys/mman.h>
+#endif
+
+/*
+ * Size of a pooled buffer: enough to read or write a TLS record of the
+ * maximum length, with compression allowed but no extra space.
+ */
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD!=0
+# define POOL_ALIGN SSL3_ALIGN_PAYLOAD
+#else
+# define POOL_ALIGN 0
+#endif
+#ifndef OPENSSL_NO_COMP
+# define POOL_COMP_OVERHEAD SSL3_RT_MAX_COMPRESSED_OVERHEAD
+#else
+# define POOL_COMP_OVERHEAD 0
+#endif
+#define POOL_BUFFER_LEN (SSL3_RT_MAX_PLAIN_LENGTH \
+                         + SSL3_RT_MAX_ENCRYPTED_OVERHEAD \
+                         + SSL3_RT_HEADER_LENGTH + POOL_ALIGN \
+                         + POOL_COMP_OVERHEAD)
+/* Distance between buffers in an arena */
+#define POOL_BUFFER_STRIDE ((POOL_BUFFER_LEN + 63) & ~(size_t)63)
+#define POOL_HUGE_PAGE     (2 * 1024 * 1024)
+
+/* An idle buffer in a pool holds the link to the next one */
+typedef struct pool_item_st {
+    struct pool_item_st *next;
+} POOL_ITEM;
+
+struct ssl3_buffer_pool_st {
+    CRYPTO_RWLOCK *lock;
+    /* set once the application has configured the pool */
+    int enabled;
+    POOL_ITEM *idle;
+    /* number of buffers on |idle| */
+    size_t size;
+    /* most heap allocated buffers to keep on |idle| */
+    size_t max;
+    /* buffers currently lent to connections and the most there ever were */
+    size_t in_use;
+    size_t high_water;
+    /* buffers taken from |idle| and buffers that had to be allocated */
+    unsigned long hits;
+    unsigned long misses;
+    /* preallocated buffers, which are never freed until the pool is */
+    unsigned char *arena;
+    size_t arena_len;
+    int arena_mapped;
+};
+
+SSL3_BUFFER_POOL *ssl3_buffer_pool_new(void)
+{
+    SSL3_BUFFER_POOL *pool = OPENSSL_zalloc(sizeof(*pool));
+
+    if (pool == NULL)
+        return NULL;
+    pool->lock = CRYPTO_THREAD_lock_new();
+    if (pool->lock == NULL) {
+        OPENSSL_free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+static int buffer_pool_in_arena(SSL3_BUFFER_POOL *pool,
+                                const unsigned char *p)
+{
+    return pool->arena != NULL && p >= pool->arena
+        && p < pool->arena + pool->arena_len;
+}
+
+void ssl3_buffer_pool_free(SSL3_BUFFER_POOL *pool)
+{
+    POOL_ITEM *item, *next;
+
+    if (pool == NULL)
+        return;
+    for (item = pool->idle; item != NULL; item = next) {
+        next = item->next;
+        if (!buffer_pool_in_arena(pool, (unsigned char *)item))
+            OPENSSL_free(item);
+    }
+#ifdef POOL_MMAP
+    if (pool->arena_mapped)
+        munmap(pool->arena, pool->arena_len);
+    else
+#endif
+        OPENSSL_free(pool->arena);
+    CRYPTO_THREAD_lock_free(pool->lock);
+    OPENSSL_free(pool);
+}
+
+/*
+ * Set up an arena of |num| buffers, on huge pages if the system lets us, and
+ * put them on the idle list of |pool|.
+ */
+static int buffer_pool_set_arena(SSL3_BUFFER_POOL *pool, size_t num)
+{
+    unsigned char *arena = NULL;
+    size_t i, len;
+    int mapped = 0;
+
+    if (num == 0
+            || num > (((size_t)-1) - POOL_HUGE_PAGE) / POOL_BUFFER_STRIDE)
+        return 0;
+    len = num * POOL_BUFFER_STRIDE;
+
+#ifdef POOL_MMAP
+    {
+        size_t hlen = (len + POOL_HUGE_PAGE - 1) & ~(size_t)(POOL_HUGE_PAGE - 1);
+        void *map = MAP_FAILED;
+
+# ifdef MAP_HUGETLB
+        map = mmap(NULL, hlen, PROT_READ | PROT_WRITE,
+                   MAP_ANON | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+# endif
+        if (map == MAP_FAILED) {
+            /* No reserved huge pages: ask for transparent ones instead */
+            map = mmap(NULL, hlen, PROT_READ | PROT_WRITE,
+                       MAP_ANON | MAP_PRIVATE, -1, 0);
+# ifdef MADV_HUGEPAGE
+            if (map != MAP_FAILED)
+                madvise(map, hlen, MADV_HUGEPAGE);
+# endif
+        }
+        if (map != MAP_FAILED) {
+            arena = map;
+            len = hlen;
+            mapped = 1;
+        }
+    }
+#endif
+    if (arena == NULL && (arena = OPENSSL_malloc(len)) == NULL)
+        return 0;
+
+    CRYPTO_THREAD_write_lock(pool->lock);
+    if (pool->arena != NULL) {
+        /* Lost the race against another caller: only one arena per pool */
+        CRYPTO_THREAD_unlock(pool->lock);
+#ifdef POOL_MMAP
+        if (mapped)
+            munmap(arena, len);
+        else
+#endif
+            OPENSSL_free(arena);
+        return 0;
+    }
+    pool->enabled = 1;
+    pool->arena = arena;
+    pool->arena_len = len;
+    pool->arena_mapped = mapped;
+    for (i = 0; i + POOL_BUFFER_STRIDE <= len; i += POOL_BUFFER_STRIDE) {
+        POOL_ITEM *item = (POOL_ITEM *)(arena + i);
+
+        item->next = pool->idle;
+        pool->idle = item;
+        pool->size++;
+    }
+    CRYPTO_THREAD_unlock(pool->lock);
+    return 1;
+}
+
+/*
+ * Borrow a buffer of |len| bytes for |b| from the pool of |s|, if it has one
+ * and |len| fits. Returns 1 if |b| was set up, 0 if the caller should
+ * allocate it itself and -1 on allocation failure.
+ */
+static int buffer_pool_get(SSL *s, SSL3_BUFFER *b, size_t len)
+{
+    SSL3_BUFFER_POOL *pool;
+    unsigned char *p = NULL;
+
+    /* DTLS moves read buffers in and out of its record queues */
+    if (s->initial_ctx == NULL || SSL_IS_DTLS(s) || len > POOL_BUFFER_LEN)
+        return 0;
+    pool = s->initial_ctx->buffer_pool;
+
+    CRYPTO_THREAD_write_lock(pool->lock);
+    if (!pool->enabled) {
+        CRYPTO_THREAD_unlock(pool->lock);
+        return 0;
+    }
+    if (pool->idle != NULL) {
+        p = (unsigned char *)pool->idle;
+        pool->idle = pool->idle->next;
+        pool->size--;
+        pool->hits++;
+    } else {
+        pool->misses++;
+    }
+    if (++pool->in_use > pool->high_water)
+        pool->high_water = pool->in_use;
+    CRYPTO_THREAD_unlock(pool->lock);
+
+    if (p == NULL && (p = OPENSSL_malloc(POOL_BUFFER_LEN)) == NULL) {
+        CRYPTO_THREAD_write_lock(pool->lock);
+        pool->in_use--;
+        CRYPTO_THREAD_unlock(pool->lock);
+        return -1;
+    }
+    b->buf = p;
+    b->len = POOL_BUFFER_LEN;
+    b->pooled = 1;
+    return 1;
+}
+
+/* Free the buffer of |b|, returning it to the pool it was borrowed from */
+static void buffer_release(SSL *s, SSL3_BUFFER *b)
+{
+    SSL3_BUFFER_POOL *pool;
+    POOL_ITEM *item = (POOL_ITEM *)b->buf;
+
+    /* Unpooled buffers may be released before |initial_ctx| is set */
+    if (!b->pooled || item == NULL) {
+        OPENSSL_free(b->buf);
+    } else {
+        pool = s->initial_ctx->buffer_pool;
+        CRYPTO_THREAD_write_lock(pool->lock);
+        pool->in_use--;
+        if (pool->size < pool->max
+                || buffer_pool_in_arena(pool, (unsigned char *)item)) {
+            item->next = pool->idle;
+            pool->idle = item;
+            pool->size++;
+            item = NULL;
+        }
+        CRYPTO_THREAD_unlock(pool->lock);
+        OPENSSL_free(item);
+    }
+    b->buf = NULL;
+    b->pooled = 0;
+}
+
+long ssl3_buffer_pool_ctrl(SSL_CTX *ctx, int cmd, long larg)
+{
+    SSL3_BUFFER_POOL *pool = ctx->buffer_pool;
+    long ret = 0;
+
+    if (cmd == SSL_CTRL_SET_BUFFER_POOL
+            || cmd == SSL_CTRL_SET_BUFFER_POOL_ARENA) {
+        if (larg < 0)
+            return 0;
+        if (cmd == SSL_CTRL_SET_BUFFER_POOL_ARENA)
+            return buffer_pool_set_arena(pool, (size_t)larg);
+    }
+
+    CRYPTO_THREAD_write_lock(pool->lock);
+    switch (cmd) {
+    case SSL_CTRL_SET_BUFFER_POOL:
+        ret = (long)pool->max;
+        pool->max = (size_t)larg;
+        pool->enabled = 1;
+        break;
+    case SSL_CTRL_GET_BUFFER_POOL:
+        ret = (long)pool->max;
+        break;
+    case SSL_CTRL_BUFFER_POOL_SIZE:
+        ret = (long)pool->size;
+        break;
+    case SSL_CTRL_BUFFER_POOL_IN_USE:
+        ret = (long)pool->in_use;
+        break;
+    case SSL_CTRL_BUFFER_POOL_HIGH_WATER:
+        ret = (long)pool->high_water;
+        break;
+    case SSL_CTRL_BUFFER_POOL_HITS:
+        ret = (long)pool->hits;
+        break;
+    case SSL_CTRL_BUFFER_POOL_MISSES:
+        ret = (long)pool->misses;
+        break;
+    }
+    CRYPTO_THREAD_unlock(pool->lock);
+    return ret;
+}
+
 void SSL3_BUFFER_set_data(SSL3_BUFFER *b, const unsigned char *d, int n)
 {
     if (d != NULL)
@@ -127,10 +406,14 @@ void SSL3_BUFFER_clear(SSL3_BUFFER *b)
 {
     unsigned char *buf = b->buf;
     size_t len = b->len;
+    size_t default_len = b->default_len;
+    int pooled = b->pooled;
 
     memset(b, 0, sizeof(*b));
     b->buf = buf;
     b->len = len;
+    b->default_len = default_len;
+    b->pooled = pooled;
 }
 
 void SSL3_BUFFER_release(SSL3_BUFFER *b)
@@ -167,10 +450,20 @@ int ssl3_setup_read_buffer(SSL *s)
         if (ssl_allow_compression(s))
             len += SSL3_RT_MAX_COMPRESSED_OVERHEAD;
 #endif
-        if ((p = OPENSSL_malloc(len)) == NULL)
+        if (b->default_len > len)
+            len = b->default_len;
+        switch (buffer_pool_get(s, b, len)) {
+        case 1:
+            break;
+        case 0:
+            if ((p = OPENSSL_malloc(len)) == NULL)
+                goto err;
+            b->buf = p;
+            b->len = len;
+            break;
+        default:
             goto err;
-        b->buf = p;
-        b->len = len;
+        }
     }
 
     RECORD_LAYER_set_packet(&s->rlayer, &(b->buf[0]));
@@ -208,10 +501,18 @@ int ssl3_setup_write_buffer(SSL *s)
         if (!(s->options & SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS))
             len += headerlen + align + SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD;
 
-        if ((p = OPENSSL_malloc(len)) == NULL)
+        switch (buffer_pool_get(s, wb, len)) {
+        case 1:
+            break;
+        case 0:
+            if ((p = OPENSSL_malloc(len)) == NULL)
+                goto err;
+            wb->buf = p;
+            wb->len = len;
+            break;
+        default:
             goto err;
-        wb->buf = p;
-        wb->len = len;
+        }
     }
 
     return 1;
@@ -235,9 +536,7 @@ int ssl3_release_write_buffer(SSL *s)
     SSL3_BUFFER *wb;
 
     wb = RECORD_LAYER_get_wbuf(&s->rlayer);
-
-    OPENSSL_free(wb->buf);
-    wb->buf = NULL;
+    buffer_release(s, wb);
     return 1;
 }
 
@@ -246,7 +545,6 @@ int ssl3_release_read_buffer(SSL *s)
     SSL3_BUFFER *b;
 
     b = RECORD_LAYER_get_rbuf(&s->rlayer);
-    OPENSSL_free(b->buf);
-    b->buf = NULL;
+    buffer_release(s, b);
     return 1;
 }
@@ -173,6 +173,7 @@ void SSL3_RECORD_set_seq_num(SSL3_RECORD *r, const unsigned char *seq_num)
 #define MAX_EMPTY_RECORDS 32
 
 #define SSL2_RT_HEADER_LENGTH   2
+
 /*-
  * Call this to get a new input record.
  * It will return <= 0 if more data is needed, normally due to an error
@@ -651,7 +652,7 @@ int tls1_enc(SSL *s, int send)
     SSL3_RECORD *rec;
     EVP_CIPHER_CTX *ds;
     unsigned long l;
-    int bs, i, j, k, pad = 0, ret, mac_size = 0;
+    int bs, i, j, k, pad = 0, ret, mac_size = 0, eivlen = 0;
     const EVP_CIPHER *enc;
 
     if (send) {
@@ -740,6 +741,26 @@ int tls1_enc(SSL *s, int send)
             if (send) {
                 l += pad;
                 rec->length += pad;
+            } else {
+                if (EVP_CIPHER_mode(enc) == EVP_CIPH_GCM_MODE)
+                    eivlen = EVP_GCM_TLS_EXPLICIT_IV_LEN;
+                else if (EVP_CIPHER_mode(enc) == EVP_CIPH_CCM_MODE)
+                    eivlen = EVP_CCM_TLS_EXPLICIT_IV_LEN;
+                /*
+                 * If the payload of an application data record fits in
+                 * the buffer that ssl3_read_bytes() is reading into,
+                 * decrypt it there and save copying it out of the read
+                 * buffer later.
+                 */
+                if (s->rlayer.rdest != NULL
+                    && rec->type == SSL3_RT_APPLICATION_DATA
+                    && s->expand == NULL
+                    && (EVP_CIPHER_flags(enc) & EVP_CIPH_FLAG_TLS_DECRYPT_OUT)
+                    && l >= (unsigned long)(eivlen + pad)
+                    && l - eivlen - pad <= s->rlayer.rdestlen) {
+                    rec->data = s->rlayer.rdest;
+                    s->rlayer.rdest = NULL;
+                }
             }
         } else if ((bs != 1) && send) {
             i = bs - ((int)l % bs);
@@ -764,16 +785,12 @@ int tls1_enc(SSL *s, int send)
             ? (i < 0)
             : (i == 0))
             return -1;          /* AEAD can fail to verify MAC */
-        if (send == 0) {
-            if (EVP_CIPHER_mode(enc) == EVP_CIPH_GCM_MODE) {
-                rec->data += EVP_GCM_TLS_EXPLICIT_IV_LEN;
-                rec->input += EVP_GCM_TLS_EXPLICIT_IV_LEN;
-                rec->length -= EVP_GCM_TLS_EXPLICIT_IV_LEN;
-            } else if (EVP_CIPHER_mode(enc) == EVP_CIPH_CCM_MODE) {
-                rec->data += EVP_CCM_TLS_EXPLICIT_IV_LEN;
-                rec->input += EVP_CCM_TLS_EXPLICIT_IV_LEN;
-                rec->length -= EVP_CCM_TLS_EXPLICIT_IV_LEN;
-            }
+        if (send == 0 && eivlen > 0) {
+            /* Payload decrypted elsewhere has no explicit IV in front */
+            if (rec->data == rec->input)
+                rec->data += eivlen;
+            rec->input += eivlen;
+            rec->length -= eivlen;
         }
 
         ret = 1;
@@ -156,6 +156,7 @@
 # include <openssl/dh.h>
 #endif
 #include <openssl/rand.h>
+#include "internal/refcount.h"
 
 #define SSL3_NUM_CIPHERS        OSSL_NELEM(ssl3_ciphers)
 
@@ -3770,6 +3771,122 @@ OPENSSL_GLOBAL const SSL_CIPHER ssl3_ciphers[] = {
      256,
      },
 
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+# ifndef OPENSSL_NO_EC
+    /* Cipher CCA8 */
+    {
+     1,
+     TLS1_TXT_ECDHE_RSA_WITH_CHACHA20_POLY1305,
+     TLS1_CK_ECDHE_RSA_WITH_CHACHA20_POLY1305,
+     SSL_kECDHE,
+     SSL_aRSA,
+     SSL_CHACHA20POLY1305,
+     SSL_AEAD,
+     SSL_TLSV1_2,
+     SSL_NOT_EXP | SSL_HIGH,
+     SSL_HANDSHAKE_MAC_SHA256 | TLS1_PRF_SHA256,
+     256,
+     256,
+     },
+
+    /* Cipher CCA9 */
+    {
+     1,
+     TLS1_TXT_ECDHE_ECDSA_WITH_CHACHA20_POLY1305,
+     TLS1_CK_ECDHE_ECDSA_WITH_CHACHA20_POLY1305,
+     SSL_kECDHE,
+     SSL_aECDSA,
+     SSL_CHACHA20POLY1305,
+     SSL_AEAD,
+     SSL_TLSV1_2,
+     SSL_NOT_EXP | SSL_HIGH,
+     SSL_HANDSHAKE_MAC_SHA256 | TLS1_PRF_SHA256,
+     256,
+     256,
+     },
+# endif
+    /* Cipher CCAA */
+    {
+     1,
+     TLS1_TXT_DHE_RSA_WITH_CHACHA20_POLY1305,
+     TLS1_CK_DHE_RSA_WITH_CHACHA20_POLY1305,
+     SSL_kDHE,
+     SSL_aRSA,
+     SSL_CHACHA20POLY1305,
+     SSL_AEAD,
+     SSL_TLSV1_2,
+     SSL_NOT_EXP | SSL_HIGH,
+     SSL_HANDSHAKE_MAC_SHA256 | TLS1_PRF_SHA256,
+     256,
+     256,
+     },
+# ifndef OPENSSL_NO_PSK
+    /* Cipher CCAB */
+    {
+     1,
+     TLS1_TXT_PSK_WITH_CHACHA20_POLY1305,
+     TLS1_CK_PSK_WITH_CHACHA20_POLY1305,
+     SSL_kPSK,
+     SSL_aPSK,
+     SSL_CHACHA20POLY1305,
+     SSL_AEAD,
+     SSL_TLSV1_2,
+     SSL_NOT_EXP | SSL_HIGH,
+     SSL_HANDSHAKE_MAC_SHA256 | TLS1_PRF_SHA256,
+     256,
+     256,
+     },
+#  ifndef OPENSSL_NO_EC
+    /* Cipher CCAC */
+    {
+     1,
+     TLS1_TXT_ECDHE_PSK_WITH_CHACHA20_POLY1305,
+     TLS1_CK_ECDHE_PSK_WITH_CHACHA20_POLY1305,
+     SSL_kECDHEPSK,
+     SSL_aPSK,
+     SSL_CHACHA20POLY1305,
+     SSL_AEAD,
+     SSL_TLSV1_2,
+     SSL_NOT_EXP | SSL_HIGH,
+     SSL_HANDSHAKE_MAC_SHA256 | TLS1_PRF_SHA256,
+     256,
+     256,
+     },
+#  endif
+    /* Cipher CCAD */
+    {
+     1,
+     TLS1_TXT_DHE_PSK_WITH_CHACHA20_POLY1305,
+     TLS1_CK_DHE_PSK_WITH_CHACHA20_POLY1305,
+     SSL_kDHEPSK,
+     SSL_aPSK,
+     SSL_CHACHA20POLY1305,
+     SSL_AEAD,
+     SSL_TLSV1_2,
+     SSL_NOT_EXP | SSL_HIGH,
+     SSL_HANDSHAKE_MAC_SHA256 | TLS1_PRF_SHA256,
+     256,
+     256,
+     },
+
+    /* Cipher CCAE */
+    {
+     1,
+     TLS1_TXT_RSA_PSK_WITH_CHACHA20_POLY1305,
+     TLS1_CK_RSA_PSK_WITH_CHACHA20_POLY1305,
+     SSL_kRSAPSK,
+     SSL_aRSA,
+     SSL_CHACHA20POLY1305,
+     SSL_AEAD,
+     SSL_TLSV1_2,
+     SSL_NOT_EXP | SSL_HIGH,
+     SSL_HANDSHAKE_MAC_SHA256 | TLS1_PRF_SHA256,
+     256,
+     256,
+     },
+# endif                         /* OPENSSL_NO_PSK */
+#endif                          /* !OPENSSL_NO_CHACHA && !OPENSSL_NO_POLY1305 */
+
 /* end of list */
 };
 
@@ -3867,6 +3984,8 @@ void ssl3_free(SSL *s)
 #ifndef OPENSSL_NO_EC
     EC_KEY_free(s->s3->tmp.ecdh);
     EC_KEY_free(s->s3->peer_ecdh_tmp);
+    EVP_PKEY_free(s->s3->tmp.pkey);
+    EVP_PKEY_free(s->s3->peer_tmp);
 #endif
 
     sk_X509_NAME_pop_free(s->s3->tmp.ca_names, X509_NAME_free);
@@ -3912,6 +4031,10 @@ void ssl3_clear(SSL *s)
     s->s3->tmp.ecdh = NULL;
     EC_KEY_free(s->s3->peer_ecdh_tmp);
     s->s3->peer_ecdh_tmp = NULL;
+    EVP_PKEY_free(s->s3->tmp.pkey);
+    s->s3->tmp.pkey = NULL;
+    EVP_PKEY_free(s->s3->peer_tmp);
+    s->s3->peer_tmp = NULL;
     s->s3->is_probably_safari = 0;
 #endif                         /* !OPENSSL_NO_EC */
 
@@ -4306,6 +4429,14 @@ long ssl3_ctrl(SSL *s, int cmd, long larg, void *parg)
         else {
             EVP_PKEY *ptmp;
             int rv = 0;
+#ifndef OPENSSL_NO_EC
+            if (s->s3->peer_tmp != NULL) {
+                CRYPTO_UP_REF(&s->s3->peer_tmp->references,
+                              CRYPTO_LOCK_EVP_PKEY);
+                *(EVP_PKEY **)parg = s->s3->peer_tmp;
+                return 1;
+            }
+#endif
 #if !defined(OPENSSL_NO_RSA) && !defined(OPENSSL_NO_DH) && !defined(OPENSSL_NO_EC)
             if (!s->s3->peer_rsa_tmp && !s->s3->peer_dh_tmp && !s->s3->peer_ecdh_tmp)
                 return 0;
@@ -4793,7 +4924,7 @@ SSL_CIPHER *ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
                                STACK_OF(SSL_CIPHER) *srvr)
 {
     SSL_CIPHER *c, *ret = NULL;
-    STACK_OF(SSL_CIPHER) *prio, *allow;
+    STACK_OF(SSL_CIPHER) *prio, *allow, *prio_chacha = NULL;
     int i, ii, ok;
     unsigned long alg_k, alg_a, mask_k, mask_a, emask_k, emask_a;
 
@@ -4828,6 +4959,31 @@ SSL_CIPHER *ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
     if (s->options & SSL_OP_CIPHER_SERVER_PREFERENCE || tls1_suiteb(s)) {
         prio = srvr;
         allow = clnt;
+
+        /*
+         * Clients without AES hardware put ChaCha20-Poly1305 first: honour
+         * that by moving the server's ChaCha20 suites to the front, keeping
+         * the server order otherwise.
+         */
+        if ((s->options & SSL_OP_PRIORITIZE_CHACHA)
+            && sk_SSL_CIPHER_num(clnt) > 0) {
+            c = sk_SSL_CIPHER_value(clnt, 0);
+            if (c->algorithm_enc == SSL_CHACHA20POLY1305
+                && (prio_chacha = sk_SSL_CIPHER_new_null()) != NULL) {
+                for (i = 0; i < sk_SSL_CIPHER_num(srvr); i++) {
+                    c = sk_SSL_CIPHER_value(srvr, i);
+                    if (c->algorithm_enc == SSL_CHACHA20POLY1305)
+                        sk_SSL_CIPHER_push(prio_chacha, c);
+                }
+                for (i = 0; i < sk_SSL_CIPHER_num(srvr); i++) {
+                    c = sk_SSL_CIPHER_value(srvr, i);
+                    if (c->algorithm_enc != SSL_CHACHA20POLY1305)
+                        sk_SSL_CIPHER_push(prio_chacha, c);
+                }
+                if (sk_SSL_CIPHER_num(prio_chacha) == sk_SSL_CIPHER_num(srvr))
+                    prio = prio_chacha;
+            }
+        }
     } else {
         prio = clnt;
         allow = srvr;
@@ -4908,6 +5064,7 @@ SSL_CIPHER *ssl3_choose_cipher(SSL *s, STACK_OF(SSL_CIPHER) *clnt,
             break;
         }
     }
+    sk_SSL_CIPHER_free(prio_chacha);
     return (ret);
 }
 
@@ -5066,6 +5223,16 @@ int ssl3_write(SSL *s, const void *buf, int len)
                                          buf, len);
 }
 
+/* |iov| is a BIO_IOVEC array, see SSL_writev() */
+int ssl3_writev(SSL *s, const void *iov, int iovcnt)
+{
+    clear_sys_error();
+    if (s->s3->renegotiate)
+        ssl3_renegotiate_check(s);
+
+    return ssl3_writev_bytes(s, iov, iovcnt);
+}
+
 static int ssl3_read_internal(SSL *s, void *buf, int len, int peek)
 {
     int ret;
@@ -5241,3 +5408,71 @@ int ssl_generate_master_secret(SSL *s, unsigned char *pms, size_t pmslen,
         s->s3->tmp.pms = NULL;
     return s->session->master_key_length >= 0;
 }
+
+#ifndef OPENSSL_NO_EC
+/* Generate a private key for curve |nid| which has no EC_KEY form */
+EVP_PKEY *ssl_generate_pkey(int nid)
+{
+    EVP_PKEY_CTX *pctx;
+    EVP_PKEY *pkey = NULL;
+
+    pctx = EVP_PKEY_CTX_new_id(nid, NULL);
+    if (pctx == NULL)
+        return NULL;
+    if (EVP_PKEY_keygen_init(pctx) <= 0 || EVP_PKEY_keygen(pctx, &pkey) <= 0) {
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    EVP_PKEY_CTX_free(pctx);
+    return pkey;
+}
+
+/*
+ * Derive the premaster secret from |privkey| and |pubkey|.  On success
+ * |*ppms| is set to a newly allocated buffer of |*ppmslen| bytes.
+ */
+int ssl_derive(EVP_PKEY *privkey, EVP_PKEY *pubkey,
+               unsigned char **ppms, size_t *ppmslen)
+{
+    int rv = 0;
+    unsigned char *pms = NULL;
+    size_t pmslen = 0;
+    EVP_PKEY_CTX *pctx;
+
+    if (privkey == NULL || pubkey == NULL)
+        return 0;
+
+    pctx = EVP_PKEY_CTX_new(privkey, NULL);
+    if (pctx == NULL) {
+        SSLerr(SSL_F_SSL_DERIVE, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+
+    if (EVP_PKEY_derive_init(pctx) <= 0
+            || EVP_PKEY_derive_set_peer(pctx, pubkey) <= 0
+            || EVP_PKEY_derive(pctx, NULL, &pmslen) <= 0) {
+        SSLerr(SSL_F_SSL_DERIVE, ERR_R_INTERNAL_ERROR);
+        goto err;
+    }
+
+    pms = OPENSSL_malloc(pmslen);
+    if (pms == NULL) {
+        SSLerr(SSL_F_SSL_DERIVE, ERR_R_MALLOC_FAILURE);
+        goto err;
+    }
+
+    if (EVP_PKEY_derive(pctx, pms, &pmslen) <= 0) {
+        SSLerr(SSL_F_SSL_DERIVE, ERR_R_INTERNAL_ERROR);
+        OPENSSL_free(pms);
+        goto err;
+    }
+
+    *ppms = pms;
+    *ppmslen = pmslen;
+    rv = 1;
+
+ err:
+    EVP_PKEY_CTX_free(pctx);
+    return rv;
+}
+#endif
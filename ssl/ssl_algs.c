@@ -106,6 +106,9 @@ int SSL_library_init(void)
 #ifndef OPENSSL_NO_SEED
     EVP_add_cipher(EVP_seed_cbc());
 #endif
+#if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+    EVP_add_cipher(EVP_chacha20_poly1305());
+#endif
 
 #ifndef OPENSSL_NO_MD5
     EVP_add_digest(EVP_md5());
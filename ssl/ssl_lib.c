@@ -152,6 +152,7 @@
 #include <openssl/x509v3.h>
 #include <openssl/rand.h>
 #include <openssl/ocsp.h>
+#include "internal/refcount.h"
 #ifndef OPENSSL_NO_DH
 # include <openssl/dh.h>
 #endif
@@ -194,6 +195,18 @@ static void clear_ciphers(SSL *s)
     ssl_clear_hash_ctx(&s->write_hash);
 }
 
+/*
+ * Discard an async job that was left paused.  Nothing is done when called
+ * from inside the job itself, e.g. SSL_clear() from the handshake.
+ */
+static void ssl_abort_async_job(SSL *s)
+{
+    if (s->job != NULL && s->job != ASYNC_get_current_job()) {
+        ASYNC_abort_job(s->job);
+        s->job = NULL;
+    }
+}
+
 int SSL_clear(SSL *s)
 {
     if (s->method == NULL) {
@@ -201,6 +214,8 @@ int SSL_clear(SSL *s)
         return (0);
     }
 
+    ssl_abort_async_job(s);
+
     if (ssl_clear_bad_session(s)) {
         SSL_SESSION_free(s->session);
         s->session = NULL;
@@ -316,8 +331,13 @@ SSL *SSL_new(SSL_CTX *ctx)
     X509_VERIFY_PARAM_inherit(s->param, ctx->param);
     s->quiet_shutdown = ctx->quiet_shutdown;
     s->max_send_fragment = ctx->max_send_fragment;
+    s->dyn_record_threshold = ctx->dyn_record_threshold;
+    s->dyn_record_timeout = ctx->dyn_record_timeout;
+    s->dyn_record_size = ctx->dyn_record_size;
+    if (ctx->default_read_buf_len > 0)
+        SSL_set_default_read_buffer_len(s, ctx->default_read_buf_len);
 
-    CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+    CRYPTO_UP_REF(&ctx->references, CRYPTO_LOCK_SSL_CTX);
     s->ctx = ctx;
     s->tlsext_debug_cb = 0;
     s->tlsext_debug_arg = NULL;
@@ -328,7 +348,7 @@ SSL *SSL_new(SSL_CTX *ctx)
     s->tlsext_ocsp_exts = NULL;
     s->tlsext_ocsp_resp = NULL;
     s->tlsext_ocsp_resplen = -1;
-    CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+    CRYPTO_UP_REF(&ctx->references, CRYPTO_LOCK_SSL_CTX);
     s->initial_ctx = ctx;
 # ifndef OPENSSL_NO_EC
     if (ctx->tlsext_ecpointformatlist) {
@@ -420,9 +440,9 @@ int SSL_set_session_id_context(SSL *ssl, const unsigned char *sid_ctx,
 
 int SSL_CTX_set_generate_session_id(SSL_CTX *ctx, GEN_SESSION_CB cb)
 {
-    CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
+    CRYPTO_THREAD_write_lock(ctx->lock);
     ctx->generate_session_id = cb;
-    CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+    CRYPTO_THREAD_unlock(ctx->lock);
     return 1;
 }
 
@@ -453,9 +473,17 @@ int SSL_has_matching_session_id(const SSL *ssl, const unsigned char *id,
     r.session_id_length = id_len;
     memcpy(r.session_id, id, id_len);
 
-    CRYPTO_r_lock(CRYPTO_LOCK_SSL_CTX);
-    p = lh_SSL_SESSION_retrieve(ssl->ctx->sessions, &r);
-    CRYPTO_r_unlock(CRYPTO_LOCK_SSL_CTX);
+    if (ssl->ctx->session_shards != NULL) {
+        SSL_SESS_SHARD *sh = ssl_session_shard(ssl->ctx, &r);
+
+        ssl_session_shard_lock(ssl->ctx, sh, CRYPTO_LOCK | CRYPTO_READ);
+        p = lh_SSL_SESSION_retrieve(sh->sessions, &r);
+        ssl_session_shard_lock(ssl->ctx, sh, CRYPTO_UNLOCK | CRYPTO_READ);
+    } else {
+        CRYPTO_THREAD_read_lock(ssl->ctx->lock);
+        p = lh_SSL_SESSION_retrieve(ssl->ctx->sessions, &r);
+        CRYPTO_THREAD_unlock(ssl->ctx->lock);
+    }
     return (p != NULL);
 }
 
@@ -511,7 +539,7 @@ void SSL_free(SSL *s)
     if (s == NULL)
         return;
 
-    i = CRYPTO_add(&s->references, -1, CRYPTO_LOCK_SSL);
+    i = CRYPTO_DOWN_REF(&s->references, CRYPTO_LOCK_SSL);
 #ifdef REF_PRINT
     REF_PRINT("SSL", s);
 #endif
@@ -524,6 +552,8 @@ void SSL_free(SSL *s)
     }
 #endif
 
+    ssl_abort_async_job(s);
+
     X509_VERIFY_PARAM_free(s->param);
     CRYPTO_free_ex_data(CRYPTO_EX_INDEX_SSL, s, &s->ex_data);
 
@@ -557,7 +587,6 @@ void SSL_free(SSL *s)
     /* Free up if allocated */
 
     OPENSSL_free(s->tlsext_hostname);
-    SSL_CTX_free(s->initial_ctx);
 #ifndef OPENSSL_NO_EC
     OPENSSL_free(s->tlsext_ecpointformatlist);
     OPENSSL_free(s->tlsext_ellipticcurvelist);
@@ -565,6 +594,7 @@ void SSL_free(SSL *s)
     sk_X509_EXTENSION_pop_free(s->tlsext_ocsp_exts, X509_EXTENSION_free);
     sk_OCSP_RESPID_pop_free(s->tlsext_ocsp_ids, OCSP_RESPID_free);
     OPENSSL_free(s->tlsext_ocsp_resp);
+    ssl_ocsp_staple_free(s->ocsp_staple);
     OPENSSL_free(s->alpn_client_proto_list);
 
     sk_X509_NAME_pop_free(s->client_CA, X509_NAME_free);
@@ -572,8 +602,10 @@ void SSL_free(SSL *s)
     if (s->method != NULL)
         s->method->ssl_free(s);
 
+    /* Pooled record buffers go back to initial_ctx */
     RECORD_LAYER_release(&s->rlayer);
 
+    SSL_CTX_free(s->initial_ctx);
     SSL_CTX_free(s->ctx);
 
 #if !defined(OPENSSL_NO_NEXTPROTONEG)
@@ -793,6 +825,16 @@ void SSL_set_read_ahead(SSL *s, int yes)
     RECORD_LAYER_set_read_ahead(&s->rlayer, yes);
 }
 
+void SSL_CTX_set_default_read_buffer_len(SSL_CTX *ctx, size_t len)
+{
+    ctx->default_read_buf_len = len;
+}
+
+void SSL_set_default_read_buffer_len(SSL *s, size_t len)
+{
+    RECORD_LAYER_set_default_read_buffer_len(&s->rlayer, len);
+}
+
 int SSL_get_read_ahead(const SSL *s)
 {
     return RECORD_LAYER_get_read_ahead(&s->rlayer);
@@ -864,7 +906,7 @@ int SSL_copy_session_id(SSL *t, const SSL *f)
         t->method->ssl_new(t);  /* setup new */
     }
 
-    CRYPTO_add(&f->cert->references, 1, CRYPTO_LOCK_SSL_CERT);
+    CRYPTO_UP_REF(&f->cert->references, CRYPTO_LOCK_SSL_CERT);
     ssl_cert_free(t->cert);
     t->cert = f->cert;
     if (!SSL_set_session_id_context(t, f->sid_ctx, f->sid_ctx_length)) {
@@ -911,13 +953,29 @@ int SSL_check_private_key(const SSL *ssl)
                                    ssl->cert->key->privatekey));
 }
 
+int SSL_waiting_for_async(SSL *s)
+{
+    if (s->job)
+        return 1;
+
+    return 0;
+}
+
+OSSL_ASYNC_FD SSL_get_async_wait_fd(SSL *s)
+{
+    if (s->job == NULL)
+        return OSSL_BAD_ASYNC_FD;
+
+    return ASYNC_get_wait_fd(s->job);
+}
+
 int SSL_accept(SSL *s)
 {
     if (s->handshake_func == 0)
         /* Not properly initialized yet */
         SSL_set_accept_state(s);
 
-    return (s->method->ssl_accept(s));
+    return SSL_do_handshake(s);
 }
 
 int SSL_connect(SSL *s)
@@ -926,7 +984,7 @@ int SSL_connect(SSL *s)
         /* Not properly initialized yet */
         SSL_set_connect_state(s);
 
-    return (s->method->ssl_connect(s));
+    return SSL_do_handshake(s);
 }
 
 long SSL_get_default_timeout(const SSL *s)
@@ -934,6 +992,75 @@ long SSL_get_default_timeout(const SSL *s)
     return (s->method->get_timeout());
 }
 
+/*
+ * In SSL_MODE_ASYNC the handshake, read and write functions run inside an
+ * ASYNC job.  If something in the job (normally an engine) pauses, we
+ * return -1 with SSL_ERROR_WANT_ASYNC, and the next call to the same
+ * function resumes the job instead of starting a new one.
+ */
+struct ssl_async_args {
+    SSL *s;
+    void *buf;
+    int num;
+    enum { READFUNC, WRITEFUNC, OTHERFUNC } type;
+    union {
+        int (*func_read) (SSL *, void *, int);
+        int (*func_write) (SSL *, const void *, int);
+        int (*func_other) (SSL *);
+    } f;
+};
+
+static int ssl_start_async_job(SSL *s, struct ssl_async_args *args,
+                               int (*func) (void *))
+{
+    int ret;
+
+    s->rwstate = SSL_NOTHING;
+    switch (ASYNC_start_job(&s->job, &ret, func, args,
+                            sizeof(struct ssl_async_args))) {
+    case ASYNC_ERR:
+        s->rwstate = SSL_NOTHING;
+        SSLerr(SSL_F_SSL_START_ASYNC_JOB, SSL_R_FAILED_TO_INIT_ASYNC);
+        return -1;
+    case ASYNC_PAUSE:
+        s->rwstate = SSL_ASYNC_PAUSED;
+        return -1;
+    case ASYNC_NO_JOBS:
+        s->rwstate = SSL_ASYNC_NO_JOBS;
+        return -1;
+    case ASYNC_FINISH:
+        s->job = NULL;
+        return ret;
+    default:
+        s->rwstate = SSL_NOTHING;
+        SSLerr(SSL_F_SSL_START_ASYNC_JOB, ERR_R_INTERNAL_ERROR);
+        /* Shouldn't happen */
+        return -1;
+    }
+}
+
+static int ssl_io_intern(void *vargs)
+{
+    struct ssl_async_args *args;
+    SSL *s;
+    void *buf;
+    int num;
+
+    args = (struct ssl_async_args *)vargs;
+    s = args->s;
+    buf = args->buf;
+    num = args->num;
+    switch (args->type) {
+    case READFUNC:
+        return args->f.func_read(s, buf, num);
+    case WRITEFUNC:
+        return args->f.func_write(s, buf, num);
+    case OTHERFUNC:
+        return args->f.func_other(s);
+    }
+    return -1;
+}
+
 int SSL_read(SSL *s, void *buf, int num)
 {
     if (s->handshake_func == 0) {
@@ -945,6 +1072,18 @@ int SSL_read(SSL *s, void *buf, int num)
         s->rwstate = SSL_NOTHING;
         return (0);
     }
+
+    if ((s->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
+        struct ssl_async_args args;
+
+        args.s = s;
+        args.buf = buf;
+        args.num = num;
+        args.type = READFUNC;
+        args.f.func_read = s->method->ssl_read;
+
+        return ssl_start_async_job(s, &args, ssl_io_intern);
+    }
     return (s->method->ssl_read(s, buf, num));
 }
 
@@ -958,9 +1097,50 @@ int SSL_peek(SSL *s, void *buf, int num)
     if (s->shutdown & SSL_RECEIVED_SHUTDOWN) {
         return (0);
     }
+
+    if ((s->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
+        struct ssl_async_args args;
+
+        args.s = s;
+        args.buf = buf;
+        args.num = num;
+        args.type = READFUNC;
+        args.f.func_read = s->method->ssl_peek;
+
+        return ssl_start_async_job(s, &args, ssl_io_intern);
+    }
     return (s->method->ssl_peek(s, buf, num));
 }
 
+/*
+ * Point |*buf| at the decrypted data of the current record, leaving it in
+ * place. The pointer is valid until the next read from |s|.
+ */
+int SSL_peek_ptr(SSL *s, const void **buf)
+{
+    int ret;
+
+    ret = SSL_peek(s, NULL, SSL3_RT_MAX_PLAIN_LENGTH);
+    if (ret > 0)
+        *buf = RECORD_LAYER_get_rrec_data(&s->rlayer);
+    return ret;
+}
+
+int SSL_read_ptr(SSL *s, const void **buf, int num)
+{
+    int ret;
+
+    if (num <= 0)
+        return 0;
+    ret = SSL_peek_ptr(s, buf);
+    if (ret <= 0)
+        return ret;
+    if (ret > num)
+        ret = num;
+    /* Consume the data, it stays in the read buffer until the next read */
+    return s->method->ssl_read(s, NULL, ret);
+}
+
 int SSL_write(SSL *s, const void *buf, int num)
 {
     if (s->handshake_func == 0) {
@@ -973,9 +1153,54 @@ int SSL_write(SSL *s, const void *buf, int num)
         SSLerr(SSL_F_SSL_WRITE, SSL_R_PROTOCOL_IS_SHUTDOWN);
         return (-1);
     }
+
+    if ((s->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
+        struct ssl_async_args args;
+
+        args.s = s;
+        args.buf = (void *)buf;
+        args.num = num;
+        args.type = WRITEFUNC;
+        args.f.func_write = s->method->ssl_write;
+
+        return ssl_start_async_job(s, &args, ssl_io_intern);
+    }
     return (s->method->ssl_write(s, buf, num));
 }
 
+int SSL_writev(SSL *s, const BIO_IOVEC *iov, int iovcnt)
+{
+    if (s->handshake_func == 0) {
+        SSLerr(SSL_F_SSL_WRITEV, SSL_R_UNINITIALIZED);
+        return -1;
+    }
+
+    if (s->shutdown & SSL_SENT_SHUTDOWN) {
+        s->rwstate = SSL_NOTHING;
+        SSLerr(SSL_F_SSL_WRITEV, SSL_R_PROTOCOL_IS_SHUTDOWN);
+        return (-1);
+    }
+
+    /* Datagrams cannot be coalesced into records */
+    if (SSL_IS_DTLS(s)) {
+        SSLerr(SSL_F_SSL_WRITEV, SSL_R_UNSUPPORTED_PROTOCOL);
+        return -1;
+    }
+
+    if ((s->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
+        struct ssl_async_args args;
+
+        args.s = s;
+        args.buf = (void *)iov;
+        args.num = iovcnt;
+        args.type = WRITEFUNC;
+        args.f.func_write = ssl3_writev;
+
+        return ssl_start_async_job(s, &args, ssl_io_intern);
+    }
+    return ssl3_writev(s, iov, iovcnt);
+}
+
 int SSL_shutdown(SSL *s)
 {
     /*
@@ -1060,6 +1285,21 @@ long SSL_ctrl(SSL *s, int cmd, long larg, void *parg)
             return 0;
         s->max_send_fragment = larg;
         return 1;
+    case SSL_CTRL_SET_DYNAMIC_RECORD_THRESHOLD:
+        if (larg < 0)
+            return 0;
+        s->dyn_record_threshold = larg;
+        return 1;
+    case SSL_CTRL_SET_DYNAMIC_RECORD_TIMEOUT:
+        if (larg < 0)
+            return 0;
+        s->dyn_record_timeout = larg;
+        return 1;
+    case SSL_CTRL_SET_DYNAMIC_RECORD_SIZE:
+        if (larg < 512 || larg > SSL3_RT_MAX_PLAIN_LENGTH)
+            return 0;
+        s->dyn_record_size = larg;
+        return 1;
     case SSL_CTRL_GET_RI_SUPPORT:
         if (s->s3)
             return s->s3->send_connection_binding;
@@ -1156,12 +1396,22 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
         return (ctx->session_cache_size);
     case SSL_CTRL_SET_SESS_CACHE_MODE:
         l = ctx->session_cache_mode;
+        if ((l ^ larg) & SSL_SESS_CACHE_SHARDED) {
+            /* Changing the cache layout discards all cached sessions */
+            SSL_CTX_flush_sessions(ctx, 0);
+            if (!(larg & SSL_SESS_CACHE_SHARDED))
+                ssl_session_shards_free(ctx);
+            else if (!ssl_session_shards_new(ctx))
+                larg &= ~SSL_SESS_CACHE_SHARDED;
+        }
         ctx->session_cache_mode = larg;
         return (l);
     case SSL_CTRL_GET_SESS_CACHE_MODE:
         return (ctx->session_cache_mode);
 
     case SSL_CTRL_SESS_NUMBER:
+        if (ctx->session_shards != NULL)
+            return ssl_session_shards_num_items(ctx);
         return (lh_SSL_SESSION_num_items(ctx->sessions));
     case SSL_CTRL_SESS_CONNECT:
         return (ctx->stats.sess_connect);
@@ -1184,6 +1434,9 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
     case SSL_CTRL_SESS_TIMEOUTS:
         return (ctx->stats.sess_timeout);
     case SSL_CTRL_SESS_CACHE_FULL:
+        if (ctx->session_shards != NULL)
+            return ctx->stats.sess_cache_full
+                   + ssl_session_shards_cache_full(ctx);
         return (ctx->stats.sess_cache_full);
     case SSL_CTRL_OPTIONS:
         return (ctx->options |= larg);
@@ -1198,6 +1451,30 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
             return 0;
         ctx->max_send_fragment = larg;
         return 1;
+    case SSL_CTRL_SET_DYNAMIC_RECORD_THRESHOLD:
+        if (larg < 0)
+            return 0;
+        ctx->dyn_record_threshold = larg;
+        return 1;
+    case SSL_CTRL_SET_DYNAMIC_RECORD_TIMEOUT:
+        if (larg < 0)
+            return 0;
+        ctx->dyn_record_timeout = larg;
+        return 1;
+    case SSL_CTRL_SET_DYNAMIC_RECORD_SIZE:
+        if (larg < 512 || larg > SSL3_RT_MAX_PLAIN_LENGTH)
+            return 0;
+        ctx->dyn_record_size = larg;
+        return 1;
+    case SSL_CTRL_SET_BUFFER_POOL:
+    case SSL_CTRL_GET_BUFFER_POOL:
+    case SSL_CTRL_SET_BUFFER_POOL_ARENA:
+    case SSL_CTRL_BUFFER_POOL_SIZE:
+    case SSL_CTRL_BUFFER_POOL_IN_USE:
+    case SSL_CTRL_BUFFER_POOL_HIGH_WATER:
+    case SSL_CTRL_BUFFER_POOL_HITS:
+    case SSL_CTRL_BUFFER_POOL_MISSES:
+        return ssl3_buffer_pool_ctrl(ctx, cmd, larg);
     case SSL_CTRL_CERT_FLAGS:
         return (ctx->cert->cert_flags |= larg);
     case SSL_CTRL_CLEAR_CERT_FLAGS:
@@ -1663,6 +1940,39 @@ static int ssl_session_cmp(const SSL_SESSION *a, const SSL_SESSION *b)
 static IMPLEMENT_LHASH_HASH_FN(ssl_session, SSL_SESSION)
 static IMPLEMENT_LHASH_COMP_FN(ssl_session, SSL_SESSION)
 
+/*
+ * Allocate the partitions of a sharded session cache. Lives here rather
+ * than in ssl_sess.c as the shards share the hash and compare functions
+ * above with the unsharded cache.
+ */
+int ssl_session_shards_new(SSL_CTX *ctx)
+{
+    SSL_SESS_SHARD *shards;
+    int i;
+
+    shards = OPENSSL_zalloc(sizeof(*shards) * SSL_SESS_CACHE_SHARDS);
+    if (shards == NULL)
+        goto err;
+    for (i = 0; i < SSL_SESS_CACHE_SHARDS; i++) {
+        shards[i].sessions = lh_SSL_SESSION_new();
+        if (shards[i].sessions == NULL)
+            goto err;
+        shards[i].lock = CRYPTO_THREAD_lock_new();
+        if (shards[i].lock == NULL)
+            goto err;
+    }
+    ctx->session_shards = shards;
+    return 1;
+
+ err:
+    if (shards != NULL) {
+        ctx->session_shards = shards;
+        ssl_session_shards_free(ctx);
+    }
+    SSLerr(SSL_F_SSL_SESSION_SHARDS_NEW, ERR_R_MALLOC_FAILURE);
+    return 0;
+}
+
 SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
 {
     SSL_CTX *ret = NULL;
@@ -1691,6 +2001,9 @@ SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
     /* We take the system default. */
     ret->session_timeout = meth->get_timeout();
     ret->references = 1;
+    ret->lock = CRYPTO_THREAD_lock_new();
+    if (ret->lock == NULL)
+        goto err;
     ret->max_cert_list = SSL_MAX_CERT_LIST_DEFAULT;
     ret->verify_mode = SSL_VERIFY_NONE;
     if ((ret->cert = ssl_cert_new()) == NULL)
@@ -1727,6 +2040,12 @@ SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
     if ((ret->client_CA = sk_X509_NAME_new_null()) == NULL)
         goto err;
 
+    if ((ret->ocsp_staples = ssl_ocsp_cache_new()) == NULL)
+        goto err;
+
+    if ((ret->buffer_pool = ssl3_buffer_pool_new()) == NULL)
+        goto err;
+
     CRYPTO_new_ex_data(CRYPTO_EX_INDEX_SSL_CTX, ret, &ret->ex_data);
 
     /* No compression for DTLS */
@@ -1734,6 +2053,8 @@ SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
         ret->comp_methods = SSL_COMP_get_compression_methods();
 
     ret->max_send_fragment = SSL3_RT_MAX_PLAIN_LENGTH;
+    ret->dyn_record_timeout = SSL3_DYN_RECORD_TIMEOUT;
+    ret->dyn_record_size = SSL3_DYN_RECORD_SIZE;
 
     /* Setup RFC4507 ticket keys */
     if ((RAND_bytes(ret->tlsext_tick_key_name, 16) <= 0)
@@ -1784,7 +2105,7 @@ void SSL_CTX_free(SSL_CTX *a)
     if (a == NULL)
         return;
 
-    i = CRYPTO_add(&a->references, -1, CRYPTO_LOCK_SSL_CTX);
+    i = CRYPTO_DOWN_REF(&a->references, CRYPTO_LOCK_SSL_CTX);
 #ifdef REF_PRINT
     REF_PRINT("SSL_CTX", a);
 #endif
@@ -1813,6 +2134,9 @@ void SSL_CTX_free(SSL_CTX *a)
 
     CRYPTO_free_ex_data(CRYPTO_EX_INDEX_SSL_CTX, a, &a->ex_data);
     lh_SSL_SESSION_free(a->sessions);
+    OPENSSL_free(a->session_timeouts.heap);
+    ssl_session_shards_free(a);
+    ssl_ocsp_cache_free(a->ocsp_staples);
     X509_STORE_free(a->cert_store);
     sk_SSL_CIPHER_free(a->cipher_list);
     sk_SSL_CIPHER_free(a->cipher_list_by_id);
@@ -1836,7 +2160,9 @@ void SSL_CTX_free(SSL_CTX *a)
     OPENSSL_free(a->tlsext_ellipticcurvelist);
 #endif
     OPENSSL_free(a->alpn_client_proto_list);
+    ssl3_buffer_pool_free(a->buffer_pool);
 
+    CRYPTO_THREAD_lock_free(a->lock);
     OPENSSL_free(a);
 }
 
@@ -2246,17 +2572,20 @@ void ssl_update_cache(SSL *s, int mode)
         && ((i & SSL_SESS_CACHE_NO_INTERNAL_STORE)
             || SSL_CTX_add_session(s->session_ctx, s->session))
         && (s->session_ctx->new_session_cb != NULL)) {
-        CRYPTO_add(&s->session->references, 1, CRYPTO_LOCK_SSL_SESSION);
+        CRYPTO_UP_REF(&s->session->references, CRYPTO_LOCK_SSL_SESSION);
         if (!s->session_ctx->new_session_cb(s, s->session))
             SSL_SESSION_free(s->session);
     }
 
-    /* auto flush every 255 connections */
+    /*
+     * auto flush every 255 connections, removing a bounded number of expired
+     * sessions so that no single handshake pays for a sweep of the cache
+     */
     if ((!(i & SSL_SESS_CACHE_NO_AUTO_CLEAR)) && ((i & mode) == mode)) {
         if ((((mode & SSL_SESS_CACHE_CLIENT)
               ? s->session_ctx->stats.sess_connect_good
               : s->session_ctx->stats.sess_accept_good) & 0xff) == 0xff) {
-            SSL_CTX_flush_sessions(s->session_ctx, (unsigned long)time(NULL));
+            ssl_session_cache_expire(s->session_ctx, (unsigned long)time(NULL));
         }
     }
 }
@@ -2364,6 +2693,12 @@ int SSL_get_error(const SSL *s, int i)
     if ((i < 0) && SSL_want_x509_lookup(s)) {
         return (SSL_ERROR_WANT_X509_LOOKUP);
     }
+    if ((i < 0) && SSL_want_async(s)) {
+        return SSL_ERROR_WANT_ASYNC;
+    }
+    if ((i < 0) && SSL_want_async_job(s)) {
+        return SSL_ERROR_WANT_ASYNC_JOB;
+    }
 
     if (i == 0) {
         if ((s->shutdown & SSL_RECEIVED_SHUTDOWN) &&
@@ -2385,7 +2720,17 @@ int SSL_do_handshake(SSL *s)
     s->method->ssl_renegotiate_check(s);
 
     if (SSL_in_init(s) || SSL_in_before(s)) {
-        ret = s->handshake_func(s);
+        if ((s->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
+            struct ssl_async_args args;
+
+            args.s = s;
+            args.type = OTHERFUNC;
+            args.f.func_other = s->handshake_func;
+
+            ret = ssl_start_async_job(s, &args, ssl_io_intern);
+        } else {
+            ret = s->handshake_func(s);
+        }
     }
     return (ret);
 }
@@ -2769,7 +3114,7 @@ SSL_CTX *SSL_set_SSL_CTX(SSL *ssl, SSL_CTX *ctx)
         memcpy(&ssl->sid_ctx, &ctx->sid_ctx, sizeof(ssl->sid_ctx));
     }
 
-    CRYPTO_add(&ctx->references, 1, CRYPTO_LOCK_SSL_CTX);
+    CRYPTO_UP_REF(&ctx->references, CRYPTO_LOCK_SSL_CTX);
     SSL_CTX_free(ssl->ctx); /* decrement reference count */
     ssl->ctx = ctx;
 
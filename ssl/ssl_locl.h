@@ -364,9 +364,11 @@
 # define SSL_AES256CCM           0x00008000L
 # define SSL_AES128CCM8          0x00010000L
 # define SSL_AES256CCM8          0x00020000L
+# define SSL_CHACHA20POLY1305    0x00040000L
 
 # define SSL_AES                 (SSL_AES128|SSL_AES256|SSL_AES128GCM|SSL_AES256GCM|SSL_AES128CCM|SSL_AES256CCM|SSL_AES128CCM8|SSL_AES256CCM8)
 # define SSL_CAMELLIA            (SSL_CAMELLIA128|SSL_CAMELLIA256)
+# define SSL_CHACHA20            (SSL_CHACHA20POLY1305)
 
 /* Bits for algorithm_mac (symmetric authentication) */
 
@@ -663,6 +665,11 @@ struct ssl_session_st {
      * implement a maximum cache size.
      */
     struct ssl_session_st *prev, *next;
+    /*
+     * Position in the expiry heap of the cache holding this session, 0 if
+     * the session is not in a cache.
+     */
+    size_t expiry_idx;
     char *tlsext_hostname;
 # ifndef OPENSSL_NO_EC
     size_t tlsext_ecpointformatlist_length;
@@ -716,6 +723,67 @@ struct ssl_comp_st {
 DECLARE_STACK_OF(SSL_COMP)
 DECLARE_LHASH_OF(SSL_SESSION);
 
+/*
+ * Binary min-heap of the sessions in a cache ordered by expiry time, so that
+ * expired sessions can be found without walking the whole cache. |heap| is
+ * indexed from 1, heap[0] is unused. The key recorded here is the expiry time
+ * at insertion; it is rechecked against the session before removal in case
+ * SSL_SESSION_set_time() or SSL_SESSION_set_timeout() moved it.
+ */
+typedef struct ssl_sess_expiry_st {
+    long expires;
+    struct ssl_session_st *sess;
+} SSL_SESS_EXPIRY;
+
+typedef struct ssl_sess_timeouts_st {
+    SSL_SESS_EXPIRY *heap;
+    size_t num;
+    size_t max;
+} SSL_SESS_TIMEOUTS;
+
+/*
+ * Maximum number of sessions removed under one acquisition of a cache lock
+ * when flushing expired sessions. This is also the most the automatic flush
+ * done every 256 connections will remove, which bounds the work done on
+ * behalf of any one handshake.
+ */
+# define SSL_SESS_FLUSH_BATCH   512
+
+/*
+ * Number of independent session cache partitions used when
+ * SSL_SESS_CACHE_SHARDED is set. Must be a power of 2.
+ */
+# define SSL_SESS_CACHE_SHARDS  16
+
+/*
+ * One partition of a sharded session cache: a hash table plus its own LRU
+ * list, protected by its own lock. A session always lives in the shard
+ * selected by ssl_session_shard() from its session ID.
+ */
+typedef struct ssl_sess_shard_st {
+    LHASH_OF(SSL_SESSION) *sessions;
+    struct ssl_session_st *session_cache_head;
+    struct ssl_session_st *session_cache_tail;
+    SSL_SESS_TIMEOUTS timeouts;
+    CRYPTO_RWLOCK *lock;
+    /* sessions removed from this shard due to a full cache */
+    int sess_cache_full;
+} SSL_SESS_SHARD;
+
+/*
+ * A verified DER encoded OCSP response, shared by reference between the
+ * SSL_CTX staple cache and the connections sending it.
+ */
+typedef struct ssl_ocsp_staple_st {
+    int references;
+    unsigned char *resp;
+    size_t resplen;
+    /* Not to be sent after this time */
+    time_t expires;
+} SSL_OCSP_STAPLE;
+
+typedef struct ssl_ocsp_cache_st SSL_OCSP_CACHE;
+
 
 struct ssl_ctx_st {
     const SSL_METHOD *method;
@@ -731,6 +799,13 @@ struct ssl_ctx_st {
     unsigned long session_cache_size;
     struct ssl_session_st *session_cache_head;
     struct ssl_session_st *session_cache_tail;
+    /* Sessions in |sessions| ordered by expiry time */
+    SSL_SESS_TIMEOUTS session_timeouts;
+    /*
+     * Array of SSL_SESS_CACHE_SHARDS partitions used instead of |sessions|
+     * when SSL_SESS_CACHE_SHARDED is set, NULL otherwise.
+     */
+    SSL_SESS_SHARD *session_shards;
     /*
      * This can have one of 2 values, ored together, SSL_SESS_CACHE_CLIENT,
      * SSL_SESS_CACHE_SERVER, Default is SSL_SESSION_CACHE_SERVER, which
@@ -775,6 +850,8 @@ struct ssl_ctx_st {
     } stats;
 
     int references;
+    /* Protects the internal session cache and |generate_session_id| */
+    CRYPTO_RWLOCK *lock;
 
     /* if defined, these override the X509_verify_cert() calls */
     int (*app_verify_callback) (X509_STORE_CTX *, void *);
@@ -853,6 +930,17 @@ struct ssl_ctx_st {
      */
     unsigned int max_send_fragment;
 
+    /* Default size of the read buffer, if larger than a record */
+    size_t default_read_buf_len;
+
+    /* Dynamic record sizing, see ssl3_dyn_record_size() */
+    unsigned long dyn_record_threshold;
+    unsigned long dyn_record_timeout;
+    unsigned int dyn_record_size;
+
+    /* Record buffers shared by the connections, NULL if not enabled */
+    SSL3_BUFFER_POOL *buffer_pool;
+
 #  ifndef OPENSSL_NO_ENGINE
     /*
      * Engine to pass requests for client certs to
@@ -877,6 +965,8 @@ struct ssl_ctx_st {
     /* Callback for status request */
     int (*tlsext_status_cb) (SSL *ssl, void *arg);
     void *tlsext_status_arg;
+    /* Staples sent when there is no status callback */
+    SSL_OCSP_CACHE *ocsp_staples;
 
 #  ifndef OPENSSL_NO_PSK
     unsigned int (*psk_client_callback) (SSL *ssl, const char *hint,
@@ -1099,6 +1189,9 @@ struct ssl_st {
     /* what was passed, used for SSLv3/TLS rollback check */
     int client_version;
     unsigned int max_send_fragment;
+    unsigned long dyn_record_threshold;
+    unsigned long dyn_record_timeout;
+    unsigned int dyn_record_size;
 
     /* TLS extension debug callback */
     void (*tlsext_debug_cb) (SSL *s, int client_server, int type,
@@ -1123,6 +1216,8 @@ struct ssl_st {
     /* OCSP response received or to be sent */
     unsigned char *tlsext_ocsp_resp;
     int tlsext_ocsp_resplen;
+    /* Cached OCSP response to be sent instead of tlsext_ocsp_resp */
+    SSL_OCSP_STAPLE *ocsp_staple;
     /* RFC4507 session ticket expected to be received or sent */
     int tlsext_ticket_expected;
 #  ifndef OPENSSL_NO_EC
@@ -1193,6 +1288,9 @@ struct ssl_st {
     int (*not_resumable_session_cb) (SSL *ssl, int is_forward_secure);
     
     RECORD_LAYER rlayer;
+
+    /* Async job running SSL_do_handshake/SSL_read/SSL_write, if paused */
+    ASYNC_JOB *job;
 };
 
 
@@ -1255,6 +1353,7 @@ typedef struct ssl3_state_st {
 #  endif
 #  ifndef OPENSSL_NO_EC
         EC_KEY *ecdh;           /* holds short lived ECDH key */
+        EVP_PKEY *pkey;         /* holds short lived X25519 key */
 #  endif
         /* used for certificate requests */
         int cert_req;
@@ -1361,6 +1460,8 @@ typedef struct ssl3_state_st {
 # endif
 # ifndef OPENSSL_NO_EC
     EC_KEY *peer_ecdh_tmp;
+    /* Peer key for curves without an EC_KEY form, i.e. X25519 */
+    EVP_PKEY *peer_tmp;
 # endif
 
 } SSL3_STATE;
@@ -1846,6 +1947,17 @@ struct openssl_ssl_test_functions {
 
 void ssl_clear_cipher_ctx(SSL *s);
 int ssl_clear_bad_session(SSL *s);
+__owur int ssl_session_shards_new(SSL_CTX *ctx);
+void ssl_session_shards_free(SSL_CTX *ctx);
+SSL_SESS_SHARD *ssl_session_shard(SSL_CTX *ctx, const SSL_SESSION *s);
+void ssl_session_shard_lock(SSL_CTX *ctx, SSL_SESS_SHARD *sh, int mode);
+long ssl_session_shards_num_items(SSL_CTX *ctx);
+long ssl_session_shards_cache_full(SSL_CTX *ctx);
+SSL_OCSP_CACHE *ssl_ocsp_cache_new(void);
+void ssl_ocsp_cache_free(SSL_OCSP_CACHE *cache);
+SSL_OCSP_STAPLE *ssl_ocsp_cache_get(SSL_OCSP_CACHE *cache, X509 *cert);
+void ssl_ocsp_staple_free(SSL_OCSP_STAPLE *staple);
+void ssl_session_cache_expire(SSL_CTX *ctx, long t);
 __owur CERT *ssl_cert_new(void);
 __owur CERT *ssl_cert_dup(CERT *cert);
 void ssl_cert_clear_certs(CERT *c);
@@ -1902,6 +2014,11 @@ void ssl_load_ciphers(void);
 __owur int ssl_fill_hello_random(SSL *s, int server, unsigned char *field, int len);
 __owur int ssl_generate_master_secret(SSL *s, unsigned char *pms, size_t pmslen,
                                       int free_pms);
+# ifndef OPENSSL_NO_EC
+__owur EVP_PKEY *ssl_generate_pkey(int nid);
+__owur int ssl_derive(EVP_PKEY *privkey, EVP_PKEY *pubkey,
+                      unsigned char **ppms, size_t *ppmslen);
+# endif
 
 __owur const SSL_CIPHER *ssl3_get_cipher_by_char(const unsigned char *p);
 __owur int ssl3_put_cipher_by_char(const SSL_CIPHER *c, unsigned char *p);
@@ -1933,6 +2050,7 @@ void ssl3_free(SSL *s);
 __owur int ssl3_read(SSL *s, void *buf, int len);
 __owur int ssl3_peek(SSL *s, void *buf, int len);
 __owur int ssl3_write(SSL *s, const void *buf, int len);
+__owur int ssl3_writev(SSL *s, const void *iov, int iovcnt);
 __owur int ssl3_shutdown(SSL *s);
 void ssl3_clear(SSL *s);
 __owur long ssl3_ctrl(SSL *s, int cmd, long larg, void *parg);
@@ -1969,6 +2087,7 @@ void dtls1_get_message_header(unsigned char *data,
                               struct hm_header_st *msg_hdr);
 __owur long dtls1_default_timeout(void);
 __owur struct timeval *dtls1_get_timeout(SSL *s, struct timeval *timeleft);
+void ssl_get_current_time(struct timeval *t);
 __owur int dtls1_check_timeout_num(SSL *s);
 __owur int dtls1_handle_timeout(SSL *s);
 __owur const SSL_CIPHER *dtls1_get_cipher(unsigned int u);
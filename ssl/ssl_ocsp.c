@@ -0,0 +1,412 @@
+/* ssl/ssl_ocsp.c */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/*
+ * Server side OCSP staple cache.  Responses for the certificates of an
+ * SSL_CTX are checked once when they are added and then sent by reference
+ * in every handshake that asks for them, until they are replaced or run
+ * past their nextUpdate time.  New responses are obtained through an
+ * application supplied fetch callback, called from
+ * SSL_CTX_refresh_ocsp_staples() once half of the lifetime of the current
+ * response has passed, never from within a handshake.
+ */
+
+#include <stdio.h>
+#include <openssl/buffer.h>
+#include <openssl/ocsp.h>
+#include <openssl/x509v3.h>
+#include "internal/refcount.h"
+#include "ssl_locl.h"
+
+/* Clock skew allowed for the thisUpdate time of a response */
+#define SSL_OCSP_STAPLE_LEEWAY          300
+/* How long a response with no nextUpdate time is sent for */
+#define SSL_OCSP_STAPLE_LIFETIME        3600
+/* How long to wait after a failed refresh before trying again */
+#define SSL_OCSP_STAPLE_RETRY           60
+
+typedef struct ssl_ocsp_entry_st {
+    X509 *cert;
+    X509 *issuer;
+    SSL_OCSP_STAPLE *staple;
+    /* When to fetch a new response */
+    time_t refresh;
+    /* Set while a thread is fetching a new response */
+    int fetching;
+    struct ssl_ocsp_entry_st *next;
+} SSL_OCSP_ENTRY;
+
+/*
+ * Entries are only ever added, so an entry found under the lock can still
+ * be used after releasing it.  Its cert and issuer never change; its
+ * staple and refresh state are protected by the lock.
+ */
+struct ssl_ocsp_cache_st {
+    CRYPTO_RWLOCK *lock;
+    SSL_OCSP_ENTRY *entries;
+    SSL_ocsp_fetch_cb fetch_cb;
+    void *fetch_arg;
+};
+
+void ssl_ocsp_staple_free(SSL_OCSP_STAPLE *staple)
+{
+    if (staple == NULL)
+        return;
+    if (CRYPTO_DOWN_REF(&staple->references, CRYPTO_LOCK_SSL_CTX) > 0)
+        return;
+    OPENSSL_free(staple->resp);
+    OPENSSL_free(staple);
+}
+
+/*
+ * Check that |resp| is a successful OCSP response about |cert|, signed by
+ * |issuer| or by a responder it has delegated to, and currently valid.
+ * On success returns a new staple holding |resp|; in any case the caller
+ * no longer owns |resp|.
+ */
+static SSL_OCSP_STAPLE *ocsp_staple_new(X509 *cert, X509 *issuer,
+                                        unsigned char *resp, size_t resplen)
+{
+    const unsigned char *p = resp;
+    OCSP_RESPONSE *rsp = NULL;
+    OCSP_BASICRESP *bs = NULL;
+    OCSP_CERTID *id = NULL;
+    X509_STORE *st = NULL;
+    ASN1_GENERALIZEDTIME *thisupd, *nextupd;
+    SSL_OCSP_STAPLE *staple = NULL;
+    time_t now = time(NULL);
+    int status, reason, day, sec;
+
+    if (resplen > 0xffffff
+        || (rsp = d2i_OCSP_RESPONSE(NULL, &p, (long)resplen)) == NULL
+        || p != resp + resplen
+        || OCSP_response_status(rsp) != OCSP_RESPONSE_STATUS_SUCCESSFUL
+        || (bs = OCSP_response_get1_basic(rsp)) == NULL)
+        goto end;
+
+    /*
+     * The issuer is the only trust anchor: a staple need not chain to
+     * anything the server trusts for other purposes.
+     */
+    if ((st = X509_STORE_new()) == NULL
+        || !X509_STORE_add_cert(st, issuer)
+        || !X509_STORE_set_flags(st, X509_V_FLAG_PARTIAL_CHAIN)
+        || OCSP_basic_verify(bs, NULL, st, 0) <= 0)
+        goto end;
+
+    if ((id = OCSP_cert_to_id(NULL, cert, issuer)) == NULL
+        || !OCSP_resp_find_status(bs, id, &status, &reason, NULL, &thisupd,
+                                  &nextupd)
+        || !OCSP_check_validity(thisupd, nextupd, SSL_OCSP_STAPLE_LEEWAY, -1))
+        goto end;
+
+    if ((staple = OPENSSL_zalloc(sizeof(*staple))) == NULL)
+        goto end;
+    staple->references = 1;
+    if (nextupd == NULL)
+        staple->expires = now + SSL_OCSP_STAPLE_LIFETIME;
+    else if (ASN1_TIME_diff(&day, &sec, NULL, nextupd))
+        staple->expires = now + (time_t)day * 24 * 60 * 60 + sec;
+    if (staple->expires <= now) {
+        OPENSSL_free(staple);
+        staple = NULL;
+        goto end;
+    }
+    staple->resp = resp;
+    staple->resplen = resplen;
+    resp = NULL;
+
+ end:
+    OPENSSL_free(resp);
+    OCSP_CERTID_free(id);
+    X509_STORE_free(st);
+    OCSP_BASICRESP_free(bs);
+    OCSP_RESPONSE_free(rsp);
+    return staple;
+}
+
+/*
+ * Created along with the SSL_CTX, so that threads sharing the SSL_CTX
+ * never race to create it.
+ */
+SSL_OCSP_CACHE *ssl_ocsp_cache_new(void)
+{
+    SSL_OCSP_CACHE *cache;
+
+    if ((cache = OPENSSL_zalloc(sizeof(*cache))) == NULL)
+        return NULL;
+    if ((cache->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        OPENSSL_free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void ssl_ocsp_cache_free(SSL_OCSP_CACHE *cache)
+{
+    SSL_OCSP_ENTRY *e, *next;
+
+    if (cache == NULL)
+        return;
+    for (e = cache->entries; e != NULL; e = next) {
+        next = e->next;
+        X509_free(e->cert);
+        X509_free(e->issuer);
+        ssl_ocsp_staple_free(e->staple);
+        OPENSSL_free(e);
+    }
+    CRYPTO_THREAD_lock_free(cache->lock);
+    OPENSSL_free(cache);
+}
+
+/* Must be called with the cache lock held */
+static SSL_OCSP_ENTRY *ocsp_entry_find(SSL_OCSP_CACHE *cache, X509 *cert)
+{
+    SSL_OCSP_ENTRY *e;
+
+    /* Usually the very certificate the entry was created for */
+    for (e = cache->entries; e != NULL; e = e->next) {
+        if (e->cert == cert)
+            return e;
+    }
+    for (e = cache->entries; e != NULL; e = e->next) {
+        if (X509_cmp(e->cert, cert) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/* Must be called with the cache write locked */
+static SSL_OCSP_ENTRY *ocsp_entry_add(SSL_OCSP_CACHE *cache, X509 *cert,
+                                      X509 *issuer)
+{
+    SSL_OCSP_ENTRY *e = ocsp_entry_find(cache, cert);
+
+    if (e != NULL)
+        return e;
+    if ((e = OPENSSL_zalloc(sizeof(*e))) == NULL)
+        return NULL;
+    X509_up_ref(cert);
+    X509_up_ref(issuer);
+    e->cert = cert;
+    e->issuer = issuer;
+    e->next = cache->entries;
+    cache->entries = e;
+    return e;
+}
+
+/* Must be called with the cache write locked */
+static void ocsp_entry_set(SSL_OCSP_ENTRY *e, SSL_OCSP_STAPLE *staple)
+{
+    time_t now = time(NULL);
+
+    ssl_ocsp_staple_free(e->staple);
+    e->staple = staple;
+    e->refresh = now + (staple->expires - now) / 2;
+}
+
+SSL_OCSP_STAPLE *ssl_ocsp_cache_get(SSL_OCSP_CACHE *cache, X509 *cert)
+{
+    SSL_OCSP_ENTRY *e;
+    SSL_OCSP_STAPLE *staple = NULL;
+
+    CRYPTO_THREAD_read_lock(cache->lock);
+    e = ocsp_entry_find(cache, cert);
+    if (e != NULL && e->staple != NULL && time(NULL) < e->staple->expires) {
+        staple = e->staple;
+        CRYPTO_UP_REF(&staple->references, CRYPTO_LOCK_SSL_CTX);
+    }
+    CRYPTO_THREAD_unlock(cache->lock);
+    return staple;
+}
+
+int SSL_CTX_set_ocsp_staple_fetch_cb(SSL_CTX *ctx, SSL_ocsp_fetch_cb cb,
+                                     void *arg)
+{
+    SSL_OCSP_CACHE *cache = ctx->ocsp_staples;
+
+    CRYPTO_THREAD_write_lock(cache->lock);
+    cache->fetch_cb = cb;
+    cache->fetch_arg = arg;
+    CRYPTO_THREAD_unlock(cache->lock);
+    return 1;
+}
+
+int SSL_CTX_add_ocsp_staple(SSL_CTX *ctx, X509 *cert, X509 *issuer,
+                            const unsigned char *resp, size_t resplen)
+{
+    SSL_OCSP_CACHE *cache = ctx->ocsp_staples;
+    SSL_OCSP_ENTRY *e;
+    SSL_OCSP_STAPLE *staple;
+    unsigned char *copy;
+
+    if ((copy = BUF_memdup(resp, resplen)) == NULL) {
+        SSLerr(SSL_F_SSL_CTX_ADD_OCSP_STAPLE, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    if ((staple = ocsp_staple_new(cert, issuer, copy, resplen)) == NULL) {
+        SSLerr(SSL_F_SSL_CTX_ADD_OCSP_STAPLE, SSL_R_BAD_OCSP_STAPLE);
+        return 0;
+    }
+
+    CRYPTO_THREAD_write_lock(cache->lock);
+    if ((e = ocsp_entry_add(cache, cert, issuer)) != NULL)
+        ocsp_entry_set(e, staple);
+    CRYPTO_THREAD_unlock(cache->lock);
+    if (e == NULL) {
+        ssl_ocsp_staple_free(staple);
+        SSLerr(SSL_F_SSL_CTX_ADD_OCSP_STAPLE, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Find the issuer of the certificate in |cpk| among the chain certificates
+ * of |ctx| or in its certificate store.
+ */
+static X509 *ocsp_find_issuer(SSL_CTX *ctx, CERT_PKEY *cpk)
+{
+    STACK_OF(X509) *chains[2];
+    X509_STORE *store;
+    X509_STORE_CTX xs_ctx;
+    X509 *issuer = NULL;
+    int i, j;
+
+    chains[0] = cpk->chain;
+    chains[1] = ctx->extra_certs;
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < sk_X509_num(chains[i]); j++) {
+            issuer = sk_X509_value(chains[i], j);
+            if (X509_check_issued(issuer, cpk->x509) == X509_V_OK) {
+                X509_up_ref(issuer);
+                return issuer;
+            }
+        }
+    }
+
+    store = ctx->cert->chain_store != NULL ? ctx->cert->chain_store
+                                           : ctx->cert_store;
+    if (store == NULL || !X509_STORE_CTX_init(&xs_ctx, store, cpk->x509, NULL))
+        return NULL;
+    if (X509_STORE_CTX_get1_issuer(&issuer, &xs_ctx, cpk->x509) <= 0)
+        issuer = NULL;
+    X509_STORE_CTX_cleanup(&xs_ctx);
+    return issuer;
+}
+
+int SSL_CTX_refresh_ocsp_staples(SSL_CTX *ctx)
+{
+    SSL_OCSP_CACHE *cache = ctx->ocsp_staples;
+    SSL_OCSP_ENTRY *e;
+    SSL_OCSP_STAPLE *staple;
+    SSL_ocsp_fetch_cb fetch_cb;
+    void *fetch_arg;
+    X509 *issuer;
+    unsigned char *resp;
+    size_t resplen;
+    int i, due, n = 0;
+
+    CRYPTO_THREAD_read_lock(cache->lock);
+    fetch_cb = cache->fetch_cb;
+    fetch_arg = cache->fetch_arg;
+    CRYPTO_THREAD_unlock(cache->lock);
+    if (fetch_cb == NULL) {
+        SSLerr(SSL_F_SSL_CTX_REFRESH_OCSP_STAPLES,
+               SSL_R_NO_OCSP_FETCH_CALLBACK);
+        return -1;
+    }
+
+    for (i = 0; i < SSL_PKEY_NUM; i++) {
+        CERT_PKEY *cpk = &ctx->cert->pkeys[i];
+
+        if (cpk->x509 == NULL
+            || (issuer = ocsp_find_issuer(ctx, cpk)) == NULL)
+            continue;
+
+        CRYPTO_THREAD_write_lock(cache->lock);
+        e = ocsp_entry_add(cache, cpk->x509, issuer);
+        due = e != NULL && !e->fetching
+              && (e->staple == NULL || time(NULL) >= e->refresh);
+        if (due)
+            e->fetching = 1;
+        CRYPTO_THREAD_unlock(cache->lock);
+        X509_free(issuer);
+        if (!due)
+            continue;
+
+        /* The fetch may block, so it is done without the lock */
+        resp = NULL;
+        resplen = 0;
+        staple = NULL;
+        if (fetch_cb(ctx, e->cert, e->issuer, &resp, &resplen, fetch_arg)
+            && resp != NULL)
+            staple = ocsp_staple_new(e->cert, e->issuer, resp, resplen);
+        else
+            OPENSSL_free(resp);
+
+        CRYPTO_THREAD_write_lock(cache->lock);
+        if (staple != NULL) {
+            ocsp_entry_set(e, staple);
+            n++;
+        } else {
+            /* Keep sending the current response while it lasts */
+            e->refresh = time(NULL) + SSL_OCSP_STAPLE_RETRY;
+        }
+        e->fetching = 0;
+        CRYPTO_THREAD_unlock(cache->lock);
+    }
+    return n;
+}
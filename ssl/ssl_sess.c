@@ -142,10 +142,20 @@
 # include <openssl/engine.h>
 #endif
 #include "ssl_locl.h"
+#include "internal/refcount.h"
 
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s);
-static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s);
+static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESS_SHARD *sh,
+                                    SSL_SESSION *s);
+static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESS_SHARD *sh,
+                                 SSL_SESSION *s);
 static int remove_session_lock(SSL_CTX *ctx, SSL_SESSION *c, int lck);
+static int timeouts_add(SSL_SESS_TIMEOUTS *to, SSL_SESSION *s);
+static void timeouts_remove(SSL_SESS_TIMEOUTS *to, SSL_SESSION *s);
+
+static SSL_SESS_TIMEOUTS *cache_timeouts(SSL_CTX *ctx, SSL_SESS_SHARD *sh)
+{
+    return sh != NULL ? &sh->timeouts : &ctx->session_timeouts;
+}
 
 SSL_SESSION *SSL_get_session(const SSL *ssl)
 /* aka SSL_get0_session; gets 0 objects, just returns a copy of the pointer */
@@ -165,7 +175,7 @@ SSL_SESSION *SSL_get1_session(SSL *ssl)
     CRYPTO_w_lock(CRYPTO_LOCK_SSL_SESSION);
     sess = ssl->session;
     if (sess)
-        sess->references++;
+        CRYPTO_UP_REF_LOCKED(&sess->references);
     CRYPTO_w_unlock(CRYPTO_LOCK_SSL_SESSION);
     return (sess);
 }
@@ -244,6 +254,7 @@ SSL_SESSION *ssl_session_dup(SSL_SESSION *src, int ticket)
     /* We deliberately don't copy the prev and next pointers */
     dest->prev = NULL;
     dest->next = NULL;
+    dest->expiry_idx = 0;
 
     dest->references = 1;
 
@@ -447,12 +458,12 @@ int ssl_get_new_session(SSL *s, int session)
         }
 
         /* Choose which callback will set the session ID */
-        CRYPTO_r_lock(CRYPTO_LOCK_SSL_CTX);
+        CRYPTO_THREAD_read_lock(s->session_ctx->lock);
         if (s->generate_session_id)
             cb = s->generate_session_id;
         else if (s->session_ctx->generate_session_id)
             cb = s->session_ctx->generate_session_id;
-        CRYPTO_r_unlock(CRYPTO_LOCK_SSL_CTX);
+        CRYPTO_THREAD_unlock(s->session_ctx->lock);
         /* Choose a session ID */
         tmp = ss->session_id_length;
         if (!cb(s, ss->session_id, &tmp)) {
@@ -572,13 +583,25 @@ int ssl_get_prev_session(SSL *s, const PACKET *ext, const PACKET *session_id)
             goto err;
         }
         data.session_id_length = local_len;
-        CRYPTO_r_lock(CRYPTO_LOCK_SSL_CTX);
-        ret = lh_SSL_SESSION_retrieve(s->session_ctx->sessions, &data);
-        if (ret != NULL) {
-            /* don't allow other threads to steal it: */
-            CRYPTO_add(&ret->references, 1, CRYPTO_LOCK_SSL_SESSION);
+        if (s->session_ctx->session_shards != NULL) {
+            SSL_SESS_SHARD *sh = ssl_session_shard(s->session_ctx, &data);
+
+            ssl_session_shard_lock(s->session_ctx, sh,
+                                   CRYPTO_LOCK | CRYPTO_READ);
+            ret = lh_SSL_SESSION_retrieve(sh->sessions, &data);
+            if (ret != NULL)
+                CRYPTO_UP_REF(&ret->references, CRYPTO_LOCK_SSL_SESSION);
+            ssl_session_shard_lock(s->session_ctx, sh,
+                                   CRYPTO_UNLOCK | CRYPTO_READ);
+        } else {
+            CRYPTO_THREAD_read_lock(s->session_ctx->lock);
+            ret = lh_SSL_SESSION_retrieve(s->session_ctx->sessions, &data);
+            if (ret != NULL) {
+                /* don't allow other threads to steal it: */
+                CRYPTO_UP_REF(&ret->references, CRYPTO_LOCK_SSL_SESSION);
+            }
+            CRYPTO_THREAD_unlock(s->session_ctx->lock);
         }
-        CRYPTO_r_unlock(CRYPTO_LOCK_SSL_CTX);
         if (ret == NULL)
             s->session_ctx->stats.sess_miss++;
     }
@@ -605,7 +628,7 @@ int ssl_get_prev_session(SSL *s, const PACKET *ext, const PACKET *session_id)
              * thread-safe).
              */
             if (copy)
-                CRYPTO_add(&ret->references, 1, CRYPTO_LOCK_SSL_SESSION);
+                CRYPTO_UP_REF(&ret->references, CRYPTO_LOCK_SSL_SESSION);
 
             /*
              * Add the externally cached session to the internal cache as
@@ -708,19 +731,29 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 {
     int ret = 0;
     SSL_SESSION *s;
+    SSL_SESS_SHARD *sh = NULL;
+    LHASH_OF(SSL_SESSION) *cache = ctx->sessions;
+    unsigned long max = SSL_CTX_sess_get_cache_size(ctx);
 
     /*
      * add just 1 reference count for the SSL_CTX's session cache even though
      * it has two ways of access: each session is in a doubly linked list and
      * an lhash
      */
-    CRYPTO_add(&c->references, 1, CRYPTO_LOCK_SSL_SESSION);
+    CRYPTO_UP_REF(&c->references, CRYPTO_LOCK_SSL_SESSION);
     /*
      * if session c is in already in cache, we take back the increment later
      */
 
-    CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-    s = lh_SSL_SESSION_insert(ctx->sessions, c);
+    if (ctx->session_shards != NULL) {
+        /* Each shard gets an equal part of the overall cache size */
+        sh = ssl_session_shard(ctx, c);
+        cache = sh->sessions;
+        max = (max + SSL_SESS_CACHE_SHARDS - 1) / SSL_SESS_CACHE_SHARDS;
+    }
+
+    ssl_session_shard_lock(ctx, sh, CRYPTO_LOCK | CRYPTO_WRITE);
+    s = lh_SSL_SESSION_insert(cache, c);
 
     /*
      * s != NULL iff we already had a session with the given PID. In this
@@ -729,7 +762,8 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
      */
     if (s != NULL && s != c) {
         /* We *are* in trouble ... */
-        SSL_SESSION_list_remove(ctx, s);
+        SSL_SESSION_list_remove(ctx, sh, s);
+        timeouts_remove(cache_timeouts(ctx, sh), s);
         SSL_SESSION_free(s);
         /*
          * ... so pretend the other session did not exist in cache (we cannot
@@ -741,8 +775,15 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
     }
 
     /* Put at the head of the queue unless it is already in the cache */
-    if (s == NULL)
-        SSL_SESSION_list_add(ctx, c);
+    if (s == NULL) {
+        SSL_SESSION_list_add(ctx, sh, c);
+        /*
+         * If this fails the session can still be removed through the LRU
+         * list or on lookup once it has expired, it just won't be found by
+         * SSL_CTX_flush_sessions().
+         */
+        (void)timeouts_add(cache_timeouts(ctx, sh), c);
+    }
 
     if (s != NULL) {
         /*
@@ -759,17 +800,21 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 
         ret = 1;
 
-        if (SSL_CTX_sess_get_cache_size(ctx) > 0) {
-            while (SSL_CTX_sess_number(ctx) >
-                   SSL_CTX_sess_get_cache_size(ctx)) {
-                if (!remove_session_lock(ctx, ctx->session_cache_tail, 0))
+        if (max > 0) {
+            while (lh_SSL_SESSION_num_items(cache) > max) {
+                if (!remove_session_lock(ctx, sh != NULL
+                                              ? sh->session_cache_tail
+                                              : ctx->session_cache_tail, 0))
                     break;
+                /* Shards only share |ctx| itself, not its lock */
+                if (sh != NULL)
+                    sh->sess_cache_full++;
                 else
                     ctx->stats.sess_cache_full++;
             }
         }
     }
-    CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+    ssl_session_shard_lock(ctx, sh, CRYPTO_UNLOCK | CRYPTO_WRITE);
     return (ret);
 }
 
@@ -781,19 +826,26 @@ int SSL_CTX_remove_session(SSL_CTX *ctx, SSL_SESSION *c)
 static int remove_session_lock(SSL_CTX *ctx, SSL_SESSION *c, int lck)
 {
     SSL_SESSION *r;
+    SSL_SESS_SHARD *sh = NULL;
+    LHASH_OF(SSL_SESSION) *cache = ctx->sessions;
     int ret = 0;
 
     if ((c != NULL) && (c->session_id_length != 0)) {
+        if (ctx->session_shards != NULL) {
+            sh = ssl_session_shard(ctx, c);
+            cache = sh->sessions;
+        }
         if (lck)
-            CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-        if ((r = lh_SSL_SESSION_retrieve(ctx->sessions, c)) == c) {
+            ssl_session_shard_lock(ctx, sh, CRYPTO_LOCK | CRYPTO_WRITE);
+        if ((r = lh_SSL_SESSION_retrieve(cache, c)) == c) {
             ret = 1;
-            r = lh_SSL_SESSION_delete(ctx->sessions, c);
-            SSL_SESSION_list_remove(ctx, c);
+            r = lh_SSL_SESSION_delete(cache, c);
+            SSL_SESSION_list_remove(ctx, sh, c);
+            timeouts_remove(cache_timeouts(ctx, sh), c);
         }
 
         if (lck)
-            CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+            ssl_session_shard_lock(ctx, sh, CRYPTO_UNLOCK | CRYPTO_WRITE);
 
         if (ret) {
             r->not_resumable = 1;
@@ -813,7 +865,7 @@ void SSL_SESSION_free(SSL_SESSION *ss)
     if (ss == NULL)
         return;
 
-    i = CRYPTO_add(&ss->references, -1, CRYPTO_LOCK_SSL_SESSION);
+    i = CRYPTO_DOWN_REF(&ss->references, CRYPTO_LOCK_SSL_SESSION);
 #ifdef REF_PRINT
     REF_PRINT("SSL_SESSION", ss);
 #endif
@@ -871,7 +923,7 @@ int SSL_set_session(SSL *s, SSL_SESSION *session)
         }
 
         /* CRYPTO_w_lock(CRYPTO_LOCK_SSL); */
-        CRYPTO_add(&session->references, 1, CRYPTO_LOCK_SSL_SESSION);
+        CRYPTO_UP_REF(&session->references, CRYPTO_LOCK_SSL_SESSION);
         SSL_SESSION_free(s->session);
         s->session = session;
         s->verify_result = s->session->verify_result;
@@ -1029,47 +1081,250 @@ int SSL_set_session_ticket_ext(SSL *s, void *ext_data, int ext_len)
     return 0;
 }
 
-typedef struct timeout_param_st {
-    SSL_CTX *ctx;
-    long time;
-    LHASH_OF(SSL_SESSION) *cache;
-} TIMEOUT_PARAM;
+static void timeouts_set(SSL_SESS_TIMEOUTS *to, size_t i,
+                         const SSL_SESS_EXPIRY *e)
+{
+    to->heap[i] = *e;
+    e->sess->expiry_idx = i;
+}
+
+static void timeouts_sift_up(SSL_SESS_TIMEOUTS *to, size_t i)
+{
+    SSL_SESS_EXPIRY e = to->heap[i];
+
+    while (i > 1 && to->heap[i / 2].expires > e.expires) {
+        timeouts_set(to, i, &to->heap[i / 2]);
+        i /= 2;
+    }
+    timeouts_set(to, i, &e);
+}
+
+static void timeouts_sift_down(SSL_SESS_TIMEOUTS *to, size_t i)
+{
+    SSL_SESS_EXPIRY e = to->heap[i];
+    size_t c;
+
+    while ((c = 2 * i) <= to->num) {
+        if (c < to->num && to->heap[c + 1].expires < to->heap[c].expires)
+            c++;
+        if (to->heap[c].expires >= e.expires)
+            break;
+        timeouts_set(to, i, &to->heap[c]);
+        i = c;
+    }
+    timeouts_set(to, i, &e);
+}
+
+static int timeouts_add(SSL_SESS_TIMEOUTS *to, SSL_SESSION *s)
+{
+    if (to->num + 1 >= to->max) {
+        size_t max = to->max == 0 ? 64 : to->max * 2;
+        SSL_SESS_EXPIRY *heap;
 
-static void timeout_doall_arg(SSL_SESSION *s, TIMEOUT_PARAM *p)
+        heap = OPENSSL_realloc(to->heap, max * sizeof(*heap));
+        if (heap == NULL)
+            return 0;
+        to->heap = heap;
+        to->max = max;
+    }
+    to->num++;
+    to->heap[to->num].expires = s->time + s->timeout;
+    to->heap[to->num].sess = s;
+    timeouts_sift_up(to, to->num);
+    return 1;
+}
+
+static void timeouts_remove(SSL_SESS_TIMEOUTS *to, SSL_SESSION *s)
 {
-    if ((p->time == 0) || (p->time > (s->time + s->timeout))) { /* timeout */
+    size_t i = s->expiry_idx;
+
+    if (i == 0)
+        return;
+    s->expiry_idx = 0;
+    if (i != to->num) {
+        /* Move the last entry into the hole and restore the heap order */
+        timeouts_set(to, i, &to->heap[to->num]);
+        to->num--;
+        timeouts_sift_up(to, i);
+        timeouts_sift_down(to, i);
+    } else {
+        to->num--;
+    }
+}
+
+/*
+ * Remove up to |max| sessions that expired before |t|, or any sessions if |t|
+ * is 0, from the part of the cache belonging to |sh|. The caller must hold
+ * the lock for that part. Only expired sessions are looked at, so this costs
+ * O(log n) per session removed rather than a walk of the whole cache.
+ * Returns the number of steps taken: if that is |max| there may be more
+ * expired sessions left.
+ */
+static int flush_expired(SSL_CTX *ctx, SSL_SESS_SHARD *sh, long t, int max)
+{
+    SSL_SESS_TIMEOUTS *to = cache_timeouts(ctx, sh);
+    LHASH_OF(SSL_SESSION) *cache = sh != NULL ? sh->sessions : ctx->sessions;
+    SSL_SESSION *s;
+    long expires;
+    int n;
+
+    for (n = 0; n < max; n++) {
+        if (t == 0) {
+            /*
+             * Flushing everything: go by the LRU list rather than the heap as
+             * it is guaranteed to hold every cached session.
+             */
+            s = sh != NULL ? sh->session_cache_tail : ctx->session_cache_tail;
+            if (s == NULL)
+                break;
+        } else {
+            if (to->num == 0 || to->heap[1].expires >= t)
+                break;
+            s = to->heap[1].sess;
+            expires = s->time + s->timeout;
+            if (expires >= t) {
+                /* The session was given more time after it was cached */
+                to->heap[1].expires = expires;
+                timeouts_sift_down(to, 1);
+                continue;
+            }
+        }
         /*
          * The reason we don't call SSL_CTX_remove_session() is to save on
          * locking overhead
          */
-        (void)lh_SSL_SESSION_delete(p->cache, s);
-        SSL_SESSION_list_remove(p->ctx, s);
+        timeouts_remove(to, s);
+        (void)lh_SSL_SESSION_delete(cache, s);
+        SSL_SESSION_list_remove(ctx, sh, s);
         s->not_resumable = 1;
-        if (p->ctx->remove_session_cb != NULL)
-            p->ctx->remove_session_cb(p->ctx, s);
+        if (ctx->remove_session_cb != NULL)
+            ctx->remove_session_cb(ctx, s);
         SSL_SESSION_free(s);
     }
+    return n;
 }
 
-static IMPLEMENT_LHASH_DOALL_ARG_FN(timeout, SSL_SESSION, TIMEOUT_PARAM)
+static void flush_sessions(SSL_CTX *s, SSL_SESS_SHARD *sh, long t)
+{
+    int n;
+
+    if (sh == NULL && s->sessions == NULL)
+        return;
+    /*
+     * Work in batches, dropping the lock in between so that other threads
+     * can get at the cache while a large number of sessions is flushed.
+     */
+    do {
+        ssl_session_shard_lock(s, sh, CRYPTO_LOCK | CRYPTO_WRITE);
+        n = flush_expired(s, sh, t, SSL_SESS_FLUSH_BATCH);
+        ssl_session_shard_lock(s, sh, CRYPTO_UNLOCK | CRYPTO_WRITE);
+    } while (n == SSL_SESS_FLUSH_BATCH);
+}
 
 void SSL_CTX_flush_sessions(SSL_CTX *s, long t)
 {
-    unsigned long i;
-    TIMEOUT_PARAM tp;
+    int i;
+
+    if (s->session_shards != NULL) {
+        /* Only one shard is locked at a time */
+        for (i = 0; i < SSL_SESS_CACHE_SHARDS; i++)
+            flush_sessions(s, &s->session_shards[i], t);
+    } else {
+        flush_sessions(s, NULL, t);
+    }
+}
+
+/*
+ * Remove at most SSL_SESS_FLUSH_BATCH sessions that expired before |t|. Used
+ * for the automatic flush in ssl_update_cache(), where it must not take time
+ * proportional to the size of the cache.
+ */
+void ssl_session_cache_expire(SSL_CTX *ctx, long t)
+{
+    SSL_SESS_SHARD *sh;
+    int i;
 
-    tp.ctx = s;
-    tp.cache = s->sessions;
-    if (tp.cache == NULL)
+    if (ctx->session_shards == NULL) {
+        CRYPTO_THREAD_write_lock(ctx->lock);
+        flush_expired(ctx, NULL, t, SSL_SESS_FLUSH_BATCH);
+        CRYPTO_THREAD_unlock(ctx->lock);
         return;
-    tp.time = t;
-    CRYPTO_w_lock(CRYPTO_LOCK_SSL_CTX);
-    i = CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load;
-    CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load = 0;
-    lh_SSL_SESSION_doall_arg(tp.cache, LHASH_DOALL_ARG_FN(timeout),
-                             TIMEOUT_PARAM, &tp);
-    CHECKED_LHASH_OF(SSL_SESSION, tp.cache)->down_load = i;
-    CRYPTO_w_unlock(CRYPTO_LOCK_SSL_CTX);
+    }
+    for (i = 0; i < SSL_SESS_CACHE_SHARDS; i++) {
+        sh = &ctx->session_shards[i];
+        ssl_session_shard_lock(ctx, sh, CRYPTO_LOCK | CRYPTO_WRITE);
+        flush_expired(ctx, sh, t, SSL_SESS_FLUSH_BATCH / SSL_SESS_CACHE_SHARDS);
+        ssl_session_shard_lock(ctx, sh, CRYPTO_UNLOCK | CRYPTO_WRITE);
+    }
+}
+
+SSL_SESS_SHARD *ssl_session_shard(SSL_CTX *ctx, const SSL_SESSION *s)
+{
+    unsigned int i, h = 0;
+
+    /*
+     * Unlike the lhash hash, which only looks at the first four bytes, mix
+     * in the whole ID so that short IDs set by a GEN_SESSION_CB still spread
+     * over all shards.
+     */
+    for (i = 0; i < s->session_id_length; i++)
+        h = (h * 31) + s->session_id[i];
+    return &ctx->session_shards[h & (SSL_SESS_CACHE_SHARDS - 1)];
+}
+
+/*
+ * Lock or unlock the part of |ctx|'s session cache guarded by |sh|. A NULL
+ * |sh| refers to the unsharded cache which uses the SSL_CTX lock.
+ */
+void ssl_session_shard_lock(SSL_CTX *ctx, SSL_SESS_SHARD *sh, int mode)
+{
+    CRYPTO_RWLOCK *lock = sh != NULL ? sh->lock : ctx->lock;
+
+    if (!(mode & CRYPTO_LOCK))
+        CRYPTO_THREAD_unlock(lock);
+    else if (mode & CRYPTO_READ)
+        CRYPTO_THREAD_read_lock(lock);
+    else
+        CRYPTO_THREAD_write_lock(lock);
+}
+
+long ssl_session_shards_num_items(SSL_CTX *ctx)
+{
+    long n = 0;
+    int i;
+
+    for (i = 0; i < SSL_SESS_CACHE_SHARDS; i++)
+        n += lh_SSL_SESSION_num_items(ctx->session_shards[i].sessions);
+    return n;
+}
+
+long ssl_session_shards_cache_full(SSL_CTX *ctx)
+{
+    long n = 0;
+    int i;
+
+    for (i = 0; i < SSL_SESS_CACHE_SHARDS; i++)
+        n += ctx->session_shards[i].sess_cache_full;
+    return n;
+}
+
+/* The shards must have been emptied by SSL_CTX_flush_sessions() first */
+void ssl_session_shards_free(SSL_CTX *ctx)
+{
+    SSL_SESS_SHARD *sh;
+    int i;
+
+    if (ctx->session_shards == NULL)
+        return;
+    for (i = 0; i < SSL_SESS_CACHE_SHARDS; i++) {
+        sh = &ctx->session_shards[i];
+        ctx->stats.sess_cache_full += sh->sess_cache_full;
+        lh_SSL_SESSION_free(sh->sessions);
+        OPENSSL_free(sh->timeouts.heap);
+        CRYPTO_THREAD_lock_free(sh->lock);
+    }
+    OPENSSL_free(ctx->session_shards);
+    ctx->session_shards = NULL;
 }
 
 int ssl_clear_bad_session(SSL *s)
@@ -1083,27 +1338,35 @@ int ssl_clear_bad_session(SSL *s)
         return (0);
 }
 
-/* locked by SSL_CTX in the calling function */
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
+/*
+ * locked by SSL_CTX (or by |sh| for a sharded cache) in the calling function
+ */
+static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESS_SHARD *sh,
+                                    SSL_SESSION *s)
 {
+    SSL_SESSION **head = sh != NULL ? &sh->session_cache_head
+                                    : &ctx->session_cache_head;
+    SSL_SESSION **tail = sh != NULL ? &sh->session_cache_tail
+                                    : &ctx->session_cache_tail;
+
     if ((s->next == NULL) || (s->prev == NULL))
         return;
 
-    if (s->next == (SSL_SESSION *)&(ctx->session_cache_tail)) {
+    if (s->next == (SSL_SESSION *)tail) {
         /* last element in list */
-        if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head)) {
+        if (s->prev == (SSL_SESSION *)head) {
             /* only one element in list */
-            ctx->session_cache_head = NULL;
-            ctx->session_cache_tail = NULL;
+            *head = NULL;
+            *tail = NULL;
         } else {
-            ctx->session_cache_tail = s->prev;
-            s->prev->next = (SSL_SESSION *)&(ctx->session_cache_tail);
+            *tail = s->prev;
+            s->prev->next = (SSL_SESSION *)tail;
         }
     } else {
-        if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head)) {
+        if (s->prev == (SSL_SESSION *)head) {
             /* first element in list */
-            ctx->session_cache_head = s->next;
-            s->next->prev = (SSL_SESSION *)&(ctx->session_cache_head);
+            *head = s->next;
+            s->next->prev = (SSL_SESSION *)head;
         } else {
             /* middle of list */
             s->next->prev = s->prev;
@@ -1113,21 +1376,27 @@ static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
     s->prev = s->next = NULL;
 }
 
-static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s)
+static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESS_SHARD *sh,
+                                 SSL_SESSION *s)
 {
+    SSL_SESSION **head = sh != NULL ? &sh->session_cache_head
+                                    : &ctx->session_cache_head;
+    SSL_SESSION **tail = sh != NULL ? &sh->session_cache_tail
+                                    : &ctx->session_cache_tail;
+
     if ((s->next != NULL) && (s->prev != NULL))
-        SSL_SESSION_list_remove(ctx, s);
+        SSL_SESSION_list_remove(ctx, sh, s);
 
-    if (ctx->session_cache_head == NULL) {
-        ctx->session_cache_head = s;
-        ctx->session_cache_tail = s;
-        s->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-        s->next = (SSL_SESSION *)&(ctx->session_cache_tail);
+    if (*head == NULL) {
+        *head = s;
+        *tail = s;
+        s->prev = (SSL_SESSION *)head;
+        s->next = (SSL_SESSION *)tail;
     } else {
-        s->next = ctx->session_cache_head;
+        s->next = *head;
         s->next->prev = s;
-        s->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-        ctx->session_cache_head = s;
+        s->prev = (SSL_SESSION *)head;
+        *head = s;
     }
 }
 
@@ -1631,6 +1631,8 @@ MSG_PROCESS_RETURN tls_process_key_exchange(SSL *s, PACKET *pkt)
 #ifndef OPENSSL_NO_EC
     EC_KEY_free(s->s3->peer_ecdh_tmp);
     s->s3->peer_ecdh_tmp = NULL;
+    EVP_PKEY_free(s->s3->peer_tmp);
+    s->s3->peer_tmp = NULL;
 #endif
 
     alg_a = s->s3->tmp.new_cipher->algorithm_auth;
@@ -1802,11 +1804,6 @@ MSG_PROCESS_RETURN tls_process_key_exchange(SSL *s, PACKET *pkt)
         PACKET encoded_pt;
         unsigned char *ecparams;
 
-        if ((ecdh = EC_KEY_new()) == NULL) {
-            SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_MALLOC_FAILURE);
-            goto err;
-        }
-
         /*
          * Extract elliptic curve parameters and the server's ephemeral ECDH
          * public key. For now we only support named (not generic) curves and
@@ -1832,43 +1829,78 @@ MSG_PROCESS_RETURN tls_process_key_exchange(SSL *s, PACKET *pkt)
             goto f_err;
         }
 
-        ngroup = EC_GROUP_new_by_curve_name(curve_nid);
-        if (ngroup == NULL) {
-            SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_EC_LIB);
-            goto err;
-        }
-        if (EC_KEY_set_group(ecdh, ngroup) == 0) {
-            SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_EC_LIB);
-            goto err;
-        }
-        EC_GROUP_free(ngroup);
+        if (curve_nid == NID_X25519) {
+            /* X25519 has no EC_KEY form: keep the peer key as an EVP_PKEY */
+            if (!PACKET_get_length_prefixed_1(pkt, &encoded_pt)) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, SSL_R_LENGTH_MISMATCH);
+                goto f_err;
+            }
+            s->s3->peer_tmp = EVP_PKEY_new();
+            if (s->s3->peer_tmp == NULL
+                    || EVP_PKEY_set_type(s->s3->peer_tmp, curve_nid) <= 0) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_EVP_LIB);
+                goto err;
+            }
+            if (!EVP_PKEY_set1_tls_encodedpoint(s->s3->peer_tmp,
+                        PACKET_data(&encoded_pt),
+                        PACKET_remaining(&encoded_pt))) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, SSL_R_BAD_ECPOINT);
+                goto f_err;
+            }
+        } else {
+            if ((ecdh = EC_KEY_new()) == NULL) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_MALLOC_FAILURE);
+                goto err;
+            }
 
-        group = EC_KEY_get0_group(ecdh);
+            ngroup = EC_GROUP_new_by_curve_name(curve_nid);
+            if (ngroup == NULL) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_EC_LIB);
+                goto err;
+            }
+            if (EC_KEY_set_group(ecdh, ngroup) == 0) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_EC_LIB);
+                goto err;
+            }
+            EC_GROUP_free(ngroup);
 
-        if (SSL_C_IS_EXPORT(s->s3->tmp.new_cipher) &&
-            (EC_GROUP_get_degree(group) > 163)) {
-            al = SSL_AD_EXPORT_RESTRICTION;
-            SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE,
-                   SSL_R_ECGROUP_TOO_LARGE_FOR_CIPHER);
-            goto f_err;
-        }
+            group = EC_KEY_get0_group(ecdh);
 
-        /* Next, get the encoded ECPoint */
-        if (((srvr_ecpoint = EC_POINT_new(group)) == NULL) ||
-            ((bn_ctx = BN_CTX_new()) == NULL)) {
-            SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_MALLOC_FAILURE);
-            goto err;
-        }
+            if (SSL_C_IS_EXPORT(s->s3->tmp.new_cipher) &&
+                (EC_GROUP_get_degree(group) > 163)) {
+                al = SSL_AD_EXPORT_RESTRICTION;
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE,
+                       SSL_R_ECGROUP_TOO_LARGE_FOR_CIPHER);
+                goto f_err;
+            }
 
-        if (!PACKET_get_length_prefixed_1(pkt, &encoded_pt)) {
-            SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, SSL_R_LENGTH_MISMATCH);
-            goto f_err;
-        }
+            /* Next, get the encoded ECPoint */
+            if (((srvr_ecpoint = EC_POINT_new(group)) == NULL) ||
+                ((bn_ctx = BN_CTX_new()) == NULL)) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, ERR_R_MALLOC_FAILURE);
+                goto err;
+            }
 
-        if (EC_POINT_oct2point(group, srvr_ecpoint, PACKET_data(&encoded_pt),
-                               PACKET_remaining(&encoded_pt), bn_ctx) == 0) {
-            SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, SSL_R_BAD_ECPOINT);
-            goto f_err;
+            if (!PACKET_get_length_prefixed_1(pkt, &encoded_pt)) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, SSL_R_LENGTH_MISMATCH);
+                goto f_err;
+            }
+
+            if (EC_POINT_oct2point(group, srvr_ecpoint,
+                                   PACKET_data(&encoded_pt),
+                                   PACKET_remaining(&encoded_pt),
+                                   bn_ctx) == 0) {
+                SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, SSL_R_BAD_ECPOINT);
+                goto f_err;
+            }
+
+            EC_KEY_set_public_key(ecdh, srvr_ecpoint);
+            s->s3->peer_ecdh_tmp = ecdh;
+            ecdh = NULL;
+            BN_CTX_free(bn_ctx);
+            bn_ctx = NULL;
+            EC_POINT_free(srvr_ecpoint);
+            srvr_ecpoint = NULL;
         }
 
         /*
@@ -1886,13 +1918,6 @@ MSG_PROCESS_RETURN tls_process_key_exchange(SSL *s, PACKET *pkt)
             pkey = X509_get_pubkey(s->session->peer);
 # endif
         /* else anonymous ECDH, so no certificate or pkey. */
-        EC_KEY_set_public_key(ecdh, srvr_ecpoint);
-        s->s3->peer_ecdh_tmp = ecdh;
-        ecdh = NULL;
-        BN_CTX_free(bn_ctx);
-        bn_ctx = NULL;
-        EC_POINT_free(srvr_ecpoint);
-        srvr_ecpoint = NULL;
     } else if (alg_k) {
         al = SSL_AD_UNEXPECTED_MESSAGE;
         SSLerr(SSL_F_TLS_PROCESS_KEY_EXCHANGE, SSL_R_UNEXPECTED_MESSAGE);
@@ -2595,7 +2620,38 @@ psk_err:
 #endif
 
 #ifndef OPENSSL_NO_EC
-    else if (alg_k & (SSL_kECDHE | SSL_kECDHr | SSL_kECDHe | SSL_kECDHEPSK)) {
+    else if ((alg_k & (SSL_kECDHE | SSL_kECDHEPSK))
+             && s->s3->peer_tmp != NULL) {
+        /* X25519: generate our share and derive using EVP_PKEY */
+        EVP_PKEY *ckey;
+        size_t encoded_len;
+
+        ckey = ssl_generate_pkey(EVP_PKEY_id(s->s3->peer_tmp));
+        if (ckey == NULL) {
+            SSLerr(SSL_F_TLS_CONSTRUCT_CLIENT_KEY_EXCHANGE, ERR_R_EVP_LIB);
+            goto err;
+        }
+        if (!ssl_derive(ckey, s->s3->peer_tmp, &pms, &pmslen)) {
+            EVP_PKEY_free(ckey);
+            SSLerr(SSL_F_TLS_CONSTRUCT_CLIENT_KEY_EXCHANGE, ERR_R_EVP_LIB);
+            goto err;
+        }
+        encoded_len = EVP_PKEY_get1_tls_encodedpoint(ckey, &encodedPoint);
+        EVP_PKEY_free(ckey);
+        if (encoded_len == 0) {
+            SSLerr(SSL_F_TLS_CONSTRUCT_CLIENT_KEY_EXCHANGE, ERR_R_EC_LIB);
+            goto err;
+        }
+
+        *p = encoded_len;       /* length of encoded point */
+        p += 1;
+        memcpy(p, encodedPoint, encoded_len);
+        /* increment n to account for length field */
+        n = encoded_len + 1;
+
+        OPENSSL_free(encodedPoint);
+        encodedPoint = NULL;
+    } else if (alg_k & (SSL_kECDHE | SSL_kECDHr | SSL_kECDHe | SSL_kECDHEPSK)) {
         const EC_GROUP *srvr_group = NULL;
         EC_KEY *tkey;
         int ecdh_clnt_cert = 0;
@@ -222,8 +222,10 @@ typedef struct {
     unsigned int flags;         /* Flags: currently just field type */
 } tls_curve_info;
 
-# define TLS_CURVE_CHAR2         0x1
+# define TLS_CURVE_TYPE          0x3 /* Mask for curve type */
 # define TLS_CURVE_PRIME         0x0
+# define TLS_CURVE_CHAR2         0x1
+# define TLS_CURVE_CUSTOM        0x2
 
 static const tls_curve_info nid_list[] = {
     {NID_sect163k1, 80, TLS_CURVE_CHAR2}, /* sect163k1 (1) */
@@ -254,6 +256,7 @@ static const tls_curve_info nid_list[] = {
     {NID_brainpoolP256r1, 128, TLS_CURVE_PRIME}, /* brainpoolP256r1 (26) */
     {NID_brainpoolP384r1, 192, TLS_CURVE_PRIME}, /* brainpoolP384r1 (27) */
     {NID_brainpoolP512r1, 256, TLS_CURVE_PRIME}, /* brainpool512r1 (28) */
+    {NID_X25519, 128, TLS_CURVE_CUSTOM}, /* X25519 (29) */
 };
 
 static const unsigned char ecformats_default[] = {
@@ -264,7 +267,11 @@ static const unsigned char ecformats_default[] = {
 
 /* The client's default curves / the server's 'auto' curves. */
 static const unsigned char eccurves_auto[] = {
-    /* Prefer P-256 which has the fastest and most secure implementations. */
+    /*
+     * Prefer X25519 and then P-256, which have the fastest and most secure
+     * implementations.
+     */
+    0, 29,                      /* X25519 (29) */
     0, 23,                      /* secp256r1 (23) */
     /* Other >= 256-bit prime curves. */
     0, 25,                      /* secp521r1 (25) */
@@ -283,7 +290,11 @@ static const unsigned char eccurves_auto[] = {
 };
 
 static const unsigned char eccurves_all[] = {
-    /* Prefer P-256 which has the fastest and most secure implementations. */
+    /*
+     * Prefer X25519 and then P-256, which have the fastest and most secure
+     * implementations.
+     */
+    0, 29,                      /* X25519 (29) */
     0, 23,                      /* secp256r1 (23) */
     /* Other >= 256-bit prime curves. */
     0, 25,                      /* secp521r1 (25) */
@@ -328,7 +339,7 @@ static const unsigned char suiteb_curves[] = {
 
 int tls1_ec_curve_id2nid(int curve_id)
 {
-    /* ECC curves from RFC 4492 and RFC 7027 */
+    /* ECC curves from RFC 4492, RFC 7027 and draft-ietf-tls-rfc4492bis */
     if ((curve_id < 1) || ((unsigned int)curve_id > OSSL_NELEM(nid_list)))
         return 0;
     return nid_list[curve_id - 1].nid;
@@ -394,6 +405,8 @@ int tls1_ec_nid2curve_id(int nid)
         return 27;
     case NID_brainpoolP512r1:  /* brainpool512r1 (28) */
         return 28;
+    case NID_X25519:           /* X25519 (29) */
+        return 29;
     default:
         return 0;
     }
@@ -472,7 +485,7 @@ static int tls_curve_allowed(SSL *s, const unsigned char *curve, int op)
         return 0;
     cinfo = &nid_list[curve[1] - 1];
 # ifdef OPENSSL_NO_EC2M
-    if (cinfo->flags & TLS_CURVE_CHAR2)
+    if ((cinfo->flags & TLS_CURVE_TYPE) == TLS_CURVE_CHAR2)
         return 0;
 # endif
     return ssl_security(s, op, cinfo->secbits, cinfo->nid, (void *)curve);
@@ -2776,6 +2789,20 @@ int ssl_check_clienthello_tlsext_late(SSL *s)
             al = SSL_AD_INTERNAL_ERROR;
             goto err;
         }
+    } else if (s->tlsext_status_type == TLSEXT_STATUSTYPE_ocsp
+               && s->ctx != NULL) {
+        CERT_PKEY *certpkey = ssl_get_server_send_pkey(s);
+
+        /*
+         * No callback: staple a cached response for the certificate we are
+         * about to send, if we have a current one.
+         */
+        ssl_ocsp_staple_free(s->ocsp_staple);
+        s->ocsp_staple = NULL;
+        if (certpkey != NULL && certpkey->x509 != NULL)
+            s->ocsp_staple = ssl_ocsp_cache_get(s->ctx->ocsp_staples,
+                                                certpkey->x509);
+        s->tlsext_status_expected = s->ocsp_staple != NULL;
     } else
         s->tlsext_status_expected = 0;
 
@@ -0,0 +1,365 @@
+/* test/asynctest.c */
+/*
+ * Tests for the ASYNC job framework: pausing and resuming jobs, wait fds,
+ * pool limits and blocking pauses.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/async.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+
+#ifndef _WIN32
+# include <sys/select.h>
+#endif
+
+static int ctr = 0;
+static ASYNC_JOB *currjob = NULL;
+
+static int only_pause(void *args)
+{
+    ASYNC_pause_job();
+
+    return 1;
+}
+
+static int add_two(void *args)
+{
+    ctr++;
+    ASYNC_pause_job();
+    ctr++;
+
+    return 2;
+}
+
+static int save_current(void *args)
+{
+    currjob = ASYNC_get_current_job();
+    ASYNC_pause_job();
+
+    return 1;
+}
+
+static int sum_args(void *args)
+{
+    int *vals = args;
+
+    ASYNC_pause_job();
+
+    return vals[0] + vals[1];
+}
+
+static int wake(void *args)
+{
+    ASYNC_JOB *job = ASYNC_get_current_job();
+
+    ASYNC_wake(job);
+    ASYNC_pause_job();
+    ASYNC_clear_wake(job);
+
+    return 1;
+}
+
+static int blockpause(void *args)
+{
+    ASYNC_block_pause();
+    ASYNC_pause_job();
+    ASYNC_unblock_pause();
+    ASYNC_pause_job();
+
+    return 1;
+}
+
+static int test_ASYNC_start_job(void)
+{
+    ASYNC_JOB *job = NULL;
+    int ret;
+
+    ctr = 0;
+
+    if (!ASYNC_init_thread(1, 0)
+            || ASYNC_start_job(&job, &ret, add_two, NULL, 0) != ASYNC_PAUSE
+            || ctr != 1
+            || ASYNC_start_job(&job, &ret, add_two, NULL, 0) != ASYNC_FINISH
+            || ctr != 2
+            || ret != 2
+            || job != NULL) {
+        fprintf(stderr, "test_ASYNC_start_job() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+
+    ASYNC_cleanup_thread();
+    return 1;
+}
+
+static int test_ASYNC_init_thread(void)
+{
+    ASYNC_JOB *job1 = NULL, *job2 = NULL, *job3 = NULL;
+    int funcret1, funcret2, funcret3;
+
+    if (ASYNC_init_thread(1, 2)) {
+        fprintf(stderr, "test_ASYNC_init_thread() accepted a bad pool size\n");
+        return 0;
+    }
+    ERR_clear_error();
+
+    if (!ASYNC_init_thread(2, 0)
+            || ASYNC_init_thread(2, 0)
+            || ASYNC_start_job(&job1, &funcret1, only_pause, NULL, 0)
+                != ASYNC_PAUSE
+            || ASYNC_start_job(&job2, &funcret2, only_pause, NULL, 0)
+                != ASYNC_PAUSE
+            || ASYNC_start_job(&job3, &funcret3, only_pause, NULL, 0)
+                != ASYNC_NO_JOBS
+            || ASYNC_start_job(&job1, &funcret1, only_pause, NULL, 0)
+                != ASYNC_FINISH
+            || ASYNC_start_job(&job3, &funcret3, only_pause, NULL, 0)
+                != ASYNC_PAUSE
+            || ASYNC_start_job(&job2, &funcret2, only_pause, NULL, 0)
+                != ASYNC_FINISH
+            || ASYNC_start_job(&job3, &funcret3, only_pause, NULL, 0)
+                != ASYNC_FINISH
+            || funcret1 != 1
+            || funcret2 != 1
+            || funcret3 != 1) {
+        fprintf(stderr, "test_ASYNC_init_thread() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+    ERR_clear_error();
+
+    ASYNC_cleanup_thread();
+    return 1;
+}
+
+static int test_ASYNC_get_current_job(void)
+{
+    ASYNC_JOB *job = NULL;
+    int funcret;
+
+    currjob = NULL;
+    if (!ASYNC_init_thread(1, 0)
+            || ASYNC_start_job(&job, &funcret, save_current, NULL, 0)
+                != ASYNC_PAUSE
+            || currjob != job
+            || ASYNC_get_current_job() != NULL
+            || ASYNC_start_job(&job, &funcret, save_current, NULL, 0)
+                != ASYNC_FINISH
+            || funcret != 1) {
+        fprintf(stderr, "test_ASYNC_get_current_job() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+
+    ASYNC_cleanup_thread();
+    return 1;
+}
+
+static int test_ASYNC_args(void)
+{
+    ASYNC_JOB *job = NULL;
+    int vals[2] = { 3, 4 };
+    int funcret;
+
+    /* The arguments are copied, so the caller's copy can change */
+    if (!ASYNC_init_thread(1, 0)
+            || ASYNC_start_job(&job, &funcret, sum_args, vals, sizeof(vals))
+                != ASYNC_PAUSE) {
+        fprintf(stderr, "test_ASYNC_args() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+    vals[0] = 100;
+    if (ASYNC_start_job(&job, &funcret, sum_args, vals, sizeof(vals))
+            != ASYNC_FINISH
+            || funcret != 7) {
+        fprintf(stderr, "test_ASYNC_args() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+
+    ASYNC_cleanup_thread();
+    return 1;
+}
+
+static int wait_fd_ready(OSSL_ASYNC_FD fd)
+{
+#ifdef _WIN32
+    return 1;
+#else
+    fd_set waitfdset;
+    struct timeval tv = { 0, 0 };
+
+    FD_ZERO(&waitfdset);
+    FD_SET(fd, &waitfdset);
+    return select(fd + 1, &waitfdset, NULL, NULL, &tv) == 1;
+#endif
+}
+
+static int test_ASYNC_get_wait_fd(void)
+{
+    ASYNC_JOB *job = NULL;
+    int funcret;
+    OSSL_ASYNC_FD fd;
+
+    if (!ASYNC_init_thread(1, 0)
+            || ASYNC_start_job(&job, &funcret, wake, NULL, 0)
+                != ASYNC_PAUSE) {
+        fprintf(stderr, "test_ASYNC_get_wait_fd() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+    fd = ASYNC_get_wait_fd(job);
+    if (!wait_fd_ready(fd)) {
+        fprintf(stderr, "test_ASYNC_get_wait_fd() wait fd not readable\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+    if (ASYNC_start_job(&job, &funcret, wake, NULL, 0) != ASYNC_FINISH
+            || funcret != 1) {
+        fprintf(stderr, "test_ASYNC_get_wait_fd() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+
+    ASYNC_cleanup_thread();
+    return 1;
+}
+
+static int test_ASYNC_block_pause(void)
+{
+    ASYNC_JOB *job = NULL;
+    int funcret;
+
+    /* Only the second pause, after unblocking, takes effect */
+    if (!ASYNC_init_thread(1, 0)
+            || ASYNC_start_job(&job, &funcret, blockpause, NULL, 0)
+                != ASYNC_PAUSE
+            || ASYNC_start_job(&job, &funcret, blockpause, NULL, 0)
+                != ASYNC_FINISH
+            || funcret != 1) {
+        fprintf(stderr, "test_ASYNC_block_pause() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+
+    ASYNC_cleanup_thread();
+    return 1;
+}
+
+static int test_ASYNC_abort_job(void)
+{
+    ASYNC_JOB *job1 = NULL, *job2 = NULL;
+    int funcret;
+
+    /* Aborting the only job in a full pool must make room for another */
+    if (!ASYNC_init_thread(1, 0)
+            || ASYNC_start_job(&job1, &funcret, only_pause, NULL, 0)
+                != ASYNC_PAUSE
+            || ASYNC_start_job(&job2, &funcret, only_pause, NULL, 0)
+                != ASYNC_NO_JOBS) {
+        fprintf(stderr, "test_ASYNC_abort_job() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+    ASYNC_abort_job(job1);
+    job2 = NULL;
+    if (ASYNC_start_job(&job2, &funcret, only_pause, NULL, 0)
+                != ASYNC_PAUSE
+            || ASYNC_start_job(&job2, &funcret, only_pause, NULL, 0)
+                != ASYNC_FINISH
+            || funcret != 1) {
+        fprintf(stderr, "test_ASYNC_abort_job() failed\n");
+        ASYNC_cleanup_thread();
+        return 0;
+    }
+
+    ASYNC_cleanup_thread();
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 1;
+
+    CRYPTO_malloc_debug_init();
+    CRYPTO_set_mem_debug_options(V_CRYPTO_MDEBUG_ALL);
+    CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_ON);
+
+    if (!ASYNC_is_capable()) {
+        fprintf(stderr,
+                "OpenSSL build is not ASYNC capable - skipping async tests\n");
+        ret = 0;
+    } else if (test_ASYNC_start_job()
+               && test_ASYNC_init_thread()
+               && test_ASYNC_get_current_job()
+               && test_ASYNC_args()
+               && test_ASYNC_get_wait_fd()
+               && test_ASYNC_block_pause()
+               && test_ASYNC_abort_job()) {
+        printf("PASS\n");
+        ret = 0;
+    }
+
+    ERR_print_errors_fp(stderr);
+    ERR_free_strings();
+    ERR_remove_thread_state(NULL);
+    CRYPTO_mem_leaks_fp(stderr);
+    return ret;
+}
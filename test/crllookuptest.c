@@ -0,0 +1,464 @@
+/* test/crllookuptest.c */
+/*
+ * Tests and benchmarks CRL serial number lookups: builds a large CRL,
+ * then measures decoding time, memory use and lookup latency. With -lazy
+ * the CRL is decoded with d2i_X509_CRL_lazy().
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#ifndef OPENSSL_NO_EC
+# include <openssl/ec.h>
+#else
+# include <openssl/rsa.h>
+#endif
+
+#ifdef OPENSSL_SYS_UNIX
+# include <sys/time.h>
+#endif
+
+#define DEFAULT_ENTRIES     20000
+#define DEFAULT_LOOKUPS     200000
+
+/*
+ * The last INDIRECT entries of an indirect CRL are for certificates from
+ * another issuer, and reuse serial numbers of the CRL issuer's own entries.
+ */
+#define INDIRECT            16
+
+/* The entry with this index has the removeFromCRL reason code */
+#define REMOVED             1
+
+static size_t mem_in_use = 0;
+
+/* Keep the size of each block in front of it to count memory in use */
+static void *count_malloc(size_t n)
+{
+    size_t *p = malloc(n + sizeof(size_t) * 2);
+
+    if (p == NULL)
+        return NULL;
+    p[0] = n;
+    mem_in_use += n;
+    return p + 2;
+}
+
+static void *count_realloc(void *ptr, size_t n)
+{
+    size_t *p = ptr, old;
+
+    if (p == NULL)
+        return count_malloc(n);
+    p -= 2;
+    old = p[0];
+    if ((p = realloc(p, n + sizeof(size_t) * 2)) == NULL)
+        return NULL;
+    p[0] = n;
+    mem_in_use += n - old;
+    return p + 2;
+}
+
+static void count_free(void *ptr)
+{
+    size_t *p = ptr;
+
+    if (p == NULL)
+        return;
+    p -= 2;
+    mem_in_use -= p[0];
+    free(p);
+}
+
+static double now(void)
+{
+#ifdef OPENSSL_SYS_UNIX
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Serial number of entry |i|: spread out and of varying length */
+static long entry_serial(long i)
+{
+    return i * 7919 + (i % 3) * 0x1000000;
+}
+
+static EVP_PKEY *make_key(void)
+{
+    EVP_PKEY *pkey = EVP_PKEY_new();
+#ifndef OPENSSL_NO_EC
+    EC_KEY *ec = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+
+    if (pkey == NULL || ec == NULL || !EC_KEY_generate_key(ec)
+        || !EVP_PKEY_assign_EC_KEY(pkey, ec)) {
+        EC_KEY_free(ec);
+        EVP_PKEY_free(pkey);
+        return NULL;
+    }
+#else
+    RSA *rsa = RSA_new();
+    BIGNUM *e = BN_new();
+
+    if (pkey == NULL || rsa == NULL || e == NULL || !BN_set_word(e, RSA_F4)
+        || !RSA_generate_key_ex(rsa, 1024, e, NULL)
+        || !EVP_PKEY_assign_RSA(pkey, rsa)) {
+        BN_free(e);
+        RSA_free(rsa);
+        EVP_PKEY_free(pkey);
+        return NULL;
+    }
+    BN_free(e);
+#endif
+    return pkey;
+}
+
+static X509_NAME *make_name(const char *cn)
+{
+    X509_NAME *name = X509_NAME_new();
+
+    if (name == NULL
+        || !X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                       (unsigned char *)cn, -1, -1, 0)) {
+        X509_NAME_free(name);
+        return NULL;
+    }
+    return name;
+}
+
+static int add_entry(X509_CRL *crl, long serial, ASN1_TIME *date,
+                     int reason, GENERAL_NAMES *issuer)
+{
+    X509_REVOKED *rev = X509_REVOKED_new();
+    ASN1_INTEGER *ser = ASN1_INTEGER_new();
+    ASN1_ENUMERATED *rtmp = NULL;
+    int ok = 0;
+
+    if (rev == NULL || ser == NULL || !ASN1_INTEGER_set(ser, serial)
+        || !X509_REVOKED_set_serialNumber(rev, ser)
+        || !X509_REVOKED_set_revocationDate(rev, date))
+        goto end;
+    if (reason != CRL_REASON_NONE
+        && ((rtmp = ASN1_ENUMERATED_new()) == NULL
+            || !ASN1_ENUMERATED_set(rtmp, reason)
+            || !X509_REVOKED_add1_ext_i2d(rev, NID_crl_reason, rtmp, 0, 0)))
+        goto end;
+    if (issuer != NULL
+        && !X509_REVOKED_add1_ext_i2d(rev, NID_certificate_issuer, issuer,
+                                      1, 0))
+        goto end;
+    if (!X509_CRL_add0_revoked(crl, rev))
+        goto end;
+    rev = NULL;
+    ok = 1;
+ end:
+    ASN1_ENUMERATED_free(rtmp);
+    ASN1_INTEGER_free(ser);
+    X509_REVOKED_free(rev);
+    return ok;
+}
+
+/*
+ * Make the DER encoding of a CRL from "CN=Test CA" signed with |pkey|,
+ * with |n| entries followed by |indirect| entries for "CN=Other CA".
+ */
+static int make_crl(EVP_PKEY *pkey, long n, int indirect,
+                    unsigned char **der, long *derlen)
+{
+    X509_CRL *crl = X509_CRL_new();
+    X509_NAME *name = NULL;
+    ASN1_TIME *date = NULL;
+    GENERAL_NAMES *other = NULL;
+    GENERAL_NAME *gen = NULL;
+    long i;
+    int len, ok = 0;
+
+    *der = NULL;
+    if (crl == NULL || (name = make_name("Test CA")) == NULL
+        || (date = X509_gmtime_adj(NULL, 0)) == NULL
+        || !X509_CRL_set_version(crl, 1)
+        || !X509_CRL_set_issuer_name(crl, name)
+        || !X509_CRL_set_lastUpdate(crl, date))
+        goto end;
+    for (i = 0; i < n; i++) {
+        if (!add_entry(crl, entry_serial(i), date,
+                       i == REMOVED ? CRL_REASON_REMOVE_FROM_CRL
+                                    : CRL_REASON_NONE, NULL))
+            goto end;
+    }
+
+    if ((other = GENERAL_NAMES_new()) == NULL
+        || (gen = GENERAL_NAME_new()) == NULL
+        || (gen->d.directoryName = make_name("Other CA")) == NULL)
+        goto end;
+    gen->type = GEN_DIRNAME;
+    if (!sk_GENERAL_NAME_push(other, gen))
+        goto end;
+    gen = NULL;
+    for (i = 0; i < indirect; i++) {
+        /* The certificate issuer extension applies to the entries after */
+        if (!add_entry(crl, entry_serial(i), date, CRL_REASON_NONE,
+                       i == 0 ? other : NULL))
+            goto end;
+    }
+
+    if (!X509_CRL_sign(crl, pkey, EVP_sha256()))
+        goto end;
+    if ((len = i2d_X509_CRL(crl, der)) <= 0)
+        goto end;
+    *derlen = len;
+    ok = 1;
+ end:
+    GENERAL_NAME_free(gen);
+    GENERAL_NAMES_free(other);
+    ASN1_TIME_free(date);
+    X509_NAME_free(name);
+    X509_CRL_free(crl);
+    return ok;
+}
+
+static X509_CRL *decode_crl(const unsigned char *der, long derlen, int lazy)
+{
+    if (lazy)
+        return d2i_X509_CRL_lazy(NULL, &der, derlen);
+    return d2i_X509_CRL(NULL, &der, derlen);
+}
+
+/*
+ * Check the lookups of a few of the |n| entries, and of the |indirect|
+ * entries for the other issuer.
+ */
+static int check_crl(X509_CRL *crl, long n, int indirect)
+{
+    X509 *x = X509_new();
+    X509_NAME *other = make_name("Other CA");
+    ASN1_INTEGER *ser = ASN1_INTEGER_new();
+    X509_REVOKED *rev;
+    long i;
+    int ok = 0, expected;
+
+    if (x == NULL || other == NULL || ser == NULL
+        || !X509_set_issuer_name(x, X509_CRL_get_issuer(crl)))
+        goto end;
+
+    for (i = 0; i < n; i += i < REMOVED ? 1 : n / 100 + 1) {
+        /* Present, and found both by serial and by certificate */
+        expected = i == REMOVED ? 2 : 1;
+        if (!ASN1_INTEGER_set(ser, entry_serial(i))
+            || X509_CRL_get0_by_serial(crl, &rev, ser) != expected
+            || ASN1_INTEGER_cmp(X509_REVOKED_get0_serialNumber(rev), ser)
+            || !X509_set_serialNumber(x, ser)
+            || X509_CRL_get0_by_cert(crl, &rev, x) != expected)
+            goto end;
+        /* Absent */
+        if (!ASN1_INTEGER_set(ser, entry_serial(i) + 1)
+            || X509_CRL_get0_by_serial(crl, &rev, ser) != 0)
+            goto end;
+    }
+
+    /* Entries for the other issuer only match its certificates */
+    if (!X509_set_issuer_name(x, other))
+        goto end;
+    for (i = 0; i < INDIRECT + 1; i++) {
+        if (!ASN1_INTEGER_set(ser, entry_serial(i))
+            || !X509_set_serialNumber(x, ser)
+            || X509_CRL_get0_by_cert(crl, &rev, x) != (i < indirect))
+            goto end;
+    }
+    ok = 1;
+ end:
+    ASN1_INTEGER_free(ser);
+    X509_NAME_free(other);
+    X509_free(x);
+    return ok;
+}
+
+/* Check that |crl| encodes as |der| and that its signature verifies */
+static int check_encoding(X509_CRL *crl, const unsigned char *der,
+                          long derlen, EVP_PKEY *pkey)
+{
+    unsigned char *enc = NULL;
+    int len, ok;
+
+    len = i2d_X509_CRL(crl, &enc);
+    ok = len == derlen && memcmp(enc, der, len) == 0
+        && X509_CRL_verify(crl, pkey) == 1;
+    OPENSSL_free(enc);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    long n = DEFAULT_ENTRIES, lookups = DEFAULT_LOOKUPS, derlen = 0, i;
+    unsigned char *der = NULL;
+    EVP_PKEY *pkey = NULL;
+    X509_CRL *crl = NULL;
+    ASN1_INTEGER *ser = NULL;
+    size_t mem;
+    double start, secs;
+    int lazy = 0, found = 0, ret = 1;
+
+    if (!CRYPTO_set_mem_functions(count_malloc, count_realloc, count_free)) {
+        fprintf(stderr, "Can't count memory use\n");
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            n = atol(argv[++i]);
+        else if (strcmp(argv[i], "-lookups") == 0 && i + 1 < argc)
+            lookups = atol(argv[++i]);
+        else if (strcmp(argv[i], "-lazy") == 0)
+            lazy = 1;
+        else
+            break;
+    }
+    if (i != argc || n < INDIRECT + 1 || lookups < 1) {
+        fprintf(stderr, "usage: %s [-lazy] [-n entries] [-lookups n]\n",
+                argv[0]);
+        return 1;
+    }
+
+    ERR_load_crypto_strings();
+    OpenSSL_add_all_digests();
+
+    /* Lazy decoding is only used for direct CRLs */
+    if ((pkey = make_key()) == NULL
+        || !make_crl(pkey, n, lazy ? 0 : INDIRECT, &der, &derlen)) {
+        printf("Error making CRL\n");
+        goto end;
+    }
+
+    mem = mem_in_use;
+    start = now();
+    if ((crl = decode_crl(der, derlen, lazy)) == NULL) {
+        printf("Error decoding CRL\n");
+        goto end;
+    }
+    secs = now() - start;
+    printf("Decoded %ld entry CRL (%ld bytes) in %.3f seconds"
+           " using %lu bytes\n", n + (lazy ? 0 : INDIRECT), derlen, secs,
+           (unsigned long)(mem_in_use - mem));
+
+    if (lazy && X509_CRL_get_REVOKED(crl) != NULL) {
+        printf("CRL entries were decoded\n");
+        goto end;
+    }
+    if (!check_crl(crl, n, lazy ? 0 : INDIRECT)) {
+        printf("CRL lookup gave wrong result\n");
+        goto end;
+    }
+    if (!check_encoding(crl, der, derlen, pkey)) {
+        printf("CRL encoding or signature changed\n");
+        goto end;
+    }
+
+    if ((ser = ASN1_INTEGER_new()) == NULL)
+        goto end;
+    start = now();
+    for (i = 0; i < lookups; i++) {
+        /* Alternate between present and absent serial numbers */
+        ASN1_INTEGER_set(ser, entry_serial((i * 7) % n) + (i & 1));
+        if (X509_CRL_get0_by_serial(crl, NULL, ser) > 0)
+            found++;
+    }
+    secs = now() - start;
+    if (found != (lookups + 1) / 2) {
+        printf("%d of %ld serial numbers found\n", found, lookups);
+        goto end;
+    }
+    printf("%ld lookups took %.3f seconds (%.0f ns per lookup)\n",
+           lookups, secs, secs * 1e9 / lookups);
+
+    if (lazy) {
+        /* Indirect CRLs are decoded in full */
+        X509_CRL_free(crl);
+        OPENSSL_free(der);
+        crl = NULL;
+        if (!make_crl(pkey, INDIRECT + 1, INDIRECT, &der, &derlen)
+            || (crl = decode_crl(der, derlen, lazy)) == NULL
+            || X509_CRL_get_REVOKED(crl) == NULL
+            || !check_crl(crl, INDIRECT + 1, INDIRECT)
+            || !check_encoding(crl, der, derlen, pkey)) {
+            printf("Indirect CRL failed\n");
+            goto end;
+        }
+    }
+    ret = 0;
+ end:
+    ASN1_INTEGER_free(ser);
+    X509_CRL_free(crl);
+    OPENSSL_free(der);
+    EVP_PKEY_free(pkey);
+    ERR_print_errors_fp(stderr);
+    EVP_cleanup();
+    ERR_free_strings();
+    ERR_remove_thread_state(NULL);
+    if (ret == 0)
+        printf("PASS\n");
+    return ret;
+}
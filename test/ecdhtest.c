@@ -520,6 +520,7 @@ int main(int argc, char *argv[])
     ERR_print_errors_fp(stderr);
     BN_CTX_free(ctx);
     BIO_free(out);
+    RAND_cleanup();
     CRYPTO_cleanup_all_ex_data();
     ERR_remove_thread_state(NULL);
     CRYPTO_mem_leaks_fp(stderr);
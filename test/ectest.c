@@ -1666,6 +1666,7 @@ int main(int argc, char *argv[])
 # ifndef OPENSSL_NO_ENGINE
     ENGINE_cleanup();
 # endif
+    RAND_cleanup();
     CRYPTO_cleanup_all_ex_data();
     ERR_free_strings();
     ERR_remove_thread_state(NULL);
@@ -0,0 +1,273 @@
+/* test/errthreadtest.c */
+/*
+ * Checks that error queues are private to each thread and measures the cost
+ * of ERR_put_error()/ERR_clear_error() as the number of threads grows.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/opensslconf.h>
+
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX)
+# define ERRTHREAD_PTHREADS
+# include <pthread.h>
+# include <sys/time.h>
+#endif
+
+#ifdef ERRTHREAD_PTHREADS
+
+typedef struct {
+    int idx;
+    int num;
+    int failed;
+} ERR_JOB;
+
+/*
+ * Queue errors tagged with this thread's index and make sure only those come
+ * back out. Other threads are doing the same thing at the same time.
+ */
+static void *check_loop(void *arg)
+{
+    ERR_JOB *job = arg;
+    unsigned long e;
+    int i, j;
+
+    for (i = 0; i < job->num; i++) {
+        for (j = 0; j < 4; j++)
+            ERR_put_error(ERR_LIB_USER, job->idx, j + 1, __FILE__, __LINE__);
+        for (j = 0; j < 4; j++) {
+            e = ERR_get_error();
+            if (ERR_GET_LIB(e) != ERR_LIB_USER
+                || ERR_GET_FUNC(e) != job->idx
+                || ERR_GET_REASON(e) != j + 1) {
+                job->failed = 1;
+                return NULL;
+            }
+        }
+        if (ERR_peek_error() != 0) {
+            job->failed = 1;
+            return NULL;
+        }
+    }
+    /* Leave something behind to be freed when the thread exits */
+    ERR_put_error(ERR_LIB_USER, job->idx, 1, __FILE__, __LINE__);
+    return NULL;
+}
+
+static void *bench_loop(void *arg)
+{
+    ERR_JOB *job = arg;
+    int i;
+
+    for (i = 0; i < job->num; i++) {
+        ERR_put_error(ERR_LIB_USER, job->idx, 1, __FILE__, __LINE__);
+        ERR_clear_error();
+    }
+    return NULL;
+}
+
+static pthread_mutex_t *static_locks = NULL;
+
+static void static_lock_cb(int mode, int type, const char *file, int line)
+{
+    if (mode & CRYPTO_LOCK)
+        pthread_mutex_lock(&static_locks[type]);
+    else
+        pthread_mutex_unlock(&static_locks[type]);
+}
+
+static int threads_setup(void)
+{
+    int i;
+
+    static_locks = OPENSSL_malloc(CRYPTO_num_locks() * sizeof(*static_locks));
+    if (static_locks == NULL)
+        return 0;
+    for (i = 0; i < CRYPTO_num_locks(); i++)
+        pthread_mutex_init(&static_locks[i], NULL);
+    CRYPTO_set_locking_callback(static_lock_cb);
+    return 1;
+}
+
+static void threads_cleanup(void)
+{
+    int i;
+
+    if (static_locks == NULL)
+        return;
+    CRYPTO_set_locking_callback(NULL);
+    for (i = 0; i < CRYPTO_num_locks(); i++)
+        pthread_mutex_destroy(&static_locks[i]);
+    OPENSSL_free(static_locks);
+    static_locks = NULL;
+}
+
+/*
+ * Run |fn| in |nthreads| threads, |num| iterations each. Returns the total
+ * number of iterations per second, or a negative value on failure.
+ */
+static double run_threads(void *(*fn)(void *), int nthreads, int num)
+{
+    ERR_JOB *jobs;
+    pthread_t *tids;
+    struct timeval start, end;
+    double secs;
+    int i, failed = 0;
+
+    jobs = OPENSSL_zalloc(nthreads * sizeof(*jobs));
+    tids = OPENSSL_malloc(nthreads * sizeof(*tids));
+    if (jobs == NULL || tids == NULL) {
+        OPENSSL_free(jobs);
+        OPENSSL_free(tids);
+        return -1;
+    }
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < nthreads; i++) {
+        jobs[i].idx = i + 1;
+        jobs[i].num = num;
+        if (pthread_create(&tids[i], NULL, fn, &jobs[i]) != 0) {
+            nthreads = i;
+            failed = 1;
+            break;
+        }
+    }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(tids[i], NULL);
+        failed |= jobs[i].failed;
+    }
+    gettimeofday(&end, NULL);
+
+    OPENSSL_free(jobs);
+    OPENSSL_free(tids);
+    if (failed)
+        return -1;
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+    if (secs <= 0)
+        secs = 1e-6;
+    return (double)nthreads * num / secs;
+}
+
+static int bench(int maxthreads, int num)
+{
+    double rate;
+    int n;
+
+    printf("%8s %16s %20s\n", "threads", "put+clear/s", "per thread/s");
+    for (n = 1; n <= maxthreads; n *= 2) {
+        if ((rate = run_threads(bench_loop, n, num)) < 0)
+            return 0;
+        printf("%8d %16.1f %20.1f\n", n, rate, rate / n);
+        fflush(stdout);
+    }
+    return 1;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    int benchmark = 0, nthreads = 8, num = 1000, ret = 1;
+
+    for (argc--, argv++; argc > 0; argc--, argv++) {
+        if (strcmp(*argv, "-bench") == 0) {
+            benchmark = 1;
+            num = 1000000;
+        } else if (strcmp(*argv, "-threads") == 0 && argc > 1) {
+            nthreads = atoi(*++argv);
+            argc--;
+        } else if (strcmp(*argv, "-num") == 0 && argc > 1) {
+            num = atoi(*++argv);
+            argc--;
+        } else {
+            break;
+        }
+    }
+    if (argc > 0 || nthreads < 1 || num < 1) {
+        fprintf(stderr, "Usage: errthreadtest [-bench] [-threads n] [-num n]\n");
+        return 1;
+    }
+
+#ifdef ERRTHREAD_PTHREADS
+    if (!threads_setup())
+        return 1;
+    if (benchmark) {
+        if (!bench(nthreads, num))
+            goto end;
+    } else {
+        if (run_threads(check_loop, nthreads, num) < 0) {
+            printf("Error queues are not thread-private: FAILED\n");
+            goto end;
+        }
+        /* The main thread's queue must be untouched by the others */
+        if (ERR_peek_error() != 0) {
+            printf("Main thread error queue not empty: FAILED\n");
+            goto end;
+        }
+    }
+    ret = 0;
+ end:
+    threads_cleanup();
+#else
+    printf("No thread support, skipping\n");
+    ret = 0;
+#endif
+    ERR_remove_thread_state(NULL);
+    return ret;
+}
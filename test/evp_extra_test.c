@@ -73,6 +73,7 @@
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/rsa.h>
+#include <openssl/rand.h>
 #include <openssl/x509.h>
 
 /*
@@ -462,6 +463,7 @@ int main(void)
 #endif
 
     EVP_cleanup();
+    RAND_cleanup();
     CRYPTO_cleanup_all_ex_data();
     ERR_remove_thread_state(NULL);
     ERR_free_strings();
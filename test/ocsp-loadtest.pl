@@ -0,0 +1,155 @@
+#! /usr/bin/perl
+# test/ocsp-loadtest.pl
+#
+# ====================================================================
+# Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in
+#    the documentation and/or other materials provided with the
+#    distribution.
+#
+# 3. All advertising materials mentioning features or use of this
+#    software must display the following acknowledgment:
+#    "This product includes software developed by the OpenSSL Project
+#    for use in the OpenSSL Toolkit. (http://www.OpenSSL.org/)"
+#
+# 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+#    endorse or promote products derived from this software without
+#    prior written permission. For written permission, please contact
+#    licensing@OpenSSL.org.
+#
+# 5. Products derived from this software may not be called "OpenSSL"
+#    nor may "OpenSSL" appear in their names without prior written
+#    permission of the OpenSSL Project.
+#
+# 6. Redistributions of any form whatsoever must retain the following
+#    acknowledgment:
+#    "This product includes software developed by the OpenSSL Project
+#    for use in the OpenSSL Toolkit (http://www.OpenSSL.org/)"
+#
+# THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+# EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+# ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+# NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+# STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+# OF THE POSSIBILITY OF SUCH DAMAGE.
+# ====================================================================
+#
+# Load test for "openssl ocsp" running as a responder.
+#
+# Usage: ocsp-loadtest.pl [-c clients] [-n requests] [-get] host:port req.der
+#
+# Starts |clients| processes that between them send |requests| copies of the
+# DER encoded OCSP request in req.der to the responder, one per connection
+# as "openssl ocsp" expects, and reports the request rate. For example:
+#
+#   openssl ocsp -index index.txt -CA ca.pem -rsigner ca.pem -rkey ca.key \
+#       -ndays 1 -port 8888 -presign -multi 4 &
+#   openssl ocsp -issuer ca.pem -cert cert.pem -no_nonce -reqout req.der
+#   perl test/ocsp-loadtest.pl -c 8 -n 20000 localhost:8888 req.der
+
+use strict;
+use warnings;
+
+use IO::Socket::INET;
+use MIME::Base64;
+use Time::HiRes qw(time);
+
+my $clients = 4;
+my $requests = 10000;
+my $use_get = 0;
+
+while (@ARGV && $ARGV[0] =~ /^-/) {
+    my $opt = shift @ARGV;
+    if ($opt eq "-c") {
+        $clients = shift @ARGV;
+    } elsif ($opt eq "-n") {
+        $requests = shift @ARGV;
+    } elsif ($opt eq "-get") {
+        $use_get = 1;
+    } else {
+        die "Unknown option $opt\n";
+    }
+}
+die "Usage: ocsp-loadtest.pl [-c clients] [-n requests] [-get] host:port req.der\n"
+    unless @ARGV == 2 && $clients > 0 && $requests > 0;
+
+my ($server, $reqfile) = @ARGV;
+open(my $fh, "<", $reqfile) or die "Cannot open $reqfile: $!\n";
+binmode $fh;
+my $der = do { local $/; <$fh> };
+close $fh;
+
+my $http;
+if ($use_get) {
+    my $url = encode_base64($der, "");
+    $url =~ s/([^A-Za-z0-9])/sprintf("%%%02X", ord($1))/ge;
+    $http = "GET /$url HTTP/1.0\r\n\r\n";
+} else {
+    $http = "POST / HTTP/1.0\r\n"
+        . "Content-Type: application/ocsp-request\r\n"
+        . "Content-Length: " . length($der) . "\r\n\r\n" . $der;
+}
+
+# One request per connection; returns 1 if a successful response came back
+sub one_request {
+    my $sock = IO::Socket::INET->new(PeerAddr => $server, Proto => "tcp")
+        or return 0;
+    binmode $sock;
+    print $sock $http;
+    my $reply = "";
+    while (sysread($sock, my $buf, 16384)) {
+        $reply .= $buf;
+    }
+    close $sock;
+    return 0 unless $reply =~ /^HTTP\/1\.[01] 200 .*?\r\n\r\n(.)/s;
+    # Skip past the headers to the OCSPResponse; its responseStatus is the
+    # first field, an ENUMERATED that must be 0 (successful)
+    my $body = substr($reply, index($reply, "\r\n\r\n") + 4);
+    return $body =~ /^\x30.{1,4}?\x0a\x01\x00/s ? 1 : 0;
+}
+
+my $start = time();
+my @pids;
+for my $n (0 .. $clients - 1) {
+    my $share = int($requests / $clients) + ($n < $requests % $clients);
+    my $pid = fork();
+    die "fork failed: $!\n" unless defined $pid;
+    if ($pid == 0) {
+        my $failed = 0;
+        for (1 .. $share) {
+            $failed++ unless one_request();
+        }
+        exit($failed > 255 ? 255 : $failed);
+    }
+    push @pids, $pid;
+}
+
+my $failed = 0;
+foreach (@pids) {
+    waitpid($_, 0);
+    $failed += $? >> 8;
+}
+my $elapsed = time() - $start;
+
+printf "%d requests from %d clients in %.2f seconds: %.1f requests/s\n",
+    $requests, $clients, $elapsed, $requests / $elapsed;
+if ($failed) {
+    print "At least $failed requests failed\n";
+    exit 1;
+}
+exit 0;
@@ -0,0 +1,372 @@
+/* test/ocspstapletest.c */
+/*
+ * Functional test for the SSL_CTX OCSP staple cache.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/*-
+ * Usage: ocspstapletest cert.pem key.pem issuer.pem resp.der badresp.der
+ *
+ * |resp.der| must be a current OCSP response for |cert.pem| signed by
+ * |issuer.pem|, and |badresp.der| one that is not signed by the issuer.
+ * Checks that SSL_CTX_refresh_ocsp_staples() fetches and verifies a response
+ * only when it is due, that the server staples it byte for byte without a
+ * status callback, and that a bad response is never accepted or sent.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/bio.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+typedef struct {
+    unsigned char *data;
+    long len;
+} RESP;
+
+static RESP good, bad;
+static int fetches = 0;
+
+static int read_resp(const char *file, RESP *resp)
+{
+    BIO *in = BIO_new_file(file, "rb");
+    BUF_MEM *mem = NULL;
+    char buf[1024];
+    int n;
+
+    if (in == NULL || (mem = BUF_MEM_new()) == NULL)
+        goto err;
+    while ((n = BIO_read(in, buf, sizeof(buf))) > 0) {
+        if (!BUF_MEM_grow(mem, mem->length + n))
+            goto err;
+        memcpy(mem->data + mem->length - n, buf, n);
+    }
+    if (mem->length == 0)
+        goto err;
+    resp->len = (long)mem->length;
+    resp->data = (unsigned char *)mem->data;
+    mem->data = NULL;
+    BUF_MEM_free(mem);
+    BIO_free(in);
+    return 1;
+ err:
+    printf("Cannot read %s\n", file);
+    BUF_MEM_free(mem);
+    BIO_free(in);
+    return 0;
+}
+
+static X509 *read_cert(const char *file)
+{
+    BIO *in = BIO_new_file(file, "r");
+    X509 *x = NULL;
+
+    if (in != NULL)
+        x = PEM_read_bio_X509(in, NULL, NULL, NULL);
+    BIO_free(in);
+    if (x == NULL)
+        printf("Cannot read %s\n", file);
+    return x;
+}
+
+/* Hand out a copy of the RESP passed as |arg| */
+static int fetch_cb(SSL_CTX *ctx, X509 *cert, X509 *issuer,
+                    unsigned char **resp, size_t *resplen, void *arg)
+{
+    RESP *r = arg;
+
+    fetches++;
+    if ((*resp = OPENSSL_malloc(r->len)) == NULL)
+        return 0;
+    memcpy(*resp, r->data, r->len);
+    *resplen = r->len;
+    return 1;
+}
+
+/* Client side: record whatever the server stapled */
+static int status_cb(SSL *s, void *arg)
+{
+    RESP *got = arg;
+    unsigned char *p;
+    long len = SSL_get_tlsext_status_ocsp_resp(s, &p);
+
+    OPENSSL_free(got->data);
+    got->data = NULL;
+    got->len = len;
+    if (len > 0) {
+        if ((got->data = OPENSSL_malloc(len)) == NULL)
+            return 0;
+        memcpy(got->data, p, len);
+    }
+    return 1;
+}
+
+/* Drive the handshake between |c| and |s| over a BIO pair to completion */
+static int do_handshake(SSL *c, SSL *s)
+{
+    int i, r, cdone = 0, sdone = 0;
+
+    for (i = 0; i < 64 && !(cdone && sdone); i++) {
+        if (!cdone) {
+            r = SSL_do_handshake(c);
+            if (r == 1)
+                cdone = 1;
+            else if (SSL_get_error(c, r) != SSL_ERROR_WANT_READ)
+                return 0;
+        }
+        if (!sdone) {
+            r = SSL_do_handshake(s);
+            if (r == 1)
+                sdone = 1;
+            else if (SSL_get_error(s, r) != SSL_ERROR_WANT_READ)
+                return 0;
+        }
+    }
+    return cdone && sdone;
+}
+
+/*
+ * Connect a client asking for certificate status to a server from |sctx|
+ * and check that it receives |expect|, or no response if |expect| is NULL.
+ */
+static int check_staple(SSL_CTX *sctx, const RESP *expect)
+{
+    SSL_CTX *cctx = NULL;
+    SSL *c = NULL, *s = NULL;
+    BIO *cbio = NULL, *sbio = NULL;
+    RESP got = { NULL, -1 };
+    int ret = 0;
+
+    if ((cctx = SSL_CTX_new(TLS_client_method())) == NULL)
+        goto end;
+    SSL_CTX_set_tlsext_status_cb(cctx, status_cb);
+    SSL_CTX_set_tlsext_status_arg(cctx, &got);
+    if ((c = SSL_new(cctx)) == NULL || (s = SSL_new(sctx)) == NULL
+        || !BIO_new_bio_pair(&cbio, 0, &sbio, 0))
+        goto end;
+    SSL_set_bio(c, cbio, cbio);
+    SSL_set_bio(s, sbio, sbio);
+    SSL_set_connect_state(c);
+    SSL_set_accept_state(s);
+    SSL_set_tlsext_status_type(c, TLSEXT_STATUSTYPE_ocsp);
+    if (!do_handshake(c, s)) {
+        printf("Handshake failed\n");
+        goto end;
+    }
+
+    if (expect == NULL) {
+        if (got.len > 0) {
+            printf("Unexpected OCSP staple\n");
+            goto end;
+        }
+    } else if (got.len != expect->len
+               || memcmp(got.data, expect->data, got.len) != 0) {
+        printf("Stapled response differs from the cached one\n");
+        goto end;
+    }
+    ret = 1;
+ end:
+    OPENSSL_free(got.data);
+    SSL_free(c);
+    SSL_free(s);
+    SSL_CTX_free(cctx);
+    return ret;
+}
+
+static SSL_CTX *server_ctx_new(const char *certfile, const char *keyfile,
+                               X509 *issuer)
+{
+    SSL_CTX *sctx = SSL_CTX_new(TLS_server_method());
+
+    if (sctx == NULL)
+        return NULL;
+    if (SSL_CTX_use_certificate_file(sctx, certfile, SSL_FILETYPE_PEM) <= 0
+        || SSL_CTX_use_PrivateKey_file(sctx, keyfile, SSL_FILETYPE_PEM) <= 0) {
+        SSL_CTX_free(sctx);
+        return NULL;
+    }
+    X509_up_ref(issuer);
+    if (!SSL_CTX_add_extra_chain_cert(sctx, issuer)) {
+        X509_free(issuer);
+        SSL_CTX_free(sctx);
+        return NULL;
+    }
+    return sctx;
+}
+
+static int test_refresh(const char *certfile, const char *keyfile,
+                        X509 *issuer)
+{
+    SSL_CTX *sctx = server_ctx_new(certfile, keyfile, issuer);
+    int ret = 0;
+
+    if (sctx == NULL)
+        goto end;
+
+    /* Without a cache nothing is stapled, and nothing can be fetched */
+    if (!check_staple(sctx, NULL))
+        goto end;
+    if (SSL_CTX_refresh_ocsp_staples(sctx) != -1) {
+        printf("Refresh without a fetch callback succeeded\n");
+        goto end;
+    }
+    ERR_clear_error();
+
+    if (!SSL_CTX_set_ocsp_staple_fetch_cb(sctx, fetch_cb, &good))
+        goto end;
+    fetches = 0;
+    if (SSL_CTX_refresh_ocsp_staples(sctx) != 1 || fetches != 1) {
+        printf("First refresh did not fetch a response\n");
+        goto end;
+    }
+    /* The response is good for a day, so it is not due again yet */
+    if (SSL_CTX_refresh_ocsp_staples(sctx) != 0 || fetches != 1) {
+        printf("Second refresh fetched again\n");
+        goto end;
+    }
+    if (!check_staple(sctx, &good) || !check_staple(sctx, &good))
+        goto end;
+    ret = 1;
+ end:
+    SSL_CTX_free(sctx);
+    return ret;
+}
+
+static int test_bad(const char *certfile, const char *keyfile, X509 *cert,
+                    X509 *issuer)
+{
+    SSL_CTX *sctx = server_ctx_new(certfile, keyfile, issuer);
+    int ret = 0;
+
+    if (sctx == NULL)
+        goto end;
+
+    /* A response the issuer did not sign is rejected */
+    if (SSL_CTX_add_ocsp_staple(sctx, cert, issuer, bad.data, bad.len)) {
+        printf("Bad response was added\n");
+        goto end;
+    }
+    ERR_clear_error();
+    if (!SSL_CTX_set_ocsp_staple_fetch_cb(sctx, fetch_cb, &bad))
+        goto end;
+    fetches = 0;
+    if (SSL_CTX_refresh_ocsp_staples(sctx) != 0 || fetches != 1) {
+        printf("Bad response was fetched into the cache\n");
+        goto end;
+    }
+    ERR_clear_error();
+    if (!check_staple(sctx, NULL))
+        goto end;
+
+    /* A good response can still be added directly, and is stapled */
+    if (!SSL_CTX_add_ocsp_staple(sctx, cert, issuer, good.data, good.len)) {
+        printf("Good response was rejected\n");
+        goto end;
+    }
+    if (!check_staple(sctx, &good))
+        goto end;
+    ret = 1;
+ end:
+    SSL_CTX_free(sctx);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    X509 *cert = NULL, *issuer = NULL;
+    int ret = 1;
+
+    if (argc != 6) {
+        fprintf(stderr, "Usage: ocspstapletest cert.pem key.pem issuer.pem "
+                "resp.der badresp.der\n");
+        return 1;
+    }
+
+    SSL_library_init();
+    SSL_load_error_strings();
+
+    if ((cert = read_cert(argv[1])) == NULL
+        || (issuer = read_cert(argv[3])) == NULL
+        || !read_resp(argv[4], &good) || !read_resp(argv[5], &bad))
+        goto end;
+
+    if (!test_refresh(argv[1], argv[2], issuer)) {
+        printf("OCSP staple refresh: FAILED\n");
+        goto end;
+    }
+    if (!test_bad(argv[1], argv[2], cert, issuer)) {
+        printf("Bad OCSP staple: FAILED\n");
+        goto end;
+    }
+    ret = 0;
+
+ end:
+    ERR_print_errors_fp(stdout);
+    X509_free(cert);
+    X509_free(issuer);
+    OPENSSL_free(good.data);
+    OPENSSL_free(bad.data);
+    ERR_free_strings();
+    ERR_remove_thread_state(NULL);
+    EVP_cleanup();
+    CRYPTO_cleanup_all_ex_data();
+    return ret;
+}
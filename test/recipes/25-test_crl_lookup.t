@@ -0,0 +1,10 @@
+#! /usr/bin/perl
+
+use OpenSSL::Test;
+
+setup("test_crl_lookup");
+
+plan tests => 2;
+
+ok(run(test(["crllookuptest"])), "running crllookuptest");
+ok(run(test(["crllookuptest", "-lazy"])), "running crllookuptest -lazy");
@@ -11,8 +11,16 @@ setup("test_verify");
 plan skip_all => "no rehash.time was found."
     unless (-f top_file("rehash.time"));
 
-plan tests => 1;
+plan tests => 3;
 
 note("Expect some failures and expired certificate");
 ok(run(app(["openssl", "verify", "-CApath", top_dir("certs", "demo"),
 	    glob(top_file("certs", "demo", "*.pem"))])), "verying demo certs");
+ok(run(app(["openssl", "verify", "-threads", "2",
+            "-CApath", top_dir("certs", "demo"),
+	    glob(top_file("certs", "demo", "*.pem"))])),
+   "verifying demo certs in two threads");
+ok(run(app(["openssl", "verify", "-threads", "2", "-repeat", "3",
+            "-CApath", top_dir("certs", "demo"),
+	    glob(top_file("certs", "demo", "*.pem"))])),
+   "verifying demo certs three times over in two threads");
@@ -0,0 +1,49 @@
+#! /usr/bin/perl
+
+use strict;
+use warnings;
+
+use OpenSSL::Test qw/:DEFAULT top_file/;
+use OpenSSL::Test::Utils;
+
+setup("test_ocspstaple");
+
+plan skip_all => "test_ocspstaple needs OCSP and RSA enabled"
+    if disabled("ocsp") || disabled("rsa");
+
+plan tests => 4;
+
+my $leaf = top_file("test", "certs", "leaf.pem");
+my $leafkey = top_file("test", "certs", "leaf.key");
+my $issuer = top_file("test", "certs", "subinterCA.pem");
+my $issuerkey = top_file("test", "certs", "subinterCA.key");
+my $root = top_file("test", "certs", "rootCA.pem");
+my $rootkey = top_file("test", "certs", "rootCA.key");
+
+# A responder database that knows the leaf certificate as valid
+open(my $fh, ">", "ocspstaple-index.txt")
+    or die "Cannot create ocspstaple-index.txt: $!";
+print $fh "V\t350702131949Z\t\tA44DB0329A714A8D\tunknown\t",
+    "/C=AU/ST=Some-State/O=Internet Widgits Pty Ltd/CN=leaf\n";
+close $fh;
+
+ok(run(app(["openssl", "ocsp", "-issuer", $issuer, "-cert", $leaf,
+            "-no_nonce", "-reqout", "ocspstaple-req.der"])),
+   "creating OCSP request");
+ok(run(app(["openssl", "ocsp", "-index", "ocspstaple-index.txt",
+            "-rsigner", $issuer, "-rkey", $issuerkey, "-CA", $issuer,
+            "-ndays", "1", "-reqin", "ocspstaple-req.der",
+            "-respout", "ocspstaple-resp.der"])),
+   "creating OCSP response signed by the issuer");
+ok(run(app(["openssl", "ocsp", "-index", "ocspstaple-index.txt",
+            "-rsigner", $root, "-rkey", $rootkey, "-CA", $issuer,
+            "-ndays", "1", "-reqin", "ocspstaple-req.der",
+            "-respout", "ocspstaple-bad.der"])),
+   "creating OCSP response signed by another CA");
+
+ok(run(test(["ocspstapletest", $leaf, $leafkey, $issuer,
+             "ocspstaple-resp.der", "ocspstaple-bad.der"])),
+   "running ocspstapletest");
+
+unlink "ocspstaple-index.txt", "ocspstaple-req.der", "ocspstaple-resp.der",
+    "ocspstaple-bad.der";
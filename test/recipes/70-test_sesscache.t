@@ -0,0 +1,14 @@
+#! /usr/bin/perl
+
+use OpenSSL::Test qw/:DEFAULT top_file/;
+use OpenSSL::Test::Utils;
+
+setup("test_sesscache");
+
+plan skip_all => "test_sesscache needs RSA enabled"
+    if disabled("rsa");
+
+plan tests => 1;
+
+ok(run(test(["sesscachetest", top_file("apps", "server.pem")])),
+   "running sesscachetest");
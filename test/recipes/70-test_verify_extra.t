@@ -1,12 +1,20 @@
 #! /usr/bin/perl
 
+use File::Path 2.00 qw/make_path remove_tree/;
 use OpenSSL::Test qw/:DEFAULT top_file/;
 
 setup("test_verify_extra");
 
+my $dir = "verify_extra_dir";
+remove_tree($dir, { safe => 0 });
+make_path($dir);
+
 plan tests => 1;
 
 ok(run(test(["verify_extra_test",
              top_file("test", "certs", "roots.pem"),
              top_file("test", "certs", "untrusted.pem"),
-             top_file("test", "certs", "bad.pem")])));
+             top_file("test", "certs", "bad.pem"),
+             $dir])));
+
+remove_tree($dir, { safe => 0 });
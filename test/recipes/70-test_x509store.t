@@ -0,0 +1,11 @@
+#! /usr/bin/perl
+
+use OpenSSL::Test;
+
+setup("test_x509store");
+
+plan tests => 2;
+
+ok(run(test(["x509storetest"])), "running x509storetest");
+ok(run(test(["x509storetest", "-verify"])),
+   "running x509storetest -verify");
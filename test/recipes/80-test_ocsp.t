@@ -6,7 +6,7 @@ use warnings;
 use POSIX;
 use File::Spec::Functions qw/devnull catfile/;
 use File::Copy;
-use OpenSSL::Test qw/:DEFAULT with pipe top_dir/;
+use OpenSSL::Test qw/:DEFAULT with pipe top_dir top_file/;
 
 setup("test_ocsp");
 
@@ -31,7 +31,7 @@ sub test_ocsp {
 		  $title); });
 }
 
-plan tests => 10;
+plan tests => 11;
 
 subtest "=== VALID OCSP RESPONSES ===" => sub {
     plan tests => 6;
@@ -191,3 +191,43 @@ subtest "=== INVALID SIGNATURE on the ISSUER CERTIFICATE ===" => sub {
     test_ocsp("DELEGATED; Root CA -> EE",
 	      "D3.ors", "ISIC_D3_Issuer_Root.pem", 0);
 };
+
+subtest "=== RESPONSES SIGNED IN ADVANCE ===" => sub {
+    plan tests => 5;
+
+    my $leaf = top_file("test", "certs", "leaf.pem");
+    my $ca = top_file("test", "certs", "subinterCA.pem");
+    my $cakey = top_file("test", "certs", "subinterCA.key");
+    my @responder = ("openssl", "ocsp", "-index", "presign-index.txt",
+                     "-CA", $ca, "-rsigner", $ca, "-rkey", $cakey,
+                     "-ndays", "1", "-presign");
+
+    open(my $fh, ">", "presign-index.txt")
+        or die "Cannot create presign-index.txt: $!";
+    print $fh "V\t350702131949Z\t\tA44DB0329A714A8D\tunknown\t",
+        "/C=AU/ST=Some-State/O=Internet Widgits Pty Ltd/CN=leaf\n";
+    close $fh;
+
+    ok(run(app(["openssl", "ocsp", "-issuer", $ca, "-cert", $leaf,
+                "-no_nonce", "-reqout", "presign-req.der"])),
+       "creating OCSP request");
+    ok(run(app([@responder, "-reqin", "presign-req.der",
+                "-respout", "presign-resp.der"])),
+       "answering from a response signed in advance");
+    ok(grep(/: good$/,
+            run(app(["openssl", "ocsp", "-respin", "presign-resp.der",
+                     "-issuer", $ca, "-cert", $leaf, "-partial_chain",
+                     "-CAfile", $ca, "-no-CApath"]), capture => 1)),
+       "checking the response signed in advance");
+
+    # A certificate missing from the index is still answered, as unknown
+    ok(run(app(["openssl", "ocsp", "-issuer", $ca, "-serial", "0x1234",
+                "-no_nonce", "-reqout", "presign-req.der"])),
+       "creating OCSP request for an unknown certificate");
+    ok(grep(/Cert Status: unknown/,
+            run(app([@responder, "-reqin", "presign-req.der", "-resp_text"]),
+                capture => 1)),
+       "answering a request for an unknown certificate");
+
+    unlink "presign-index.txt", "presign-req.der", "presign-resp.der";
+};
@@ -6,13 +6,17 @@ use warnings;
 use POSIX;
 use File::Spec;
 use File::Copy;
-use OpenSSL::Test qw/:DEFAULT with top_file cmdstr/;
+use OpenSSL::Test qw/:DEFAULT with top_file top_dir cmdstr/;
 use OpenSSL::Test::Utils;
 
 setup("test_ssl");
 
 my ($no_rsa, $no_dsa, $no_dh, $no_ec, $no_srp, $no_psk) =
     disabled qw/rsa dsa dh ec srp psk/;
+my $shared_libs =
+    (map { s/\R//; s/^SHARED_LIBS=\s*//; $_ }
+     grep { /^SHARED_LIBS=/ }
+     do { local @ARGV = ( top_file("Makefile") ); <> })[0] ne "";
 
 my $digest = "-sha1";
 my @reqcmd = ("openssl", "req");
@@ -55,7 +59,7 @@ my $P2intermediate="tmp_intP2.ss";
 plan tests =>
     1				# For testss
     + 1				# For ssltest -test_cipherlist
-    + 8				# For the first testssl
+    + 9				# For the first testssl
     + 16			# For the first testsslproxy
     + 16			# For the second testsslproxy
     ;
@@ -320,7 +324,7 @@ sub testssl {
 
     subtest 'standard SSL tests' => sub {
 	######################################################################
-	plan tests => 27;
+	plan tests => 34;
 
 	ok(run(test([@ssltest, "-ssl3", @extra])),
 	   'test sslv3');
@@ -374,6 +378,31 @@ sub testssl {
 	}
 	ok(run(test([@ssltest, "-bio_pair", "-dhe1024dsa", "-v", @extra])),
 	   'test sslv2/sslv3 with 1024bit DHE via BIO pair');
+	ok(run(test([@ssltest, "-bio_pair", "-named_curve", "auto", "-v", @extra])),
+	   'test sslv2/sslv3 with negotiated ECDHE curve via BIO pair');
+	ok(run(test([@ssltest, "-bio_pair", "-async", @extra])),
+	   'test sslv2/sslv3 in async mode via BIO pair');
+	ok(run(test([@ssltest, "-read_ptr", "-bytes", "1m", @extra])),
+	   'test sslv2/sslv3 with SSL_read_ptr');
+	ok(run(test([@ssltest, "-writev", "-bytes", "1m", @extra])),
+	   'test sslv2/sslv3 with SSL_writev');
+	ok(run(test([@ssltest, "-buffer_pool", "8", "-num", "10", "-reuse",
+		     "-bytes", "100k", @extra])),
+	   'test sslv2/sslv3 with a record buffer pool');
+	ok(run(test([@ssltest, "-dynamic_records", "100000", "-bytes", "1m",
+		     @extra])),
+	   'test sslv2/sslv3 with dynamic record sizing');
+	{
+	  SKIP: {
+	      skip "skipping async test with the dasync engine, no shared engines", 1
+		  if disabled("engine") || !$shared_libs;
+
+	      local $ENV{OPENSSL_ENGINES} = top_dir("engines");
+	      ok(run(test([@ssltest, "-bio_pair", "-async", "-engine", "dasync",
+			   @extra])),
+		 'test sslv2/sslv3 in async mode with the dasync engine via BIO pair');
+	    }
+	}
 	ok(run(test([@ssltest, "-bio_pair", "-server_auth", @CA, @extra])),
 	   'test sslv2/sslv3 with server authentication');
 	ok(run(test([@ssltest, "-bio_pair", "-client_auth", @CA, @extra])),
@@ -553,6 +582,37 @@ sub testssl {
 	}
     };
 
+    subtest 'ChaCha20-Poly1305 prioritization tests' => sub {
+	######################################################################
+
+	plan tests => 3;
+
+	my $gcm = "ECDHE-RSA-AES128-GCM-SHA256";
+	my $chacha = "ECDHE-RSA-CHACHA20-POLY1305";
+
+	SKIP: {
+	    skip "skipping ChaCha20-Poly1305 prioritization tests", 3
+		if $dsa_cert || disabled("chacha") || disabled("poly1305")
+		   || disabled("ec");
+
+	    ok(run(test([@ssltest, "-bio_pair", "-s_serverpref",
+			 "-s_prioritize_chacha", "-cipher", "$chacha:$gcm",
+			 "-s_cipher", "$gcm:$chacha",
+			 "-cipher_expected", $chacha])),
+	       'server picks ChaCha20-Poly1305 when the client prefers it');
+	    ok(run(test([@ssltest, "-bio_pair", "-s_serverpref",
+			 "-cipher", "$chacha:$gcm",
+			 "-s_cipher", "$gcm:$chacha",
+			 "-cipher_expected", $gcm])),
+	       'server keeps its own order without prioritize_chacha');
+	    ok(run(test([@ssltest, "-bio_pair", "-s_serverpref",
+			 "-s_prioritize_chacha", "-cipher", "$gcm:$chacha",
+			 "-s_cipher", "$gcm:$chacha",
+			 "-cipher_expected", $gcm])),
+	       'server keeps its own order when the client prefers AES');
+	}
+    };
+
     subtest 'Multi-buffer tests' => sub {
 	######################################################################
 
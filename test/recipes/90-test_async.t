@@ -0,0 +1,9 @@
+#! /usr/bin/perl
+
+use OpenSSL::Test;
+
+setup("test_async");
+
+plan tests => 1;
+
+ok(run(test(["asynctest"])), "running asynctest");
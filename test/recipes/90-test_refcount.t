@@ -0,0 +1,9 @@
+#! /usr/bin/perl
+
+use OpenSSL::Test;
+
+setup("test_refcount");
+
+plan tests => 1;
+
+ok(run(test(["refcounttest"])), "running refcounttest");
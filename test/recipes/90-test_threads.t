@@ -0,0 +1,9 @@
+#! /usr/bin/perl
+
+use OpenSSL::Test;
+
+setup("test_threads");
+
+plan tests => 1;
+
+ok(run(test(["threadstest"])), "running threadstest");
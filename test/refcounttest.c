@@ -0,0 +1,288 @@
+/* test/refcounttest.c */
+/*
+ * Checks that reference counts stay exact when an object is shared by many
+ * threads and measures X509_up_ref()/X509_free() throughput against the old
+ * lock-per-update scheme.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/x509.h>
+#include <openssl/opensslconf.h>
+
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX)
+# define REFCOUNT_PTHREADS
+# include <pthread.h>
+# include <sys/time.h>
+#endif
+
+#ifdef REFCOUNT_PTHREADS
+
+typedef struct {
+    X509 *x;
+    int num;
+} REF_JOB;
+
+static int locked_count = 1;
+
+static void *ref_loop(void *arg)
+{
+    REF_JOB *job = arg;
+    int i;
+
+    for (i = 0; i < job->num; i++) {
+        X509_up_ref(job->x);
+        X509_free(job->x);
+    }
+    return NULL;
+}
+
+/* What every reference count update used to cost */
+static void *locked_loop(void *arg)
+{
+    REF_JOB *job = arg;
+    int i;
+
+    for (i = 0; i < job->num; i++) {
+        CRYPTO_w_lock(CRYPTO_LOCK_X509);
+        locked_count++;
+        CRYPTO_w_unlock(CRYPTO_LOCK_X509);
+        CRYPTO_w_lock(CRYPTO_LOCK_X509);
+        locked_count--;
+        CRYPTO_w_unlock(CRYPTO_LOCK_X509);
+    }
+    return NULL;
+}
+
+static pthread_mutex_t *static_locks = NULL;
+
+static void static_lock_cb(int mode, int type, const char *file, int line)
+{
+    if (mode & CRYPTO_LOCK)
+        pthread_mutex_lock(&static_locks[type]);
+    else
+        pthread_mutex_unlock(&static_locks[type]);
+}
+
+static int threads_setup(void)
+{
+    int i;
+
+    static_locks = OPENSSL_malloc(CRYPTO_num_locks() * sizeof(*static_locks));
+    if (static_locks == NULL)
+        return 0;
+    for (i = 0; i < CRYPTO_num_locks(); i++)
+        pthread_mutex_init(&static_locks[i], NULL);
+    CRYPTO_set_locking_callback(static_lock_cb);
+    return 1;
+}
+
+static void threads_cleanup(void)
+{
+    int i;
+
+    if (static_locks == NULL)
+        return;
+    CRYPTO_set_locking_callback(NULL);
+    for (i = 0; i < CRYPTO_num_locks(); i++)
+        pthread_mutex_destroy(&static_locks[i]);
+    OPENSSL_free(static_locks);
+    static_locks = NULL;
+}
+
+/*
+ * Run |fn| on |x| in |nthreads| threads, |num| iterations each. Returns the
+ * total number of iterations per second, or a negative value on failure.
+ */
+static double run_threads(void *(*fn)(void *), X509 *x, int nthreads,
+                          int num)
+{
+    REF_JOB job;
+    pthread_t *tids;
+    struct timeval start, end;
+    double secs;
+    int i, failed = 0;
+
+    if ((tids = OPENSSL_malloc(nthreads * sizeof(*tids))) == NULL)
+        return -1;
+    job.x = x;
+    job.num = num;
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < nthreads; i++) {
+        if (pthread_create(&tids[i], NULL, fn, &job) != 0) {
+            nthreads = i;
+            failed = 1;
+            break;
+        }
+    }
+    for (i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+    gettimeofday(&end, NULL);
+
+    OPENSSL_free(tids);
+    if (failed)
+        return -1;
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+    if (secs <= 0)
+        secs = 1e-6;
+    return (double)nthreads * num / secs;
+}
+
+static void note_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx,
+                      long argl, void *argp)
+{
+    if (ptr != NULL)
+        *(int *)ptr = 1;
+}
+
+/*
+ * Hammer one certificate from |nthreads| threads. Afterwards it must be
+ * freed by the final X509_free() and not a moment earlier.
+ */
+static int test_refcount(int nthreads, int num)
+{
+    X509 *x;
+    int idx, freed = 0;
+
+    idx = X509_get_ex_new_index(0, NULL, NULL, NULL, note_free);
+    if (idx < 0 || (x = X509_new()) == NULL)
+        return 0;
+    if (!X509_set_ex_data(x, idx, &freed)) {
+        X509_free(x);
+        return 0;
+    }
+    if (run_threads(ref_loop, x, nthreads, num) < 0 || freed) {
+        if (!freed)
+            X509_free(x);
+        return 0;
+    }
+    X509_free(x);
+    return freed;
+}
+
+static int bench(int maxthreads, int num)
+{
+    X509 *x;
+    double rate, locked;
+    int n;
+
+    if ((x = X509_new()) == NULL)
+        return 0;
+    printf("%8s %16s %16s\n", "threads", "up_ref+free/s", "locked/s");
+    for (n = 1; n <= maxthreads; n *= 2) {
+        if ((rate = run_threads(ref_loop, x, n, num)) < 0
+            || (locked = run_threads(locked_loop, x, n, num)) < 0) {
+            X509_free(x);
+            return 0;
+        }
+        printf("%8d %16.1f %16.1f\n", n, rate, locked);
+        fflush(stdout);
+    }
+    X509_free(x);
+    return 1;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    int benchmark = 0, nthreads = 8, num = 10000, ret = 1;
+
+    for (argc--, argv++; argc > 0; argc--, argv++) {
+        if (strcmp(*argv, "-bench") == 0) {
+            benchmark = 1;
+            num = 1000000;
+        } else if (strcmp(*argv, "-threads") == 0 && argc > 1) {
+            nthreads = atoi(*++argv);
+            argc--;
+        } else if (strcmp(*argv, "-num") == 0 && argc > 1) {
+            num = atoi(*++argv);
+            argc--;
+        } else {
+            break;
+        }
+    }
+    if (argc > 0 || nthreads < 1 || num < 1) {
+        fprintf(stderr, "Usage: refcounttest [-bench] [-threads n] [-num n]\n");
+        return 1;
+    }
+
+#ifdef REFCOUNT_PTHREADS
+    if (!threads_setup())
+        return 1;
+    if (benchmark) {
+        if (!bench(nthreads, num))
+            goto end;
+    } else if (!test_refcount(nthreads, num)) {
+        printf("Shared X509 reference count: FAILED\n");
+        goto end;
+    }
+    ret = 0;
+ end:
+    threads_cleanup();
+#else
+    printf("No thread support, skipping\n");
+    ret = 0;
+#endif
+    ERR_print_errors_fp(stdout);
+    CRYPTO_cleanup_all_ex_data();
+    ERR_remove_thread_state(NULL);
+    return ret;
+}
@@ -325,6 +325,7 @@ int main(int argc, char *argv[])
         RSA_free(key);
     }
 
+    RAND_cleanup();
     CRYPTO_cleanup_all_ex_data();
     ERR_remove_thread_state(NULL);
 
@@ -0,0 +1,543 @@
+/* test/sesscachetest.c */
+/*
+ * Functional test and contention benchmark for the internal server session
+ * cache, in both its default and its SSL_SESS_CACHE_SHARDED layout.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+/*-
+ * Usage: sesscachetest [-bench] [-threads n] [-num n] certkey.pem
+ *
+ * Without -bench, checks that resumption, cache size limits and flushing
+ * behave the same with and without SSL_SESS_CACHE_SHARDED, including from
+ * several threads at once. With -bench, prints the rate of session ID
+ * resumptions against one server SSL_CTX for 1, 2, 4, ... up to -threads
+ * concurrent threads, for each cache layout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <openssl/bio.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+
+#if defined(OPENSSL_THREADS) && !defined(OPENSSL_SYS_WINDOWS) \
+    && !defined(OPENSSL_SYS_VMS)
+# define SESSCACHE_PTHREADS
+# include <pthread.h>
+# include <sys/time.h>
+#endif
+
+static const char *certkey = NULL;
+
+/* Drive the handshake between |c| and |s| over a BIO pair to completion */
+static int do_handshake(SSL *c, SSL *s)
+{
+    int i, r, cdone = 0, sdone = 0;
+
+    for (i = 0; i < 64 && !(cdone && sdone); i++) {
+        if (!cdone) {
+            r = SSL_do_handshake(c);
+            if (r == 1)
+                cdone = 1;
+            else if (SSL_get_error(c, r) != SSL_ERROR_WANT_READ)
+                return 0;
+        }
+        if (!sdone) {
+            r = SSL_do_handshake(s);
+            if (r == 1)
+                sdone = 1;
+            else if (SSL_get_error(s, r) != SSL_ERROR_WANT_READ)
+                return 0;
+        }
+    }
+    return cdone && sdone;
+}
+
+/*
+ * Connect a client from |cctx| to a server from |sctx|, offering |*sess| if
+ * set. On return |*sess| holds the session used and |*reused| tells whether
+ * it was resumed. If |srvsess| is not NULL it receives the server's copy of
+ * the session.
+ */
+static int connect_once(SSL_CTX *sctx, SSL_CTX *cctx, SSL_SESSION **sess,
+                        SSL_SESSION **srvsess, int *reused)
+{
+    SSL *c = NULL, *s = NULL;
+    BIO *cbio = NULL, *sbio = NULL;
+    int ret = 0;
+
+    if ((c = SSL_new(cctx)) == NULL || (s = SSL_new(sctx)) == NULL
+        || !BIO_new_bio_pair(&cbio, 0, &sbio, 0))
+        goto end;
+    SSL_set_bio(c, cbio, cbio);
+    SSL_set_bio(s, sbio, sbio);
+    SSL_set_connect_state(c);
+    SSL_set_accept_state(s);
+    if (*sess != NULL && !SSL_set_session(c, *sess))
+        goto end;
+    if (!do_handshake(c, s))
+        goto end;
+
+    *reused = SSL_session_reused(c);
+    if (!*reused) {
+        SSL_SESSION_free(*sess);
+        *sess = SSL_get1_session(c);
+    }
+    if (srvsess != NULL)
+        *srvsess = SSL_get1_session(s);
+    /* A clean shutdown keeps the session resumable */
+    SSL_set_shutdown(c, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    SSL_set_shutdown(s, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    ret = 1;
+ end:
+    SSL_free(c);
+    SSL_free(s);
+    return ret;
+}
+
+static SSL_CTX *server_ctx_new(long mode)
+{
+    SSL_CTX *sctx = SSL_CTX_new(TLS_server_method());
+
+    if (sctx == NULL)
+        return NULL;
+    /* Force use of the session ID cache rather than tickets */
+    SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_session_cache_mode(sctx, mode);
+    if ((SSL_CTX_get_session_cache_mode(sctx) & mode) != mode
+        || SSL_CTX_use_certificate_file(sctx, certkey, SSL_FILETYPE_PEM) <= 0
+        || SSL_CTX_use_PrivateKey_file(sctx, certkey, SSL_FILETYPE_PEM) <= 0) {
+        SSL_CTX_free(sctx);
+        return NULL;
+    }
+    return sctx;
+}
+
+typedef struct {
+    SSL_CTX *sctx;
+    SSL_CTX *cctx;
+    int num;
+    int failed;
+} RESUME_JOB;
+
+/* One full handshake followed by |num| resumptions of the same session */
+static void *resume_loop(void *arg)
+{
+    RESUME_JOB *job = arg;
+    SSL_SESSION *sess = NULL;
+    int i, reused;
+
+    if (!connect_once(job->sctx, job->cctx, &sess, NULL, &reused) || reused) {
+        job->failed = 1;
+        goto end;
+    }
+    for (i = 0; i < job->num; i++) {
+        if (!connect_once(job->sctx, job->cctx, &sess, NULL, &reused) || !reused) {
+            job->failed = 1;
+            break;
+        }
+    }
+ end:
+    SSL_SESSION_free(sess);
+    ERR_remove_thread_state(NULL);
+    return NULL;
+}
+
+#ifdef SESSCACHE_PTHREADS
+
+struct CRYPTO_dynlock_value {
+    pthread_rwlock_t lock;
+};
+
+static pthread_rwlock_t *static_locks = NULL;
+
+static void rwlock_op(pthread_rwlock_t *l, int mode)
+{
+    if (mode & CRYPTO_UNLOCK)
+        pthread_rwlock_unlock(l);
+    else if (mode & CRYPTO_READ)
+        pthread_rwlock_rdlock(l);
+    else
+        pthread_rwlock_wrlock(l);
+}
+
+static void static_lock_cb(int mode, int type, const char *file, int line)
+{
+    rwlock_op(&static_locks[type], mode);
+}
+
+static struct CRYPTO_dynlock_value *dynlock_create_cb(const char *file,
+                                                       int line)
+{
+    struct CRYPTO_dynlock_value *l = malloc(sizeof(*l));
+
+    if (l != NULL)
+        pthread_rwlock_init(&l->lock, NULL);
+    return l;
+}
+
+static void dynlock_lock_cb(int mode, struct CRYPTO_dynlock_value *l,
+                            const char *file, int line)
+{
+    rwlock_op(&l->lock, mode);
+}
+
+static void dynlock_destroy_cb(struct CRYPTO_dynlock_value *l,
+                               const char *file, int line)
+{
+    pthread_rwlock_destroy(&l->lock);
+    free(l);
+}
+
+static int threads_setup(void)
+{
+    int i;
+
+    static_locks = malloc(CRYPTO_num_locks() * sizeof(*static_locks));
+    if (static_locks == NULL)
+        return 0;
+    for (i = 0; i < CRYPTO_num_locks(); i++)
+        pthread_rwlock_init(&static_locks[i], NULL);
+    CRYPTO_set_locking_callback(static_lock_cb);
+    CRYPTO_set_dynlock_create_callback(dynlock_create_cb);
+    CRYPTO_set_dynlock_lock_callback(dynlock_lock_cb);
+    CRYPTO_set_dynlock_destroy_callback(dynlock_destroy_cb);
+    return 1;
+}
+
+static void threads_cleanup(void)
+{
+    int i;
+
+    CRYPTO_set_locking_callback(NULL);
+    CRYPTO_set_dynlock_create_callback(NULL);
+    CRYPTO_set_dynlock_lock_callback(NULL);
+    CRYPTO_set_dynlock_destroy_callback(NULL);
+    for (i = 0; i < CRYPTO_num_locks(); i++)
+        pthread_rwlock_destroy(&static_locks[i]);
+    free(static_locks);
+}
+
+/*
+ * Run |nthreads| concurrent resume_loop()s against |sctx|. Returns the
+ * number of resumptions per second, or -1 on failure.
+ */
+static double run_threads(SSL_CTX *sctx, SSL_CTX *cctx, int nthreads,
+                          int num)
+{
+    pthread_t *tids;
+    RESUME_JOB *jobs;
+    struct timeval start, end;
+    double secs;
+    int i, failed = 0;
+
+    tids = malloc(nthreads * sizeof(*tids));
+    jobs = malloc(nthreads * sizeof(*jobs));
+    if (tids == NULL || jobs == NULL) {
+        free(tids);
+        free(jobs);
+        return -1;
+    }
+    gettimeofday(&start, NULL);
+    for (i = 0; i < nthreads; i++) {
+        jobs[i].sctx = sctx;
+        jobs[i].cctx = cctx;
+        jobs[i].num = num;
+        jobs[i].failed = 0;
+        pthread_create(&tids[i], NULL, resume_loop, &jobs[i]);
+    }
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(tids[i], NULL);
+        failed |= jobs[i].failed;
+    }
+    gettimeofday(&end, NULL);
+    free(tids);
+    free(jobs);
+    if (failed)
+        return -1;
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+    return secs > 0 ? (double)nthreads * num / secs : 0;
+}
+
+#endif
+
+static int test_cache(SSL_CTX *cctx, long mode, int nthreads, int num)
+{
+    SSL_CTX *sctx = NULL;
+    SSL_SESSION *sess = NULL, *srvsess = NULL;
+    long now;
+    int i, reused, ret = 0;
+
+    if ((sctx = server_ctx_new(mode)) == NULL) {
+        printf("Failed to set up server SSL_CTX\n");
+        goto end;
+    }
+
+    /* Simple resumption */
+    if (!connect_once(sctx, cctx, &sess, NULL, &reused) || reused
+        || SSL_CTX_sess_number(sctx) != 1
+        || !connect_once(sctx, cctx, &sess, NULL, &reused) || !reused
+        || SSL_CTX_sess_hits(sctx) != 1) {
+        printf("Resumption failed\n");
+        goto end;
+    }
+
+    /* Explicit removal */
+    if (!connect_once(sctx, cctx, &sess, &srvsess, &reused) || !reused
+        || !SSL_CTX_remove_session(sctx, srvsess)
+        || SSL_CTX_sess_number(sctx) != 0
+        || !connect_once(sctx, cctx, &sess, NULL, &reused) || reused) {
+        printf("Session removal failed\n");
+        goto end;
+    }
+
+    /* Cache size limit */
+    SSL_CTX_sess_set_cache_size(sctx, 32);
+    for (i = 0; i < 100; i++) {
+        SSL_SESSION_free(sess);
+        sess = NULL;
+        if (!connect_once(sctx, cctx, &sess, NULL, &reused)) {
+            printf("Handshake failed\n");
+            goto end;
+        }
+    }
+    if (SSL_CTX_sess_number(sctx) > 32 || SSL_CTX_sess_cache_full(sctx) == 0) {
+        printf("Cache size limit not enforced (%ld sessions)\n",
+               SSL_CTX_sess_number(sctx));
+        goto end;
+    }
+    /* The most recently added session must have survived */
+    if (!connect_once(sctx, cctx, &sess, NULL, &reused) || !reused) {
+        printf("Most recent session was evicted\n");
+        goto end;
+    }
+    SSL_CTX_sess_set_cache_size(sctx, SSL_SESSION_CACHE_MAX_SIZE_DEFAULT);
+
+    /* Flushing */
+    SSL_CTX_flush_sessions(sctx, 0);
+    if (SSL_CTX_sess_number(sctx) != 0
+        || !connect_once(sctx, cctx, &sess, NULL, &reused) || reused) {
+        printf("Flushing the cache failed\n");
+        goto end;
+    }
+
+    /* Expiry: only sessions past their timeout are flushed */
+    SSL_CTX_flush_sessions(sctx, 0);
+    now = (long)time(NULL);
+    for (i = 0; i < 20; i++) {
+        SSL_SESSION_free(sess);
+        SSL_SESSION_free(srvsess);
+        sess = srvsess = NULL;
+        SSL_CTX_set_timeout(sctx, (i % 2) ? 1000 : 100);
+        if (!connect_once(sctx, cctx, &sess, &srvsess, &reused)) {
+            printf("Handshake failed\n");
+            goto end;
+        }
+    }
+    /* The last session has the long timeout: give it some more */
+    SSL_SESSION_set_timeout(srvsess, 2000);
+    SSL_CTX_flush_sessions(sctx, now + 500);
+    if (SSL_CTX_sess_number(sctx) != 10) {
+        printf("Flushing expired sessions failed (%ld left)\n",
+               SSL_CTX_sess_number(sctx));
+        goto end;
+    }
+    SSL_CTX_flush_sessions(sctx, now + 1500);
+    if (SSL_CTX_sess_number(sctx) != 1
+        || !connect_once(sctx, cctx, &sess, NULL, &reused) || !reused) {
+        printf("Extended session timeout not honoured\n");
+        goto end;
+    }
+    SSL_CTX_flush_sessions(sctx, now + 5000);
+    if (SSL_CTX_sess_number(sctx) != 0) {
+        printf("Flushing the last session failed\n");
+        goto end;
+    }
+    SSL_CTX_set_timeout(sctx, 300);
+
+    /* Concurrent resumptions */
+#ifdef SESSCACHE_PTHREADS
+    if (run_threads(sctx, cctx, nthreads, num) < 0) {
+        printf("Concurrent resumption failed\n");
+        goto end;
+    }
+#else
+    {
+        RESUME_JOB job;
+
+        job.sctx = sctx;
+        job.cctx = cctx;
+        job.num = num;
+        job.failed = 0;
+        resume_loop(&job);
+        if (job.failed) {
+            printf("Repeated resumption failed\n");
+            goto end;
+        }
+    }
+#endif
+
+    ret = 1;
+ end:
+    ERR_print_errors_fp(stdout);
+    SSL_SESSION_free(sess);
+    SSL_SESSION_free(srvsess);
+    SSL_CTX_free(sctx);
+    return ret;
+}
+
+#ifdef SESSCACHE_PTHREADS
+static int bench(SSL_CTX *cctx, int maxthreads, int num)
+{
+    static const long modes[2] = {
+        SSL_SESS_CACHE_SERVER,
+        SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_SHARDED
+    };
+    SSL_CTX *sctx;
+    double rate;
+    int i, n;
+
+    printf("%8s %16s %16s\n", "threads", "default/s", "sharded/s");
+    for (n = 1; n <= maxthreads; n *= 2) {
+        printf("%8d", n);
+        for (i = 0; i < 2; i++) {
+            if ((sctx = server_ctx_new(modes[i])) == NULL)
+                return 0;
+            rate = run_threads(sctx, cctx, n, num);
+            SSL_CTX_free(sctx);
+            if (rate < 0)
+                return 0;
+            printf(" %16.1f", rate);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    return 1;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    SSL_CTX *cctx = NULL;
+    int benchmark = 0, nthreads = 4, num = 50, ret = 1;
+
+    for (argc--, argv++; argc > 0; argc--, argv++) {
+        if (strcmp(*argv, "-bench") == 0) {
+            benchmark = 1;
+        } else if (strcmp(*argv, "-threads") == 0 && argc > 1) {
+            nthreads = atoi(*++argv);
+            argc--;
+        } else if (strcmp(*argv, "-num") == 0 && argc > 1) {
+            num = atoi(*++argv);
+            argc--;
+        } else {
+            certkey = *argv;
+        }
+    }
+    if (certkey == NULL || nthreads < 1 || num < 1) {
+        fprintf(stderr,
+                "Usage: sesscachetest [-bench] [-threads n] [-num n] certkey.pem\n");
+        return 1;
+    }
+
+    SSL_library_init();
+    SSL_load_error_strings();
+#ifdef SESSCACHE_PTHREADS
+    if (!threads_setup())
+        return 1;
+#endif
+
+    if ((cctx = SSL_CTX_new(TLS_client_method())) == NULL)
+        goto end;
+    SSL_CTX_set_session_cache_mode(cctx, SSL_SESS_CACHE_OFF);
+
+    if (benchmark) {
+#ifdef SESSCACHE_PTHREADS
+        if (!bench(cctx, nthreads, num))
+            goto end;
+#else
+        printf("No thread support, nothing to benchmark\n");
+#endif
+    } else {
+        if (!test_cache(cctx, SSL_SESS_CACHE_SERVER, nthreads, num)) {
+            printf("Default session cache: FAILED\n");
+            goto end;
+        }
+        if (!test_cache(cctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_SHARDED,
+                        nthreads, num)) {
+            printf("Sharded session cache: FAILED\n");
+            goto end;
+        }
+    }
+    ret = 0;
+
+ end:
+    ERR_print_errors_fp(stdout);
+    SSL_CTX_free(cctx);
+#ifdef SESSCACHE_PTHREADS
+    threads_cleanup();
+#endif
+    ERR_free_strings();
+    ERR_remove_thread_state(NULL);
+    EVP_cleanup();
+    CRYPTO_cleanup_all_ex_data();
+    return ret;
+}
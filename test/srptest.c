@@ -144,6 +144,7 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    RAND_cleanup();
     CRYPTO_cleanup_all_ex_data();
     ERR_remove_thread_state(NULL);
     ERR_free_strings();
@@ -371,6 +371,9 @@ static const char *alpn_server;
 static const char *alpn_expected;
 static unsigned char *alpn_selected;
 
+/* The cipher suite that -cipher_expected says should be negotiated */
+static const char *cipher_expected = NULL;
+
 /*-
  * next_protos_parse parses a comma separated list of strings into a string
  * in a format suitable for passing to SSL_CTX_set_next_protos_advertised.
@@ -532,6 +535,26 @@ static int serverinfo_cli_parse_cb(SSL *s, unsigned int ext_type,
     return 1;
 }
 
+static int verify_cipher(SSL *client, SSL *server)
+{
+    const char *client_name, *server_name;
+
+    if (cipher_expected == NULL)
+        return 0;
+
+    client_name = SSL_CIPHER_get_name(SSL_get_current_cipher(client));
+    server_name = SSL_CIPHER_get_name(SSL_get_current_cipher(server));
+    if (strcmp(client_name, cipher_expected) != 0
+        || strcmp(server_name, cipher_expected) != 0) {
+        BIO_printf(bio_stdout,
+                   "Cipher negotiated: client: '%s', server: '%s', "
+                   "expected: '%s'\n", client_name, server_name,
+                   cipher_expected);
+        return -1;
+    }
+    return 0;
+}
+
 static int verify_serverinfo()
 {
     if (serverinfo_sct != serverinfo_sct_seen)
@@ -723,6 +746,8 @@ static int custom_ext_3_srv_add_cb(SSL *s, unsigned int ext_type,
 static char *cipher = NULL;
 static int verbose = 0;
 static int debug = 0;
+static int read_ptr = 0;
+static int use_writev = 0;
 static const char rnd_seed[] =
     "string to make the random number generator think it has entropy";
 
@@ -786,7 +811,19 @@ static void sv_usage(void)
     fprintf(stderr,
             " -c_key arg    - Client key file (default: same as -c_cert)\n");
     fprintf(stderr, " -cipher arg   - The cipher list\n");
+    fprintf(stderr,
+            " -cipher_expected arg - The cipher suite that should be negotiated\n");
     fprintf(stderr, " -bio_pair     - Use BIO pairs\n");
+    fprintf(stderr, " -async        - Use SSL_MODE_ASYNC on client and server\n");
+    fprintf(stderr, " -read_ptr     - Server reads with SSL_read_ptr()\n");
+    fprintf(stderr, " -writev       - Client writes with SSL_writev()\n");
+    fprintf(stderr,
+            " -buffer_pool n - Release buffers when idle, into a pool of n\n");
+    fprintf(stderr,
+            " -dynamic_records n - Send small records for the first n bytes\n");
+#ifndef OPENSSL_NO_ENGINE
+    fprintf(stderr, " -engine id    - Use engine id for all algorithms\n");
+#endif
     fprintf(stderr, " -f            - Test even cases that can't work\n");
     fprintf(stderr,
             " -time         - measure processor time used by client and server\n");
@@ -795,7 +832,7 @@ static void sv_usage(void)
     fprintf(stderr,
             " -named_curve arg  - Elliptic curve name to use for ephemeral ECDH keys.\n"
             "                 Use \"openssl ecparam -list_curves\" for all names\n"
-            "                 (default is sect163r2).\n");
+            "                 (default is sect163r2), or \"auto\" to negotiate.\n");
 #endif
     fprintf(stderr,
             " -test_cipherlist - Verifies the order of the ssl cipher lists.\n"
@@ -957,6 +994,13 @@ int main(int argc, char *argv[])
     SSL_CTX *s_ctx = NULL;
     SSL_CTX *c_ctx = NULL;
     const SSL_METHOD *meth = NULL;
+    int async = 0;
+    int buffer_pool = 0;
+    long dynamic_records = 0;
+#ifndef OPENSSL_NO_ENGINE
+    const char *engine_id = NULL;
+    ENGINE *e = NULL;
+#endif
     SSL *c_ssl, *s_ssl;
     int number = 1, reuse = 0;
     long bytes = 256L;
@@ -1155,6 +1199,10 @@ int main(int argc, char *argv[])
             if (--argc < 1)
                 goto bad;
             cipher = *(++argv);
+        } else if (strcmp(*argv, "-cipher_expected") == 0) {
+            if (--argc < 1)
+                goto bad;
+            cipher_expected = *(++argv);
         } else if (strcmp(*argv, "-CApath") == 0) {
             if (--argc < 1)
                 goto bad;
@@ -1165,7 +1213,29 @@ int main(int argc, char *argv[])
             CAfile = *(++argv);
         } else if (strcmp(*argv, "-bio_pair") == 0) {
             bio_pair = 1;
-        } else if (strcmp(*argv, "-f") == 0) {
+        } else if (strcmp(*argv, "-async") == 0) {
+            async = 1;
+        } else if (strcmp(*argv, "-dynamic_records") == 0) {
+            if (--argc < 1)
+                goto bad;
+            dynamic_records = atol(*(++argv));
+        } else if (strcmp(*argv, "-buffer_pool") == 0) {
+            if (--argc < 1)
+                goto bad;
+            buffer_pool = atoi(*(++argv));
+        } else if (strcmp(*argv, "-read_ptr") == 0) {
+            read_ptr = 1;
+        } else if (strcmp(*argv, "-writev") == 0) {
+            use_writev = 1;
+        }
+#ifndef OPENSSL_NO_ENGINE
+        else if (strcmp(*argv, "-engine") == 0) {
+            if (--argc < 1)
+                goto bad;
+            engine_id = *(++argv);
+        }
+#endif
+        else if (strcmp(*argv, "-f") == 0) {
             force = 1;
         } else if (strcmp(*argv, "-time") == 0) {
             print_time = 1;
@@ -1361,6 +1431,17 @@ int main(int argc, char *argv[])
     }
 #endif
 
+#ifndef OPENSSL_NO_ENGINE
+    if (engine_id != NULL) {
+        if ((e = ENGINE_by_id(engine_id)) == NULL
+            || !ENGINE_set_default(e, ENGINE_METHOD_ALL)) {
+            fprintf(stderr, "Failed to load engine %s\n", engine_id);
+            ERR_print_errors(bio_err);
+            goto end;
+        }
+    }
+#endif
+
     /*
      * At this point, ssl3/tls1 is only set if the protocol is available.
      * (Otherwise we exit early.) However the compiler doesn't know this, so
@@ -1397,6 +1478,33 @@ int main(int argc, char *argv[])
     SSL_CTX_set_security_level(c_ctx, 0);
     SSL_CTX_set_security_level(s_ctx, 0);
 
+    if (async) {
+        SSL_CTX_set_mode(c_ctx, SSL_MODE_ASYNC);
+        SSL_CTX_set_mode(s_ctx, SSL_MODE_ASYNC);
+    }
+
+    if (dynamic_records > 0) {
+        if (!SSL_CTX_set_dynamic_record_threshold(c_ctx, dynamic_records)
+            || !SSL_CTX_set_dynamic_record_threshold(s_ctx,
+                                                     dynamic_records)) {
+            fprintf(stderr, "Invalid -dynamic_records value\n");
+            goto end;
+        }
+    }
+
+    if (buffer_pool > 0) {
+        /* Half the buffers preallocated, half from the heap */
+        if (!SSL_CTX_set_buffer_pool_arena(c_ctx, buffer_pool / 2 + 1)
+            || !SSL_CTX_set_buffer_pool_arena(s_ctx, buffer_pool / 2 + 1)) {
+            fprintf(stderr, "Invalid -buffer_pool value\n");
+            goto end;
+        }
+        SSL_CTX_set_buffer_pool(c_ctx, buffer_pool);
+        SSL_CTX_set_buffer_pool(s_ctx, buffer_pool);
+        SSL_CTX_set_mode(c_ctx, SSL_MODE_RELEASE_BUFFERS);
+        SSL_CTX_set_mode(s_ctx, SSL_MODE_RELEASE_BUFFERS);
+    }
+
     if (cipher != NULL) {
         if (!SSL_CTX_set_cipher_list(c_ctx, cipher)
            || !SSL_CTX_set_cipher_list(s_ctx, cipher)) {
@@ -1450,7 +1558,10 @@ int main(int argc, char *argv[])
 #endif
 
 #ifndef OPENSSL_NO_EC
-    if (!no_ecdhe) {
+    if (!no_ecdhe && named_curve != NULL
+        && strcmp(named_curve, "auto") == 0) {
+        SSL_CTX_set_ecdh_auto(s_ctx, 1);
+    } else if (!no_ecdhe) {
         int nid;
 
         if (named_curve != NULL) {
@@ -1701,6 +1812,28 @@ int main(int argc, char *argv[])
     SSL_free(s_ssl);
     SSL_free(c_ssl);
 
+    if (buffer_pool > 0) {
+        if (verbose)
+            BIO_printf(bio_stdout, "buffer pool: %ld hits, %ld misses, "
+                       "%ld buffers at most in use, %ld idle\n",
+                       SSL_CTX_buffer_pool_hits(s_ctx),
+                       SSL_CTX_buffer_pool_misses(s_ctx),
+                       SSL_CTX_buffer_pool_high_water(s_ctx),
+                       SSL_CTX_buffer_pool_size(s_ctx));
+        /*
+         * Every buffer must have been returned, and some borrowed again
+         * unless this is DTLS, which does not use the pool.
+         */
+        if (SSL_CTX_buffer_pool_in_use(c_ctx) != 0
+            || SSL_CTX_buffer_pool_in_use(s_ctx) != 0
+            || (!dtls1 && !dtls12
+                && (SSL_CTX_buffer_pool_hits(c_ctx) == 0
+                    || SSL_CTX_buffer_pool_hits(s_ctx) == 0))) {
+            BIO_printf(bio_err, "Buffer pool not used as expected\n");
+            ret = 1;
+        }
+    }
+
  end:
     SSL_CTX_free(s_ctx);
     SSL_CTX_free(c_ctx);
@@ -1714,8 +1847,11 @@ int main(int argc, char *argv[])
     free_tmp_rsa();
 #endif
 #ifndef OPENSSL_NO_ENGINE
+    ENGINE_free(e);
     ENGINE_cleanup();
 #endif
+    ASYNC_cleanup_thread();
+    RAND_cleanup();
     CRYPTO_cleanup_all_ex_data();
     ERR_free_strings();
     ERR_remove_thread_state(NULL);
@@ -1842,7 +1978,11 @@ int doit_biopair(SSL *s_ssl, SSL *c_ssl, long count,
                 }
             }
 
-            if (cr_num > 0) {
+            /*
+             * A paused async job must be resumed by repeating the call that
+             * started it, so don't try to read while a write is pending.
+             */
+            if (cr_num > 0 && !SSL_waiting_for_async(c_ssl)) {
                 /* Read from server. */
 
                 r = BIO_read(c_ssl_bio, cbuf, sizeof(cbuf));
@@ -1914,7 +2054,7 @@ int doit_biopair(SSL *s_ssl, SSL *c_ssl, long count,
                 }
             }
 
-            if (sr_num > 0) {
+            if (sr_num > 0 && !SSL_waiting_for_async(s_ssl)) {
                 /* Read from client. */
 
                 r = BIO_read(s_ssl_bio, sbuf, sizeof(sbuf));
@@ -2068,6 +2208,10 @@ int doit_biopair(SSL *s_ssl, SSL *c_ssl, long count,
         ret = 1;
         goto err;
     }
+    if (verify_cipher(c_ssl, s_ssl) < 0) {
+        ret = 1;
+        goto err;
+    }
 
     if (custom_ext_error) {
         fprintf(stderr, "Custom extension error\n");
@@ -2096,6 +2240,58 @@ int doit_biopair(SSL *s_ssl, SSL *c_ssl, long count,
 #define C_DONE  1
 #define S_DONE  2
 
+/*
+ * Read from |b| like BIO_read() would, but through SSL_read_ptr(), copying
+ * the data out of the record layer only afterwards.
+ */
+static int ptr_read(BIO *b, char *buf, int num)
+{
+    SSL *ssl = NULL;
+    const void *p;
+    int ret;
+
+    BIO_get_ssl(b, &ssl);
+    BIO_clear_retry_flags(b);
+    ret = SSL_read_ptr(ssl, &p, num);
+    if (ret > 0) {
+        memcpy(buf, p, ret);
+        return ret;
+    }
+    switch (SSL_get_error(ssl, ret)) {
+    case SSL_ERROR_WANT_READ:
+        BIO_set_retry_read(b);
+        break;
+    case SSL_ERROR_WANT_WRITE:
+        BIO_set_retry_write(b);
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
+
+/*
+ * Write to |b| with BIO_writev(), which ends up in SSL_writev(), with |buf|
+ * cut into pieces of uneven length.
+ */
+static int writev_write(BIO *b, const char *buf, int num)
+{
+    /* static, as a retry must pass the same array */
+    static BIO_IOVEC iov[4];
+    static const int cut[] = { 1, 300, 5000 };
+    int i, n = 0, off = 0;
+
+    for (i = 0; i < (int)OSSL_NELEM(cut) && off + cut[i] < num; i++) {
+        iov[n].base = buf + off;
+        iov[n++].len = cut[i];
+        off += cut[i];
+    }
+    iov[n].base = buf + off;
+    iov[n++].len = num - off;
+
+    return BIO_writev(b, iov, n);
+}
+
 int doit(SSL *s_ssl, SSL *c_ssl, long count)
 {
     char *cbuf = NULL, *sbuf = NULL;
@@ -2194,7 +2390,10 @@ int doit(SSL *s_ssl, SSL *c_ssl, long count)
         if (do_client && !(done & C_DONE)) {
             if (c_write) {
                 j = (cw_num > bufsiz) ? (int)bufsiz : (int)cw_num;
-                i = BIO_write(c_bio, cbuf, j);
+                if (use_writev)
+                    i = writev_write(c_bio, cbuf, j);
+                else
+                    i = BIO_write(c_bio, cbuf, j);
                 if (i < 0) {
                     c_r = 0;
                     c_w = 0;
@@ -2258,7 +2457,10 @@ int doit(SSL *s_ssl, SSL *c_ssl, long count)
 
         if (do_server && !(done & S_DONE)) {
             if (!s_write) {
-                i = BIO_read(s_bio, sbuf, bufsiz);
+                if (read_ptr)
+                    i = ptr_read(s_bio, sbuf, bufsiz);
+                else
+                    i = BIO_read(s_bio, sbuf, bufsiz);
                 if (i < 0) {
                     s_r = 0;
                     s_w = 0;
@@ -2343,6 +2545,10 @@ int doit(SSL *s_ssl, SSL *c_ssl, long count)
         ret = 1;
         goto err;
     }
+    if (verify_cipher(c_ssl, s_ssl) < 0) {
+        ret = 1;
+        goto err;
+    }
     if (custom_ext_error) {
         fprintf(stderr, "Custom extension error\n");
         ret = 1;
@@ -0,0 +1,193 @@
+/* test/threadstest.c */
+/*
+ * Exercises the built-in threading primitives: read/write locks, run-once
+ * initialisation and thread-local storage, with no locking callbacks set.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/opensslconf.h>
+
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX)
+# define THREADS_PTHREADS
+# include <pthread.h>
+#endif
+
+#define NUM_THREADS     8
+#define NUM_LOOPS       10000
+
+static CRYPTO_RWLOCK *counter_lock = NULL;
+static int counter = 0;
+
+static CRYPTO_ONCE once = CRYPTO_ONCE_STATIC_INIT;
+static int once_calls = 0;
+
+static CRYPTO_THREAD_LOCAL local_key;
+static int local_frees = 0;
+
+static void once_init(void)
+{
+    once_calls++;
+}
+
+static void local_free(void *ptr)
+{
+    CRYPTO_THREAD_write_lock(counter_lock);
+    local_frees++;
+    CRYPTO_THREAD_unlock(counter_lock);
+    OPENSSL_free(ptr);
+}
+
+/*
+ * Each thread bumps the shared counter under the lock, races for the
+ * run-once initialiser and checks that its thread-local value is private.
+ */
+static void *worker(void *arg)
+{
+    int i, *mine;
+
+    if (!CRYPTO_THREAD_run_once(&once, once_init))
+        return NULL;
+    if (CRYPTO_THREAD_get_local(&local_key) != NULL)
+        return NULL;
+    if ((mine = OPENSSL_malloc(sizeof(*mine))) == NULL)
+        return NULL;
+    *mine = 0;
+    if (!CRYPTO_THREAD_set_local(&local_key, mine)) {
+        OPENSSL_free(mine);
+        return NULL;
+    }
+
+    for (i = 0; i < NUM_LOOPS; i++) {
+        CRYPTO_THREAD_write_lock(counter_lock);
+        counter++;
+        CRYPTO_THREAD_unlock(counter_lock);
+        CRYPTO_THREAD_read_lock(counter_lock);
+        CRYPTO_THREAD_unlock(counter_lock);
+        (*(int *)CRYPTO_THREAD_get_local(&local_key))++;
+    }
+    if (*mine != NUM_LOOPS)
+        return NULL;
+    return arg;
+}
+
+static int test_threads(void)
+{
+    int i, ok = 1;
+#ifdef THREADS_PTHREADS
+    pthread_t tids[NUM_THREADS];
+    void *res;
+    int started = 0;
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        if (pthread_create(&tids[i], NULL, worker, &counter) != 0) {
+            ok = 0;
+            break;
+        }
+        started++;
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(tids[i], &res);
+        if (res == NULL)
+            ok = 0;
+    }
+    if (ok && (counter != NUM_THREADS * NUM_LOOPS
+               || local_frees != NUM_THREADS)) {
+        printf("counter %d, %d thread-local values freed\n",
+               counter, local_frees);
+        ok = 0;
+    }
+#else
+    if (worker(&counter) == NULL || counter != NUM_LOOPS)
+        ok = 0;
+    OPENSSL_free(CRYPTO_THREAD_get_local(&local_key));
+#endif
+    if (once_calls != 1) {
+        printf("run-once initialiser called %d times\n", once_calls);
+        ok = 0;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 1;
+
+    if ((counter_lock = CRYPTO_THREAD_lock_new()) == NULL
+        || !CRYPTO_THREAD_init_local(&local_key, local_free)) {
+        printf("Thread primitive setup: FAILED\n");
+        goto end;
+    }
+    if (!CRYPTO_THREAD_compare_id(CRYPTO_THREAD_get_current_id(),
+                                  CRYPTO_THREAD_get_current_id())) {
+        printf("Thread id comparison: FAILED\n");
+        goto end;
+    }
+    if (!test_threads()) {
+        printf("Built-in thread primitives: FAILED\n");
+        goto end;
+    }
+    ret = 0;
+ end:
+    CRYPTO_THREAD_cleanup_local(&local_key);
+    CRYPTO_THREAD_lock_free(counter_lock);
+    ERR_print_errors_fp(stdout);
+    ERR_remove_thread_state(NULL);
+    return ret;
+}
@@ -185,6 +185,191 @@ static int test_alt_chains_cert_forgery(const char *roots_f,
     return ret;
 }
 
+static int verify_leaf(X509_STORE *store, const char *untrusted_f,
+                       unsigned long flags)
+{
+    int ret = 0;
+    STACK_OF(X509) *untrusted = NULL;
+    X509_STORE_CTX *sctx = NULL;
+
+    /*
+     * Load fresh copies each time so that no certificate is already marked
+     * as having a valid signature.  The leaf is the second entry.
+     */
+    untrusted = load_certs_from_file(untrusted_f);
+    if (untrusted == NULL || sk_X509_num(untrusted) != 2)
+        goto err;
+
+    sctx = X509_STORE_CTX_new();
+    if (sctx == NULL)
+        goto err;
+    if (!X509_STORE_CTX_init(sctx, store, sk_X509_value(untrusted, 1),
+                             untrusted))
+        goto err;
+    if (flags != 0)
+        X509_VERIFY_PARAM_set_flags(X509_STORE_CTX_get0_param(sctx), flags);
+
+    ret = X509_verify_cert(sctx) == 1;
+ err:
+    X509_STORE_CTX_free(sctx);
+    sk_X509_pop_free(untrusted, X509_free);
+    return ret;
+}
+
+/*
+ * Check the signature cache: the first verification of leaf populates the
+ * cache, the second is satisfied from it, and neither X509_V_FLAG_NO_SIG_CACHE
+ * nor a disabled cache touch the counters.
+ */
+static int test_sigcache(const char *roots_f, const char *untrusted_f)
+{
+    int ret = 0;
+    unsigned long hits, misses, first_misses;
+    X509_STORE *store = NULL;
+    X509_LOOKUP *lookup = NULL;
+
+    store = X509_STORE_new();
+    if (store == NULL)
+        goto err;
+
+    lookup = X509_STORE_add_lookup(store, X509_LOOKUP_file());
+    if (lookup == NULL)
+        goto err;
+    if (!X509_LOOKUP_load_file(lookup, roots_f, X509_FILETYPE_PEM))
+        goto err;
+
+    if (X509_STORE_get_sigcache_size(store) != 0
+        || !X509_STORE_set_sigcache_size(store, 16)
+        || X509_STORE_get_sigcache_size(store) != 16)
+        goto err;
+
+    if (!verify_leaf(store, untrusted_f, 0))
+        goto err;
+    X509_STORE_get_sigcache_stats(store, &hits, &first_misses);
+    if (hits != 0 || first_misses == 0)
+        goto err;
+
+    if (!verify_leaf(store, untrusted_f, 0))
+        goto err;
+    X509_STORE_get_sigcache_stats(store, &hits, &misses);
+    if (hits != first_misses || misses != first_misses)
+        goto err;
+
+    if (!verify_leaf(store, untrusted_f, X509_V_FLAG_NO_SIG_CACHE))
+        goto err;
+    X509_STORE_get_sigcache_stats(store, &hits, &misses);
+    if (hits != first_misses || misses != first_misses)
+        goto err;
+
+    if (!X509_STORE_set_sigcache_size(store, 0)
+        || !verify_leaf(store, untrusted_f, 0))
+        goto err;
+    X509_STORE_get_sigcache_stats(store, &hits, &misses);
+    if (hits != first_misses || misses != first_misses)
+        goto err;
+
+    ret = 1;
+ err:
+    X509_STORE_free(store);
+    if (ret != 1)
+        ERR_print_errors_fp(stderr);
+    return ret;
+}
+
+/*
+ * Write each of |roots| to |dir| under its hashed name, as garbage if
+ * |garbage| is set.
+ */
+static int write_hashed_roots(const char *dir, STACK_OF(X509) *roots,
+                              int garbage)
+{
+    int i, ok;
+    char path[1024];
+    BIO *bio;
+
+    for (i = 0; i < sk_X509_num(roots); i++) {
+        X509 *x = sk_X509_value(roots, i);
+
+        BIO_snprintf(path, sizeof(path), "%s/%08lx.0", dir,
+                     X509_subject_name_hash(x));
+        if ((bio = BIO_new_file(path, "w")) == NULL)
+            return 0;
+        if (garbage)
+            ok = BIO_puts(bio, "garbage\n") > 0;
+        else
+            ok = PEM_write_bio_X509(bio, x);
+        BIO_free(bio);
+        if (!ok)
+            return 0;
+    }
+    return 1;
+}
+
+static X509_STORE *new_indexed_store(const char *dir, long interval)
+{
+    X509_STORE *store = X509_STORE_new();
+    X509_LOOKUP *lookup;
+
+    if (store == NULL)
+        return NULL;
+    lookup = X509_STORE_add_lookup(store, X509_LOOKUP_hash_dir());
+    if (lookup == NULL
+        || !X509_LOOKUP_add_dir(lookup, dir, X509_FILETYPE_PEM)
+        || !X509_LOOKUP_index_dirs(lookup, interval)) {
+        X509_STORE_free(store);
+        return NULL;
+    }
+    return store;
+}
+
+/*
+ * Check the indexed hashed directory lookup: with |dir| empty the leaf
+ * can't be verified, and once the roots have been written to it under
+ * their hashed names the change is noticed and it can.  A second store,
+ * which won't re-read the directory, first sees the roots' files while
+ * they are unreadable, to check that a failed load is retried.
+ */
+static int test_dir_index(const char *dir, const char *roots_f,
+                          const char *untrusted_f)
+{
+    int ret = 0;
+    STACK_OF(X509) *roots = NULL;
+    X509_STORE *store = NULL, *retry_store = NULL;
+
+    if ((store = new_indexed_store(dir, 0)) == NULL)
+        goto err;
+
+    if (verify_leaf(store, untrusted_f, 0))
+        goto err;
+    ERR_clear_error();
+
+    roots = load_certs_from_file(roots_f);
+    if (roots == NULL || !write_hashed_roots(dir, roots, 1))
+        goto err;
+
+    if ((retry_store = new_indexed_store(dir, 3600)) == NULL)
+        goto err;
+    if (verify_leaf(retry_store, untrusted_f, 0))
+        goto err;
+    ERR_clear_error();
+
+    if (!write_hashed_roots(dir, roots, 0))
+        goto err;
+
+    if (!verify_leaf(store, untrusted_f, 0)
+        || !verify_leaf(retry_store, untrusted_f, 0))
+        goto err;
+
+    ret = 1;
+ err:
+    sk_X509_pop_free(roots, X509_free);
+    X509_STORE_free(store);
+    X509_STORE_free(retry_store);
+    if (ret != 1)
+        ERR_print_errors_fp(stderr);
+    return ret;
+}
+
 int main(int argc, char **argv)
 {
     CRYPTO_malloc_debug_init();
@@ -194,8 +379,8 @@ int main(int argc, char **argv)
     ERR_load_crypto_strings();
     OpenSSL_add_all_digests();
 
-    if (argc != 4) {
-        fprintf(stderr, "usage: verify_extra_test roots.pem untrusted.pem bad.pem\n");
+    if (argc != 5) {
+        fprintf(stderr, "usage: verify_extra_test roots.pem untrusted.pem bad.pem emptydir\n");
         return 1;
     }
 
@@ -204,6 +389,16 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    if (!test_sigcache(argv[1], argv[2])) {
+        fprintf(stderr, "Test signature cache failed\n");
+        return 1;
+    }
+
+    if (!test_dir_index(argv[4], argv[1], argv[2])) {
+        fprintf(stderr, "Test indexed directory lookup failed\n");
+        return 1;
+    }
+
     EVP_cleanup();
     CRYPTO_cleanup_all_ex_data();
     ERR_remove_thread_state(NULL);
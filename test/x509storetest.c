@@ -0,0 +1,542 @@
+/* test/x509storetest.c */
+/*
+ * Tests and benchmarks the X509_STORE object indexes: loads a large set of
+ * CA certificates into a store and resolves issuers from several threads.
+ */
+/* ====================================================================
+ * Copyright (c) 2015 The OpenSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit. (http://www.openssl.org/)"
+ *
+ * 4. The names "OpenSSL Toolkit" and "OpenSSL Project" must not be used to
+ *    endorse or promote products derived from this software without
+ *    prior written permission. For written permission, please contact
+ *    openssl-core@openssl.org.
+ *
+ * 5. Products derived from this software may not be called "OpenSSL"
+ *    nor may "OpenSSL" appear in their names without prior written
+ *    permission of the OpenSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the OpenSSL Project
+ *    for use in the OpenSSL Toolkit (http://www.openssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE OpenSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE OpenSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ *
+ * This product includes cryptographic software written by Eric Young
+ * (eay@cryptsoft.com).  This product includes software written by Tim
+ * Hudson (tjh@cryptsoft.com).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#ifndef OPENSSL_NO_EC
+# include <openssl/ec.h>
+#else
+# include <openssl/rsa.h>
+#endif
+
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX)
+# define STORETEST_PTHREADS
+# include <pthread.h>
+# include <sys/time.h>
+#endif
+
+#define DEFAULT_NUM_CAS     1000
+#define DEFAULT_THREADS     4
+#define DEFAULT_LOOKUPS     20000
+#define MAX_THREADS         64
+
+/*
+ * Every ROLLOVER'th CA has a twin with the same subject name but another
+ * key identifier, as after a key rollover.  Leaves of those CAs name the
+ * twin in their authority key identifier, so the lookup has to use it to
+ * pick the right issuer.
+ */
+#define ROLLOVER            4
+
+static X509_STORE *store = NULL;
+static int num_certs = 0;
+/* Certificates whose issuers are looked up, and the expected issuers */
+static X509 **subjects = NULL;
+static X509 **issuers = NULL;
+static int lookups_per_thread = DEFAULT_LOOKUPS;
+/* Run full chain verifications instead of bare issuer lookups */
+static int verify = 0;
+
+static double now(void)
+{
+#ifdef STORETEST_PTHREADS
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+#else
+    return (double)time(NULL);
+#endif
+}
+
+static EVP_PKEY *make_key(void)
+{
+    EVP_PKEY *pkey = EVP_PKEY_new();
+#ifndef OPENSSL_NO_EC
+    EC_KEY *ec = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+
+    if (pkey == NULL || ec == NULL || !EC_KEY_generate_key(ec)
+        || !EVP_PKEY_assign_EC_KEY(pkey, ec)) {
+        EC_KEY_free(ec);
+        EVP_PKEY_free(pkey);
+        return NULL;
+    }
+#else
+    RSA *rsa = RSA_new();
+    BIGNUM *e = BN_new();
+
+    if (pkey == NULL || rsa == NULL || e == NULL || !BN_set_word(e, RSA_F4)
+        || !RSA_generate_key_ex(rsa, 1024, e, NULL)
+        || !EVP_PKEY_assign_RSA(pkey, rsa)) {
+        BN_free(e);
+        RSA_free(rsa);
+        EVP_PKEY_free(pkey);
+        return NULL;
+    }
+    BN_free(e);
+#endif
+    return pkey;
+}
+
+/* Derive a key identifier from |label| and |n| */
+static ASN1_OCTET_STRING *make_keyid(const char *label, int n)
+{
+    char buf[64];
+    unsigned char md[SHA_DIGEST_LENGTH];
+    ASN1_OCTET_STRING *keyid = ASN1_OCTET_STRING_new();
+
+    BIO_snprintf(buf, sizeof(buf), "%s%d", label, n);
+    SHA1((unsigned char *)buf, strlen(buf), md);
+    if (keyid == NULL || !ASN1_OCTET_STRING_set(keyid, md, sizeof(md))) {
+        ASN1_OCTET_STRING_free(keyid);
+        return NULL;
+    }
+    return keyid;
+}
+
+static X509_NAME *make_name(const char *prefix, int n)
+{
+    char cn[32];
+    X509_NAME *name = X509_NAME_new();
+
+    BIO_snprintf(cn, sizeof(cn), "%s %d", prefix, n);
+    if (name == NULL
+        || !X509_NAME_add_entry_by_txt(name, "O", MBSTRING_ASC,
+                                       (unsigned char *)"x509storetest", -1,
+                                       -1, 0)
+        || !X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                       (unsigned char *)cn, -1, -1, 0)) {
+        X509_NAME_free(name);
+        return NULL;
+    }
+    return name;
+}
+
+/*
+ * Make a certificate for "CA |n|", or for "leaf |n|" issued by "CA |n|" if
+ * |leaf| is set.  |skid| and |akid| are the key identifiers to include, if
+ * any.
+ */
+static X509 *make_cert(EVP_PKEY *pkey, long serial, int n, int leaf,
+                       ASN1_OCTET_STRING *skid, ASN1_OCTET_STRING *akid)
+{
+    X509 *x = X509_new();
+    X509_NAME *subject = NULL, *issuer = NULL;
+    AUTHORITY_KEYID *akeyid = NULL;
+    BASIC_CONSTRAINTS *bc = NULL;
+    int ok = 0;
+
+    if (x == NULL
+        || (subject = make_name(leaf ? "leaf" : "CA", n)) == NULL
+        || (issuer = make_name("CA", n)) == NULL)
+        goto end;
+    if (!X509_set_version(x, 2)
+        || !ASN1_INTEGER_set(X509_get_serialNumber(x), serial)
+        || X509_gmtime_adj(X509_get_notBefore(x), -3600) == NULL
+        || X509_gmtime_adj(X509_get_notAfter(x), 86400) == NULL
+        || !X509_set_subject_name(x, subject)
+        || !X509_set_issuer_name(x, issuer)
+        || !X509_set_pubkey(x, pkey))
+        goto end;
+
+    if (!leaf) {
+        if ((bc = BASIC_CONSTRAINTS_new()) == NULL)
+            goto end;
+        bc->ca = 1;
+        if (!X509_add1_ext_i2d(x, NID_basic_constraints, bc, 1, 0))
+            goto end;
+    }
+    if (skid != NULL
+        && !X509_add1_ext_i2d(x, NID_subject_key_identifier, skid, 0, 0))
+        goto end;
+    if (akid != NULL) {
+        if ((akeyid = AUTHORITY_KEYID_new()) == NULL
+            || (akeyid->keyid = ASN1_OCTET_STRING_dup(akid)) == NULL
+            || !X509_add1_ext_i2d(x, NID_authority_key_identifier, akeyid,
+                                  0, 0))
+            goto end;
+    }
+    if (!X509_sign(x, pkey, EVP_sha256()))
+        goto end;
+    ok = 1;
+ end:
+    BASIC_CONSTRAINTS_free(bc);
+    AUTHORITY_KEYID_free(akeyid);
+    X509_NAME_free(subject);
+    X509_NAME_free(issuer);
+    if (!ok) {
+        X509_free(x);
+        return NULL;
+    }
+    return x;
+}
+
+/*
+ * Generate |n| CAs (plus their rollover twins) and add them to the store,
+ * and one leaf issued by each CA to look up.
+ */
+static int make_store(int n)
+{
+    EVP_PKEY *pkey = NULL;
+    ASN1_OCTET_STRING *skid = NULL, *twin_skid = NULL;
+    X509 *ca = NULL, *twin = NULL;
+    STACK_OF(X509) *cas = NULL;
+    double start;
+    int i, ok = 0;
+
+    subjects = OPENSSL_zalloc(sizeof(*subjects) * n);
+    issuers = OPENSSL_zalloc(sizeof(*issuers) * n);
+    if (subjects == NULL || issuers == NULL
+        || (cas = sk_X509_new_null()) == NULL
+        || (pkey = make_key()) == NULL)
+        goto end;
+    num_certs = n;
+
+    for (i = 0; i < n; i++) {
+        if ((skid = make_keyid("ca", i)) == NULL
+            || (ca = make_cert(pkey, 2 * i, i, 0, skid, NULL)) == NULL
+            || !sk_X509_push(cas, ca))
+            goto end;
+        issuers[i] = ca;
+        ca = NULL;
+        if (i % ROLLOVER == 0) {
+            if ((twin_skid = make_keyid("rollover", i)) == NULL
+                || (twin = make_cert(pkey, 2 * i + 1, i, 0, twin_skid,
+                                     NULL)) == NULL
+                || !sk_X509_push(cas, twin))
+                goto end;
+            issuers[i] = twin;
+            twin = NULL;
+        }
+        X509_up_ref(issuers[i]);
+        if ((subjects[i] = make_cert(pkey, i, i, 1, NULL,
+                                     twin_skid != NULL ? twin_skid
+                                                       : skid)) == NULL)
+            goto end;
+        ASN1_OCTET_STRING_free(skid);
+        ASN1_OCTET_STRING_free(twin_skid);
+        skid = twin_skid = NULL;
+    }
+
+    start = now();
+    for (i = 0; i < sk_X509_num(cas); i++) {
+        if (!X509_STORE_add_cert(store, sk_X509_value(cas, i)))
+            goto end;
+    }
+    printf("Loaded %d certificates in %.3f seconds\n",
+           sk_X509_num(cas), now() - start);
+
+    /* Adding a certificate twice must fail */
+    if (X509_STORE_add_cert(store, sk_X509_value(cas, n / 2))) {
+        printf("Duplicate certificate accepted\n");
+        goto end;
+    }
+    ERR_clear_error();
+    ok = 1;
+ end:
+    ASN1_OCTET_STRING_free(skid);
+    ASN1_OCTET_STRING_free(twin_skid);
+    X509_free(ca);
+    X509_free(twin);
+    sk_X509_pop_free(cas, X509_free);
+    EVP_PKEY_free(pkey);
+    return ok;
+}
+
+/* Use the certificates in |file| as both the store and the subjects */
+static int load_store(const char *file)
+{
+    BIO *bio = BIO_new_file(file, "r");
+    STACK_OF(X509) *certs = sk_X509_new_null();
+    X509 *x;
+    double start;
+    int i, ok = 0;
+
+    if (bio == NULL || certs == NULL)
+        goto end;
+    while ((x = PEM_read_bio_X509(bio, NULL, NULL, NULL)) != NULL) {
+        if (!sk_X509_push(certs, x)) {
+            X509_free(x);
+            goto end;
+        }
+    }
+    ERR_clear_error();
+    if (sk_X509_num(certs) == 0)
+        goto end;
+    subjects = OPENSSL_zalloc(sizeof(*subjects) * sk_X509_num(certs));
+    if (subjects == NULL)
+        goto end;
+    num_certs = sk_X509_num(certs);
+
+    start = now();
+    for (i = 0; i < num_certs; i++) {
+        x = sk_X509_value(certs, i);
+        /* Bundles may contain duplicates */
+        X509_STORE_add_cert(store, x);
+        X509_up_ref(x);
+        subjects[i] = x;
+    }
+    ERR_clear_error();
+    printf("Loaded %d certificates in %.3f seconds\n",
+           num_certs, now() - start);
+    ok = 1;
+ end:
+    BIO_free(bio);
+    sk_X509_pop_free(certs, X509_free);
+    return ok;
+}
+
+/*
+ * Look up the issuers of a sequence of subjects, checking the result
+ * against the expected issuer if known, or verify the subjects if
+ * |verify| is set.  Returns |arg| on success.
+ */
+static void *worker(void *arg)
+{
+    X509_STORE_CTX *sctx = X509_STORE_CTX_new();
+    X509 *x, *issuer;
+    int i, n, ok = 1;
+
+    if (sctx == NULL)
+        return NULL;
+    n = *(int *)arg;
+    for (i = 0; i < lookups_per_thread && ok; i++, n += 7919) {
+        x = subjects[n % num_certs];
+        if (!X509_STORE_CTX_init(sctx, store, x, NULL)) {
+            ok = 0;
+            break;
+        }
+        if (verify) {
+            if (X509_verify_cert(sctx) != 1 && issuers != NULL)
+                ok = 0;
+        } else if (X509_STORE_CTX_get1_issuer(&issuer, sctx, x) != 1) {
+            /* Bundles may contain certificates whose issuer is absent */
+            if (issuers != NULL)
+                ok = 0;
+        } else {
+            if (issuers != NULL && X509_cmp(issuer, issuers[n % num_certs]))
+                ok = 0;
+            X509_free(issuer);
+        }
+        X509_STORE_CTX_cleanup(sctx);
+    }
+    X509_STORE_CTX_free(sctx);
+    ERR_remove_thread_state(NULL);
+    return ok ? arg : NULL;
+}
+
+static int run_lookups(int threads)
+{
+    int i, ok = 1;
+    int seeds[MAX_THREADS];
+    double start, secs;
+#ifdef STORETEST_PTHREADS
+    pthread_t tids[MAX_THREADS];
+    void *res;
+    int started = 0;
+#endif
+
+    start = now();
+#ifdef STORETEST_PTHREADS
+    for (i = 0; i < threads; i++) {
+        seeds[i] = i * (num_certs / threads + 1);
+        if (pthread_create(&tids[i], NULL, worker, &seeds[i]) != 0) {
+            ok = 0;
+            break;
+        }
+        started++;
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(tids[i], &res);
+        if (res == NULL)
+            ok = 0;
+    }
+#else
+    threads = 1;
+    seeds[0] = 0;
+    if (worker(&seeds[0]) == NULL)
+        ok = 0;
+#endif
+    secs = now() - start;
+    printf("%d %s in %d threads took %.3f seconds",
+           threads * lookups_per_thread,
+           verify ? "verifications" : "issuer lookups", threads, secs);
+    if (secs > 0)
+        printf(" (%.0f/s)", threads * lookups_per_thread / secs);
+    printf("\n");
+    if (!ok)
+        printf("%s failed\n", verify ? "Verification" : "Issuer lookup");
+    return ok;
+}
+
+/* Verify all the subjects with one X509_verify_cert_batch() call */
+static int run_batch(int threads)
+{
+    X509_STORE_CTX **ctxs = OPENSSL_zalloc(sizeof(*ctxs) * num_certs);
+    int *results = OPENSSL_malloc(sizeof(*results) * num_certs);
+    double start, secs;
+    int i, ret, ok = 0;
+
+    if (ctxs == NULL || results == NULL)
+        goto end;
+    for (i = 0; i < num_certs; i++) {
+        if ((ctxs[i] = X509_STORE_CTX_new()) == NULL
+            || !X509_STORE_CTX_init(ctxs[i], store, subjects[i], NULL))
+            goto end;
+    }
+
+    start = now();
+    ret = X509_verify_cert_batch(ctxs, results, num_certs, threads);
+    secs = now() - start;
+    printf("Batch of %d verifications in %d threads took %.3f seconds\n",
+           num_certs, threads, secs);
+    if (ret < 0)
+        goto end;
+    for (i = 0; i < num_certs; i++) {
+        /* The overall result must agree with the individual ones */
+        if (results[i] != 1 && ret == 1)
+            goto end;
+        if (results[i] != 1 && issuers != NULL) {
+            printf("Batch verification of certificate %d failed\n", i);
+            goto end;
+        }
+    }
+    ok = 1;
+ end:
+    if (ctxs != NULL) {
+        for (i = 0; i < num_certs; i++)
+            X509_STORE_CTX_free(ctxs[i]);
+    }
+    OPENSSL_free(ctxs);
+    OPENSSL_free(results);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int num_cas = DEFAULT_NUM_CAS, threads = DEFAULT_THREADS;
+    const char *bundle = NULL;
+    int i, ret = 1;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            num_cas = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-lookups") == 0 && i + 1 < argc)
+            lookups_per_thread = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-bundle") == 0 && i + 1 < argc)
+            bundle = argv[++i];
+        else if (strcmp(argv[i], "-verify") == 0)
+            verify = 1;
+        else
+            break;
+    }
+    if (i != argc || num_cas < 1 || threads < 1 || threads > MAX_THREADS
+        || lookups_per_thread < 1) {
+        fprintf(stderr, "usage: %s [-n cas] [-threads n] [-lookups n]"
+                " [-bundle file] [-verify]\n", argv[0]);
+        return 1;
+    }
+
+    OpenSSL_add_all_digests();
+    if ((store = X509_STORE_new()) == NULL)
+        goto end;
+    if (bundle != NULL ? !load_store(bundle) : !make_store(num_cas))
+        goto end;
+    /*
+     * With repeated signatures served from the cache, what is left of the
+     * verification cost is mostly the per-certificate bookkeeping, which is
+     * what the threads contend on.
+     */
+    if (verify && !X509_STORE_set_sigcache_size(store, 4 * num_certs))
+        goto end;
+    if (!run_lookups(threads))
+        goto end;
+    /* Without a store cache, the batch brings its own */
+    if (verify && (!X509_STORE_set_sigcache_size(store, 0)
+                   || !run_batch(threads)))
+        goto end;
+    ret = 0;
+ end:
+    for (i = 0; i < num_certs; i++) {
+        X509_free(subjects[i]);
+        if (issuers != NULL)
+            X509_free(issuers[i]);
+    }
+    OPENSSL_free(subjects);
+    OPENSSL_free(issuers);
+    X509_STORE_free(store);
+    EVP_cleanup();
+    ERR_print_errors_fp(stderr);
+    ERR_remove_thread_state(NULL);
+    if (ret == 0)
+        printf("PASS\n");
+    return ret;
+}
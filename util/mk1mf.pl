@@ -65,6 +65,7 @@ my %mf_import = (
 	WP_ASM_OBJ     => \$mf_wp_asm,
 	CMLL_ENC       => \$mf_cm_asm,
 	MODES_ASM_OBJ  => \$mf_modes_asm,
+	CHACHA_ASM_OBJ => \$mf_chacha_asm,
         ENGINES_ASM_OBJ=> \$mf_engines_asm,
 	PERLASM_SCHEME => \$mf_perlasm_scheme,
 	FIPSCANISTERONLY  => \$mf_fipscanisteronly,
@@ -876,6 +877,7 @@ if ($orig_platform eq 'copy') {
 	$lib_obj{CRYPTO} .= fix_asm($mf_engines_asm, 'engines');
 	$lib_obj{CRYPTO} .= fix_asm($mf_rc4_asm, 'crypto/rc4');
 	$lib_obj{CRYPTO} .= fix_asm($mf_modes_asm, 'crypto/modes');
+	$lib_obj{CRYPTO} .= fix_asm($mf_chacha_asm, 'crypto/chacha');
 	$lib_obj{CRYPTO} .= fix_asm($mf_ec_asm, 'crypto/ec');
 }
 